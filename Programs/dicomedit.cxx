@@ -0,0 +1,847 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "vtkDICOMConfig.h"
+#include "vtkDICOMMetaData.h"
+#include "vtkDICOMItem.h"
+#include "vtkDICOMSequence.h"
+#include "vtkDICOMDataElement.h"
+#include "vtkDICOMParser.h"
+#include "vtkDICOMCompiler.h"
+#include "vtkDICOMFile.h"
+#include "vtkDICOMFilePath.h"
+#include "vtkDICOMFileDirectory.h"
+
+// from dicomcli
+#include "vtkConsoleOutputWindow.h"
+#include "mainmacro.h"
+#include "readquery.h"
+#include "progress.h"
+
+#include "vtkErrorCode.h"
+#include "vtkSmartPointer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// A table for remapping UIDs
+typedef std::map<std::string, std::string> dicomedit_uidmap;
+
+// A file to be rewritten
+struct dicomedit_job
+{
+  std::string source;
+  std::string output;
+};
+
+// Simple structure for command-line options
+struct dicomedit_options
+{
+  vtkDICOMItem edits;
+  QueryTagList edit_tags;
+  QueryTagList removals;
+  dicomedit_uidmap uids;
+  bool remove_private;
+  bool follow_symlinks;
+  int threads;
+  bool silent;
+  bool verbose;
+  const char *output;
+};
+
+// The results of rewriting the files
+struct dicomedit_counts
+{
+  std::atomic<int> files;
+  std::atomic<int> failed;
+  std::atomic<long long> bytes;
+};
+
+// print the version
+void dicomedit_version(FILE *file, const char *cp)
+{
+  fprintf(file, "%s %s\n", cp, DICOM_VERSION);
+  fprintf(file, "\n"
+    "Copyright (c) 2012-2024, David Gobbi.\n\n"
+    "This software is distributed under an open-source license.  See the\n"
+    "Copyright.txt file that comes with the vtk-dicom source distribution.\n");
+}
+
+// print the usage
+void dicomedit_usage(FILE *file, const char *cp)
+{
+  fprintf(file, "usage:\n"
+    "  %s [options] -o <directory> <file or directory> ...\n\n", cp);
+  fprintf(file, "options:\n"
+    "  -k tag=value      Set an attribute to the given value.\n"
+    "  -q <edits.txt>    Provide a file that lists attributes to set.\n"
+    "  -r tag            Remove an attribute.\n"
+    "  -R <remove.txt>   Provide a file that lists attributes to remove.\n"
+    "  -u <uidmap.txt>   Provide a file for remapping UIDs.\n"
+    "  -o <directory>    Directory to place the files into.\n"
+    "  -j n              The number of files to rewrite in parallel.\n"
+    "  -L                Follow symbolic links (default).\n"
+    "  -P                Do not follow symbolic links.\n"
+    "  --remove-private  Remove all private attributes.\n"
+    "  --silent          Do not report any progress information.\n"
+    "  --verbose         Verbose error reporting.\n"
+    "  --help            Print a brief help message.\n"
+    "  --version         Print the software version.\n"
+    );
+}
+
+// print the help
+void dicomedit_help(FILE *file, const char *cp)
+{
+  dicomedit_usage(file, cp);
+  fprintf(file, "\n"
+    "Rewrite dicom files with modified attributes, e.g. for anonymization.\n"
+    "\n"
+    "Only the meta data is rewritten, the pixel data is copied from the\n"
+    "original files without being decoded, so this is much faster than a\n"
+    "full conversion.  Directories are searched recursively, and the\n"
+    "directory structure is reproduced within the output directory.\n"
+    "\n"
+    "Attributes are set with \"-k key=value\" where keys can either use the\n"
+    "standard names given in the DICOM dictionary, e.g. PatientName, or can\n"
+    "be in the form GGGG,EEEE with hexadecimal group and element values.\n"
+    "Use \"-k key=\" to set an attribute to an empty value.  Attributes can\n"
+    "also be listed in a file with the \"-q\" option (one per line).  The\n"
+    "attributes to remove are given in the same way with \"-r\" and \"-R\".\n"
+    "Only top-level attributes can be set or removed, not attributes that\n"
+    "are within sequences.  The file meta information (group 0002) cannot\n"
+    "be modified, since the pixel data keeps its transfer syntax.\n"
+    "\n"
+    "The \"-u\" option provides a table for remapping UIDs.  Each line of\n"
+    "the file must contain an existing UID followed by its replacement,\n"
+    "separated by a space or a comma.  All occurrences of the UIDs are\n"
+    "replaced, including those within sequences.\n"
+    "\n"
+    "Files with the Deflate transfer syntax cannot be rewritten.  After the\n"
+    "files are written, the throughput is reported in files per second and\n"
+    "in megabytes per second.\n"
+    "\n"
+  );
+}
+
+// remove path portion of filename
+const char *dicomedit_basename(const char *filename)
+{
+  const char *cp = filename + strlen(filename);
+  while (cp != filename && cp[-1] != '\\' && cp[-1] != '/') { --cp; }
+  return cp;
+}
+
+// read a tag and check that it is at the top level of the data set
+bool dicomedit_readkey(
+  const char *arg, vtkDICOMItem *item, QueryTagList *ql, bool qfile)
+{
+  size_t n = ql->size();
+  if (qfile)
+  {
+    if (!dicomcli_readquery(arg, item, ql))
+    {
+      fprintf(stderr, "Error: Can't read file %s\n\n", arg);
+      return false;
+    }
+  }
+  else if (!dicomcli_readkey(arg, item, ql))
+  {
+    return false;
+  }
+
+  for (size_t i = n; i < ql->size(); i++)
+  {
+    if ((*ql)[i].HasTail())
+    {
+      fprintf(stderr, "Error: Attributes within sequences cannot be "
+                      "modified: %s\n\n", arg);
+      return false;
+    }
+    // the pixel data is copied raw, so its transfer syntax must be kept
+    if ((*ql)[i].GetHead().GetGroup() == 0x0002)
+    {
+      fprintf(stderr, "Error: The file meta information (group 0002) "
+                      "cannot be modified: %s\n\n", arg);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// read a table of UIDs, one pair per line
+bool dicomedit_readuidmap(const char *fname, dicomedit_uidmap *uids)
+{
+  FILE *fp = fopen(fname, "rb");
+  if (!fp)
+  {
+    fprintf(stderr, "Error: Can't open file: %s\n\n", fname);
+    return false;
+  }
+
+  bool rval = true;
+  int lineno = 0;
+  char line[256];
+  while (rval && fgets(line, sizeof(line), fp))
+  {
+    lineno++;
+
+    // split the line into two UIDs
+    std::string uid[2];
+    const char *cp = line;
+    int k = 0;
+    while (k < 3)
+    {
+      while (*cp == ',' || isspace(static_cast<unsigned char>(*cp)))
+      {
+        cp++;
+      }
+      if (*cp == '\0' || *cp == '#')
+      {
+        break;
+      }
+      const char *ep = cp;
+      while (*ep == '.' || isdigit(static_cast<unsigned char>(*ep)))
+      {
+        ep++;
+      }
+      if (k == 2 || ep == cp || ep - cp > 64 || (*ep != '\0' &&
+          *ep != ',' && !isspace(static_cast<unsigned char>(*ep))))
+      {
+        k = 3;
+        break;
+      }
+      uid[k++].assign(cp, ep - cp);
+      cp = ep;
+    }
+
+    if (k == 2)
+    {
+      (*uids)[uid[0]] = uid[1];
+    }
+    else if (k != 0)
+    {
+      fprintf(stderr, "Error: Bad UID pair on line %d of %s\n\n",
+              lineno, fname);
+      rval = false;
+    }
+  }
+
+  fclose(fp);
+  return rval;
+}
+
+// find all the files to rewrite, and the directories to create
+bool dicomedit_findfiles(
+  const dicomedit_options *options, const std::string& source,
+  const std::string& output, int depth,
+  std::vector<dicomedit_job> *jobs, std::set<std::string> *dirs)
+{
+  int code = vtkDICOMFile::Access(source.c_str(), vtkDICOMFile::In);
+  if (code == vtkDICOMFile::Good)
+  {
+    dicomedit_job job;
+    job.source = source;
+    job.output = output;
+    jobs->push_back(job);
+    return true;
+  }
+  else if (code != vtkDICOMFile::FileIsDirectory)
+  {
+    fprintf(stderr, "Error: File not found: %s\n\n", source.c_str());
+    return false;
+  }
+
+  // guard against runaway recursion, e.g. from a symlink cycle
+  if (depth > 64)
+  {
+    fprintf(stderr, "Error: Directories nested too deeply: %s\n\n",
+            source.c_str());
+    return false;
+  }
+
+  vtkDICOMFileDirectory d(source.c_str());
+  if (d.GetError())
+  {
+    fprintf(stderr, "Error: Can't read directory: %s\n\n", source.c_str());
+    return false;
+  }
+
+  dirs->insert(output);
+
+  bool rval = true;
+  vtkDICOMFilePath spath(source);
+  vtkDICOMFilePath opath(output);
+  int n = d.GetNumberOfEntries();
+  for (int i = 0; i < n; i++)
+  {
+    const char *entry = d.GetEntry(i);
+    if (d.IsHidden(i) || d.IsSpecial(i) || d.IsBroken(i) ||
+        (d.IsSymlink(i) && !options->follow_symlinks) ||
+        strcmp(entry, ".") == 0 || strcmp(entry, "..") == 0)
+    {
+      continue;
+    }
+    rval &= dicomedit_findfiles(
+      options, spath.Join(entry), opath.Join(entry), depth + 1, jobs, dirs);
+  }
+
+  return rval;
+}
+
+// replace the UIDs in a value, return true if any were replaced
+bool dicomedit_remapuids(
+  const dicomedit_uidmap& uids, const vtkDICOMValue& v,
+  vtkDICOMValue *newv)
+{
+  bool changed = false;
+  size_t n = v.GetNumberOfValues();
+
+  if (v.GetVR() == vtkDICOMVR::UI)
+  {
+    std::string s;
+    for (size_t i = 0; i < n; i++)
+    {
+      std::string uid = v.GetString(i);
+      dicomedit_uidmap::const_iterator u = uids.find(uid);
+      if (u != uids.end())
+      {
+        uid = u->second;
+        changed = true;
+      }
+      if (i > 0)
+      {
+        s.push_back('\\');
+      }
+      s += uid;
+    }
+    if (changed)
+    {
+      *newv = vtkDICOMValue(vtkDICOMVR::UI, s);
+    }
+  }
+  else if (v.GetVR() == vtkDICOMVR::SQ)
+  {
+    const vtkDICOMItem *items = v.GetSequenceData();
+    vtkDICOMSequence seq(static_cast<unsigned int>(n));
+    for (size_t i = 0; i < n; i++)
+    {
+      // the item is copy-on-write, so the original is not modified
+      vtkDICOMItem item = items[i];
+      vtkDICOMDataElementIterator iter = items[i].Begin();
+      vtkDICOMDataElementIterator iterEnd = items[i].End();
+      for (; iter != iterEnd; ++iter)
+      {
+        vtkDICOMValue u;
+        if (dicomedit_remapuids(uids, iter->GetValue(), &u))
+        {
+          item.Set(iter->GetTag(), u);
+          changed = true;
+        }
+      }
+      seq.SetItem(i, item);
+    }
+    if (changed)
+    {
+      *newv = seq;
+    }
+  }
+
+  return changed;
+}
+
+// apply all of the requested modifications to the meta data
+void dicomedit_apply(const dicomedit_options *options, vtkDICOMMetaData *meta)
+{
+  // remove attributes
+  std::vector<vtkDICOMTag> erase;
+  for (size_t i = 0; i < options->removals.size(); i++)
+  {
+    erase.push_back(options->removals[i].GetHead());
+  }
+  vtkDICOMDataElementIterator iter;
+  if (options->remove_private)
+  {
+    for (iter = meta->Begin(); iter != meta->End(); ++iter)
+    {
+      if ((iter->GetTag().GetGroup() & 1) != 0)
+      {
+        erase.push_back(iter->GetTag());
+      }
+    }
+  }
+  for (size_t i = 0; i < erase.size(); i++)
+  {
+    meta->Erase(erase[i]);
+  }
+
+  // remap the UIDs
+  if (!options->uids.empty())
+  {
+    std::vector<std::pair<vtkDICOMTag, vtkDICOMValue> > changes;
+    for (iter = meta->Begin(); iter != meta->End(); ++iter)
+    {
+      // the compiler writes a new meta header, keep the old one intact
+      vtkDICOMValue v;
+      if (iter->GetTag().GetGroup() != 0x0002 &&
+          dicomedit_remapuids(options->uids, iter->GetValue(), &v))
+      {
+        changes.push_back(std::make_pair(iter->GetTag(), v));
+      }
+    }
+    for (size_t i = 0; i < changes.size(); i++)
+    {
+      meta->Set(changes[i].first, changes[i].second);
+    }
+  }
+
+  // set new values, after converting text to the file's character set
+  vtkDICOMCharacterSet cs(meta->Get(DC::SpecificCharacterSet).AsString());
+  vtkDICOMDataElementIterator editsEnd = options->edits.End();
+  for (iter = options->edits.Begin(); iter != editsEnd; ++iter)
+  {
+    const vtkDICOMValue& v = iter->GetValue();
+    if (v.GetVR().HasSpecificCharacterSet() && v.GetVL() > 0)
+    {
+      meta->Set(iter->GetTag(),
+        vtkDICOMValue::FromUTF8String(v.GetVR(), cs, v.AsUTF8String()));
+    }
+    else
+    {
+      meta->Set(iter->GetTag(), v);
+    }
+  }
+}
+
+// print an error for the parser or the compiler
+void dicomedit_error(unsigned long errorcode, const char *filename)
+{
+  switch (errorcode)
+  {
+    case vtkErrorCode::FileNotFoundError:
+      fprintf(stderr, "Error: File not found: %s\n", filename);
+      break;
+    case vtkErrorCode::CannotOpenFileError:
+      fprintf(stderr, "Error: Cannot open file: %s\n", filename);
+      break;
+    case vtkErrorCode::UnrecognizedFileTypeError:
+      fprintf(stderr, "Error: Not a DICOM file: %s\n", filename);
+      break;
+    case vtkErrorCode::PrematureEndOfFileError:
+      fprintf(stderr, "Error: File is truncated: %s\n", filename);
+      break;
+    case vtkErrorCode::FileFormatError:
+      fprintf(stderr, "Error: Bad DICOM file: %s\n", filename);
+      break;
+    case vtkErrorCode::OutOfDiskSpaceError:
+      fprintf(stderr, "Error: Out of disk space while writing file: %s\n",
+              filename);
+      break;
+    default:
+      fprintf(stderr, "Error: Cannot rewrite file: %s\n", filename);
+      break;
+  }
+}
+
+// rewrite one file, return the number of bytes or -1 on failure
+long long dicomedit_rewrite(
+  const dicomedit_options *options, const dicomedit_job& job,
+  vtkDICOMParser *parser, vtkDICOMCompiler *compiler,
+  vtkDICOMMetaData *meta)
+{
+  const char *srcname = job.source.c_str();
+  const char *outname = job.output.c_str();
+
+  if (vtkDICOMFile::SameFile(srcname, outname))
+  {
+    fprintf(stderr, "Error: Output would overwrite input: %s\n", srcname);
+    return -1;
+  }
+
+  // read the meta data, stopping at the pixel data
+  meta->Initialize();
+  parser->SetFileName(srcname);
+  parser->Update();
+  if (parser->GetErrorCode() != vtkErrorCode::NoError)
+  {
+    dicomedit_error(parser->GetErrorCode(), srcname);
+    return -1;
+  }
+
+  // copy the syntax, since the edits might modify the meta data
+  std::string tsyntax = meta->Get(DC::TransferSyntaxUID).AsString();
+  if (tsyntax == "1.2.840.10008.1.2.1.99")
+  {
+    fprintf(stderr, "Error: Deflated files cannot be rewritten: %s\n",
+            srcname);
+    return -1;
+  }
+
+  dicomedit_apply(options, meta);
+
+  // keep the UIDs, rather than letting the compiler generate new ones
+  const char *instanceUID = meta->Get(DC::SOPInstanceUID).GetCharData();
+  if (instanceUID == nullptr)
+  {
+    instanceUID = meta->Get(DC::MediaStorageSOPInstanceUID).GetCharData();
+  }
+  compiler->SetSOPInstanceUID(instanceUID);
+  compiler->SetSeriesInstanceUID(
+    meta->Get(DC::SeriesInstanceUID).GetCharData());
+  compiler->SetStudyInstanceUID(
+    meta->Get(DC::StudyInstanceUID).GetCharData());
+  compiler->SetSourceApplicationEntityTitle(
+    meta->Get(DC::SourceApplicationEntityTitle).GetCharData());
+  // the pixel data is copied raw, so it must keep its transfer syntax
+  compiler->SetTransferSyntaxUID(
+    tsyntax.empty() ? nullptr : tsyntax.c_str());
+
+  // copy the pixel data straight from the source file
+  if (parser->GetPixelDataFound())
+  {
+    compiler->SetPixelDataSource(
+      srcname, parser->GetFileOffset(), parser->GetPixelDataVL());
+  }
+  else
+  {
+    compiler->SetPixelDataSource(nullptr, 0, 0);
+  }
+
+  compiler->SetFileName(outname);
+  compiler->WriteHeader();
+  compiler->Close();
+  if (compiler->GetErrorCode() != vtkErrorCode::NoError)
+  {
+    dicomedit_error(compiler->GetErrorCode(), outname);
+    return -1;
+  }
+
+  return parser->GetFileSize();
+}
+
+// rewrite files until there are no more files left
+void dicomedit_worker(
+  const dicomedit_options *options, const std::vector<dicomedit_job> *jobs,
+  std::atomic<size_t> *next, dicomedit_counts *counts,
+  ProgressObserver *p)
+{
+  vtkSmartPointer<vtkDICOMMetaData> meta =
+    vtkSmartPointer<vtkDICOMMetaData>::New();
+  vtkSmartPointer<vtkDICOMParser> parser =
+    vtkSmartPointer<vtkDICOMParser>::New();
+  parser->SetMetaData(meta);
+  vtkSmartPointer<vtkDICOMCompiler> compiler =
+    vtkSmartPointer<vtkDICOMCompiler>::New();
+  compiler->SetMetaData(meta);
+  compiler->SetBufferSize(65536);
+
+  size_t total = jobs->size();
+  size_t i;
+  while ((i = (*next)++) < total)
+  {
+    long long n = dicomedit_rewrite(
+      options, (*jobs)[i], parser, compiler, meta);
+    if (n >= 0)
+    {
+      counts->files++;
+      counts->bytes += n;
+    }
+    else
+    {
+      counts->failed++;
+    }
+
+    // only one thread reports the progress
+    if (p)
+    {
+      double progress = (static_cast<double>(counts->files + counts->failed)/
+                         static_cast<double>(total));
+      p->Execute(nullptr, vtkCommand::ProgressEvent, &progress);
+    }
+  }
+}
+
+// This program will rewrite the meta data of DICOM files
+int MAINMACRO(int argc, char *argv[])
+{
+  // redirect all VTK errors to stderr
+  vtkConsoleOutputWindow::Install();
+
+  dicomedit_options options;
+  options.remove_private = false;
+  options.follow_symlinks = true;
+  options.threads = 0;
+  options.silent = false;
+  options.verbose = false;
+  options.output = nullptr;
+
+  std::vector<std::string> inputs;
+
+  if (argc < 2)
+  {
+    dicomedit_usage(stdout, dicomedit_basename(argv[0]));
+    return 0;
+  }
+  else if (argc == 2 && strcmp(argv[1], "--help") == 0)
+  {
+    dicomedit_help(stdout, dicomedit_basename(argv[0]));
+    return 0;
+  }
+  else if (argc == 2 && strcmp(argv[1], "--version") == 0)
+  {
+    dicomedit_version(stdout, dicomedit_basename(argv[0]));
+    return 0;
+  }
+
+  vtkDICOMItem removeItem;
+  for (int argi = 1; argi < argc; argi++)
+  {
+    const char *arg = argv[argi];
+    if (strcmp(arg, "-P") == 0)
+    {
+      options.follow_symlinks = false;
+    }
+    else if (strcmp(arg, "-L") == 0)
+    {
+      options.follow_symlinks = true;
+    }
+    else if (strcmp(arg, "-k") == 0 || strcmp(arg, "-r") == 0)
+    {
+      ++argi;
+      if (argi == argc)
+      {
+        fprintf(stderr, "Error: %s must be followed by gggg,eeee%s "
+                        "where gggg,eeee is a DICOM tag.\n\n", arg,
+                        (arg[1] == 'k' ? "=value" : ""));
+        return 1;
+      }
+      bool r = (arg[1] == 'k' ?
+        dicomedit_readkey(argv[argi], &options.edits,
+                          &options.edit_tags, false) :
+        dicomedit_readkey(argv[argi], &removeItem,
+                          &options.removals, false));
+      if (!r)
+      {
+        return 1;
+      }
+    }
+    else if (strcmp(arg, "-q") == 0 || strcmp(arg, "-R") == 0 ||
+             strcmp(arg, "-u") == 0)
+    {
+      if (argi + 1 == argc || argv[argi+1][0] == '-')
+      {
+        fprintf(stderr, "Error: %s must be followed by a file.\n\n", arg);
+        dicomedit_usage(stderr, dicomedit_basename(argv[0]));
+        return 1;
+      }
+      const char *qfile = argv[++argi];
+      bool r = true;
+      if (arg[1] == 'q')
+      {
+        r = dicomedit_readkey(qfile, &options.edits,
+                              &options.edit_tags, true);
+      }
+      else if (arg[1] == 'R')
+      {
+        r = dicomedit_readkey(qfile, &removeItem, &options.removals, true);
+      }
+      else
+      {
+        r = dicomedit_readuidmap(qfile, &options.uids);
+      }
+      if (!r)
+      {
+        return 1;
+      }
+    }
+    else if (strcmp(arg, "-o") == 0)
+    {
+      ++argi;
+      if (argi == argc || argv[argi][0] == '-')
+      {
+        fprintf(stderr, "Error: %s must be followed by output directory.\n\n",
+                arg);
+        return 1;
+      }
+      options.output = argv[argi];
+    }
+    else if (strcmp(arg, "-j") == 0)
+    {
+      ++argi;
+      if (argi == argc || !isdigit(argv[argi][0]))
+      {
+        fprintf(stderr, "Error: %s must be followed by a number.\n\n", arg);
+        return 1;
+      }
+      options.threads = static_cast<int>(atol(argv[argi]));
+    }
+    else if (strcmp(arg, "--remove-private") == 0)
+    {
+      options.remove_private = true;
+    }
+    else if (strcmp(arg, "--silent") == 0)
+    {
+      options.silent = true;
+    }
+    else if (strcmp(arg, "--verbose") == 0)
+    {
+      options.verbose = true;
+    }
+    else if (arg[0] == '-')
+    {
+      fprintf(stderr, "Error: Unrecognized option %s.\n\n", arg);
+      dicomedit_usage(stderr, dicomedit_basename(argv[0]));
+      return 1;
+    }
+    else if (dicomcli_looks_like_key(arg) &&
+             vtkDICOMFile::Access(arg, vtkDICOMFile::In) ==
+             vtkDICOMFile::FileNotFound)
+    {
+      fprintf(stderr, "Error: Missing -k before %s.\n\n", arg);
+      return 1;
+    }
+    else
+    {
+      inputs.push_back(arg);
+    }
+  }
+
+  // whether to silence VTK warnings and errors
+  vtkObject::SetGlobalWarningDisplay(options.verbose);
+
+  // output directory is mandatory
+  if (options.output == nullptr)
+  {
+    fprintf(stderr,
+      "\nError: No output directory was specified (-o <directory>).\n\n");
+    return 1;
+  }
+
+  if (inputs.empty())
+  {
+    fprintf(stderr, "Error: No input files were specified.\n\n");
+    return 1;
+  }
+
+  // build the list of files, mirroring directories within the output
+  std::vector<dicomedit_job> jobs;
+  std::set<std::string> dirs;
+  dirs.insert(options.output);
+  vtkDICOMFilePath outpath(options.output);
+  for (size_t i = 0; i < inputs.size(); i++)
+  {
+    const char *arg = inputs[i].c_str();
+    std::string output = options.output;
+    if (vtkDICOMFile::Access(arg, vtkDICOMFile::In) == vtkDICOMFile::Good)
+    {
+      output = outpath.Join(dicomedit_basename(arg));
+    }
+    if (!dicomedit_findfiles(&options, inputs[i], output, 0, &jobs, &dirs))
+    {
+      return 1;
+    }
+  }
+
+  // create the output directories before the threads start
+  std::set<std::string>::iterator di;
+  for (di = dirs.begin(); di != dirs.end(); ++di)
+  {
+    int code = vtkDICOMFileDirectory::Create(di->c_str());
+    if (code != vtkDICOMFileDirectory::Good)
+    {
+      fprintf(stderr, "Error: Cannot create directory: %s\n\n", di->c_str());
+      return 1;
+    }
+  }
+
+  int threads = options.threads;
+  if (threads <= 0)
+  {
+    threads = static_cast<int>(std::thread::hardware_concurrency());
+  }
+  if (threads > static_cast<int>(jobs.size()))
+  {
+    threads = static_cast<int>(jobs.size());
+  }
+  if (threads < 1)
+  {
+    threads = 1;
+  }
+
+  vtkSmartPointer<ProgressObserver> p =
+    vtkSmartPointer<ProgressObserver>::New();
+  if (!options.silent)
+  {
+    p->SetText("Rewriting");
+    p->Execute(nullptr, vtkCommand::StartEvent, nullptr);
+  }
+
+  dicomedit_counts counts;
+  counts.files = 0;
+  counts.failed = 0;
+  counts.bytes = 0;
+  std::atomic<size_t> next(0);
+
+  std::chrono::steady_clock::time_point startTime =
+    std::chrono::steady_clock::now();
+
+  // the main thread is also a worker, and it reports the progress
+  std::vector<std::thread> workers;
+  for (int t = 1; t < threads; t++)
+  {
+    workers.push_back(std::thread(dicomedit_worker,
+      &options, &jobs, &next, &counts,
+      static_cast<ProgressObserver *>(nullptr)));
+  }
+  dicomedit_worker(&options, &jobs, &next, &counts,
+                   (options.silent ? nullptr : p.GetPointer()));
+  for (size_t t = 0; t < workers.size(); t++)
+  {
+    workers[t].join();
+  }
+
+  double seconds = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - startTime).count();
+
+  if (!options.silent)
+  {
+    p->Execute(nullptr, vtkCommand::EndEvent, nullptr);
+
+    int files = counts.files;
+    double mb = static_cast<double>(counts.bytes)/1048576.0;
+    double s = (seconds > 1e-6 ? seconds : 1e-6);
+    fprintf(stdout, "Rewrote %d files (%.1f MB) in %.2f s with %d threads: "
+            "%.1f files/s, %.1f MB/s\n", files, mb, seconds, threads,
+            files/s, mb/s);
+    if (counts.failed > 0)
+    {
+      fprintf(stdout, "Failed to rewrite %d files\n",
+              static_cast<int>(counts.failed));
+    }
+  }
+
+  return (counts.failed == 0 ? 0 : 1);
+}
@@ -29,6 +29,7 @@
 
 #include "vtkVersion.h"
 #include "vtkImageData.h"
+#include "vtkInformation.h"
 #include "vtkMatrix4x4.h"
 #include "vtkImageReslice.h"
 #include "vtkImageCast.h"
@@ -68,6 +69,7 @@ struct dicomtonifti_options
   bool no_qform;
   bool no_sform;
   bool batch;
+  bool stream;
   bool silent;
   bool verbose;
   bool version;
@@ -116,6 +118,7 @@ void dicomtonifti_usage(FILE *file, const char *command_name)
     "  -s --silent             Do not echo output filenames.\n"
     "  -v --verbose            Verbose error reporting.\n"
     "  -L --follow-symlinks    Follow symbolic links when recursing.\n"
+    "  --stream                Stream the slices to reduce memory use.\n"
     "  --descrip <text>        Set the NIFTI descrip field to <text>.\n"
     "  --fsl                   Format axial image for use in FSL.\n"
     "  --reformat-to-axial     Reformat the image into axial orientation.\n"
@@ -184,6 +187,16 @@ void dicomtonifti_help(FILE *file, const char *command_name)
     "The --time-delta option will force the temporal spacing to be a specific\n"
     "value, e.g. 500ms, 2s, or 2600us.\n"
     "\n");
+  fprintf(file,
+    "The --stream option reduces memory usage for very large series by\n"
+    "reading and writing just a few slices at a time, rather than reading\n"
+    "the whole series into memory before writing.  Streaming is only done\n"
+    "for series that are stored one slice per file, and it is not done if\n"
+    "the slice direction would be changed by --reformat-to-axial or if the\n"
+    "series is from a CT with a tilted gantry.  When streaming, cal_min and\n"
+    "cal_max are set only if the DICOM window/level is the same for every\n"
+    "slice, since the whole image is never in memory at once.\n"
+    "\n");
   fprintf(file,
     "If batch mode is selected, the output file given with \"-o\" can be\n"
     "constructed from DICOM attributes, by providing the attribute names\n"
@@ -332,6 +345,7 @@ void dicomtonifti_read_options(
   options->no_qform = false;
   options->no_sform = false;
   options->batch = false;
+  options->stream = false;
   options->silent = false;
   options->verbose = false;
   options->version = false;
@@ -448,6 +462,10 @@ void dicomtonifti_read_options(
       {
         options->batch = true;
       }
+      else if (strcmp(arg, "--stream") == 0)
+      {
+        options->stream = true;
+      }
       else if (strcmp(arg, "--silent") == 0)
       {
         options->silent = true;
@@ -712,11 +730,24 @@ bool dicomtonifti_convert_one(
     }
     reader->GetSorter()->SetTimeTag(tag);
   }
-  reader->Update();
+
+  // when streaming, the pixel data is read when the file is written
+  bool streaming = options->stream;
+  if (streaming)
+  {
+    reader->UpdateInformation();
+    // the reader can only stream if each file has one slice
+    streaming = (reader->GetFileDimensionality() == 2);
+  }
+  if (!streaming)
+  {
+    reader->Update();
+  }
   if (dicomtonifti_check_error(reader))
   {
     return false;
   }
+  vtkInformation *readerInfo = reader->GetOutputInformation(0);
 
   // get the output and the orientation matrix
   vtkAlgorithmOutput *lastOutput = reader->GetOutputPort();
@@ -728,15 +759,18 @@ bool dicomtonifti_convert_one(
   extract->SetInputConnection(lastOutput);
   if (options->volume >= 0)
   {
-    if (reader->GetOutput()->GetNumberOfScalarComponents() <= options->volume)
+    int numComponents = vtkImageData::GetNumberOfScalarComponents(readerInfo);
+    if (numComponents <= options->volume)
     {
       fprintf(stderr, "Only %d volumes, but --volume %d used.\n",
-              reader->GetOutput()->GetNumberOfScalarComponents(),
-              options->volume);
+              numComponents, options->volume);
       return false;
     }
     extract->SetComponents(options->volume);
-    extract->Update();
+    if (!streaming)
+    {
+      extract->Update();
+    }
     lastOutput = extract->GetOutputPort();
   }
 
@@ -756,6 +790,7 @@ bool dicomtonifti_convert_one(
   if (fabs(vtkDICOMCTRectifier::GetGantryDetectorTilt(patientMatrix)) > 1e-2)
   {
     // tilt is significant, so regrid as a rectangular volume
+    streaming = false;
     rectifier->SetInputConnection(lastOutput);
     rectifier->SetVolumeMatrix(patientMatrix);
     rectifier->Update();
@@ -867,6 +902,9 @@ bool dicomtonifti_convert_one(
 
       vtkMatrix4x4::Multiply4x4(*axes->Element, fslmat, *axes->Element);
     }
+    // stream only if the slice axis is not changed by reformatting
+    streaming = (streaming && permutation[2] == 2);
+
     // reformat with the permutated axes
     reformat->SetResliceAxes(axes);
     reformat->SetInputConnection(lastOutput);
@@ -876,8 +914,18 @@ bool dicomtonifti_convert_one(
     vtkMatrix4x4::Multiply4x4(matrix, axes, matrix);
   }
 
+  // if streaming is not possible after all, then read the whole image
+  if (options->stream && !streaming)
+  {
+    reader->Update();
+    if (dicomtonifti_check_error(reader))
+    {
+      return false;
+    }
+  }
+
   // convert to signed short if fsl
-  int scalarType = reader->GetOutput()->GetScalarType();
+  int scalarType = vtkImageData::GetScalarType(readerInfo);
   vtkSmartPointer<vtkImageCast> caster =
     vtkSmartPointer<vtkImageCast>::New();
   if (options->fsl && scalarType != VTK_UNSIGNED_CHAR &&
@@ -890,7 +938,15 @@ bool dicomtonifti_convert_one(
         scalarType == VTK_SIGNED_CHAR)
     {
       outputType = VTK_SHORT;
-      if (scalarType == VTK_UNSIGNED_SHORT)
+      if (scalarType == VTK_UNSIGNED_SHORT && streaming)
+      {
+        // the data isn't in memory, so check the bits stored instead
+        if (reader->GetMetaData()->Get(DC::BitsStored).AsInt() > 15)
+        {
+          outputType = VTK_FLOAT;
+        }
+      }
+      else if (scalarType == VTK_UNSIGNED_SHORT)
       {
         // change to float if values greater than 32767 exist
         const unsigned short *sptr = static_cast<const unsigned short *>(
@@ -1009,7 +1065,7 @@ bool dicomtonifti_convert_one(
     }
   }
 
-  if (!useWindowLevel)
+  if (!useWindowLevel && !streaming)
   {
     std::string photometric =
       meta->Get(DC::PhotometricInterpretation).AsString();
@@ -1072,11 +1128,16 @@ bool dicomtonifti_convert_one(
     writer->SetSFormMatrix(matrix);
   }
   writer->SetInputConnection(lastOutput);
+  writer->SetStreaming(streaming);
   writer->Write();
   if (dicomtonifti_check_error(writer))
   {
     return false;
   }
+  if (streaming && dicomtonifti_check_error(reader))
+  {
+    return false;
+  }
 
   return true;
 }
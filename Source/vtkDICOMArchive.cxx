@@ -0,0 +1,1025 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "vtkDICOMArchive.h"
+#include "vtkDICOMFile.h"
+#include "vtkDICOMFilePath.h"
+#include "vtkDICOMStream.h"
+
+// Header for zlib
+#ifdef DICOM_USE_VTKZLIB
+#include "vtk_zlib.h"
+#else
+#include "zlib.h"
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------
+// The index of an archive, which is shared via the cache
+class vtkDICOMArchive::Index
+{
+public:
+  //! Compression methods (the same values as used by zip).
+  enum Method
+  {
+    Unsupported = -1,
+    Stored = 0,
+    Deflated = 8
+  };
+
+  //! Information about one member of the archive.
+  struct Member
+  {
+    std::string Name;
+    Size Offset; // for zip, this is the offset to the local header
+    Size CompressedSize;
+    Size MemberSize;
+    int Method;
+  };
+
+  Index() : FileSize(0), ModTime(0), IsZip(false) {}
+
+  //! Read the index from the archive, return an error code.
+  int Read(const char *filename);
+
+  std::string FileName;
+  Size FileSize;
+  long long ModTime;
+  bool IsZip;
+  std::vector<Member> Members;
+  std::map<std::string, int> Names;
+
+private:
+  int ReadZip(vtkDICOMFile *f);
+  int ReadTar(vtkDICOMFile *f);
+  void AddMember(const Member& m);
+};
+
+namespace {
+
+typedef vtkDICOMArchive::Size Size;
+
+//----------------------------------------------------------------------------
+// Check if the given character is a path separator
+inline bool IsSeparator(char c)
+{
+#ifdef _WIN32
+  return (c == '/' || c == '\\');
+#else
+  return (c == '/');
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Decode little-endian integers, as used by zip
+inline unsigned int GetLE16(const unsigned char *cp)
+{
+  return cp[0] | (cp[1] << 8);
+}
+
+inline unsigned int GetLE32(const unsigned char *cp)
+{
+  return cp[0] | (cp[1] << 8) | (cp[2] << 16) |
+    (static_cast<unsigned int>(cp[3]) << 24);
+}
+
+inline Size GetLE64(const unsigned char *cp)
+{
+  return GetLE32(cp) | (static_cast<Size>(GetLE32(cp + 4)) << 32);
+}
+
+//----------------------------------------------------------------------------
+// Decode a numeric field from a tar header
+Size GetTarNumber(const unsigned char *cp, size_t l)
+{
+  Size v = 0;
+  if ((cp[0] & 0x80) != 0)
+  {
+    // GNU base-256 encoding, used for large files
+    v = (cp[0] & 0x7f);
+    for (size_t i = 1; i < l; i++)
+    {
+      v = (v << 8) | cp[i];
+    }
+    return v;
+  }
+
+  // otherwise, octal digits with optional leading spaces
+  size_t i = 0;
+  while (i < l && cp[i] == ' ') { i++; }
+  while (i < l && cp[i] >= '0' && cp[i] <= '7')
+  {
+    v = (v << 3) + (cp[i++] - '0');
+  }
+  return v;
+}
+
+//----------------------------------------------------------------------------
+// Verify the checksum of a tar header block
+bool CheckTarHeader(const unsigned char *cp)
+{
+  // the checksum is computed with the checksum field set to spaces
+  unsigned int s = 0;
+  int t = 0;
+  for (int i = 0; i < 512; i++)
+  {
+    unsigned char c = ((i >= 148 && i < 156) ? ' ' : cp[i]);
+    s += c;
+    t += static_cast<signed char>(c); // some old tar programs used this
+  }
+  Size checksum = GetTarNumber(cp + 148, 8);
+  return (cp[148] != '\0' &&
+          (checksum == s || checksum == static_cast<unsigned int>(t)));
+}
+
+//----------------------------------------------------------------------------
+// Get a NUL-terminated string from a fixed-length field
+std::string GetTarString(const unsigned char *cp, size_t l)
+{
+  size_t n = 0;
+  while (n < l && cp[n] != '\0') { n++; }
+  return std::string(reinterpret_cast<const char *>(cp), n);
+}
+
+//----------------------------------------------------------------------------
+// Read exactly n bytes at the given offset, return false on failure
+bool ReadAt(vtkDICOMFile *f, Size offset, unsigned char *data, size_t n)
+{
+  if (!f->SetPosition(offset))
+  {
+    return false;
+  }
+  while (n > 0)
+  {
+    size_t m = f->Read(data, n);
+    if (m == 0)
+    {
+      return false;
+    }
+    data += m;
+    n -= m;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Get the size and modification time of an ordinary file
+bool GetFileStamp(const char *path, Size *size, long long *mtime)
+{
+#ifdef _WIN32
+  vtkDICOMFilePath fpath(path);
+  const wchar_t *widePath = fpath.Wide();
+  WIN32_FILE_ATTRIBUTE_DATA attr;
+  if (widePath == nullptr ||
+      !GetFileAttributesExW(widePath, GetFileExInfoStandard, &attr) ||
+      (attr.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+  {
+    return false;
+  }
+  *size = (static_cast<Size>(attr.nFileSizeHigh) << 32) | attr.nFileSizeLow;
+  *mtime = (static_cast<long long>(attr.ftLastWriteTime.dwHighDateTime) << 32)
+    | attr.ftLastWriteTime.dwLowDateTime;
+#else
+  struct stat fs;
+  if (stat(path, &fs) != 0 || !S_ISREG(fs.st_mode))
+  {
+    return false;
+  }
+  *size = static_cast<Size>(fs.st_size);
+  *mtime = static_cast<long long>(fs.st_mtime);
+#endif
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// A stream that reads one member of an archive
+class ArchiveMemberStream : public vtkDICOMStream
+{
+public:
+  ArchiveMemberStream(
+    const vtkDICOMArchive::Index *index,
+    const vtkDICOMArchive::Index::Member& member);
+  ~ArchiveMemberStream() VTK_DICOM_OVERRIDE;
+
+  size_t Read(unsigned char *data, size_t size) VTK_DICOM_OVERRIDE;
+  bool SetPosition(Size offset) VTK_DICOM_OVERRIDE;
+  Size GetSize() VTK_DICOM_OVERRIDE { return this->MemberSize; }
+  bool GetError() VTK_DICOM_OVERRIDE { return this->Error; }
+
+private:
+  // Read compressed (or stored) data from the archive
+  size_t ReadRaw(unsigned char *data, size_t size);
+
+  // Read and inflate the data, up to 1 GiB at a time
+  size_t ReadInflated(unsigned char *data, size_t size);
+
+  vtkDICOMFile File;
+  Size Offset;
+  Size CompressedSize;
+  Size MemberSize;
+  int Method;
+  Size Position;
+  Size RawPosition;
+  z_stream Stream;
+  std::vector<unsigned char> RawBuffer;
+  bool Initialized;
+  bool StreamEnd;
+  bool Error;
+};
+
+//----------------------------------------------------------------------------
+ArchiveMemberStream::ArchiveMemberStream(
+  const vtkDICOMArchive::Index *index,
+  const vtkDICOMArchive::Index::Member& member)
+  : File(index->FileName.c_str(), vtkDICOMFile::In),
+    Offset(member.Offset), CompressedSize(member.CompressedSize),
+    MemberSize(member.MemberSize), Method(member.Method),
+    Position(0), RawPosition(0),
+    Initialized(false), StreamEnd(false), Error(false)
+{
+  this->Error = (this->File.GetError() != 0);
+
+  if (!this->Error && index->IsZip)
+  {
+    // skip the local header, which can differ from the central directory
+    unsigned char h[30];
+    if (ReadAt(&this->File, this->Offset, h, 30) &&
+        GetLE32(h) == 0x04034b50)
+    {
+      this->Offset += 30 + GetLE16(h + 26) + GetLE16(h + 28);
+    }
+    else
+    {
+      this->Error = true;
+    }
+  }
+
+  if (!this->Error && this->Method == vtkDICOMArchive::Index::Deflated)
+  {
+    this->RawBuffer.resize(65536);
+    this->Stream.zalloc = Z_NULL;
+    this->Stream.zfree = Z_NULL;
+    this->Stream.opaque = Z_NULL;
+    this->Stream.next_in = Z_NULL;
+    this->Stream.avail_in = 0;
+    this->Initialized = (inflateInit2(&this->Stream, -MAX_WBITS) == Z_OK);
+    this->Error = !this->Initialized;
+  }
+}
+
+//----------------------------------------------------------------------------
+ArchiveMemberStream::~ArchiveMemberStream()
+{
+  if (this->Initialized)
+  {
+    inflateEnd(&this->Stream);
+  }
+}
+
+//----------------------------------------------------------------------------
+size_t ArchiveMemberStream::ReadRaw(unsigned char *data, size_t size)
+{
+  Size r = this->CompressedSize - this->RawPosition;
+  size_t n = (r < size ? static_cast<size_t>(r) : size);
+  if (n == 0 || this->Error)
+  {
+    return 0;
+  }
+
+  if (!ReadAt(&this->File, this->Offset + this->RawPosition, data, n))
+  {
+    // the archive is truncated, or an I/O error occurred
+    this->Error = true;
+    return 0;
+  }
+
+  this->RawPosition += n;
+  return n;
+}
+
+//----------------------------------------------------------------------------
+size_t ArchiveMemberStream::ReadInflated(unsigned char *data, size_t size)
+{
+  const size_t chunksize = 1024*1024*1024;
+  size = (size < chunksize ? size : chunksize);
+
+  z_stream *strm = &this->Stream;
+  strm->next_out = data;
+  strm->avail_out = static_cast<uInt>(size);
+
+  while (strm->avail_out > 0 && !this->StreamEnd && !this->Error)
+  {
+    if (strm->avail_in == 0)
+    {
+      size_t m = this->ReadRaw(&this->RawBuffer[0], this->RawBuffer.size());
+      if (m == 0)
+      {
+        // compressed data ended before the end of the stream
+        this->Error = true;
+        break;
+      }
+      strm->next_in = &this->RawBuffer[0];
+      strm->avail_in = static_cast<uInt>(m);
+    }
+
+    int r = inflate(strm, Z_NO_FLUSH);
+    if (r == Z_STREAM_END)
+    {
+      this->StreamEnd = true;
+    }
+    else if (r != Z_OK && r != Z_BUF_ERROR)
+    {
+      this->Error = true;
+    }
+  }
+
+  return size - strm->avail_out;
+}
+
+//----------------------------------------------------------------------------
+size_t ArchiveMemberStream::Read(unsigned char *data, size_t size)
+{
+  Size r = this->MemberSize - this->Position;
+  size_t n = (r < size ? static_cast<size_t>(r) : size);
+  size_t m = 0;
+
+  if (this->Method == vtkDICOMArchive::Index::Stored)
+  {
+    // for stored data, the raw position is the position
+    this->RawPosition = this->Position;
+    m = this->ReadRaw(data, n);
+  }
+  else if (this->Method == vtkDICOMArchive::Index::Deflated)
+  {
+    while (m < n && !this->Error)
+    {
+      size_t l = this->ReadInflated(data + m, n - m);
+      if (l == 0)
+      {
+        break;
+      }
+      m += l;
+    }
+  }
+  else
+  {
+    this->Error = true;
+  }
+
+  this->Position += m;
+  return m;
+}
+
+//----------------------------------------------------------------------------
+bool ArchiveMemberStream::SetPosition(Size offset)
+{
+  if (offset > this->MemberSize || this->Error)
+  {
+    return false;
+  }
+
+  if (this->Method != vtkDICOMArchive::Index::Deflated)
+  {
+    this->Position = offset;
+    return true;
+  }
+
+  // deflated data must be inflated from the start to seek backwards
+  if (offset < this->Position)
+  {
+    inflateReset(&this->Stream);
+    this->Stream.next_in = Z_NULL;
+    this->Stream.avail_in = 0;
+    this->Position = 0;
+    this->RawPosition = 0;
+    this->StreamEnd = false;
+  }
+
+  // inflate and discard data until the offset is reached
+  unsigned char buffer[16384];
+  while (this->Position < offset)
+  {
+    Size r = offset - this->Position;
+    size_t n = (r < sizeof(buffer) ? static_cast<size_t>(r) : sizeof(buffer));
+    if (this->Read(buffer, n) == 0)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// A cache of recently used archive indexes
+struct ArchiveCache
+{
+  std::mutex Mutex;
+  std::list<std::shared_ptr<vtkDICOMArchive::Index> > Entries;
+};
+
+ArchiveCache& GetArchiveCache()
+{
+  static ArchiveCache cache;
+  return cache;
+}
+
+//----------------------------------------------------------------------------
+// Get the index for an archive, from the cache if possible
+std::shared_ptr<vtkDICOMArchive::Index> GetArchiveIndex(
+  const char *filename, int *error)
+{
+  std::shared_ptr<vtkDICOMArchive::Index> index;
+
+  Size size;
+  long long mtime;
+  if (!GetFileStamp(filename, &size, &mtime))
+  {
+    *error = vtkDICOMArchive::FileNotFound;
+    return index;
+  }
+
+  ArchiveCache& cache = GetArchiveCache();
+  {
+    std::lock_guard<std::mutex> lock(cache.Mutex);
+    std::list<std::shared_ptr<vtkDICOMArchive::Index> >::iterator iter;
+    for (iter = cache.Entries.begin(); iter != cache.Entries.end(); ++iter)
+    {
+      const vtkDICOMArchive::Index *e = iter->get();
+      if (e->FileName == filename && e->FileSize == size &&
+          e->ModTime == mtime)
+      {
+        // move the entry to the front of the list
+        index = *iter;
+        cache.Entries.erase(iter);
+        cache.Entries.push_front(index);
+        *error = vtkDICOMArchive::Good;
+        return index;
+      }
+    }
+  }
+
+  // index the archive without holding the lock
+  index = std::make_shared<vtkDICOMArchive::Index>();
+  *error = index->Read(filename);
+  if (*error != vtkDICOMArchive::Good)
+  {
+    index.reset();
+    return index;
+  }
+  index->ModTime = mtime;
+
+  {
+    std::lock_guard<std::mutex> lock(cache.Mutex);
+    cache.Entries.push_front(index);
+    // a small number of archives is enough for typical use
+    while (cache.Entries.size() > 4)
+    {
+      cache.Entries.pop_back();
+    }
+  }
+
+  return index;
+}
+
+} // end anonymous namespace
+
+//----------------------------------------------------------------------------
+void vtkDICOMArchive::Index::AddMember(const Member& m)
+{
+  // names are relative to the archive, even if they start with '/'
+  if (!m.Name.empty() && m.Name[0] == '/')
+  {
+    Member n = m;
+    n.Name.erase(0, n.Name.find_first_not_of('/'));
+    if (!n.Name.empty())
+    {
+      this->AddMember(n);
+    }
+    return;
+  }
+
+  // keep only the first of any duplicate names
+  int i = static_cast<int>(this->Members.size());
+  if (this->Names.insert(std::make_pair(m.Name, i)).second)
+  {
+    this->Members.push_back(m);
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkDICOMArchive::Index::Read(const char *filename)
+{
+  this->FileName = filename;
+
+  vtkDICOMFile f(filename, vtkDICOMFile::In);
+  if (f.GetError())
+  {
+    return FileNotFound;
+  }
+  this->FileSize = f.GetSize();
+  if (f.GetError())
+  {
+    return UnknownError;
+  }
+
+  // check the first block to identify the type of archive
+  unsigned char h[512];
+  size_t n = (this->FileSize < 512 ? static_cast<size_t>(this->FileSize) : 512);
+  if (n < 4 || !ReadAt(&f, 0, h, n))
+  {
+    return NotAnArchive;
+  }
+
+  unsigned int magic = GetLE32(h);
+  if (magic == 0x04034b50 || magic == 0x06054b50)
+  {
+    this->IsZip = true;
+    return this->ReadZip(&f);
+  }
+  else if (h[0] == 0x1f && h[1] == 0x8b)
+  {
+    // gzip, which would have to be inflated to find the members
+    return UnsupportedFormat;
+  }
+  else if (n == 512 && CheckTarHeader(h))
+  {
+    return this->ReadTar(&f);
+  }
+
+  return NotAnArchive;
+}
+
+//----------------------------------------------------------------------------
+int vtkDICOMArchive::Index::ReadZip(vtkDICOMFile *f)
+{
+  // the end-of-central-directory record is followed by a comment of
+  // up to 65535 bytes, so search backwards for its signature
+  Size size = this->FileSize;
+  size_t tail = (size < 65557 ? static_cast<size_t>(size) : 65557);
+  if (tail < 22)
+  {
+    return CorruptArchive;
+  }
+  std::vector<unsigned char> buffer(tail);
+  if (!ReadAt(f, size - tail, &buffer[0], tail))
+  {
+    return CorruptArchive;
+  }
+
+  size_t k = tail - 22;
+  while (GetLE32(&buffer[k]) != 0x06054b50)
+  {
+    if (k == 0)
+    {
+      return CorruptArchive;
+    }
+    k--;
+  }
+
+  const unsigned char *cp = &buffer[k];
+  Size entries = GetLE16(cp + 10);
+  Size cdSize = GetLE32(cp + 12);
+  Size cdOffset = GetLE32(cp + 16);
+
+  // check for a zip64 locator, which precedes the record
+  if (k >= 20 && GetLE32(cp - 20) == 0x07064b50)
+  {
+    unsigned char z[56];
+    if (!ReadAt(f, GetLE64(cp - 12), z, 56) || GetLE32(z) != 0x06064b50)
+    {
+      return CorruptArchive;
+    }
+    entries = GetLE64(z + 32);
+    cdSize = GetLE64(z + 40);
+    cdOffset = GetLE64(z + 48);
+  }
+
+  if (cdOffset > size || cdSize > size - cdOffset)
+  {
+    return CorruptArchive;
+  }
+
+  // read the whole central directory
+  std::vector<unsigned char> directory(static_cast<size_t>(cdSize) + 1);
+  if (cdSize > 0 &&
+      !ReadAt(f, cdOffset, &directory[0], static_cast<size_t>(cdSize)))
+  {
+    return CorruptArchive;
+  }
+
+  this->Members.reserve(static_cast<size_t>(entries));
+  cp = &directory[0];
+  const unsigned char *ep = cp + static_cast<size_t>(cdSize);
+  for (Size i = 0; i < entries; i++)
+  {
+    if (ep - cp < 46 || GetLE32(cp) != 0x02014b50)
+    {
+      return CorruptArchive;
+    }
+    unsigned int flags = GetLE16(cp + 8);
+    unsigned int method = GetLE16(cp + 10);
+    Size csize = GetLE32(cp + 20);
+    Size usize = GetLE32(cp + 24);
+    size_t nl = GetLE16(cp + 28);
+    size_t el = GetLE16(cp + 30);
+    size_t cl = GetLE16(cp + 32);
+    Size offset = GetLE32(cp + 42);
+    if (static_cast<size_t>(ep - cp) < 46 + nl + el + cl)
+    {
+      return CorruptArchive;
+    }
+
+    // the zip64 extra field holds the values that didn't fit
+    const unsigned char *xp = cp + 46 + nl;
+    const unsigned char *xe = xp + el;
+    while (xe - xp >= 4)
+    {
+      unsigned int id = GetLE16(xp);
+      size_t l = GetLE16(xp + 2);
+      const unsigned char *vp = xp + 4;
+      xp = vp + l;
+      if (xp > xe)
+      {
+        break;
+      }
+      if (id == 0x0001)
+      {
+        if (usize == 0xFFFFFFFF && xp - vp >= 8)
+        {
+          usize = GetLE64(vp);
+          vp += 8;
+        }
+        if (csize == 0xFFFFFFFF && xp - vp >= 8)
+        {
+          csize = GetLE64(vp);
+          vp += 8;
+        }
+        if (offset == 0xFFFFFFFF && xp - vp >= 8)
+        {
+          offset = GetLE64(vp);
+        }
+      }
+    }
+
+    Member m;
+    m.Name.assign(reinterpret_cast<const char *>(cp + 46), nl);
+    m.Offset = offset;
+    m.CompressedSize = csize;
+    m.MemberSize = usize;
+    m.Method = Unsupported;
+    if ((flags & 1) == 0 && (method == Stored || method == Deflated))
+    {
+      m.Method = static_cast<int>(method);
+    }
+
+    // directories are not members
+    if (nl > 0 && m.Name[nl - 1] != '/' && offset < size)
+    {
+      this->AddMember(m);
+    }
+
+    cp += 46 + nl + el + cl;
+  }
+
+  return Good;
+}
+
+//----------------------------------------------------------------------------
+int vtkDICOMArchive::Index::ReadTar(vtkDICOMFile *f)
+{
+  Size size = this->FileSize;
+  Size pos = 0;
+
+  // extended names and sizes from the preceding header
+  std::string longName;
+  Size longSize = 0;
+  bool hasLongSize = false;
+
+  unsigned char h[512];
+  while (pos + 512 <= size)
+  {
+    if (!ReadAt(f, pos, h, 512))
+    {
+      return CorruptArchive;
+    }
+
+    // the archive ends with blocks of zeros
+    if (h[0] == '\0')
+    {
+      break;
+    }
+    if (!CheckTarHeader(h))
+    {
+      return CorruptArchive;
+    }
+
+    Size l = GetTarNumber(h + 124, 12);
+    char type = static_cast<char>(h[156]);
+    Size dataPos = pos + 512;
+
+    if (type == 'L' || type == 'x')
+    {
+      // GNU long name, or pax extended header
+      if (l > size - dataPos || l > 1048576)
+      {
+        return CorruptArchive;
+      }
+      std::vector<unsigned char> data(static_cast<size_t>(l) + 1);
+      if (l > 0 && !ReadAt(f, dataPos, &data[0], static_cast<size_t>(l)))
+      {
+        return CorruptArchive;
+      }
+      if (type == 'L')
+      {
+        longName = GetTarString(&data[0], static_cast<size_t>(l));
+      }
+      else
+      {
+        // pax records have the form "length key=value\n"
+        size_t i = 0;
+        while (i < l)
+        {
+          size_t rl = 0;
+          size_t j = i;
+          while (j < l && rl <= l && data[j] >= '0' && data[j] <= '9')
+          {
+            rl = rl*10 + (data[j++] - '0');
+          }
+          // the length includes the digits, the space, and the newline
+          if (j >= l || rl < (j - i) + 2 || rl > l - i ||
+              data[j] != ' ' || data[i + rl - 1] != '\n')
+          {
+            break;
+          }
+          std::string record(
+            reinterpret_cast<const char *>(&data[j + 1]), i + rl - j - 2);
+          if (record.compare(0, 5, "path=") == 0)
+          {
+            longName = record.substr(5);
+          }
+          else if (record.compare(0, 5, "size=") == 0)
+          {
+            longSize = strtoull(record.c_str() + 5, nullptr, 10);
+            hasLongSize = true;
+          }
+          i += rl;
+        }
+      }
+    }
+    else
+    {
+      if (hasLongSize)
+      {
+        l = longSize;
+      }
+
+      if (type == '0' || type == '\0' || type == '7')
+      {
+        // an ordinary file
+        Member m;
+        if (!longName.empty())
+        {
+          m.Name = longName;
+        }
+        else
+        {
+          m.Name = GetTarString(h, 100);
+          if (memcmp(h + 257, "ustar", 6) == 0)
+          {
+            // POSIX ustar stores a name prefix
+            std::string prefix = GetTarString(h + 345, 155);
+            if (!prefix.empty())
+            {
+              m.Name = prefix + "/" + m.Name;
+            }
+          }
+        }
+        // strip any leading "./"
+        while (m.Name.compare(0, 2, "./") == 0)
+        {
+          m.Name.erase(0, 2);
+        }
+        m.Offset = dataPos;
+        m.CompressedSize = l;
+        m.MemberSize = l;
+        m.Method = Stored;
+        if (!m.Name.empty() && l <= size - dataPos)
+        {
+          this->AddMember(m);
+        }
+      }
+
+      // the extended information only applies to one member
+      if (type != 'g')
+      {
+        longName.clear();
+        hasLongSize = false;
+      }
+    }
+
+    // hard links, symbolic links, and directories have no data
+    if (type == '1' || type == '2' || type == '5')
+    {
+      l = 0;
+    }
+
+    // data is padded to a multiple of the block size
+    Size blocks = (l + 511)/512;
+    if (blocks > (size - dataPos)/512 + 1)
+    {
+      return CorruptArchive;
+    }
+    pos = dataPos + 512*blocks;
+  }
+
+  return Good;
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMArchive::vtkDICOMArchive(const char *filename)
+{
+  this->Internal = GetArchiveIndex(filename, &this->Error);
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMArchive::~vtkDICOMArchive()
+{
+}
+
+//----------------------------------------------------------------------------
+int vtkDICOMArchive::GetNumberOfMembers()
+{
+  return (this->Internal ?
+          static_cast<int>(this->Internal->Members.size()) : 0);
+}
+
+//----------------------------------------------------------------------------
+const std::string& vtkDICOMArchive::GetMemberName(int i)
+{
+  return this->Internal->Members[i].Name;
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMArchive::Size vtkDICOMArchive::GetMemberSize(int i)
+{
+  return this->Internal->Members[i].MemberSize;
+}
+
+//----------------------------------------------------------------------------
+int vtkDICOMArchive::FindMember(const std::string& name)
+{
+  if (this->Internal)
+  {
+    std::map<std::string, int>::const_iterator iter =
+      this->Internal->Names.find(name);
+    if (iter != this->Internal->Names.end())
+    {
+      return iter->second;
+    }
+  }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMStream *vtkDICOMArchive::OpenMember(int i)
+{
+  if (!this->Internal || i < 0 || i >= this->GetNumberOfMembers() ||
+      this->Internal->Members[i].Method == Index::Unsupported)
+  {
+    return nullptr;
+  }
+
+  ArchiveMemberStream *stream =
+    new ArchiveMemberStream(this->Internal.get(), this->Internal->Members[i]);
+  if (stream->GetError())
+  {
+    delete stream;
+    stream = nullptr;
+  }
+  return stream;
+}
+
+//----------------------------------------------------------------------------
+bool vtkDICOMArchive::IsArchiveName(const char *filename)
+{
+  size_t l = strlen(filename);
+  if (l < 4 || filename[l - 4] != '.')
+  {
+    return false;
+  }
+
+  char ext[4];
+  for (int i = 0; i < 3; i++)
+  {
+    char c = filename[l - 3 + i];
+    ext[i] = ((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c);
+  }
+  ext[3] = '\0';
+
+  return (strcmp(ext, "zip") == 0 || strcmp(ext, "tar") == 0);
+}
+
+//----------------------------------------------------------------------------
+bool vtkDICOMArchive::SplitPath(
+  const char *path, std::string *archive, std::string *member)
+{
+  std::string s = path;
+  for (size_t i = 1; i < s.length(); i++)
+  {
+    if (!IsSeparator(s[i]) ||
+        IsSeparator(s[i - 1]))
+    {
+      continue;
+    }
+
+    // is this leading portion of the path an ordinary file?
+    std::string prefix = s.substr(0, i);
+    Size size;
+    long long mtime;
+    if (GetFileStamp(prefix.c_str(), &size, &mtime))
+    {
+      // the member name uses forward slashes
+      size_t j = i;
+      while (j < s.length() && IsSeparator(s[j])) { j++; }
+      std::string name = s.substr(j);
+      for (size_t k = 0; k < name.length(); k++)
+      {
+        if (IsSeparator(name[k]))
+        {
+          name[k] = '/';
+        }
+      }
+      if (name.empty())
+      {
+        return false;
+      }
+      *archive = prefix;
+      *member = name;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMStream *vtkDICOMArchive::OpenPath(const char *path)
+{
+  std::string archivePath;
+  std::string memberName;
+  if (!vtkDICOMArchive::SplitPath(path, &archivePath, &memberName))
+  {
+    return nullptr;
+  }
+
+  vtkDICOMArchive archive(archivePath.c_str());
+  return archive.OpenMember(archive.FindMember(memberName));
+}
+
+//----------------------------------------------------------------------------
+bool vtkDICOMArchive::MemberExists(const char *path)
+{
+  std::string archivePath;
+  std::string memberName;
+  if (!vtkDICOMArchive::SplitPath(path, &archivePath, &memberName))
+  {
+    return false;
+  }
+
+  vtkDICOMArchive archive(archivePath.c_str());
+  return (archive.FindMember(memberName) >= 0);
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMArchive::ClearCache()
+{
+  ArchiveCache& cache = GetArchiveCache();
+  std::lock_guard<std::mutex> lock(cache.Mutex);
+  cache.Entries.clear();
+}
@@ -0,0 +1,135 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef vtkDICOMArchive_h
+#define vtkDICOMArchive_h
+
+#include "vtkSystemIncludes.h"
+#include "vtkDICOMModule.h" // For export macro
+#include "vtkDICOMConfig.h" // For configuration details
+
+#include <string> // Interface type
+#include <memory> // For shared index
+
+class vtkDICOMStream;
+
+//! Read-only access to the files stored in a zip or tar archive.
+/*!
+ *  When an archive is opened, an index of its members is built (from
+ *  the central directory of a zip file, or by stepping through the
+ *  headers of a tar file), and each member can then be read through a
+ *  vtkDICOMStream without extracting it.  Zip members can be stored or
+ *  deflated, while compressed tar files are not supported.
+ *
+ *  A member can also be named with a path that goes through the archive,
+ *  e.g. "/data/study.zip/series1/IM0001".  vtkDICOMFile recognizes such
+ *  paths, so they can be used wherever a file name can be used for
+ *  reading.  The indexes of recently used archives are cached, so that
+ *  the archive does not have to be re-indexed for each member.
+ */
+class VTKDICOM_EXPORT vtkDICOMArchive
+{
+public:
+  //! Typedef for a file size.
+  typedef unsigned long long Size;
+
+  //! Error codes.
+  enum Code
+  {
+    Good,              // no error
+    UnknownError,      // unspecified error
+    FileNotFound,      // the archive does not exist or is not readable
+    NotAnArchive,      // the file is not a zip or tar file
+    CorruptArchive,    // the archive index could not be read
+    UnsupportedFormat  // e.g. a compressed tar file
+  };
+
+  //@{
+  //! Open an archive and build an index of its members.
+  vtkDICOMArchive(const char *filename);
+
+  //! Destructor.
+  ~vtkDICOMArchive();
+  //@}
+
+  //@{
+  //! Return an error indicator (zero if no error).
+  int GetError() { return this->Error; }
+
+  //! Get the number of files in the archive (directories are omitted).
+  int GetNumberOfMembers();
+
+  //! Get the name of a member, using '/' as the separator.
+  const std::string& GetMemberName(int i);
+
+  //! Get the size of a member, after decompression.
+  Size GetMemberSize(int i);
+
+  //! Find a member by name, or return -1 if not found.
+  int FindMember(const std::string& name);
+
+  //! Open a member for reading.
+  /*!
+   *  The returned stream must be deleted by the caller.  If the member
+   *  cannot be read (for instance, if it is encrypted or uses an
+   *  unsupported compression method), the return value is null.
+   */
+  vtkDICOMStream *OpenMember(int i);
+  //@}
+
+  //@{
+  //! Check whether a file name has an archive extension (.zip or .tar).
+  static bool IsArchiveName(const char *filename);
+
+  //! Split a path into the archive path and the member name.
+  /*!
+   *  The archive is found by looking for the first leading portion of
+   *  the path that is an ordinary file.  The return value is false if
+   *  the path does not go through a file.  This does not check whether
+   *  the file is actually an archive.
+   */
+  static bool SplitPath(
+    const char *path, std::string *archive, std::string *member);
+
+  //! Open a member via a path that goes through the archive.
+  /*!
+   *  The returned stream must be deleted by the caller.  The return value
+   *  is null if the path does not refer to a member of an archive.
+   */
+  static vtkDICOMStream *OpenPath(const char *path);
+
+  //! Check if a path that goes through an archive refers to a member.
+  static bool MemberExists(const char *path);
+
+  //! Discard the cached archive indexes.
+  static void ClearCache();
+  //@}
+
+  //! The index of an archive (shared with the cache).
+  class Index;
+
+private:
+#ifdef VTK_DICOM_DELETE
+  vtkDICOMArchive(const vtkDICOMArchive&) VTK_DICOM_DELETE;
+  void operator=(const vtkDICOMArchive&) VTK_DICOM_DELETE;
+#else
+  vtkDICOMArchive(const vtkDICOMArchive&) = delete;
+  void operator=(const vtkDICOMArchive&) = delete;
+#endif
+
+  std::shared_ptr<Index> Internal;
+  int Error;
+};
+
+#endif /* vtkDICOMArchive_h */
+// VTK-HeaderTest-Exclude: vtkDICOMArchive.h
@@ -15,7 +15,9 @@
 #include "vtkDICOMCharacterSetTables.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <mutex>
 #include <sstream>
 #include <vector>
 
@@ -139,16 +141,26 @@ static const CharsetInfo Charsets[91] = {
   { "koi8",     nullptr,        nullptr, "KOI8-U" }, // text only, no boxes
 };
 
+//----------------------------------------------------------------------------
+// Get the expanded version of a table, or nullptr if not expanded.
+const unsigned short *ExpandedTable(const unsigned short *table);
+
 //----------------------------------------------------------------------------
 //! This is a class for compressed lookup tables.
 class CompressedTable
 {
 public:
   CompressedTable(const unsigned short *table) : M(table[0]), N(table[M+1]),
-    HTable(table+1), LTable(HTable + M+1) {}
+    HTable(table+1), LTable(HTable + M+1), FTable(ExpandedTable(table)) {}
 
   //! Use table to convert "x", return RCHAR if "x" not in table.
   unsigned short operator[](unsigned short x)
+  {
+    return (FTable ? FTable[x] : Lookup(x));
+  }
+
+  //! Search the compressed table for "x".
+  unsigned short Lookup(unsigned short x)
   {
     // uptr will indicate the table range that "x" sits within,
     // i.e. we want uptr[0] <= x < uptr[1]
@@ -214,13 +226,93 @@ public:
     return &LTable[3*N + y];
   }
 
+  //! Expand the table into a flat array with 65536 entries.
+  static void Expand(const unsigned short *table, unsigned short *flat)
+  {
+    CompressedTable ctable(table, nullptr);
+    for (unsigned int x = 0; x <= 0xFFFF; x++)
+    {
+      flat[x] = ctable.Lookup(static_cast<unsigned short>(x));
+    }
+  }
+
 private:
+  CompressedTable(const unsigned short *table, const unsigned short *flat) :
+    M(table[0]), N(table[M+1]), HTable(table+1), LTable(HTable + M+1),
+    FTable(flat) {}
+
   size_t M; // number of "hot" ranges declared for table
   size_t N; // total number of regions declared for table
   const unsigned short *HTable; // list of M values to define hot regions
   const unsigned short *LTable; // list of all regions
+  const unsigned short *FTable; // expanded table, or nullptr if none
 };
 
+//----------------------------------------------------------------------------
+// Information about the tables that can be expanded.
+struct ExpandedTableInfo
+{
+  const unsigned short *Table = nullptr; // the compressed table
+  unsigned short *Flat = nullptr; // the expanded table
+  std::once_flag Once; // for creating the expanded table
+};
+
+// The list of tables that can be expanded, set up on first use.
+const int MaxExpandedTables = 32;
+ExpandedTableInfo ExpandedTableList[MaxExpandedTables];
+std::atomic<int> ExpandedTableCount(0);
+std::mutex ExpandedTableListMutex;
+
+// Whether to use expanded tables, and how many bytes they use.
+std::atomic<bool> ExpandedTablesEnabled(false);
+std::atomic<size_t> ExpandedTablesMemory(0);
+
+// Free the expanded tables when the program exits.
+struct ExpandedTableCleanup
+{
+  ~ExpandedTableCleanup()
+  {
+    int n = ExpandedTableCount.load();
+    for (int i = 0; i < n; i++)
+    {
+      delete [] ExpandedTableList[i].Flat;
+      ExpandedTableList[i].Flat = nullptr;
+    }
+  }
+};
+
+ExpandedTableCleanup ExpandedTableCleanupInstance;
+
+void ExpandTable(ExpandedTableInfo *info)
+{
+  unsigned short *flat = new unsigned short[65536];
+  CompressedTable::Expand(info->Table, flat);
+  info->Flat = flat;
+  ExpandedTablesMemory += 65536*sizeof(unsigned short);
+}
+
+const unsigned short *ExpandedTable(const unsigned short *table)
+{
+  if (!ExpandedTablesEnabled.load(std::memory_order_acquire))
+  {
+    return nullptr;
+  }
+
+  int n = ExpandedTableCount.load(std::memory_order_acquire);
+  for (int i = 0; i < n; i++)
+  {
+    ExpandedTableInfo *info = &ExpandedTableList[i];
+    if (info->Table == table)
+    {
+      // expand the table the first time that it is used
+      std::call_once(info->Once, ExpandTable, info);
+      return info->Flat;
+    }
+  }
+
+  return nullptr;
+}
+
 //----------------------------------------------------------------------------
 // For reversed tables, accept an "unsigned int" index, since unicode
 // is too large for "unsigned short".
@@ -1334,6 +1426,54 @@ unsigned int DakutenOffset(unsigned int code, unsigned int dakuten)
 
 } // end anonymous namespace
 
+//----------------------------------------------------------------------------
+void vtkDICOMCharacterSet::SetUseExpandedTables(bool b)
+{
+  // make a list of all the multibyte tables, this is done only once
+  std::lock_guard<std::mutex> lock(ExpandedTableListMutex);
+  if (b && ExpandedTableCount.load() == 0)
+  {
+    static const unsigned char keys[] = {
+      X_EUCKR, X_GB2312, ISO_2022_IR_87, ISO_2022_IR_159, ISO_2022_IR_149,
+      ISO_2022_IR_58, GB18030, GBK, X_BIG5, X_EUCJP, X_SJIS
+    };
+    int n = 0;
+    for (size_t j = 0; j < sizeof(keys); j++)
+    {
+      const unsigned short *tables[2] = {
+        Table[keys[j]], Reverse[keys[j]] };
+      for (int k = 0; k < 2; k++)
+      {
+        // add each table only once, since some are shared
+        int i = 0;
+        while (i < n && ExpandedTableList[i].Table != tables[k])
+        {
+          i++;
+        }
+        if (i == n && n < MaxExpandedTables)
+        {
+          ExpandedTableList[n++].Table = tables[k];
+        }
+      }
+    }
+    ExpandedTableCount.store(n, std::memory_order_release);
+  }
+
+  ExpandedTablesEnabled.store(b, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+bool vtkDICOMCharacterSet::GetUseExpandedTables()
+{
+  return ExpandedTablesEnabled.load();
+}
+
+//----------------------------------------------------------------------------
+size_t vtkDICOMCharacterSet::GetExpandedTablesMemory()
+{
+  return ExpandedTablesMemory.load();
+}
+
 //----------------------------------------------------------------------------
 size_t vtkDICOMCharacterSet::UTF8ToSJIS(
   const char *text, size_t l, std::string *s, int mode)
@@ -4064,6 +4204,15 @@ std::string vtkDICOMCharacterSet::ToUTF8(
   return s;
 }
 
+//----------------------------------------------------------------------------
+size_t vtkDICOMCharacterSet::AppendToUTF8(
+  const char *text, size_t l, std::string *s) const
+{
+  size_t n = s->length();
+  this->AnyToUTF8(text, l, s, UTF8_REPLACE);
+  return s->length() - n;
+}
+
 //----------------------------------------------------------------------------
 size_t vtkDICOMCharacterSet::AnyToUTF8(
   const char *text, size_t l, std::string *s, int mode) const
@@ -0,0 +1,198 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkDICOMChromeTracer.h"
+#include "vtkDICOMFile.h"
+
+#include "vtkObjectFactory.h"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <stdio.h>
+
+vtkStandardNewMacro(vtkDICOMChromeTracer);
+
+//----------------------------------------------------------------------------
+// The buffered output, the lock, and the thread identifiers.
+class vtkDICOMChromeTracer::Internals
+{
+public:
+  Internals() : File(nullptr), EventCount(0) {}
+
+  vtkDICOMFile *File;
+  std::string Buffer;
+  size_t EventCount;
+  std::chrono::steady_clock::time_point StartTime;
+  std::map<std::thread::id, int> ThreadIds;
+  std::mutex Mutex;
+};
+
+namespace {
+
+// Append a string to the buffer as a quoted JSON string.
+void vtkDICOMChromeTracerQuote(std::string *buffer, const char *text)
+{
+  buffer->push_back('\"');
+  for (const char *cp = text; *cp != '\0'; cp++)
+  {
+    unsigned char c = static_cast<unsigned char>(*cp);
+    if (c == '\"' || c == '\\')
+    {
+      buffer->push_back('\\');
+      buffer->push_back(c);
+    }
+    else if (c < 0x20)
+    {
+      char hex[8];
+      snprintf(hex, sizeof(hex), "\\u%04x", c);
+      buffer->append(hex);
+    }
+    else
+    {
+      buffer->push_back(c);
+    }
+  }
+  buffer->push_back('\"');
+}
+
+// Size at which the buffer is written to the file.
+const size_t vtkDICOMChromeTracerBufferSize = 65536;
+
+} // end anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkDICOMChromeTracer::vtkDICOMChromeTracer()
+{
+  this->FileName = nullptr;
+  this->Internal = new Internals;
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMChromeTracer::~vtkDICOMChromeTracer()
+{
+  this->Close();
+  delete this->Internal;
+  delete [] this->FileName;
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMChromeTracer::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "FileName: "
+     << (this->FileName ? this->FileName : "(NULL)") << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMChromeTracer::Close()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  vtkDICOMFile *file = this->Internal->File;
+  if (file)
+  {
+    std::string& buffer = this->Internal->Buffer;
+    buffer.append("\n]\n");
+    file->Write(reinterpret_cast<const unsigned char *>(buffer.data()),
+                buffer.size());
+    file->Close();
+    delete file;
+    this->Internal->File = nullptr;
+    buffer.clear();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMChromeTracer::BeginSpan(const char *name, const char *filename)
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  this->WriteEvent(name, "B", filename, -1);
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMChromeTracer::EndSpan(
+  const char *name, const char *filename, vtkTypeInt64 bytes)
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  this->WriteEvent(name, "E", filename, bytes);
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMChromeTracer::WriteEvent(
+  const char *name, const char *phase, const char *filename,
+  vtkTypeInt64 bytes)
+{
+  Internals *internal = this->Internal;
+  std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+
+  if (internal->File == nullptr)
+  {
+    if (this->FileName == nullptr)
+    {
+      return;
+    }
+    internal->File = new vtkDICOMFile(this->FileName, vtkDICOMFile::Out);
+    if (internal->File->GetError())
+    {
+      delete internal->File;
+      internal->File = nullptr;
+      return;
+    }
+    internal->Buffer = "[";
+    internal->EventCount = 0;
+    internal->StartTime = t;
+  }
+
+  // give each thread a small integer identifier
+  std::thread::id threadId = std::this_thread::get_id();
+  std::map<std::thread::id, int>::iterator iter =
+    internal->ThreadIds.find(threadId);
+  if (iter == internal->ThreadIds.end())
+  {
+    int n = static_cast<int>(internal->ThreadIds.size()) + 1;
+    iter = internal->ThreadIds.insert(std::make_pair(threadId, n)).first;
+  }
+
+  double ts = std::chrono::duration<double, std::micro>(
+    t - internal->StartTime).count();
+
+  char text[128];
+  std::string& buffer = internal->Buffer;
+  buffer.append(internal->EventCount++ == 0 ? "\n" : ",\n");
+  buffer.append("{\"name\":");
+  vtkDICOMChromeTracerQuote(&buffer, (name ? name : ""));
+  snprintf(text, sizeof(text),
+           ",\"cat\":\"dicom\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%d",
+           phase, ts, iter->second);
+  buffer.append(text);
+  buffer.append(",\"args\":{\"file\":");
+  vtkDICOMChromeTracerQuote(&buffer, (filename ? filename : ""));
+  if (bytes >= 0)
+  {
+    snprintf(text, sizeof(text), ",\"bytes\":%lld",
+             static_cast<long long>(bytes));
+    buffer.append(text);
+  }
+  buffer.append("}}");
+
+  if (buffer.size() >= vtkDICOMChromeTracerBufferSize)
+  {
+    internal->File->Write(
+      reinterpret_cast<const unsigned char *>(buffer.data()), buffer.size());
+    buffer.clear();
+  }
+}
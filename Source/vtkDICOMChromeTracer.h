@@ -0,0 +1,85 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef vtkDICOMChromeTracer_h
+#define vtkDICOMChromeTracer_h
+
+#include "vtkDICOMTracer.h"
+
+//! Write trace spans to a file in the Chrome trace-event format.
+/*!
+ *  This tracer writes each span as a pair of "B" and "E" events in the
+ *  JSON trace-event format, which can be loaded into chrome://tracing
+ *  or into Perfetto for offline analysis.  Each thread is given its
+ *  own track, and the file name and byte count are stored as arguments
+ *  of the events.  The file is opened when the first span begins, and
+ *  it is completed when Close() is called or when the tracer is deleted.
+ */
+class VTKDICOM_EXPORT vtkDICOMChromeTracer : public vtkDICOMTracer
+{
+public:
+  //! Static method for construction.
+  //@{
+  static vtkDICOMChromeTracer *New();
+  vtkTypeMacro(vtkDICOMChromeTracer, vtkDICOMTracer);
+  //@}
+
+  //! Print information about this object.
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_DICOM_OVERRIDE;
+
+  //@{
+  //! Set the name of the JSON file to write.
+  vtkSetStringMacro(FileName);
+  vtkGetStringMacro(FileName);
+  //@}
+
+  //@{
+  //! Finish writing the file and close it.
+  /*!
+   *  If another span begins after the file is closed, then the file
+   *  will be overwritten.
+   */
+  void Close();
+  //@}
+
+  //@{
+  //! Write the events for the spans.
+  void BeginSpan(const char *name, const char *filename) VTK_DICOM_OVERRIDE;
+  void EndSpan(const char *name, const char *filename,
+               vtkTypeInt64 bytes) VTK_DICOM_OVERRIDE;
+  //@}
+
+protected:
+  vtkDICOMChromeTracer();
+  ~vtkDICOMChromeTracer() VTK_DICOM_OVERRIDE;
+
+  //! Write one event to the buffer, the caller must hold the lock.
+  void WriteEvent(const char *name, const char *phase,
+                  const char *filename, vtkTypeInt64 bytes);
+
+  char *FileName;
+
+private:
+  class Internals;
+  Internals *Internal;
+
+#ifdef VTK_DICOM_DELETE
+  vtkDICOMChromeTracer(const vtkDICOMChromeTracer&) VTK_DICOM_DELETE;
+  void operator=(const vtkDICOMChromeTracer&) VTK_DICOM_DELETE;
+#else
+  vtkDICOMChromeTracer(const vtkDICOMChromeTracer&) = delete;
+  void operator=(const vtkDICOMChromeTracer&) = delete;
+#endif
+};
+
+#endif // vtkDICOMChromeTracer_h
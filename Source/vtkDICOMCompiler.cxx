@@ -14,18 +14,28 @@
 #include "vtkDICOMCompiler.h"
 #include "vtkDICOMDictionary.h"
 #include "vtkDICOMFile.h"
+#include "vtkDICOMStream.h"
 #include "vtkDICOMMetaData.h"
 #include "vtkDICOMSequence.h"
 #include "vtkDICOMUtilities.h"
 #include "vtkDICOMItem.h"
 #include "vtkDICOMImageCodec.h"
+#include "vtkDICOMTracer.h"
 
 #include "vtkObjectFactory.h"
 #include "vtkStringArray.h"
 #include "vtkUnsignedShortArray.h"
 #include "vtkErrorCode.h"
 
+// Header for zlib
+#ifdef DICOM_USE_VTKZLIB
+#include "vtk_zlib.h"
+#else
+#include "zlib.h"
+#endif
+
 #include <ctype.h>
+#include <string.h>
 #include <assert.h>
 
 #include <string>
@@ -855,6 +865,19 @@ bool Encoder<E>::WriteElements(
 
 } // end anonymous namespace
 
+//----------------------------------------------------------------------------
+// The state for deflating data with the Deflate transfer syntax
+class vtkDICOMCompiler::Deflater
+{
+public:
+  z_stream Stream;
+  // buffer for compressed data that will be written to the file
+  unsigned char *Buffer;
+  size_t BufferSize;
+  // number of compressed bytes that have been written
+  vtkTypeInt64 BytesOut;
+};
+
 //----------------------------------------------------------------------------
 //----------------------------------------------------------------------------
 // Constructor
@@ -868,11 +891,18 @@ vtkDICOMCompiler::vtkDICOMCompiler()
   this->ImplementationVersionName = nullptr;
   this->SourceApplicationEntityTitle = nullptr;
   this->TransferSyntaxUID = nullptr;
+  this->SourceFileName = nullptr;
+  this->SourceOffset = 0;
+  this->SourceVL = 0;
   this->MetaData = nullptr;
   this->OutputFile = nullptr;
+  this->OutputStream = nullptr;
+  this->OutputDeflater = nullptr;
+  this->Span = nullptr;
   this->Buffer = nullptr;
   this->BufferSize = 8192;
   this->ChunkSize = 0;
+  this->BytesWritten = 0;
   this->Index = 0;
   this->FrameCounter = 0;
   this->FrameData = nullptr;
@@ -915,6 +945,7 @@ vtkDICOMCompiler::~vtkDICOMCompiler()
   delete [] this->ImplementationVersionName;
   delete [] this->SourceApplicationEntityTitle;
   delete [] this->TransferSyntaxUID;
+  delete [] this->SourceFileName;
 
   if (this->MetaData)
   {
@@ -926,6 +957,16 @@ vtkDICOMCompiler::~vtkDICOMCompiler()
   }
 }
 
+//----------------------------------------------------------------------------
+void vtkDICOMCompiler::SetOutputStream(vtkDICOMStream *stream)
+{
+  if (this->OutputStream != stream)
+  {
+    this->OutputStream = stream;
+    this->Modified();
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkDICOMCompiler::SetBufferSize(int size)
 {
@@ -945,6 +986,27 @@ void vtkDICOMCompiler::SetBufferSize(int size)
   }
 }
 
+//----------------------------------------------------------------------------
+void vtkDICOMCompiler::SetPixelDataSource(
+  const char *filename, vtkTypeInt64 offset, unsigned int vl)
+{
+  if (filename == nullptr && this->SourceFileName == nullptr)
+  {
+    return;
+  }
+
+  delete [] this->SourceFileName;
+  this->SourceFileName = nullptr;
+  if (filename)
+  {
+    this->SourceFileName = new char[strlen(filename) + 1];
+    strcpy(this->SourceFileName, filename);
+  }
+  this->SourceOffset = offset;
+  this->SourceVL = vl;
+  this->Modified();
+}
+
 //----------------------------------------------------------------------------
 void vtkDICOMCompiler::GenerateSeriesUIDs()
 {
@@ -980,12 +1042,26 @@ void vtkDICOMCompiler::Close()
     this->WriteFragments();
   }
 
+  if (this->OutputDeflater && !this->EndDeflate(true))
+  {
+    this->DiskFullError();
+    return;
+  }
+
   if (this->OutputFile)
   {
     this->OutputFile->Close();
     delete this->OutputFile;
     this->OutputFile = nullptr;
   }
+
+  // the span covers everything from opening the file to closing it
+  if (this->Span)
+  {
+    this->Span->SetBytes(this->BytesWritten);
+    delete this->Span;
+    this->Span = nullptr;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -996,13 +1072,30 @@ void vtkDICOMCompiler::CloseAndRemove()
     this->FreeFragments();
   }
 
+  this->EndDeflate(false);
+
   if (this->OutputFile)
   {
     this->OutputFile->Close();
     delete this->OutputFile;
     this->OutputFile = nullptr;
-    vtkDICOMFile::Remove(this->FileName);
+    if (this->OutputStream)
+    {
+      // discard whatever was written to the stream
+      if (this->OutputStream->SetPosition(0))
+      {
+        this->OutputStream->Truncate();
+      }
+    }
+    else
+    {
+      vtkDICOMFile::Remove(this->FileName);
+    }
   }
+
+  // end the span, with zero bytes to indicate failure
+  delete this->Span;
+  this->Span = nullptr;
 }
 
 //----------------------------------------------------------------------------
@@ -1046,6 +1139,7 @@ bool vtkDICOMCompiler::WriteFragments()
 
     // write the offset table to the file
     n = this->OutputFile->Write(buffer, tableLength + 8);
+    this->BytesWritten += n;
     if (n < tableLength + 8)
     {
       fileError = true;
@@ -1060,6 +1154,7 @@ bool vtkDICOMCompiler::WriteFragments()
       Encoder<LE>::PutInt16(buffer+2, HxE000);
       Encoder<LE>::PutInt32(buffer+4, this->FrameLength[i]);
       n = this->OutputFile->Write(buffer, 8);
+      this->BytesWritten += n;
       if (n < 8)
       {
         fileError = true;
@@ -1069,6 +1164,7 @@ bool vtkDICOMCompiler::WriteFragments()
       // - Fragment data
       assert((this->FrameLength[i] & 1) == 0);
       n = this->OutputFile->Write(this->FrameData[i], this->FrameLength[i]);
+      this->BytesWritten += n;
       if (n < this->FrameLength[i])
       {
         fileError = true;
@@ -1085,6 +1181,7 @@ bool vtkDICOMCompiler::WriteFragments()
       Encoder<LE>::PutInt16(buffer+2, HxE0DD);
       Encoder<LE>::PutInt32(buffer+4, 0);
       n = this->OutputFile->Write(buffer, 8);
+      this->BytesWritten += n;
       if (n < 8)
       {
         fileError = true;
@@ -1121,14 +1218,23 @@ void vtkDICOMCompiler::FreeFragments()
 //----------------------------------------------------------------------------
 bool vtkDICOMCompiler::WriteFile(vtkDICOMMetaData *data, int idx)
 {
-  // Check that the file name has been set.
-  if (!this->FileName)
+  // Check that the file name (or a stream) has been set.
+  if (!this->FileName && !this->OutputStream)
   {
     this->SetErrorCode(vtkErrorCode::NoFileNameError);
     vtkErrorMacro("WriteFile: No file name has been set");
     return false;
   }
 
+  // the span is ended by Close(), so that it includes the pixel data
+  const char *fileName = (this->FileName ? this->FileName : "(stream)");
+  delete this->Span;
+  this->Span = nullptr;
+  if (vtkDICOMTracer::GetGlobalTracer())
+  {
+    this->Span = new vtkDICOMTraceSpan("Write", fileName);
+  }
+
   // Generate fresh UIDs if at index zero
   if ((this->SOPInstanceUID == nullptr || this->SeriesInstanceUID == nullptr) &&
       (idx == 0 || this->SeriesUIDs == nullptr ||
@@ -1138,7 +1244,8 @@ bool vtkDICOMCompiler::WriteFile(vtkDICOMMetaData *data, int idx)
     this->GenerateSeriesUIDs();
   }
 
-  this->OutputFile = new vtkDICOMFile(this->FileName, vtkDICOMFile::Out);
+  this->OutputFile = new vtkDICOMFile(
+    this->FileName, this->OutputStream, vtkDICOMFile::Out);
 
   if (this->OutputFile->GetError())
   {
@@ -1154,11 +1261,14 @@ bool vtkDICOMCompiler::WriteFile(vtkDICOMMetaData *data, int idx)
     }
     delete this->OutputFile;
     this->OutputFile = nullptr;
-    vtkErrorMacro("WriteFile: " << errText << this->FileName);
+    delete this->Span;
+    this->Span = nullptr;
+    vtkErrorMacro("WriteFile: " << errText << fileName);
     return false;
   }
 
   this->Buffer = new unsigned char [this->BufferSize];
+  this->BytesWritten = 0;
   // guard against anyone changing BufferSize while compiling the file
   this->ChunkSize = this->BufferSize;
 
@@ -1190,6 +1300,11 @@ bool vtkDICOMCompiler::WriteFile(vtkDICOMMetaData *data, int idx)
   {
     r = this->FlushBuffer(cp, ep);
   }
+  if (r && this->SourceFileName && data->Has(DC::PixelData))
+  {
+    // stream the pixel data directly from the source file
+    r = this->CopyPixelData();
+  }
 
   delete [] this->Buffer;
 
@@ -1217,7 +1332,7 @@ void vtkDICOMCompiler::WritePixelData(const unsigned char *cp, vtkIdType size)
     return;
   }
 
-  size_t n = this->OutputFile->Write(cp, size);
+  size_t n = this->WriteToFile(cp, size);
   if (n != static_cast<size_t>(size))
   {
     this->DiskFullError();
@@ -1317,13 +1432,13 @@ void vtkDICOMCompiler::WriteFrame(const unsigned char *cp, vtkIdType size)
         cp += 8;
       }
     }
-    n = this->OutputFile->Write(buf, size);
+    n = this->WriteToFile(buf, size);
     delete [] buf;
   }
   else
   {
     // For uncompressed frames, write the data raw
-    n = this->OutputFile->Write(cp, size);
+    n = this->WriteToFile(cp, size);
   }
 
   if (n != static_cast<size_t>(size))
@@ -1461,6 +1576,14 @@ bool vtkDICOMCompiler::WriteMetaData(
     encoder->SetImplicitVR(true);
     this->BigEndian = true;
   }
+  else if (tsyntax == "1.2.840.10008.1.2.1.99") // Deflated Explicit LE
+  {
+    // flush the meta header, everything after it will be deflated
+    if (!this->FlushBuffer(cp, ep) || !this->StartDeflate())
+    {
+      return false;
+    }
+  }
   else if (tsyntax != "1.2.840.10008.1.2.1") // Explicit LE
   {
     this->Compressed = true;
@@ -1504,7 +1627,19 @@ bool vtkDICOMCompiler::WriteMetaData(
 
   // if last element is PixelData, don't write it yet
   bool hasPixelData = false;
-  if (iterEnd != iter)
+  if (this->SourceFileName)
+  {
+    // when copying the pixel data, stop at the PixelData element
+    vtkDICOMDataElementIterator pixelElement = iter;
+    while (pixelElement != iterEnd &&
+           pixelElement->GetTag() != vtkDICOMTag(DC::PixelData))
+    {
+      ++pixelElement;
+    }
+    hasPixelData = (pixelElement != iterEnd);
+    iterEnd = pixelElement;
+  }
+  else if (iterEnd != iter)
   {
     vtkDICOMDataElementIterator finalElement = iterEnd;
     --finalElement;
@@ -1529,7 +1664,7 @@ bool vtkDICOMCompiler::WriteMetaData(
       vr = vtkDICOMVR::OB;
     }
 
-    if (this->KeepOriginalPixelDataVR)
+    if (this->KeepOriginalPixelDataVR || this->SourceFileName)
     {
       vtkDICOMVR vrOriginal = this->MetaData->Get(idx, DC::PixelData).GetVR();
       if (vrOriginal.IsValid())
@@ -1539,6 +1674,11 @@ bool vtkDICOMCompiler::WriteMetaData(
     }
 
     unsigned int vl = this->ComputePixelDataSize();
+    if (this->SourceFileName)
+    {
+      // the length must match the value that will be copied
+      vl = this->SourceVL;
+    }
 
     // write the data element head
     size_t l = encoder->WriteElementHead(
@@ -1584,6 +1724,105 @@ unsigned int vtkDICOMCompiler::ComputePixelDataSize()
   return vl;
 }
 
+//----------------------------------------------------------------------------
+bool vtkDICOMCompiler::CopyPixelData()
+{
+  const char *fileName = this->SourceFileName;
+
+  if (this->OutputDeflater)
+  {
+    // the source offset would be an offset into the inflated data
+    this->SetErrorCode(vtkErrorCode::FileFormatError);
+    vtkErrorMacro("CopyPixelData: Can't copy PixelData to or from a "
+                  "file with the Deflate transfer syntax.");
+    return false;
+  }
+
+  vtkDICOMFile infile(fileName, vtkDICOMFile::In);
+  if (infile.GetError() || !infile.SetPosition(this->SourceOffset))
+  {
+    this->SetErrorCode(vtkErrorCode::CannotOpenFileError);
+    vtkErrorMacro("CopyPixelData: Can't read PixelData from " << fileName);
+    return false;
+  }
+
+  // use the IO buffer, since the header has already been flushed
+  unsigned char *buffer = this->Buffer;
+  size_t bufferSize = this->ChunkSize;
+
+  // compressed data is stored as items, with a sequence delimiter
+  const unsigned int itemTag = (static_cast<unsigned int>(HxE000) << 16) |
+                               HxFFFE;
+  const unsigned int endTag = (static_cast<unsigned int>(HxE0DD) << 16) |
+                              HxFFFE;
+  bool encapsulated = (this->SourceVL == HxFFFFFFFF);
+  vtkTypeInt64 remaining = (encapsulated ? 0 : this->SourceVL);
+  unsigned long errorCode = vtkErrorCode::PrematureEndOfFileError;
+  const char *errText = nullptr;
+  bool done = false;
+  bool r = true;
+
+  while (r && !done)
+  {
+    if (encapsulated)
+    {
+      // read the item head (always little endian)
+      if (infile.Read(buffer, 8) != 8)
+      {
+        errText = "Premature end of file while copying PixelData from ";
+        break;
+      }
+      unsigned int tag = vtkDICOMUtilities::UnpackUnsignedInt(buffer);
+      unsigned int vl = vtkDICOMUtilities::UnpackUnsignedInt(buffer + 4);
+      if ((tag != itemTag && tag != endTag) || vl == HxFFFFFFFF)
+      {
+        errorCode = vtkErrorCode::FileFormatError;
+        errText = "Bad fragment in the PixelData of ";
+        break;
+      }
+      done = (tag == endTag);
+      remaining = vl;
+      r = (this->WriteToFile(buffer, 8) == 8);
+    }
+    else
+    {
+      done = true;
+    }
+
+    // copy the value (or the fragment)
+    while (r && remaining > 0)
+    {
+      size_t n = bufferSize;
+      if (remaining < static_cast<vtkTypeInt64>(n))
+      {
+        n = static_cast<size_t>(remaining);
+      }
+      if (infile.Read(buffer, n) != n)
+      {
+        errText = "Premature end of file while copying PixelData from ";
+        break;
+      }
+      r = (this->WriteToFile(buffer, n) == n);
+      remaining -= n;
+    }
+    if (errText)
+    {
+      break;
+    }
+  }
+
+  infile.Close();
+
+  if (errText)
+  {
+    this->SetErrorCode(errorCode);
+    vtkErrorMacro("CopyPixelData: " << errText << fileName);
+    return false;
+  }
+
+  return r;
+}
+
 //----------------------------------------------------------------------------
 bool vtkDICOMCompiler::FlushBuffer(
   unsigned char* &ucp, unsigned char* &ep)
@@ -1597,19 +1836,130 @@ bool vtkDICOMCompiler::FlushBuffer(
   if (cp)
   {
     size_t n = cp - dp;
-    size_t m = this->OutputFile->Write(dp, n);
+    size_t m = this->WriteToFile(dp, n);
     rval = (n == m);
   }
 
   return rval;
 }
 
+//----------------------------------------------------------------------------
+size_t vtkDICOMCompiler::WriteToFile(const unsigned char *cp, size_t n)
+{
+  if (this->OutputDeflater)
+  {
+    return (this->WriteDeflated(cp, n, false) ? n : 0);
+  }
+
+  size_t m = this->OutputFile->Write(cp, n);
+  this->BytesWritten += m;
+  return m;
+}
+
+//----------------------------------------------------------------------------
+bool vtkDICOMCompiler::StartDeflate()
+{
+  Deflater *deflater = new Deflater;
+  deflater->BufferSize = this->ChunkSize;
+  deflater->Buffer = new unsigned char[deflater->BufferSize];
+  deflater->BytesOut = 0;
+
+  // the standard requires raw deflate, i.e. no zlib header
+  z_stream *strm = &deflater->Stream;
+  strm->zalloc = Z_NULL;
+  strm->zfree = Z_NULL;
+  strm->opaque = Z_NULL;
+  if (deflateInit2(strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                   -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+  {
+    delete [] deflater->Buffer;
+    delete deflater;
+    this->CompileError("Unable to initialize zlib deflate.");
+    return false;
+  }
+
+  this->OutputDeflater = deflater;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkDICOMCompiler::WriteDeflated(
+  const unsigned char *cp, size_t n, bool finish)
+{
+  Deflater *deflater = this->OutputDeflater;
+  z_stream *strm = &deflater->Stream;
+
+  do
+  {
+    // the zlib counters are 32-bit, so large writes must be split
+    size_t m = (n < 0x40000000 ? n : 0x40000000);
+    strm->next_in = const_cast<Bytef *>(cp);
+    strm->avail_in = static_cast<uInt>(m);
+    cp += m;
+    n -= m;
+    int flush = ((finish && n == 0) ? Z_FINISH : Z_NO_FLUSH);
+
+    // write the compressed data each time the buffer fills
+    do
+    {
+      strm->next_out = deflater->Buffer;
+      strm->avail_out = static_cast<uInt>(deflater->BufferSize);
+      if (deflate(strm, flush) == Z_STREAM_ERROR)
+      {
+        return false;
+      }
+      size_t l = deflater->BufferSize - strm->avail_out;
+      if (l > 0 && this->OutputFile->Write(deflater->Buffer, l) != l)
+      {
+        return false;
+      }
+      deflater->BytesOut += l;
+      this->BytesWritten += l;
+    }
+    while (strm->avail_out == 0);
+  }
+  while (n != 0);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkDICOMCompiler::EndDeflate(bool finish)
+{
+  Deflater *deflater = this->OutputDeflater;
+  if (deflater == nullptr)
+  {
+    return true;
+  }
+
+  bool rval = true;
+  if (finish)
+  {
+    rval = this->WriteDeflated(nullptr, 0, true);
+    if (rval && (deflater->BytesOut & 1) != 0)
+    {
+      // the deflated data must be padded to an even length
+      static const unsigned char pad[1] = { 0 };
+      rval = (this->OutputFile->Write(pad, 1) == 1);
+      this->BytesWritten += (rval ? 1 : 0);
+    }
+  }
+
+  deflateEnd(&deflater->Stream);
+  delete [] deflater->Buffer;
+  delete deflater;
+  this->OutputDeflater = nullptr;
+
+  return rval;
+}
+
 //----------------------------------------------------------------------------
 void vtkDICOMCompiler::CompileError(const char* message)
 {
   this->SetErrorCode(vtkErrorCode::FileFormatError);
   vtkErrorMacro("Error while writing file "
-                << this->FileName << ": " << message);
+                << (this->FileName ? this->FileName : "(stream)")
+                << ": " << message);
 }
 
 //----------------------------------------------------------------------------
@@ -1618,7 +1968,8 @@ void vtkDICOMCompiler::DiskFullError()
   this->CloseAndRemove();
   this->SetErrorCode(vtkErrorCode::OutOfDiskSpaceError);
   vtkErrorMacro("Error while writing file "
-                << this->FileName << ": Out of disk space.");
+                << (this->FileName ? this->FileName : "(stream)")
+                << ": Out of disk space.");
 }
 
 //----------------------------------------------------------------------------
@@ -1628,6 +1979,7 @@ void vtkDICOMCompiler::PrintSelf(ostream& os, vtkIndent indent)
 
   os << indent << "FileName: "
      << (this->FileName ? this->FileName : "(NULL)") << "\n";
+  os << indent << "OutputStream: " << this->OutputStream << "\n";
   os << indent << "SOPInstanceUID: "
      << (this->SOPInstanceUID ? this->SOPInstanceUID : "(NULL)") << "\n";
   os << indent << "SeriesInstanceUID: "
@@ -1652,4 +2004,7 @@ void vtkDICOMCompiler::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "BufferSize: " << this->BufferSize << "\n";
   os << indent << "KeepOriginalPixelDataVR: "
      << (this->KeepOriginalPixelDataVR ? "On\n" : "Off\n");
+  os << indent << "PixelDataSource: "
+     << (this->SourceFileName ? this->SourceFileName : "(NULL)") << " "
+     << this->SourceOffset << " " << this->SourceVL << "\n";
 }
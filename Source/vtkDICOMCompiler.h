@@ -30,7 +30,9 @@ VTK_ABI_NAMESPACE_END
 #endif
 
 class vtkDICOMFile;
+class vtkDICOMStream;
 class vtkDICOMMetaData;
+class vtkDICOMTraceSpan;
 class vtkDICOMCompilerInternalFriendship;
 
 //! A writer for DICOM meta data.
@@ -56,6 +58,18 @@ public:
   vtkGetStringMacro(FileName);
   //@}
 
+  //@{
+  //! Write to a stream, instead of to a file.
+  /*!
+   *  If a stream is set, then the data will be written to the stream and
+   *  the FileName will only be used in error messages.  This allows data
+   *  to be written directly to memory, via vtkDICOMMemoryStream, or to
+   *  any other destination.  The stream is not deleted by the compiler.
+   */
+  void SetOutputStream(vtkDICOMStream *stream);
+  vtkDICOMStream *GetOutputStream() { return this->OutputStream; }
+  //@}
+
   //@{
   //! Set the SOP Instance UID.
   /*!
@@ -201,6 +215,29 @@ public:
   vtkGetMacro(KeepOriginalPixelDataVR, bool);
   //@}
 
+  //@{
+  //! Copy the PixelData from an existing file, instead of encoding it.
+  /*!
+   *  This allows a file to be rewritten with modified meta data (for
+   *  example, for de-identification) without decoding or even loading
+   *  the pixel data.  The offset and length of the PixelData value are
+   *  provided by vtkDICOMParser::GetFileOffset() and GetPixelDataVL()
+   *  after the source file has been parsed, and the PixelData value,
+   *  including the fragments of compressed data, is streamed directly
+   *  from the source file by WriteHeader().  The TransferSyntaxUID must
+   *  be set to the transfer syntax of the source file, which must not
+   *  be the Deflate transfer syntax, and WritePixelData() and WriteFrame()
+   *  must not be called.  Any elements that follow the PixelData in the
+   *  meta data are discarded.  Set the file name to null to go back to
+   *  writing the pixel data with WritePixelData() or WriteFrame().
+   */
+  void SetPixelDataSource(
+    const char *filename, vtkTypeInt64 offset, unsigned int vl);
+  const char *GetPixelDataSourceFileName() { return this->SourceFileName; }
+  vtkTypeInt64 GetPixelDataSourceOffset() { return this->SourceOffset; }
+  unsigned int GetPixelDataSourceVL() { return this->SourceVL; }
+  //@}
+
 protected:
   vtkDICOMCompiler();
   ~vtkDICOMCompiler() VTK_DICOM_OVERRIDE;
@@ -250,6 +287,32 @@ protected:
   //! Compute the size of the pixel data (0xffffffff if compressed).
   unsigned int ComputePixelDataSize();
 
+  //! Copy the PixelData value from the source file, after the header.
+  bool CopyPixelData();
+
+  //! Write data to the file, deflating it if necessary.
+  size_t WriteToFile(const unsigned char *cp, size_t n);
+
+  //! Start deflating the data set, for the Deflate transfer syntax.
+  /*!
+   *  Everything that is written to the file after this is called
+   *  will be deflated, including the pixel data.
+   */
+  bool StartDeflate();
+
+  //! Deflate data and write it to the file.
+  /*!
+   *  If "finish" is set, then all remaining compressed data will be
+   *  written.  The return value is false if a write error occurred.
+   */
+  bool WriteDeflated(const unsigned char *cp, size_t n, bool finish);
+
+  //! Finish deflating (or abort, if "finish" is not set).
+  bool EndDeflate(bool finish);
+
+  //! The state of the deflater, used for the Deflate transfer syntax.
+  class Deflater;
+
   char *FileName;
   char *SOPInstanceUID;
   char *SeriesInstanceUID;
@@ -258,15 +321,22 @@ protected:
   char *ImplementationVersionName;
   char *SourceApplicationEntityTitle;
   char *TransferSyntaxUID;
+  char *SourceFileName;
+  vtkTypeInt64 SourceOffset;
+  unsigned int SourceVL;
   vtkDICOMMetaData *MetaData;
   vtkStringArray *SeriesUIDs;
   vtkDICOMFile *OutputFile;
+  vtkDICOMStream *OutputStream;
+  Deflater *OutputDeflater;
+  vtkDICOMTraceSpan *Span;
   unsigned char *Buffer;
   unsigned char **FrameData;
   unsigned int *FrameLength;
   unsigned int FrameCounter;
   int BufferSize;
   int ChunkSize;
+  vtkTypeInt64 BytesWritten;
   int Index;
   bool BigEndian;
   bool Compressed;
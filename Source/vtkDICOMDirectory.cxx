@@ -12,14 +12,17 @@
 
 =========================================================================*/
 #include "vtkDICOMDirectory.h"
+#include "vtkDICOMArchive.h"
 
 #include "vtkDICOMFile.h"
 #include "vtkDICOMFileDirectory.h"
 #include "vtkDICOMFilePath.h"
+#include "vtkDICOMFilePathTable.h"
 #include "vtkDICOMItem.h"
 #include "vtkDICOMMetaData.h"
 #include "vtkDICOMSequence.h"
 #include "vtkDICOMParser.h"
+#include "vtkDICOMTracer.h"
 #include "vtkDICOMUtilities.h"
 #include "vtkDICOMVR.h"
 
@@ -39,11 +42,12 @@
 #include <sstream>
 #include <vector>
 #include <list>
-#include <map>
 #include <algorithm>
 #include <utility>
 
 #include <ctype.h>
+#include <stdio.h>
+#include <string.h>
 #include <stdlib.h>
 
 vtkStandardNewMacro(vtkDICOMDirectory);
@@ -54,7 +58,9 @@ vtkStandardNewMacro(vtkDICOMDirectory);
 struct vtkDICOMDirectory::SeriesItem
 {
   vtkDICOMItem Record;
-  vtkSmartPointer<vtkStringArray> Files;
+  vtkIdType FirstFile; // index into FilePaths, or -1 if released
+  vtkIdType NumberOfFiles;
+  vtkSmartPointer<vtkStringArray> Files; // created on demand
   vtkSmartPointer<vtkDICOMMetaData> Meta;
 };
 
@@ -94,9 +100,11 @@ class vtkDICOMDirectory::VisitedVector
 struct vtkDICOMDirectory::FileInfo
 {
   unsigned int InstanceNumber;
-  const char *FileName;
+  vtkIdType FileId; // index into the input path table
   vtkDICOMValue ImageUID;
   vtkDICOMItem ImageRecord;
+  vtkTypeInt64 SpillOffset; // -1 unless ImageRecord is in spill file
+  unsigned int SpillSize;
 };
 
 struct vtkDICOMDirectory::FileInfoPair
@@ -125,7 +133,10 @@ struct vtkDICOMDirectory::SeriesInfo
   // -- INSTANCES --
   std::list<FileInfo> Files;
   std::vector<FileInfoPair> FilesByUID;
+  size_t FilesToSpill; // files at end of list not yet moved to spill file
+  unsigned int NumberOfInstances; // zero if not known
   bool QueryMatched;
+  bool Completed;
 };
 
 bool vtkDICOMDirectory::CompareInstanceUIDs(
@@ -134,23 +145,23 @@ bool vtkDICOMDirectory::CompareInstanceUIDs(
   return (vtkDICOMUtilities::CompareUIDs(p.Key, uid) < 0);
 }
 
-bool vtkDICOMDirectory::CompareInstance(
-  const FileInfo &fi1, const FileInfo &fi2)
+struct vtkDICOMDirectory::CompareInstance
 {
-  if (fi1.InstanceNumber != fi2.InstanceNumber)
-  {
-    return (fi1.InstanceNumber < fi2.InstanceNumber);
-  }
+  const vtkDICOMFilePathTable *Paths;
 
-  // fall back to filename comparison
-  if (fi1.FileName != nullptr && fi2.FileName != nullptr)
+  CompareInstance(const vtkDICOMFilePathTable *paths) : Paths(paths) {}
+
+  bool operator()(const FileInfo &fi1, const FileInfo &fi2) const
   {
-    return (strcmp(fi1.FileName, fi2.FileName) < 0);
-  }
+    if (fi1.InstanceNumber != fi2.InstanceNumber)
+    {
+      return (fi1.InstanceNumber < fi2.InstanceNumber);
+    }
 
-  // null filename sorts before non-null filename
-  return (fi2.FileName != nullptr);
-}
+    // fall back to filename comparison
+    return (this->Paths->Compare(fi1.FileId, fi2.FileId) < 0);
+  }
+};
 
 bool vtkDICOMDirectory::CompareSeriesUIDs(
   const SeriesInfo *si, const char *uid)
@@ -362,10 +373,13 @@ vtkDICOMDirectory::vtkDICOMDirectory()
   this->FilePattern = nullptr;
   this->DefaultCharacterSet = vtkDICOMCharacterSet::GetGlobalDefault();
   this->OverrideCharacterSet = vtkDICOMCharacterSet::GetGlobalOverride();
+  this->StreamSeries = 0;
+  this->MemoryBudget = 0;
   this->Series = new SeriesVector;
   this->Studies = new StudyVector;
   this->Patients = new PatientVector;
   this->Visited = new VisitedVector;
+  this->FilePaths = new vtkDICOMFilePathTable;
   this->FileSetID = nullptr;
   this->InternalFileName = nullptr;
   this->QueryFiles = -1;
@@ -399,6 +413,7 @@ vtkDICOMDirectory::~vtkDICOMDirectory()
   delete this->Studies;
   delete this->Patients;
   delete this->Visited;
+  delete this->FilePaths;
   delete [] this->FileSetID;
   delete this->Query;
 }
@@ -434,6 +449,11 @@ void vtkDICOMDirectory::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "FollowSymlinks: "
      << (this->FollowSymlinks ? "On\n" : "Off\n");
 
+  os << indent << "StreamSeries: "
+     << (this->StreamSeries ? "On\n" : "Off\n");
+
+  os << indent << "MemoryBudget: " << this->MemoryBudget << "\n";
+
   os << indent << "NumberOfSeries: " << this->GetNumberOfSeries() << "\n";
   os << indent << "NumberOfStudies: " << this->GetNumberOfStudies() << "\n";
   os << indent << "NumberOfPatients: " << this->GetNumberOfPatients() << "\n";
@@ -619,7 +639,29 @@ vtkIntArray *vtkDICOMDirectory::GetStudiesForPatient(int patient)
 //----------------------------------------------------------------------------
 vtkStringArray *vtkDICOMDirectory::GetFileNamesForSeries(int i)
 {
-  return (*this->Series)[i].Files;
+  SeriesItem& item = (*this->Series)[i];
+  if (item.Files == nullptr && item.FirstFile >= 0)
+  {
+    item.Files = vtkSmartPointer<vtkStringArray>::New();
+    item.Files->SetNumberOfValues(item.NumberOfFiles);
+    for (vtkIdType j = 0; j < item.NumberOfFiles; j++)
+    {
+      item.Files->SetValue(j, this->FilePaths->GetPath(item.FirstFile + j));
+    }
+  }
+  return item.Files;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkDICOMDirectory::GetNumberOfFilesForSeries(int i)
+{
+  return (*this->Series)[i].NumberOfFiles;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkDICOMDirectory::GetFirstFileIdForSeries(int i)
+{
+  return (*this->Series)[i].FirstFile;
 }
 
 //----------------------------------------------------------------------------
@@ -1117,8 +1159,28 @@ void vtkDICOMDirectory::AddSeriesFileNames(
   this->Series->push_back(SeriesItem());
   SeriesItem& item = this->Series->back();
   item.Record = seriesRecord;
-  item.Files = files;
+  item.NumberOfFiles = ni;
   item.Meta = meta;
+
+  if (this->StreamSeries)
+  {
+    // Report the series, and then release the files and meta data
+    item.FirstFile = -1;
+    item.Files = files;
+    int idx = series - 1;
+    this->InvokeEvent(vtkDICOMDirectory::SeriesCompleteEvent, &idx);
+    (*this->Series)[idx].Files = nullptr;
+    (*this->Series)[idx].Meta = nullptr;
+  }
+  else
+  {
+    // Store the file names in the compact path table
+    item.FirstFile = this->FilePaths->GetNumberOfPaths();
+    for (int ii = 0; ii < ni; ii++)
+    {
+      this->FilePaths->InsertNextPath(files->GetValue(ii));
+    }
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -1267,8 +1329,327 @@ void vtkDICOMDirectory::FillPatientRecord(
   }
 }
 
+//----------------------------------------------------------------------------
+// Encoding of records as blobs, for index files and for spill files
+namespace {
+
+// Append a value to a blob, in native byte order
+template<class T>
+void EncodeValue(std::string *blob, const T *data, unsigned int vl)
+{
+  if (data)
+  {
+    blob->append(reinterpret_cast<const char *>(data), vl);
+  }
+}
+
+// Encode a record as a blob: for each element, the tag (4 bytes), the
+// VR (2 bytes), the character set (1 byte), the VL (4 bytes), and the
+// value in native byte order
+void EncodeRecord(const vtkDICOMItem& item, std::string *blob)
+{
+  blob->clear();
+  vtkDICOMDataElementIterator iter;
+  for (iter = item.Begin(); iter != item.End(); ++iter)
+  {
+    const vtkDICOMValue& v = iter->GetValue();
+    vtkDICOMVR vr = v.GetVR();
+    unsigned int vl = v.GetVL();
+    int vt = vr.GetType();
+    if (!v.IsValid() || vl == 0xffffffff ||
+        vt == VTK_DICOM_ITEM || vt == VTK_DICOM_VALUE)
+    {
+      continue;
+    }
+
+    size_t start = blob->length();
+    unsigned short g = iter->GetTag().GetGroup();
+    unsigned short e = iter->GetTag().GetElement();
+    unsigned char cs = v.GetCharacterSet().GetKey();
+    blob->append(reinterpret_cast<const char *>(&g), 2);
+    blob->append(reinterpret_cast<const char *>(&e), 2);
+    blob->append(vr.GetText(), 2);
+    blob->push_back(static_cast<char>(cs));
+    blob->append(reinterpret_cast<const char *>(&vl), 4);
+
+    size_t l = blob->length();
+    switch (vt)
+    {
+      case VTK_CHAR:
+        EncodeValue(blob, v.GetCharData(), vl);
+        break;
+      case VTK_UNSIGNED_CHAR:
+        EncodeValue(blob, v.GetUnsignedCharData(), vl);
+        break;
+      case VTK_SHORT:
+        EncodeValue(blob, v.GetShortData(), vl);
+        break;
+      case VTK_UNSIGNED_SHORT:
+        EncodeValue(blob, v.GetUnsignedShortData(), vl);
+        break;
+      case VTK_INT:
+        EncodeValue(blob, v.GetIntData(), vl);
+        break;
+      case VTK_UNSIGNED_INT:
+        EncodeValue(blob, v.GetUnsignedIntData(), vl);
+        break;
+      case VTK_LONG_LONG:
+        EncodeValue(blob, v.GetInt64Data(), vl);
+        break;
+      case VTK_UNSIGNED_LONG_LONG:
+        EncodeValue(blob, v.GetUnsignedInt64Data(), vl);
+        break;
+      case VTK_FLOAT:
+        EncodeValue(blob, v.GetFloatData(), vl);
+        break;
+      case VTK_DOUBLE:
+        EncodeValue(blob, v.GetDoubleData(), vl);
+        break;
+      case VTK_DICOM_TAG:
+        EncodeValue(blob, v.GetTagData(), vl);
+        break;
+    }
+
+    // remove the element if the value was not stored
+    if (blob->length() != l + vl)
+    {
+      blob->resize(start);
+    }
+  }
+}
+
+// Create a value from data that was stored in a blob
+template<class T>
+vtkDICOMValue DecodeValue(vtkDICOMVR vr, const char *cp, unsigned int vl)
+{
+  size_t n = vl/sizeof(T);
+  std::vector<T> data(n + 1);
+  memcpy(&data[0], cp, n*sizeof(T));
+  return vtkDICOMValue(vr, &data[0], n);
+}
+
+// Decode a record that was stored with EncodeRecord
+void DecodeRecord(const void *vp, size_t l, vtkDICOMItem *item)
+{
+  const char *cp = static_cast<const char *>(vp);
+  const char *ep = cp + l;
+  while (ep - cp >= 11)
+  {
+    unsigned short g, e;
+    unsigned int vl;
+    memcpy(&g, cp, 2);
+    memcpy(&e, cp + 2, 2);
+    vtkDICOMVR vr(cp + 4);
+    vtkDICOMCharacterSet cs(static_cast<unsigned char>(cp[6]));
+    memcpy(&vl, cp + 7, 4);
+    cp += 11;
+    if (static_cast<size_t>(ep - cp) < vl)
+    {
+      break;
+    }
+
+    vtkDICOMValue v;
+    switch (vr.GetType())
+    {
+      case VTK_CHAR:
+        v = vtkDICOMValue(vr, cs, cp, vl);
+        break;
+      case VTK_UNSIGNED_CHAR:
+        v = vtkDICOMValue(vr, reinterpret_cast<const unsigned char *>(cp), vl);
+        break;
+      case VTK_SHORT:
+        v = DecodeValue<short>(vr, cp, vl);
+        break;
+      case VTK_UNSIGNED_SHORT:
+        v = DecodeValue<unsigned short>(vr, cp, vl);
+        break;
+      case VTK_INT:
+        v = DecodeValue<int>(vr, cp, vl);
+        break;
+      case VTK_UNSIGNED_INT:
+        v = DecodeValue<unsigned int>(vr, cp, vl);
+        break;
+      case VTK_LONG_LONG:
+        v = DecodeValue<long long>(vr, cp, vl);
+        break;
+      case VTK_UNSIGNED_LONG_LONG:
+        v = DecodeValue<unsigned long long>(vr, cp, vl);
+        break;
+      case VTK_FLOAT:
+        v = DecodeValue<float>(vr, cp, vl);
+        break;
+      case VTK_DOUBLE:
+        v = DecodeValue<double>(vr, cp, vl);
+        break;
+      case VTK_DICOM_TAG:
+        v = DecodeValue<vtkDICOMTag>(vr, cp, vl);
+        break;
+    }
+    cp += vl;
+
+    if (v.IsValid())
+    {
+      item->Set(vtkDICOMTag(g, e), v);
+    }
+  }
+}
+
+// Check whether every value in a record can be stored by EncodeRecord
+bool CanEncodeRecord(const vtkDICOMItem& item)
+{
+  vtkDICOMDataElementIterator iter;
+  for (iter = item.Begin(); iter != item.End(); ++iter)
+  {
+    const vtkDICOMValue& v = iter->GetValue();
+    int vt = v.GetVR().GetType();
+    if (v.GetVL() == 0xffffffff ||
+        vt == VTK_DICOM_ITEM || vt == VTK_DICOM_VALUE)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Estimate the memory that is used by a record
+vtkIdType RecordMemorySize(const vtkDICOMItem& item)
+{
+  // allow 32 bytes of overhead for each element
+  vtkIdType size = 0;
+  vtkDICOMDataElementIterator iter;
+  for (iter = item.Begin(); iter != item.End(); ++iter)
+  {
+    size += iter->GetValue().GetVL() + 32;
+  }
+  return size;
+}
+
+// Seek within a file that might be larger than 2GB
+int SeekLargeFile(FILE *fp, vtkTypeInt64 offset)
+{
+#ifdef _WIN32
+  return _fseeki64(fp, offset, SEEK_SET);
+#else
+  return fseeko(fp, static_cast<off_t>(offset), SEEK_SET);
+#endif
+}
+
+} // end anonymous namespace
+
+//----------------------------------------------------------------------------
+// A temporary file for image records, used when the memory budget is
+// exceeded during a scan.  The file is deleted when it is closed.
+
+class vtkDICOMDirectory::RecordSpill
+{
+public:
+  RecordSpill() : File(nullptr), Size(0) {}
+  ~RecordSpill() { if (this->File) { fclose(this->File); } }
+
+  //! Move an image record to the file, return false on failure.
+  bool Store(FileInfo *fi);
+
+  //! Read an image record back from the file.
+  bool Restore(FileInfo *fi);
+
+private:
+  FILE *File;
+  vtkTypeInt64 Size;
+  std::string Buffer;
+};
+
+bool vtkDICOMDirectory::RecordSpill::Store(FileInfo *fi)
+{
+  if (!CanEncodeRecord(fi->ImageRecord))
+  {
+    return false;
+  }
+
+  if (this->File == nullptr)
+  {
+    this->File = tmpfile();
+    if (this->File == nullptr)
+    {
+      return false;
+    }
+  }
+
+  EncodeRecord(fi->ImageRecord, &this->Buffer);
+  size_t l = this->Buffer.length();
+  if (SeekLargeFile(this->File, this->Size) != 0 ||
+      fwrite(this->Buffer.data(), 1, l, this->File) != l)
+  {
+    return false;
+  }
+
+  fi->SpillOffset = this->Size;
+  fi->SpillSize = static_cast<unsigned int>(l);
+  fi->ImageRecord.Clear();
+  this->Size += l;
+  return true;
+}
+
+bool vtkDICOMDirectory::RecordSpill::Restore(FileInfo *fi)
+{
+  if (fi->SpillOffset < 0)
+  {
+    return true;
+  }
+
+  size_t l = fi->SpillSize;
+  this->Buffer.resize(l);
+  bool success = (SeekLargeFile(this->File, fi->SpillOffset) == 0 &&
+                  fread(&this->Buffer[0], 1, l, this->File) == l);
+  if (success)
+  {
+    DecodeRecord(this->Buffer.data(), l, &fi->ImageRecord);
+  }
+  fi->SpillOffset = -1;
+  return success;
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMDirectory::AddSeriesInfo(
+  int patient, int study, SeriesInfo *v, RecordSpill *spill,
+  const vtkDICOMFilePathTable *paths)
+{
+  vtkSmartPointer<vtkStringArray> sa =
+    vtkSmartPointer<vtkStringArray>::New();
+  vtkIdType n = static_cast<vtkIdType>(v->Files.size());
+  sa->SetNumberOfValues(n);
+  std::vector<const vtkDICOMItem *> imageRecords(n);
+  v->Files.sort(CompareInstance(paths));
+  std::list<FileInfo>::iterator fi = v->Files.begin();
+  for (vtkIdType i = 0; i < n; i++)
+  {
+    std::string fileName = paths->GetPath(fi->FileId);
+    if (!spill->Restore(&(*fi)))
+    {
+      vtkWarningMacro("Unable to read back attributes for " << fileName);
+    }
+    sa->SetValue(i, fileName);
+    imageRecords[i] = &fi->ImageRecord;
+    ++fi;
+  }
+  this->AddSeriesFileNames(
+    patient, study, sa,
+    v->PatientRecord, v->StudyRecord, v->SeriesRecord, &imageRecords[0]);
+}
+
 //----------------------------------------------------------------------------
 void vtkDICOMDirectory::SortFiles(vtkStringArray *input)
+{
+  vtkDICOMFilePathTable paths;
+  vtkIdType n = input->GetNumberOfValues();
+  for (vtkIdType i = 0; i < n; i++)
+  {
+    paths.InsertNextPath(input->GetValue(i));
+  }
+  this->SortFiles(&paths);
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMDirectory::SortFiles(vtkDICOMFilePathTable *input)
 {
   vtkSmartPointer<vtkDICOMMetaData> meta =
     vtkSmartPointer<vtkDICOMMetaData>::New();
@@ -1292,6 +1673,13 @@ void vtkDICOMDirectory::SortFiles(vtkStringArray *input)
     query->Set(*tagPtr, vtkDICOMValue(vr));
   }
 
+  if (this->StreamSeries)
+  {
+    // needed to know when each series is complete
+    query->Set(DC::NumberOfSeriesRelatedInstances,
+               vtkDICOMValue(vtkDICOMVR::IS));
+  }
+
   if (this->Query)
   {
     // add elements that the user requested for the query
@@ -1314,13 +1702,19 @@ void vtkDICOMDirectory::SortFiles(vtkStringArray *input)
 
   // List of all series that have been found
   SeriesInfoList seriesList; // in order of discovery
+  SeriesInfoList::iterator li;
   SeriesInfoVector seriesByUID; // sorted by UID
 
-  vtkIdType numberOfStrings = input->GetNumberOfValues();
+  // For image records that exceed the memory budget
+  RecordSpill spill;
+  std::vector<SeriesInfo *> spillQueue; // series with FilesToSpill > 0
+  vtkIdType memoryUsed = 0;
+
+  vtkIdType numberOfStrings = input->GetNumberOfPaths();
 
   for (vtkIdType j = 0; j < numberOfStrings; j++)
   {
-    const std::string& fileName = input->GetValue(j);
+    std::string fileName = input->GetPath(j);
 
     // Skip anything that does not look like a DICOM file.
     if (!vtkDICOMUtilities::IsDICOMFile(fileName.c_str()))
@@ -1402,8 +1796,10 @@ void vtkDICOMDirectory::SortFiles(vtkStringArray *input)
     // Create a FileInfo record and find the series it belongs to
     FileInfo fileInfo;
     fileInfo.InstanceNumber = meta->Get(DC::InstanceNumber).AsUnsignedInt();
-    fileInfo.FileName = fileName.c_str(); // stored in input StringArray
+    fileInfo.FileId = j;
     fileInfo.ImageUID = meta->Get(DC::SOPInstanceUID);
+    fileInfo.SpillOffset = -1;
+    fileInfo.SpillSize = 0;
 
     const vtkDICOMValue& studyUIDValue = meta->Get(DC::StudyInstanceUID);
     const vtkDICOMValue& seriesUIDValue = meta->Get(DC::SeriesInstanceUID);
@@ -1414,7 +1810,7 @@ void vtkDICOMDirectory::SortFiles(vtkStringArray *input)
     const char *imageUID = fileInfo.ImageUID.GetCharData();
 
     bool sameFile = false;
-    bool foundSeries = false;
+    SeriesInfo *foundSeries = nullptr;
 
     // Locate the first potential match
     SeriesInfoVector::iterator vib =
@@ -1430,6 +1826,12 @@ void vtkDICOMDirectory::SortFiles(vtkStringArray *input)
     {
       SeriesInfo &v = *(*vi);
 
+      // Series that were already reported cannot be added to
+      if (v.Completed)
+      {
+        continue;
+      }
+
       // For files that lack the mandatory SeriesInstanceUID,
       // we also check whether SeriesNumber is the same
       if ((seriesUID == nullptr || seriesUID[0] == '\0') &&
@@ -1459,7 +1861,8 @@ void vtkDICOMDirectory::SortFiles(vtkStringArray *input)
           // (SameFile() is expensive, so check InstanceNumber first)
           FileInfo &f = *im->Info;
           if (f.InstanceNumber == fileInfo.InstanceNumber &&
-              vtkDICOMFile::SameFile(f.FileName, fileInfo.FileName))
+              vtkDICOMFile::SameFile(
+                input->GetPath(f.FileId).c_str(), fileName.c_str()))
           {
             // Let's ignore this file
             sameFile = true;
@@ -1488,7 +1891,7 @@ void vtkDICOMDirectory::SortFiles(vtkStringArray *input)
       v.FilesByUID.insert(im, FileInfoPair(f.ImageUID.GetCharData(), &f));
       this->FillImageRecord(&f.ImageRecord, meta, &skip[0], skip.size());
       v.QueryMatched |= queryMatched;
-      foundSeries = true;
+      foundSeries = &v;
       break;
     }
 
@@ -1514,21 +1917,98 @@ void vtkDICOMDirectory::SortFiles(vtkStringArray *input)
       v.Files.push_back(fileInfo);
       FileInfo &f = v.Files.back();
       v.FilesByUID.push_back(FileInfoPair(f.ImageUID.GetCharData(), &f));
+      v.FilesToSpill = 0;
+      v.NumberOfInstances =
+        meta->Get(DC::NumberOfSeriesRelatedInstances).AsUnsignedInt();
       v.QueryMatched = queryMatched;
+      v.Completed = false;
       this->FillPatientRecord(&v.PatientRecord, meta);
       this->FillStudyRecord(&v.StudyRecord, meta);
       this->FillSeriesRecord(&v.SeriesRecord, meta);
       skip.SetFrom(v.PatientRecord, v.StudyRecord, v.SeriesRecord);
       this->FillImageRecord(&f.ImageRecord, meta, &skip[0], skip.size());
+      foundSeries = &v;
+    }
+
+    SeriesInfo &v = *foundSeries;
+
+    // If over the memory budget, move the image records to a file
+    memoryUsed += RecordMemorySize(v.Files.back().ImageRecord);
+    if (this->MemoryBudget > 0)
+    {
+      // Files are appended to the series, so the ones that have not
+      // been considered for spilling are at the end of the list
+      if (v.FilesToSpill++ == 0)
+      {
+        spillQueue.push_back(&v);
+      }
+      if (memoryUsed > this->MemoryBudget)
+      {
+        // Each record is visited once, even if it cannot be spilled
+        for (size_t k = 0; k < spillQueue.size(); k++)
+        {
+          SeriesInfo *s = spillQueue[k];
+          std::list<FileInfo>::reverse_iterator fi = s->Files.rbegin();
+          for (; s->FilesToSpill > 0; s->FilesToSpill--, ++fi)
+          {
+            vtkIdType m = RecordMemorySize(fi->ImageRecord);
+            if (spill.Store(&(*fi)))
+            {
+              memoryUsed -= m;
+            }
+          }
+        }
+        spillQueue.clear();
+      }
+    }
+
+    // If streaming, report the series as soon as it is complete
+    if (this->StreamSeries && v.NumberOfInstances > 0 &&
+        v.Files.size() >= v.NumberOfInstances)
+    {
+      std::list<FileInfo>::iterator fi;
+      for (fi = v.Files.begin(); fi != v.Files.end(); ++fi)
+      {
+        memoryUsed -= RecordMemorySize(fi->ImageRecord);
+      }
+      memoryUsed = (memoryUsed > 0 ? memoryUsed : 0);
+
+      if (v.QueryMatched)
+      {
+        // Continue the most recent patient and study, if possible
+        int patient = this->GetNumberOfPatients();
+        int study = this->GetNumberOfStudies();
+        if (patient > 0 && study > 0 &&
+            this->Studies->back().PatientRecord.Get(DC::PatientID) ==
+              v.PatientID)
+        {
+          patient--;
+          if (this->Studies->back().Record.Get(DC::StudyInstanceUID) ==
+                v.StudyUID)
+          {
+            study--;
+          }
+        }
+        this->AddSeriesInfo(patient, study, &v, &spill, input);
+      }
+
+      // Release everything except what is needed to find the series
+      v.Files.clear();
+      v.FilesByUID.clear();
+      v.FilesToSpill = 0;
+      v.PatientRecord.Clear();
+      v.StudyRecord.Clear();
+      v.SeriesRecord.Clear();
+      v.Completed = true;
     }
   }
 
-  // Remove any series that do not match the query
+  // Remove any series that do not match the query, or were reported
   seriesByUID.clear();
-  SeriesInfoList::iterator li = seriesList.begin();
+  li = seriesList.begin();
   while (li != seriesList.end())
   {
-    if (!li->QueryMatched)
+    if (!li->QueryMatched || li->Completed)
     {
       SeriesInfoList::iterator ci = li;
       ++li;
@@ -1612,22 +2092,8 @@ void vtkDICOMDirectory::SortFiles(vtkStringArray *input)
       lastInfo = &v;
     }
 
-    vtkSmartPointer<vtkStringArray> sa =
-      vtkSmartPointer<vtkStringArray>::New();
-    vtkIdType n = static_cast<vtkIdType>(v.Files.size());
-    sa->SetNumberOfValues(n);
-    std::vector<const vtkDICOMItem *> imageRecords(n);
-    li->Files.sort(CompareInstance);
-    std::list<FileInfo>::iterator fi = li->Files.begin();
-    for (vtkIdType i = 0; i < n; i++)
-    {
-      sa->SetValue(i, fi->FileName);
-      imageRecords[i] = &fi->ImageRecord;
-      ++fi;
-    }
-    this->AddSeriesFileNames(
-      patientCount-1, studyCount-1, sa,
-      v.PatientRecord, v.StudyRecord, v.SeriesRecord, &imageRecords[0]);
+    this->AddSeriesInfo(
+      patientCount-1, studyCount-1, &v, &spill, input);
   }
 }
 
@@ -1684,21 +2150,45 @@ std::string CleanUID(const std::string& s)
 class SimpleSQL
 {
 public:
-  SimpleSQL() : DBase(nullptr), Statement(nullptr), InTransaction(false) {}
+  SimpleSQL();
   ~SimpleSQL() { this->Close(); }
   bool Open(const char *fname);
-  void Close();
-  bool Prepare(const char *query);
+  bool Create(const char *fname);
+  bool Commit();
+  bool Close();
+  bool Exec(const char *sql);
+  bool Prepare(const char *query, int slot = 0);
+  void Select(int slot) { this->Current = slot; }
   bool Next();
+  bool Step();
+  void Reset();
+  bool Insert();
+  void BindText(int i, const std::string& text);
+  void BindBlob(int i, const std::string& blob);
+  void BindInt64(int i, vtkTypeInt64 x);
+  vtkTypeInt64 GetLastRowId();
   vtkVariant GetValue(int column);
+  const void *GetBlob(int column, size_t *l);
   const char *GetError();
 private:
   void Finalize();
+  sqlite3_stmt *&Statement() { return this->Statements[this->Current]; }
+  // a few statements can be kept prepared, e.g. one per table
+  enum { MaxStatements = 4 };
   sqlite3 *DBase;
-  sqlite3_stmt *Statement;
+  sqlite3_stmt *Statements[MaxStatements];
+  int Current;
   bool InTransaction;
 };
 
+SimpleSQL::SimpleSQL() : DBase(nullptr), Current(0), InTransaction(false)
+{
+  for (int i = 0; i < MaxStatements; i++)
+  {
+    this->Statements[i] = nullptr;
+  }
+}
+
 bool SimpleSQL::Open(const char *fname)
 {
   // convert to URI for use with sqlite3_open()
@@ -1755,81 +2245,169 @@ bool SimpleSQL::Open(const char *fname)
                           SQLITE_OPEN_READONLY|SQLITE_OPEN_URI, nullptr);
   if (r == SQLITE_OK)
   {
-    char *errmsg;
+    char *errmsg = nullptr;
+    r = sqlite3_exec(this->DBase, "BEGIN TRANSACTION",
+                     nullptr, nullptr, &errmsg);
+    sqlite3_free(errmsg);
+    this->InTransaction = (r == SQLITE_OK);
+  }
+
+  return (r == SQLITE_OK);
+}
+
+bool SimpleSQL::Create(const char *fname)
+{
+  // remove any existing file, rather than adding to it
+  if (vtkDICOMFile::Access(fname, vtkDICOMFile::In) == 0)
+  {
+    vtkDICOMFile::Remove(fname);
+  }
+
+  int r = sqlite3_open_v2(fname, &this->DBase,
+                          SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE, nullptr);
+  if (r == SQLITE_OK)
+  {
+    char *errmsg = nullptr;
     r = sqlite3_exec(this->DBase, "BEGIN TRANSACTION",
                      nullptr, nullptr, &errmsg);
+    sqlite3_free(errmsg);
     this->InTransaction = (r == SQLITE_OK);
   }
 
   return (r == SQLITE_OK);
 }
 
-void SimpleSQL::Close()
+bool SimpleSQL::Commit()
 {
+  // nothing is stored in the file until the transaction is committed
   this->Finalize();
+  bool r = true;
   if (this->InTransaction)
   {
-    char *errmsg;
-    sqlite3_exec(this->DBase, "COMMIT", nullptr, nullptr, &errmsg);
+    char *errmsg = nullptr;
+    r = (sqlite3_exec(this->DBase, "COMMIT", nullptr, nullptr, &errmsg)
+         == SQLITE_OK);
+    sqlite3_free(errmsg);
+    this->InTransaction = false;
   }
-  sqlite3_close(this->DBase);
+  return r;
+}
+
+bool SimpleSQL::Close()
+{
+  bool r = this->Commit();
+  r &= (sqlite3_close(this->DBase) == SQLITE_OK);
   this->DBase = nullptr;
+  return r;
+}
+
+bool SimpleSQL::Exec(const char *sql)
+{
+  this->Finalize();
+  return (sqlite3_exec(this->DBase, sql, nullptr, nullptr, nullptr)
+          == SQLITE_OK);
 }
 
-bool SimpleSQL::Prepare(const char *query)
+bool SimpleSQL::Prepare(const char *query, int slot)
 {
-  if (this->Statement)
+  // prepare the statement in the given slot, and select it
+  this->Current = slot;
+  if (this->Statement())
   {
-    sqlite3_finalize(this->Statement);
-    this->Statement = nullptr;
+    sqlite3_finalize(this->Statement());
+    this->Statement() = nullptr;
   }
   const char *ep;
   int l = static_cast<int>(strlen(query));
-  return (sqlite3_prepare_v2(this->DBase, query, l, &this->Statement, &ep)
+  return (sqlite3_prepare_v2(this->DBase, query, l, &this->Statement(), &ep)
           == SQLITE_OK);
 }
 
 bool SimpleSQL::Next()
 {
-  int result = sqlite3_step(this->Statement);
+  int result = sqlite3_step(this->Statement());
   if (result == SQLITE_ROW)
   {
     return true;
   }
 
-  this->Finalize();
+  sqlite3_finalize(this->Statement());
+  this->Statement() = nullptr;
   return false;
 }
 
+bool SimpleSQL::Step()
+{
+  // like Next(), but keep the statement so that it can be reset
+  return (sqlite3_step(this->Statement()) == SQLITE_ROW);
+}
+
+void SimpleSQL::Reset()
+{
+  sqlite3_reset(this->Statement());
+  sqlite3_clear_bindings(this->Statement());
+}
+
+bool SimpleSQL::Insert()
+{
+  // execute the prepared statement, then reset it for the next insert
+  int result = sqlite3_step(this->Statement());
+  sqlite3_reset(this->Statement());
+  sqlite3_clear_bindings(this->Statement());
+  return (result == SQLITE_DONE);
+}
+
+void SimpleSQL::BindText(int i, const std::string& text)
+{
+  sqlite3_bind_text(this->Statement(), i, text.data(),
+                    static_cast<int>(text.length()), SQLITE_TRANSIENT);
+}
+
+void SimpleSQL::BindBlob(int i, const std::string& blob)
+{
+  sqlite3_bind_blob(this->Statement(), i, blob.data(),
+                    static_cast<int>(blob.length()), SQLITE_TRANSIENT);
+}
+
+void SimpleSQL::BindInt64(int i, vtkTypeInt64 x)
+{
+  sqlite3_bind_int64(this->Statement(), i, x);
+}
+
+vtkTypeInt64 SimpleSQL::GetLastRowId()
+{
+  return sqlite3_last_insert_rowid(this->DBase);
+}
+
 vtkVariant SimpleSQL::GetValue(int column)
 {
   vtkVariant v;
-  switch (sqlite3_column_type(this->Statement, column))
+  switch (sqlite3_column_type(this->Statement(), column))
   {
     case SQLITE_INTEGER:
     {
-      vtkTypeInt64 x = sqlite3_column_int64(this->Statement, column);
+      vtkTypeInt64 x = sqlite3_column_int64(this->Statement(), column);
       v = vtkVariant(x);
       break;
     }
     case SQLITE_FLOAT:
     {
-      double x = sqlite3_column_double(this->Statement, column);
+      double x = sqlite3_column_double(this->Statement(), column);
       v = vtkVariant(x);
       break;
     }
     case SQLITE_TEXT:
     {
       const char *x = reinterpret_cast<const char *>(
-        sqlite3_column_text(this->Statement, column));
+        sqlite3_column_text(this->Statement(), column));
       v = vtkVariant(x);
       break;
     }
     case SQLITE_BLOB:
     {
       const char *x = static_cast<const char *>(
-        sqlite3_column_blob(this->Statement, column));
-      size_t l = sqlite3_column_bytes(this->Statement, column);
+        sqlite3_column_blob(this->Statement(), column));
+      size_t l = sqlite3_column_bytes(this->Statement(), column);
       v = vtkVariant(vtkStdString(x, l));
       break;
     }
@@ -1839,6 +2417,13 @@ vtkVariant SimpleSQL::GetValue(int column)
   return v;
 }
 
+const void *SimpleSQL::GetBlob(int column, size_t *l)
+{
+  const void *x = sqlite3_column_blob(this->Statement(), column);
+  *l = sqlite3_column_bytes(this->Statement(), column);
+  return x;
+}
+
 const char *SimpleSQL::GetError()
 {
   return sqlite3_errmsg(this->DBase);
@@ -1846,11 +2431,88 @@ const char *SimpleSQL::GetError()
 
 void SimpleSQL::Finalize()
 {
-  if (this->Statement)
+  for (int i = 0; i < MaxStatements; i++)
+  {
+    if (this->Statements[i])
+    {
+      sqlite3_finalize(this->Statements[i]);
+      this->Statements[i] = nullptr;
+    }
+  }
+  this->Current = 0;
+}
+
+// The tags that are stored as columns in the index, for fast lookup
+struct IndexColumn
+{
+  const char *Table;
+  const char *Column;
+  DC::EnumType Tag;
+};
+
+const IndexColumn IndexColumns[] = {
+  { "Patient", "PatientID", DC::PatientID },
+  { "Study", "StudyInstanceUID", DC::StudyInstanceUID },
+  { "Study", "AccessionNumber", DC::AccessionNumber },
+  { "Series", "SeriesInstanceUID", DC::SeriesInstanceUID },
+  { "Series", "Modality", DC::Modality },
+  { nullptr, nullptr, DC::ItemDelimitationItem }
+};
+
+// Get the value of an attribute as stored in an index column
+std::string IndexColumnText(const vtkDICOMValue& v)
+{
+  std::string s = v.AsString();
+  size_t i = 0;
+  size_t j = s.length();
+  while (i < j && s[i] == ' ') { i++; }
+  while (j > i && s[j-1] == ' ') { j--; }
+  return s.substr(i, j - i);
+}
+
+// Check whether a query value can be matched with a simple equality test
+// (it must be a single value without wildcards)
+bool IndexColumnQuery(const vtkDICOMValue& v, std::string *text)
+{
+  if (!v.IsValid() || v.GetVL() == 0 || !v.GetVR().HasTextValue() ||
+      v.GetNumberOfValues() != 1)
   {
-    sqlite3_finalize(this->Statement);
-    this->Statement = nullptr;
+    return false;
   }
+  *text = IndexColumnText(v);
+  return (!text->empty() &&
+          text->find_first_of("*?\\") == std::string::npos);
+}
+
+// Get the path of a file relative to a directory, with "/" separators,
+// or return false if the file is not within the directory
+bool RelativePath(
+  const std::string& dirname, const std::string& filename, std::string *rel)
+{
+  std::vector<std::string> components;
+  vtkDICOMFilePath path(filename);
+  while (path.AsString() != dirname)
+  {
+    std::string back = path.GetBack();
+    if (path.IsEmpty() || path.IsRoot() || back.empty())
+    {
+      return false;
+    }
+    components.push_back(back);
+    path.PopBack();
+  }
+
+  rel->clear();
+  for (size_t i = components.size(); i > 0; --i)
+  {
+    rel->append(components[i-1]);
+    if (i > 1)
+    {
+      rel->push_back('/');
+    }
+  }
+
+  return !rel->empty();
 }
 
 }
@@ -2245,6 +2907,411 @@ void vtkDICOMDirectory::ProcessOsirixDatabase(const char *fname)
 #endif
 }
 
+//----------------------------------------------------------------------------
+void vtkDICOMDirectory::WriteIndexFile(const char *fname)
+{
+#ifdef DICOM_USE_SQLITE
+  SimpleSQL dbase;
+
+  this->ErrorCode = 0;
+
+  if (!dbase.Create(fname))
+  {
+    this->ErrorCode = vtkErrorCode::CannotOpenFileError;
+    vtkErrorMacro("File " << fname << ": " << dbase.GetError());
+    return;
+  }
+
+  // Create the tables, with an index for each lookup column
+  const char *schema =
+    "create table IndexInfo (Key text primary key, Value text);"
+    "create table Patient (PK integer primary key, PatientID text,"
+    " Record blob);"
+    "create table Study (PK integer primary key, Patient integer,"
+    " StudyInstanceUID text, AccessionNumber text, Record blob);"
+    "create table Series (PK integer primary key, Study integer,"
+    " SeriesInstanceUID text, Modality text, Record blob);"
+    "create table Image (PK integer primary key, Series integer,"
+    " Path text, Relative integer, Record blob);"
+    "create index PatientIDIndex on Patient (PatientID);"
+    "create index StudyPatientIndex on Study (Patient);"
+    "create index StudyUIDIndex on Study (StudyInstanceUID);"
+    "create index AccessionIndex on Study (AccessionNumber);"
+    "create index SeriesStudyIndex on Series (Study);"
+    "create index SeriesUIDIndex on Series (SeriesInstanceUID);"
+    "create index ModalityIndex on Series (Modality);"
+    "create index ImageSeriesIndex on Image (Series);";
+
+  if (!dbase.Exec(schema) ||
+      !dbase.Prepare("insert into IndexInfo values (?,?)"))
+  {
+    this->ErrorCode = vtkErrorCode::CannotOpenFileError;
+    vtkErrorMacro("File " << fname << ": " << dbase.GetError());
+    return;
+  }
+
+  dbase.BindText(1, "Version");
+  dbase.BindText(2, "1");
+  dbase.Insert();
+  if (this->FileSetID)
+  {
+    dbase.BindText(1, "FileSetID");
+    dbase.BindText(2, this->FileSetID);
+    dbase.Insert();
+  }
+
+  // File paths are stored relative to the index, if possible
+  vtkDICOMFilePath path(fname);
+  path.PopBack();
+  std::string dirname = path.AsString();
+
+  // Prepare the inserts for each table once, and keep them for reuse
+  bool success = (
+    dbase.Prepare("insert into Patient values (null,?,?)", 0) &&
+    dbase.Prepare("insert into Study values (null,?,?,?,?)", 1) &&
+    dbase.Prepare("insert into Series values (null,?,?,?,?)", 2) &&
+    dbase.Prepare("insert into Image values (null,?,?,?,?)", 3));
+
+  std::string blob;
+  std::string relpath;
+
+  int np = this->GetNumberOfPatients();
+  for (int ip = 0; ip < np && success; ip++)
+  {
+    const vtkDICOMItem& patientRecord = this->GetPatientRecord(ip);
+    EncodeRecord(patientRecord, &blob);
+    dbase.Select(0);
+    dbase.BindText(1, IndexColumnText(patientRecord.Get(DC::PatientID)));
+    dbase.BindBlob(2, blob);
+    success &= dbase.Insert();
+    vtkTypeInt64 patientPK = dbase.GetLastRowId();
+
+    vtkIntArray *studies = this->GetStudiesForPatient(ip);
+    vtkIdType ns = studies->GetMaxId() + 1;
+    for (vtkIdType is = 0; is < ns && success; is++)
+    {
+      int study = studies->GetValue(is);
+      const vtkDICOMItem& studyRecord = this->GetStudyRecord(study);
+      EncodeRecord(studyRecord, &blob);
+      dbase.Select(1);
+      dbase.BindInt64(1, patientPK);
+      dbase.BindText(2,
+        IndexColumnText(studyRecord.Get(DC::StudyInstanceUID)));
+      dbase.BindText(3,
+        IndexColumnText(studyRecord.Get(DC::AccessionNumber)));
+      dbase.BindBlob(4, blob);
+      success &= dbase.Insert();
+      vtkTypeInt64 studyPK = dbase.GetLastRowId();
+
+      int firstSeries = this->GetFirstSeriesForStudy(study);
+      int lastSeries = this->GetLastSeriesForStudy(study);
+      for (int series = firstSeries; series <= lastSeries && success; series++)
+      {
+        const vtkDICOMItem& seriesRecord = this->GetSeriesRecord(series);
+        EncodeRecord(seriesRecord, &blob);
+        dbase.Select(2);
+        dbase.BindInt64(1, studyPK);
+        dbase.BindText(2,
+          IndexColumnText(seriesRecord.Get(DC::SeriesInstanceUID)));
+        dbase.BindText(3, IndexColumnText(seriesRecord.Get(DC::Modality)));
+        dbase.BindBlob(4, blob);
+        success &= dbase.Insert();
+        vtkTypeInt64 seriesPK = dbase.GetLastRowId();
+
+        // The image records are the per-file attributes that are not
+        // present in the patient, study, or series records
+        vtkIdType firstFile = this->GetFirstFileIdForSeries(series);
+        vtkDICOMMetaData *meta = this->GetMetaDataForSeries(series);
+        dbase.Select(3);
+        vtkIdType nf = (firstFile >= 0 && meta ?
+                        this->GetNumberOfFilesForSeries(series) : 0);
+        for (vtkIdType jf = 0; jf < nf && success; jf++)
+        {
+          vtkDICOMItem imageRecord;
+          vtkDICOMDataElementIterator iter;
+          for (iter = meta->Begin(); iter != meta->End(); ++iter)
+          {
+            vtkDICOMTag tag = iter->GetTag();
+            const vtkDICOMValue& v = iter->GetValue(static_cast<int>(jf));
+            if (v.IsValid() &&
+                !patientRecord.Get(tag).IsValid() &&
+                !studyRecord.Get(tag).IsValid() &&
+                !seriesRecord.Get(tag).IsValid())
+            {
+              imageRecord.Set(tag, v);
+            }
+          }
+          EncodeRecord(imageRecord, &blob);
+
+          std::string fileName = this->FilePaths->GetPath(firstFile + jf);
+          bool relative = RelativePath(dirname, fileName, &relpath);
+          dbase.BindInt64(1, seriesPK);
+          dbase.BindText(2, (relative ? relpath : fileName));
+          dbase.BindInt64(3, relative);
+          dbase.BindBlob(4, blob);
+          success &= dbase.Insert();
+        }
+      }
+    }
+  }
+
+  // The rows are only written to the file when the transaction is
+  // committed, so the commit must succeed for the index to be valid
+  success = (success && dbase.Commit());
+  if (!success)
+  {
+    this->ErrorCode = vtkErrorCode::OutOfDiskSpaceError;
+    vtkErrorMacro("File " << fname << ": " << dbase.GetError());
+  }
+
+  dbase.Close();
+#else
+  this->ErrorCode = vtkErrorCode::UnknownError;
+  vtkErrorMacro("File " << fname << ": "
+                << "sqlite was not enabled in the build");
+#endif
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMDirectory::ProcessIndexFile(const char *fname)
+{
+#ifdef DICOM_USE_SQLITE
+  SimpleSQL dbase;
+
+  // Open the database
+  if (!dbase.Open(fname))
+  {
+    vtkErrorMacro("File " << fname << ": " << dbase.GetError());
+    return;
+  }
+
+  // Relative file paths are relative to the index file
+  vtkDICOMFilePath path(fname);
+  path.PopBack();
+
+  // Read the FileSetID, which also verifies that this is an index
+  if (!dbase.Prepare("select Value from IndexInfo where Key='FileSetID'"))
+  {
+    this->ErrorCode = vtkErrorCode::FileFormatError;
+    vtkErrorMacro("File " << fname << ": not a DICOM index file");
+    return;
+  }
+  if (dbase.Next() && this->FileSetID == nullptr)
+  {
+    std::string fileSetID = dbase.GetValue(0).ToString();
+    char *cp = new char[fileSetID.length() + 1];
+    strcpy(cp, fileSetID.c_str());
+    this->FileSetID = cp;
+  }
+
+  // Push simple query keys down to the indexed columns, the full query
+  // is still checked by AddSeriesWithQuery() for the series that pass
+  std::string sql =
+    "select Series.PK,Series.Record,Study.PK,Study.Record,"
+    "Patient.PK,Patient.Record from Series"
+    " join Study on Series.Study=Study.PK"
+    " join Patient on Study.Patient=Patient.PK";
+  std::vector<std::string> keys;
+  if (this->Query)
+  {
+    for (int k = 0; IndexColumns[k].Table != nullptr; k++)
+    {
+      std::string text;
+      if (IndexColumnQuery(this->Query->Get(IndexColumns[k].Tag), &text))
+      {
+        sql += (keys.empty() ? " where " : " and ");
+        sql += IndexColumns[k].Table;
+        sql += ".";
+        sql += IndexColumns[k].Column;
+        sql += "=?";
+        keys.push_back(text);
+      }
+    }
+  }
+  sql += " order by Patient.PK,Study.PK,Series.PK";
+
+  if (!dbase.Prepare(sql.c_str()))
+  {
+    this->ErrorCode = vtkErrorCode::FileFormatError;
+    vtkErrorMacro("File " << fname << ": " << dbase.GetError());
+    return;
+  }
+  for (size_t k = 0; k < keys.size(); k++)
+  {
+    dbase.BindText(static_cast<int>(k + 1), keys[k]);
+  }
+
+  // Read the matching series, along with their studies and patients
+  struct IndexSeriesRow
+  {
+    vtkTypeInt64 SeriesPK;
+    vtkTypeInt64 StudyPK;
+    vtkTypeInt64 PatientPK;
+    vtkDICOMItem SeriesRecord;
+    vtkDICOMItem StudyRecord;
+    vtkDICOMItem PatientRecord;
+  };
+
+  std::vector<IndexSeriesRow> seriesTable;
+  while (dbase.Next())
+  {
+    seriesTable.push_back(IndexSeriesRow());
+    IndexSeriesRow& row = seriesTable.back();
+    size_t l;
+    const void *vp;
+    row.SeriesPK = dbase.GetValue(0).ToTypeInt64();
+    vp = dbase.GetBlob(1, &l);
+    DecodeRecord(vp, l, &row.SeriesRecord);
+    row.StudyPK = dbase.GetValue(2).ToTypeInt64();
+    vp = dbase.GetBlob(3, &l);
+    DecodeRecord(vp, l, &row.StudyRecord);
+    row.PatientPK = dbase.GetValue(4).ToTypeInt64();
+    vp = dbase.GetBlob(5, &l);
+    DecodeRecord(vp, l, &row.PatientRecord);
+  }
+
+  // Check for abort.
+  if (!this->AbortExecute)
+  {
+    this->UpdateProgress(0.0);
+  }
+  if (this->AbortExecute)
+  {
+    return;
+  }
+
+  int patientIdx = this->GetNumberOfPatients();
+  int studyIdx = this->GetNumberOfStudies();
+  vtkTypeInt64 lastPatientPK = -1;
+  vtkTypeInt64 lastStudyPK = -1;
+
+  // The image query is prepared once, and reset for each series
+  if (!dbase.Prepare("select Path,Relative,Record from Image"
+                     " where Series=? order by PK"))
+  {
+    this->ErrorCode = vtkErrorCode::FileFormatError;
+    vtkErrorMacro("File " << fname << ": " << dbase.GetError());
+    return;
+  }
+
+  size_t nseries = seriesTable.size();
+  for (size_t i = 0; i < nseries; i++)
+  {
+    const IndexSeriesRow& row = seriesTable[i];
+    if (row.PatientPK != lastPatientPK)
+    {
+      patientIdx = this->GetNumberOfPatients();
+      lastPatientPK = row.PatientPK;
+    }
+    if (row.StudyPK != lastStudyPK)
+    {
+      studyIdx = this->GetNumberOfStudies();
+      lastStudyPK = row.StudyPK;
+    }
+
+    // Read the image records for this series
+    vtkSmartPointer<vtkStringArray> fileNames =
+      vtkSmartPointer<vtkStringArray>::New();
+    std::vector<vtkDICOMItem> imageItems;
+    dbase.Reset();
+    dbase.BindInt64(1, row.SeriesPK);
+    while (dbase.Step())
+    {
+      std::string fpath = dbase.GetValue(0).ToString();
+      if (dbase.GetValue(1).ToInt() != 0)
+      {
+        fpath = path.Join(fpath);
+      }
+      fileNames->InsertNextValue(fpath);
+      imageItems.push_back(vtkDICOMItem());
+      size_t l;
+      const void *vp = dbase.GetBlob(2, &l);
+      DecodeRecord(vp, l, &imageItems.back());
+    }
+
+    // Add the series if it passes the query
+    size_t n = imageItems.size();
+    if (n > 0)
+    {
+      std::vector<const vtkDICOMItem *> imageRecords(n);
+      for (size_t j = 0; j < n; j++)
+      {
+        imageRecords[j] = &imageItems[j];
+      }
+
+      this->AddSeriesWithQuery(
+        patientIdx, studyIdx, fileNames,
+        row.PatientRecord, row.StudyRecord, row.SeriesRecord,
+        &imageRecords[0]);
+    }
+
+    // Check for abort and update progress at 1% intervals
+    if (!this->AbortExecute)
+    {
+      double progress = (i + 1.0)/nseries;
+      if (progress == 1.0 || progress > this->GetProgress() + 0.01)
+      {
+        progress = static_cast<int>(progress*100.0)/100.0;
+        this->UpdateProgress(progress);
+      }
+    }
+    if (this->AbortExecute)
+    {
+      return;
+    }
+  }
+#else
+  vtkErrorMacro("File " << fname << ": "
+                << "sqlite was not enabled in the build");
+#endif
+}
+
+//----------------------------------------------------------------------------
+namespace {
+
+// The levels of the directory records that are used while traversing
+enum RecordLevel
+{
+  RecordPatient,
+  RecordStudy,
+  RecordSeries,
+  RecordImage,
+  RecordOther
+};
+
+// Get the level from the DirectoryRecordType, without making a copy
+int DirectoryRecordLevel(const vtkDICOMValue& v)
+{
+  const char *cp = v.GetCharData();
+  size_t l = (cp ? v.GetVL() : 0);
+  while (l > 0 && (cp[l-1] == ' ' || cp[l-1] == '\0'))
+  {
+    l--;
+  }
+
+  int level = RecordOther;
+  if (l == 7 && strncmp(cp, "PATIENT", 7) == 0)
+  {
+    level = RecordPatient;
+  }
+  else if (l == 5 && strncmp(cp, "STUDY", 5) == 0)
+  {
+    level = RecordStudy;
+  }
+  else if (l == 6 && strncmp(cp, "SERIES", 6) == 0)
+  {
+    level = RecordSeries;
+  }
+  else if (l == 5 && strncmp(cp, "IMAGE", 5) == 0)
+  {
+    level = RecordImage;
+  }
+
+  return level;
+}
+
+} // end anonymous namespace
+
 //----------------------------------------------------------------------------
 void vtkDICOMDirectory::ProcessDirectoryFile(
   const char *dirname, vtkDICOMMetaData *meta)
@@ -2262,11 +3329,20 @@ void vtkDICOMDirectory::ProcessDirectoryFile(
   unsigned int n = static_cast<unsigned int>(seq.GetNumberOfValues());
   const vtkDICOMItem *items = seq.GetSequenceData();
 
-  // The DICOMDIR uses byte offsets to identify items in the sequence.
-  std::map<unsigned int, unsigned int> offsetToIndexMap;
+  // The DICOMDIR uses byte offsets to identify items in the sequence,
+  // so make a sorted table of offsets (the items are almost always stored
+  // in order of increasing offset, so sorting is rarely necessary).
+  std::vector<std::pair<unsigned int, unsigned int> > offsetTable(n);
+  bool sorted = true;
   for (unsigned int i = 0; i < n; i++)
   {
-    offsetToIndexMap[items[i].GetByteOffset()] = i;
+    offsetTable[i] = std::make_pair(
+      static_cast<unsigned int>(items[i].GetByteOffset()), i);
+    sorted &= (i == 0 || offsetTable[i-1].first < offsetTable[i].first);
+  }
+  if (!sorted)
+  {
+    std::sort(offsetTable.begin(), offsetTable.end());
   }
 
   // Get the first entry.
@@ -2294,7 +3370,7 @@ void vtkDICOMDirectory::ProcessDirectoryFile(
   }
 
   // A stack to track the directory level.
-  std::vector<std::pair<unsigned int, std::string> > offsetStack;
+  std::vector<std::pair<unsigned int, int> > offsetStack;
   int patientIdx = this->GetNumberOfPatients();
   int studyIdx = this->GetNumberOfStudies();
   unsigned int patientItem = 0;
@@ -2307,21 +3383,42 @@ void vtkDICOMDirectory::ProcessDirectoryFile(
   std::vector<const vtkDICOMItem *> imageRecords;
 
   // The entry type that is currently being processed.
-  std::string entryType;
+  int entryType = RecordOther;
+
+  // The path to the directory, for building the file names.
+  vtkDICOMFilePath path(dirname);
+
+  // For checking the query against the records.
+  vtkDICOMItem results;
+
+  // The position in the offset table of the previous record.
+  size_t position = 0;
 
   // Go through the directory, using the "next" and "child" pointers.
   while (offset != 0)
   {
     unsigned int offsetOfChild = 0;
-    std::map<unsigned int, unsigned int>::iterator iter =
-      offsetToIndexMap.find(offset);
+    unsigned int recordOffset = offset;
     offset = 0;
 
-    if (iter != offsetToIndexMap.end() && iter->second != 0xffffffffu)
+    // The records are usually stored in the order that they are visited,
+    // so check the position after the previous record before searching.
+    if (position + 1 < n && offsetTable[position + 1].first == recordOffset)
+    {
+      position++;
+    }
+    else
+    {
+      position = std::lower_bound(offsetTable.begin(), offsetTable.end(),
+        std::make_pair(recordOffset, 0u)) - offsetTable.begin();
+    }
+
+    if (position < n && offsetTable[position].first == recordOffset &&
+        offsetTable[position].second != 0xffffffffu)
     {
       // Get the item index, mark the item as used.
-      unsigned int j = iter->second;
-      iter->second = 0xffffffffu;
+      unsigned int j = offsetTable[position].second;
+      offsetTable[position].second = 0xffffffffu;
 
       offset = items[j].Get(
         DC::OffsetOfTheNextDirectoryRecord).AsUnsignedInt();
@@ -2329,55 +3426,63 @@ void vtkDICOMDirectory::ProcessDirectoryFile(
       offsetOfChild = items[j].Get(
         DC::OffsetOfReferencedLowerLevelDirectoryEntity).AsUnsignedInt();
 
-      entryType = items[j].Get(
-        DC::DirectoryRecordType).AsString();
+      entryType = DirectoryRecordLevel(items[j].Get(DC::DirectoryRecordType));
 
-      if (entryType == "PATIENT")
-      {
-        patientItem = j;
-      }
-      else if (entryType == "STUDY")
+      if (entryType == RecordPatient ||
+          entryType == RecordStudy ||
+          entryType == RecordSeries)
       {
-        studyItem = j;
-      }
-      else if (entryType == "SERIES")
-      {
-        seriesItem = j;
+        if (entryType == RecordPatient)
+        {
+          patientItem = j;
+        }
+        else if (entryType == RecordStudy)
+        {
+          studyItem = j;
+        }
+        else
+        {
+          seriesItem = j;
+        }
+
+        // If the record doesn't match the query, then none of the records
+        // beneath it can be added, so skip over them
+        if (this->Query && !this->MatchesQuery(items[j], results))
+        {
+          offsetOfChild = 0;
+        }
       }
-      else if (entryType == "IMAGE" || !this->RequirePixelData)
+      else if (entryType == RecordImage || !this->RequirePixelData)
       {
         const vtkDICOMValue& fileID = items[j].Get(DC::ReferencedFileID);
-        if (fileID.IsValid())
+        size_t m = fileID.GetNumberOfValues();
+        if (m > 0)
         {
-          size_t m = fileID.GetNumberOfValues();
-          if (m > 0)
+          vtkDICOMFilePath filePath = path;
+          for (size_t k = 0; k < m; k++)
           {
-            vtkDICOMFilePath path(dirname);
-            for (size_t k = 0; k < m; k++)
+            filePath.PushBack(fileID.GetString(k));
+          }
+          vtkIdType ki = fileNames->InsertNextValue(filePath.AsString());
+          imageRecords.push_back(&items[j]);
+          // sort the files by instance number, they will almost always
+          // already be in order so we use a simple algorithm
+          int inst = items[j].Get(DC::InstanceNumber).AsInt();
+          while (ki > 0)
+          {
+            const vtkDICOMItem *prev = imageRecords[--ki];
+            int inst2 = prev->Get(DC::InstanceNumber).AsInt();
+            if (inst < inst2)
             {
-              path.PushBack(fileID.GetString(k));
+              std::string s = fileNames->GetValue(ki + 1);
+              fileNames->SetValue(ki + 1, fileNames->GetValue(ki));
+              fileNames->SetValue(ki, s);
+              std::swap(imageRecords[ki], imageRecords[ki + 1]);
             }
-            vtkIdType ki = fileNames->InsertNextValue(path.AsString());
-            imageRecords.push_back(&items[j]);
-            // sort the files by instance number, they will almost always
-            // already be in order so we use a simple algorithm
-            int inst = items[j].Get(DC::InstanceNumber).AsInt();
-            while (ki > 0)
+            else
             {
-              const vtkDICOMItem *prev = imageRecords[--ki];
-              int inst2 = prev->Get(DC::InstanceNumber).AsInt();
-              if (inst < inst2)
-              {
-                std::string s = fileNames->GetValue(ki + 1);
-                fileNames->SetValue(ki + 1, fileNames->GetValue(ki));
-                fileNames->SetValue(ki, s);
-                std::swap(imageRecords[ki], imageRecords[ki + 1]);
-              }
-              else
-              {
-                // sorting is finished!
-                break;
-              }
+              // sorting is finished!
+              break;
             }
           }
         }
@@ -2400,17 +3505,17 @@ void vtkDICOMDirectory::ProcessDirectoryFile(
         entryType = offsetStack.back().second;
         offsetStack.pop_back();
 
-        if (entryType == "PATIENT")
+        if (entryType == RecordPatient)
         {
           // Get current max patient index plus one
           patientIdx = this->GetNumberOfPatients();
         }
-        else if (entryType == "STUDY")
+        else if (entryType == RecordStudy)
         {
           // Get current max study index plus one
           studyIdx = this->GetNumberOfStudies();
         }
-        else if (entryType == "SERIES")
+        else if (entryType == RecordSeries)
         {
           if (!imageRecords.empty())
           {
@@ -2447,8 +3552,10 @@ void vtkDICOMDirectory::ProcessDirectoryFile(
 
 //----------------------------------------------------------------------------
 void vtkDICOMDirectory::ProcessDirectory(
-  const char *dirname, int depth, vtkStringArray *files)
+  const char *dirname, int depth, vtkDICOMFilePathTable *files)
 {
+  vtkDICOMTraceSpan span("Scan", dirname);
+
   // Check if the directory has been visited yet.  This avoids infinite
   // recursion when following circular links.
   std::string realname = vtkDICOMFilePath(dirname).GetRealPath();
@@ -2573,13 +3680,55 @@ void vtkDICOMDirectory::ProcessDirectory(
       {
         if (!d.IsSpecial(i) && !d.IsBroken(i))
         {
-          files->InsertNextValue(fileString);
+          files->InsertNextPath(fileString);
         }
       }
     }
   }
 }
 
+//----------------------------------------------------------------------------
+void vtkDICOMDirectory::ProcessArchive(
+  const char *fname, vtkDICOMFilePathTable *files)
+{
+  vtkDICOMArchive archive(fname);
+  int code = archive.GetError();
+  if (code == vtkDICOMArchive::UnsupportedFormat)
+  {
+    vtkWarningMacro("Unsupported archive format: " << fname);
+    return;
+  }
+  else if (code != 0)
+  {
+    vtkWarningMacro("Could not read archive: " << fname);
+    return;
+  }
+
+  int n = archive.GetNumberOfMembers();
+  for (int i = 0; i < n; i++)
+  {
+    const std::string& name = archive.GetMemberName(i);
+    size_t k = name.rfind('/');
+    k = (k == std::string::npos ? 0 : k + 1);
+    if (name.compare(k, std::string::npos, "DICOMDIR") == 0)
+    {
+      // The DICOMDIR isn't used, the files are scanned instead
+      continue;
+    }
+
+    // The path to the member goes through the archive
+    std::string fileString = fname;
+    fileString += '/';
+    fileString += name;
+    if (this->FilePattern == nullptr || this->FilePattern[0] == '\0' ||
+        vtkDICOMUtilities::PatternMatches(
+          this->FilePattern, fileString.c_str()))
+    {
+      files->InsertNextPath(fileString);
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkDICOMDirectory::Execute()
 {
@@ -2588,14 +3737,15 @@ void vtkDICOMDirectory::Execute()
   this->Studies->clear();
   this->Patients->clear();
   this->Visited->clear();
+  this->FilePaths->Clear();
   delete [] this->FileSetID;
   this->FileSetID = nullptr;
   this->ErrorCode = 0;
 
   this->InvokeEvent(vtkCommand::StartEvent);
 
-  vtkSmartPointer<vtkStringArray> files =
-    vtkSmartPointer<vtkStringArray>::New();
+  // The files to scan, in compact form
+  vtkDICOMFilePathTable files;
 
   if (this->InputFileNames)
   {
@@ -2605,7 +3755,7 @@ void vtkDICOMDirectory::Execute()
       int code = vtkDICOMFile::Access(fname.c_str(), vtkDICOMFile::In);
       if (code == vtkDICOMFile::FileIsDirectory)
       {
-        this->ProcessDirectory(fname.c_str(), this->ScanDepth, files);
+        this->ProcessDirectory(fname.c_str(), this->ScanDepth, &files);
       }
       else if (code != 0 && vtkDICOMFilePath(fname.c_str()).IsSymlink())
       {
@@ -2646,11 +3796,19 @@ void vtkDICOMDirectory::Execute()
       {
         this->ProcessOsirixDatabase(fname.c_str());
       }
+      else if (vtkDICOMUtilities::PatternMatches("*.dcmdb", fname.c_str()))
+      {
+        this->ProcessIndexFile(fname.c_str());
+      }
+      else if (vtkDICOMArchive::IsArchiveName(fname.c_str()))
+      {
+        this->ProcessArchive(fname.c_str(), &files);
+      }
       else if (this->FilePattern == nullptr || this->FilePattern[0] == '\0' ||
                vtkDICOMUtilities::PatternMatches(
                  this->FilePattern, fname.c_str()))
       {
-        files->InsertNextValue(fname);
+        files.InsertNextPath(fname);
       }
     }
   }
@@ -2665,7 +3823,7 @@ void vtkDICOMDirectory::Execute()
     int code = vtkDICOMFile::Access(this->DirectoryName, vtkDICOMFile::In);
     if (code == vtkDICOMFile::FileIsDirectory)
     {
-      this->ProcessDirectory(this->DirectoryName, this->ScanDepth, files);
+      this->ProcessDirectory(this->DirectoryName, this->ScanDepth, &files);
     }
     else if (code == vtkDICOMFile::FileNotFound)
     {
@@ -2691,6 +3849,10 @@ void vtkDICOMDirectory::Execute()
       vtkErrorMacro("Unknown error: " << this->DirectoryName);
       return;
     }
+    else if (vtkDICOMArchive::IsArchiveName(this->DirectoryName))
+    {
+      this->ProcessArchive(this->DirectoryName, &files);
+    }
     else
     {
       this->ErrorCode = vtkErrorCode::CannotOpenFileError;
@@ -2709,9 +3871,9 @@ void vtkDICOMDirectory::Execute()
     return;
   }
 
-  if (files->GetNumberOfValues() > 0)
+  if (files.GetNumberOfPaths() > 0)
   {
-    this->SortFiles(files);
+    this->SortFiles(&files);
   }
 
   this->InvokeEvent(vtkCommand::EndEvent);
@@ -19,6 +19,7 @@
 #include "vtkDICOMConfig.h" // For configuration details
 #include "vtkDICOMCharacterSet.h" // For character sets
 #include "vtkVersion.h" // For changes to pipeline API
+#include "vtkCommand.h" // For UserEvent
 
 // Declare VTK classes within VTK's optional namespace
 #if defined(VTK_ABI_NAMESPACE_BEGIN)
@@ -35,6 +36,7 @@ VTK_ABI_NAMESPACE_END
 class vtkDICOMMetaData;
 class vtkDICOMItem;
 class vtkDICOMTag;
+class vtkDICOMFilePathTable;
 
 //! Get information about all DICOM files within a directory.
 /*!
@@ -62,7 +64,10 @@ public:
    *  to get information about the DICOM files in the directory.  Otherwise,
    *  the directory will be scanned for DICOM files.  The depth of the
    *  scan (how many subdirectories deep) can be controlled with the
-   *  SetScanDepth() method.
+   *  SetScanDepth() method.  The name of a zip or tar file can also be
+   *  given, in which case the files in the archive are scanned without
+   *  being extracted, and the file names in the output will be paths
+   *  that go through the archive (see vtkDICOMArchive).
    */
   void SetDirectoryName(const char *name);
   const char *GetDirectoryName() { return this->DirectoryName; }
@@ -72,6 +77,8 @@ public:
   //! Set a list of filenames (or files and directories) to read.
   /*!
    *  This can be used as alternative to setting a single input directory.
+   *  Any files with the extension ".zip" or ".tar" will be scanned as
+   *  archives.
    */
   void SetInputFileNames(vtkStringArray *sa);
   vtkStringArray *GetInputFileNames() { return this->InputFileNames; }
@@ -181,8 +188,29 @@ public:
   int GetLastSeriesForStudy(int study);
 
   //! Get the file names for a specific series.
+  /*!
+   *  The file names are kept in a compact table, and the string array
+   *  for a series is only created when this method is first called for
+   *  that series.  For a very large number of files, consider using
+   *  GetFilePathTable() instead.
+   */
   vtkStringArray *GetFileNamesForSeries(int i);
 
+  //! Get the number of files in a specific series.
+  vtkIdType GetNumberOfFilesForSeries(int i);
+
+  //! Get the index of the first file of a series in the path table.
+  /*!
+   *  The files for each series are stored consecutively in the table,
+   *  so the file paths for the series can be retrieved from the table
+   *  without creating a string array.  The return value is -1 if the
+   *  series was released after SeriesCompleteEvent.
+   */
+  vtkIdType GetFirstFileIdForSeries(int i);
+
+  //! Get the table that holds the file paths for all series.
+  const vtkDICOMFilePathTable *GetFilePathTable() { return this->FilePaths; }
+
   //! Get the meta data for a specific series.
   /*!
    *  This provides a subset of the meta data of each file in the series.
@@ -193,6 +221,64 @@ public:
   vtkDICOMMetaData *GetMetaDataForSeries(int i);
   //@}
 
+  //! The event that is invoked for each series, if StreamSeries is On.
+  /*!
+   *  The call data is a pointer to an int that gives the index of the
+   *  series, which can be used with GetFileNamesForSeries(),
+   *  GetMetaDataForSeries(), and GetSeriesRecord() from within the
+   *  observer callback.
+   */
+  enum { SeriesCompleteEvent = vtkCommand::UserEvent + 1 };
+
+  //@{
+  //! Report each series through SeriesCompleteEvent, as soon as possible.
+  /*!
+   *  When this is On, SeriesCompleteEvent is invoked for each series as
+   *  soon as it is known to be complete, rather than after the whole scan
+   *  has finished.  When scanning files, a series is known to be complete
+   *  when the number of files found matches the NumberOfSeriesRelatedInstances
+   *  attribute, otherwise the series is reported at the end of the scan.
+   *  Series that are reported before the end of the scan are not sorted
+   *  with the others, and a study might be listed more than once if its
+   *  series were not reported together.  In order to limit the memory use,
+   *  the file names and meta data for each series are released after the
+   *  event, so GetFileNamesForSeries() and GetMetaDataForSeries() will
+   *  return nullptr for that series after the callback has returned.
+   */
+  vtkSetMacro(StreamSeries, int);
+  vtkBooleanMacro(StreamSeries, int);
+  int GetStreamSeries() { return this->StreamSeries; }
+  //@}
+
+  //@{
+  //! Set the memory budget for scanning files, in bytes.
+  /*!
+   *  While files are being scanned, the attributes for each file are held
+   *  in memory until the series that it belongs to is complete.  If this
+   *  budget is exceeded, then the attributes are moved to a temporary file
+   *  until they are needed.  The default is zero, which means no limit.
+   */
+  vtkSetMacro(MemoryBudget, vtkIdType);
+  vtkIdType GetMemoryBudget() { return this->MemoryBudget; }
+  //@}
+
+  //@{
+  //! Write the results to an index file, for fast lookups later.
+  /*!
+   *  After Update() has been called, this method can be used to save the
+   *  patient, study, series, and image records to an SQLite database.
+   *  If the name of this index file (which must end in ".dcmdb") is later
+   *  given to SetInputFileNames(), the records will be read from the index
+   *  instead of from the DICOM files.  When reading the index, the query
+   *  keys PatientID, AccessionNumber, StudyInstanceUID, SeriesInstanceUID,
+   *  and Modality are looked up via indexed columns if the query values
+   *  have no wildcards.  File paths are stored relative to the index file
+   *  if the files are within the same directory.  This method requires
+   *  that the library was built with USE_SQLITE.
+   */
+  void WriteIndexFile(const char *fname);
+  //@}
+
   //! Set when to query the files, rather than just the DICOMDIR index.
   /*!
    *  If a DICOMDIR file is present, the default behavior is to only
@@ -301,6 +387,8 @@ protected:
   int ScanDepth;
   vtkDICOMCharacterSet DefaultCharacterSet;
   bool OverrideCharacterSet;
+  int StreamSeries;
+  vtkIdType MemoryBudget;
 
   vtkTimeStamp UpdateTime;
   char *InternalFileName;
@@ -324,6 +412,9 @@ protected:
   //! Sort the input string array
   virtual void SortFiles(vtkStringArray *input);
 
+  //! Sort the files in the input path table
+  virtual void SortFiles(vtkDICOMFilePathTable *input);
+
   //! Add a sorted series to output.
   /*!
    *  This method is called from SortFiles to provide the files
@@ -386,11 +477,17 @@ protected:
 
   //! Process a directory, and subdirs to the specified depth.
   void ProcessDirectory(
-    const char *dirname, int depth, vtkStringArray *files);
+    const char *dirname, int depth, vtkDICOMFilePathTable *files);
+
+  //! Process a zip or tar file, as if it were a directory.
+  void ProcessArchive(const char *fname, vtkDICOMFilePathTable *files);
 
   //! Process an OsiriX sqlite database file.
   void ProcessOsirixDatabase(const char *fname);
 
+  //! Process an index file that was written by WriteIndexFile().
+  void ProcessIndexFile(const char *fname);
+
   //! Copy attributes into a meta data object.
   void CopyRecord(
     vtkDICOMMetaData *meta, const vtkDICOMItem *item, int instance);
@@ -416,6 +513,7 @@ private:
   class SeriesInfoList;
   class SeriesInfoVector;
   class VisitedVector;
+  class RecordSpill;
 
   vtkDICOMItem *Query;
   int FindLevel;
@@ -423,6 +521,7 @@ private:
   StudyVector *Studies;
   PatientVector *Patients;
   VisitedVector *Visited;
+  vtkDICOMFilePathTable *FilePaths;
   char *FileSetID;
   bool UsingOsirixDatabase;
 
@@ -431,8 +530,8 @@ private:
   const vtkDICOMItem *CurrentSeriesRecord;
   const vtkDICOMItem *CurrentImageRecord;
 
-  //! Compare FileInfo entries by instance number
-  static bool CompareInstance(const FileInfo &fi1, const FileInfo &fi2);
+  //! Compare FileInfo entries by instance number, then by path
+  struct CompareInstance;
 
   //! Compare SeriesInfo entries by SeriesUID
   static bool CompareSeriesUIDs(const SeriesInfo *si, const char *uid);
@@ -445,6 +544,15 @@ private:
 
   //! Compare SOPInstanceUID to a FileInfo entry.
   static bool CompareInstanceUIDs(const FileInfoPair& p, const char *uid);
+
+  //! Add a series that was collected by SortFiles.
+  /*!
+   *  Any image records that were moved to the spill file will be
+   *  read back before the series is added.
+   */
+  void AddSeriesInfo(
+    int patient, int study, SeriesInfo *info, RecordSpill *spill,
+    const vtkDICOMFilePathTable *paths);
 };
 
 #endif
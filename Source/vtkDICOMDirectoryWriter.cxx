@@ -0,0 +1,521 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkDICOMDirectoryWriter.h"
+#include "vtkDICOMDirectory.h"
+#include "vtkDICOMCompiler.h"
+#include "vtkDICOMParser.h"
+#include "vtkDICOMStream.h"
+#include "vtkDICOMMetaData.h"
+#include "vtkDICOMItem.h"
+#include "vtkDICOMSequence.h"
+#include "vtkDICOMFilePath.h"
+#include "vtkDICOMFilePathTable.h"
+#include "vtkDICOMUtilities.h"
+
+#include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
+#include "vtkStringArray.h"
+#include "vtkIntArray.h"
+#include "vtkErrorCode.h"
+
+#include <string>
+#include <vector>
+
+#include <string.h>
+
+vtkStandardNewMacro(vtkDICOMDirectoryWriter);
+
+namespace {
+
+// The transfer syntax and SOP class for DICOMDIR files.
+const char *vtkDICOMDirectoryWriterSyntax = "1.2.840.10008.1.2.1";
+const char *vtkDICOMDirectoryWriterClass = "1.2.840.10008.1.3.10";
+
+// A directory record, with the indices of the records that it links to.
+struct vtkDICOMDirectoryWriterRecord
+{
+  vtkDICOMItem Item;
+  int Next;
+  int Lower;
+};
+
+typedef std::vector<vtkDICOMDirectoryWriterRecord> vtkDICOMDirectoryWriterVector;
+
+// The DirectoryRecordType for each SOP class that is not an image.
+// A UID that ends in "." matches every SOP class that it is a prefix of.
+const char *const vtkDICOMDirectoryWriterTypes[][2] = {
+  { "1.2.840.10008.5.1.4.1.1.4.2", "SPECTROSCOPY" },
+  { "1.2.840.10008.5.1.4.1.1.9.", "WAVEFORM" },
+  { "1.2.840.10008.5.1.4.1.1.11.", "PRESENTATION" },
+  { "1.2.840.10008.5.1.4.1.1.66", "RAW DATA" },
+  { "1.2.840.10008.5.1.4.1.1.66.1", "REGISTRATION" },
+  { "1.2.840.10008.5.1.4.1.1.66.2", "FIDUCIAL" },
+  { "1.2.840.10008.5.1.4.1.1.66.3", "REGISTRATION" },
+  { "1.2.840.10008.5.1.4.1.1.66.5", "SURFACE" },
+  { "1.2.840.10008.5.1.4.1.1.66.6", "TRACT" },
+  { "1.2.840.10008.5.1.4.1.1.67", "VALUE MAP" },
+  { "1.2.840.10008.5.1.4.1.1.68.", "SURFACE SCAN" },
+  { "1.2.840.10008.5.1.4.1.1.77.1.5.3", "STEREOMETRIC" },
+  { "1.2.840.10008.5.1.4.1.1.78.", "MEASUREMENT" },
+  { "1.2.840.10008.5.1.4.1.1.88.59", "KEY OBJECT DOC" },
+  { "1.2.840.10008.5.1.4.1.1.88.", "SR" },
+  { "1.2.840.10008.5.1.4.1.1.104.", "ENCAP DOC" },
+  { "1.2.840.10008.5.1.4.1.1.481.2", "RT DOSE" },
+  { "1.2.840.10008.5.1.4.1.1.481.3", "RT STRUCTURE SET" },
+  { "1.2.840.10008.5.1.4.1.1.481.4", "RT TREAT RECORD" },
+  { "1.2.840.10008.5.1.4.1.1.481.5", "RT PLAN" },
+  { "1.2.840.10008.5.1.4.1.1.481.6", "RT TREAT RECORD" },
+  { "1.2.840.10008.5.1.4.1.1.481.7", "RT TREAT RECORD" },
+  { "1.2.840.10008.5.1.4.1.1.481.8", "RT PLAN" },
+  { "1.2.840.10008.5.1.4.1.1.481.9", "RT TREAT RECORD" },
+  { "1.2.840.10008.5.1.4.38.1", "HANGING PROTOCOL" },
+  { "1.2.840.10008.5.1.4.43.1", "IMPLANT" },
+  { nullptr, nullptr }
+};
+
+// Get the DirectoryRecordType for a SOP class, the first match is used.
+const char *vtkDICOMDirectoryWriterType(const std::string& sopClass)
+{
+  for (int i = 0; vtkDICOMDirectoryWriterTypes[i][0]; i++)
+  {
+    const char *uid = vtkDICOMDirectoryWriterTypes[i][0];
+    size_t l = strlen(uid);
+    if (uid[l-1] == '.' ? sopClass.compare(0, l, uid) == 0 :
+                          sopClass == uid)
+    {
+      return vtkDICOMDirectoryWriterTypes[i][1];
+    }
+  }
+  return "IMAGE";
+}
+
+// Copy the attributes of a record, except for sequences and for the
+// DICOMDIR-specific attributes, which are regenerated by the writer.
+void vtkDICOMDirectoryWriterCopy(
+  vtkDICOMItem *item, const vtkDICOMItem& record)
+{
+  vtkDICOMDataElementIterator iter = record.Begin();
+  vtkDICOMDataElementIterator iterEnd = record.End();
+  for (; iter != iterEnd; ++iter)
+  {
+    vtkDICOMTag tag = iter->GetTag();
+    const vtkDICOMValue& v = iter->GetValue();
+    if (tag.GetGroup() != 0x0004 && tag.GetElement() != 0x0000 &&
+        tag != vtkDICOMTag(0x0008, 0x0001) && v.IsValid() &&
+        v.GetVR() != vtkDICOMVR::SQ && v.GetVL() != 0xffffffff)
+    {
+      item->Set(tag, v);
+    }
+  }
+}
+
+// Create a record of the given type, with placeholders for the offsets.
+void vtkDICOMDirectoryWriterAdd(
+  vtkDICOMDirectoryWriterVector *records, const char *type)
+{
+  records->push_back(vtkDICOMDirectoryWriterRecord());
+  vtkDICOMDirectoryWriterRecord& record = records->back();
+  record.Next = -1;
+  record.Lower = -1;
+  record.Item.Set(DC::OffsetOfTheNextDirectoryRecord,
+    vtkDICOMValue(vtkDICOMVR::UL, 0u));
+  record.Item.Set(DC::OffsetOfReferencedLowerLevelDirectoryEntity,
+    vtkDICOMValue(vtkDICOMVR::UL, 0u));
+  record.Item.Set(DC::DirectoryRecordType,
+    vtkDICOMValue(vtkDICOMVR::CS, type));
+}
+
+// Get the ReferencedFileID for a file within the given directory, as
+// a backslash-separated list of path components.
+bool vtkDICOMDirectoryWriterFileID(
+  const std::string& dirname, const std::string& filename,
+  std::string *fileID)
+{
+  std::vector<std::string> components;
+  vtkDICOMFilePath path(filename);
+  while (path.AsString() != dirname)
+  {
+    std::string back = path.GetBack();
+    if (path.IsEmpty() || path.IsRoot() || back.empty())
+    {
+      return false;
+    }
+    components.push_back(back);
+    path.PopBack();
+  }
+
+  fileID->clear();
+  for (size_t i = components.size(); i > 0; --i)
+  {
+    fileID->append(components[i-1]);
+    if (i > 1)
+    {
+      fileID->push_back('\\');
+    }
+  }
+
+  return !fileID->empty();
+}
+
+} // end anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkDICOMDirectoryWriter::vtkDICOMDirectoryWriter()
+{
+  this->Directory = nullptr;
+  this->FileName = nullptr;
+  this->FileSetID = nullptr;
+  this->NumberOfSkippedFiles = 0;
+  this->ErrorCode = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMDirectoryWriter::~vtkDICOMDirectoryWriter()
+{
+  if (this->Directory)
+  {
+    this->Directory->Delete();
+  }
+  delete [] this->FileName;
+  delete [] this->FileSetID;
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMDirectoryWriter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "Directory: " << this->Directory << "\n";
+  os << indent << "FileName: "
+     << (this->FileName ? this->FileName : "(NULL)") << "\n";
+  os << indent << "FileSetID: "
+     << (this->FileSetID ? this->FileSetID : "(NULL)") << "\n";
+  os << indent << "NumberOfSkippedFiles: "
+     << this->NumberOfSkippedFiles << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMDirectoryWriter::SetDirectory(vtkDICOMDirectory *directory)
+{
+  if (this->Directory != directory)
+  {
+    if (this->Directory)
+    {
+      this->Directory->Delete();
+    }
+    if (directory)
+    {
+      directory->Register(this);
+    }
+    this->Directory = directory;
+    this->Modified();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMDirectoryWriter::Write()
+{
+  this->SetErrorCode(vtkErrorCode::NoError);
+  this->NumberOfSkippedFiles = 0;
+
+  if (this->Directory == nullptr)
+  {
+    vtkErrorMacro("Write: No directory has been set.");
+    this->SetErrorCode(vtkErrorCode::UnknownError);
+    return;
+  }
+
+  this->Directory->Update();
+  if (this->Directory->GetErrorCode() != vtkErrorCode::NoError)
+  {
+    vtkErrorMacro("Write: The directory could not be read.");
+    this->SetErrorCode(this->Directory->GetErrorCode());
+    return;
+  }
+
+  // the ReferencedFileIDs are relative to the directory of the DICOMDIR
+  std::string filename;
+  std::string dirname;
+  if (this->FileName)
+  {
+    filename = this->FileName;
+    vtkDICOMFilePath path(filename);
+    path.PopBack();
+    dirname = path.AsString();
+  }
+  else if (this->Directory->GetDirectoryName())
+  {
+    vtkDICOMFilePath path(this->Directory->GetDirectoryName());
+    dirname = path.AsString();
+    filename = path.Join("DICOMDIR");
+  }
+  else
+  {
+    vtkErrorMacro("Write: Please specify a FileName.");
+    this->SetErrorCode(vtkErrorCode::NoFileNameError);
+    return;
+  }
+
+  // build the records in the order that they will be written: each
+  // record is followed by the records at the next lower level
+  vtkDICOMDirectoryWriterVector records;
+  int lastPatient = -1;
+  int np = this->Directory->GetNumberOfPatients();
+  for (int ip = 0; ip < np; ip++)
+  {
+    const vtkDICOMItem& patientRecord = this->Directory->GetPatientRecord(ip);
+    int patient = static_cast<int>(records.size());
+    vtkDICOMDirectoryWriterAdd(&records, "PATIENT");
+    vtkDICOMDirectoryWriterCopy(&records.back().Item, patientRecord);
+    if (lastPatient >= 0)
+    {
+      records[lastPatient].Next = patient;
+    }
+    lastPatient = patient;
+
+    int lastStudy = -1;
+    vtkIntArray *studies = this->Directory->GetStudiesForPatient(ip);
+    vtkIdType ns = studies->GetMaxId() + 1;
+    for (vtkIdType is = 0; is < ns; is++)
+    {
+      int study = studies->GetValue(is);
+      const vtkDICOMItem& studyRecord = this->Directory->GetStudyRecord(study);
+      int studyIdx = static_cast<int>(records.size());
+      vtkDICOMDirectoryWriterAdd(&records, "STUDY");
+      vtkDICOMDirectoryWriterCopy(&records.back().Item, studyRecord);
+      if (lastStudy >= 0)
+      {
+        records[lastStudy].Next = studyIdx;
+      }
+      else
+      {
+        records[patient].Lower = studyIdx;
+      }
+      lastStudy = studyIdx;
+
+      int lastSeries = -1;
+      int firstSeries = this->Directory->GetFirstSeriesForStudy(study);
+      int finalSeries = this->Directory->GetLastSeriesForStudy(study);
+      for (int series = firstSeries; series <= finalSeries; series++)
+      {
+        const vtkDICOMItem& seriesRecord =
+          this->Directory->GetSeriesRecord(series);
+        int seriesIdx = static_cast<int>(records.size());
+        vtkDICOMDirectoryWriterAdd(&records, "SERIES");
+        vtkDICOMDirectoryWriterCopy(&records.back().Item, seriesRecord);
+        if (lastSeries >= 0)
+        {
+          records[lastSeries].Next = seriesIdx;
+        }
+        else
+        {
+          records[studyIdx].Lower = seriesIdx;
+        }
+        lastSeries = seriesIdx;
+
+        // the image records hold the attributes that are not present
+        // in the patient, study, or series records
+        int lastImage = -1;
+        const vtkDICOMFilePathTable *paths =
+          this->Directory->GetFilePathTable();
+        vtkIdType firstFile = this->Directory->GetFirstFileIdForSeries(series);
+        vtkDICOMMetaData *meta = this->Directory->GetMetaDataForSeries(series);
+        vtkIdType nf = (firstFile >= 0 && meta ?
+          this->Directory->GetNumberOfFilesForSeries(series) : 0);
+        for (vtkIdType jf = 0; jf < nf; jf++)
+        {
+          std::string fileName = paths->GetPath(firstFile + jf);
+          std::string fileID;
+          if (!vtkDICOMDirectoryWriterFileID(dirname, fileName, &fileID))
+          {
+            vtkWarningMacro("Write: The file " << fileName <<
+                            " is not within " << dirname << ", skipping.");
+            this->NumberOfSkippedFiles++;
+            continue;
+          }
+
+          // the record type depends on the SOP class
+          int idx = static_cast<int>(jf);
+          const vtkDICOMValue& sopClass =
+            (meta->Has(DC::SOPClassUID) ?
+             meta->Get(idx, DC::SOPClassUID) :
+             meta->Get(idx, DC::ReferencedSOPClassUIDInFile));
+
+          int imageIdx = static_cast<int>(records.size());
+          vtkDICOMDirectoryWriterAdd(&records,
+            vtkDICOMDirectoryWriterType(sopClass.AsString()));
+          vtkDICOMItem& item = records.back().Item;
+          item.Set(DC::ReferencedFileID,
+                   vtkDICOMValue(vtkDICOMVR::CS, fileID));
+
+          vtkDICOMDataElementIterator iter = meta->Begin();
+          vtkDICOMDataElementIterator iterEnd = meta->End();
+          for (; iter != iterEnd; ++iter)
+          {
+            vtkDICOMTag tag = iter->GetTag();
+            const vtkDICOMValue& v = iter->GetValue(idx);
+            if (!v.IsValid() || v.GetVR() == vtkDICOMVR::SQ ||
+                v.GetVL() == 0xffffffff || tag.GetElement() == 0x0000 ||
+                patientRecord.Get(tag).IsValid() ||
+                studyRecord.Get(tag).IsValid() ||
+                seriesRecord.Get(tag).IsValid())
+            {
+              continue;
+            }
+            if (tag == DC::SOPClassUID)
+            {
+              tag = DC::ReferencedSOPClassUIDInFile;
+            }
+            else if (tag == DC::SOPInstanceUID)
+            {
+              tag = DC::ReferencedSOPInstanceUIDInFile;
+            }
+            else if (tag == DC::TransferSyntaxUID)
+            {
+              tag = DC::ReferencedTransferSyntaxUIDInFile;
+            }
+            else if (tag.GetGroup() <= 0x0004 ||
+                     tag == vtkDICOMTag(0x0008, 0x0001))
+            {
+              continue;
+            }
+            item.Set(tag, v);
+          }
+
+          if (lastImage >= 0)
+          {
+            records[lastImage].Next = imageIdx;
+          }
+          else
+          {
+            records[seriesIdx].Lower = imageIdx;
+          }
+          lastImage = imageIdx;
+        }
+      }
+    }
+  }
+
+  // create the compiler, and give it a UID so that it doesn't make one
+  vtkSmartPointer<vtkDICOMCompiler> compiler =
+    vtkSmartPointer<vtkDICOMCompiler>::New();
+  std::string instanceUID =
+    vtkDICOMUtilities::GenerateUID(DC::MediaStorageSOPInstanceUID);
+  compiler->SetFileName(filename.c_str());
+  compiler->SetTransferSyntaxUID(vtkDICOMDirectoryWriterSyntax);
+  compiler->SetSOPInstanceUID(instanceUID.c_str());
+
+  // the attributes that precede the DirectoryRecordSequence
+  const char *fileSetID =
+    (this->FileSetID ? this->FileSetID : this->Directory->GetFileSetID());
+  vtkSmartPointer<vtkDICOMMetaData> meta =
+    vtkSmartPointer<vtkDICOMMetaData>::New();
+  meta->Set(DC::MediaStorageSOPClassUID,
+    vtkDICOMValue(vtkDICOMVR::UI, vtkDICOMDirectoryWriterClass));
+  meta->Set(DC::FileSetID,
+    vtkDICOMValue(vtkDICOMVR::CS, (fileSetID ? fileSetID : "")));
+  meta->Set(DC::OffsetOfTheFirstDirectoryRecordOfTheRootDirectoryEntity,
+    vtkDICOMValue(vtkDICOMVR::UL, 0u));
+  meta->Set(DC::OffsetOfTheLastDirectoryRecordOfTheRootDirectoryEntity,
+    vtkDICOMValue(vtkDICOMVR::UL, 0u));
+  meta->Set(DC::FileSetConsistencyFlag,
+    vtkDICOMValue(vtkDICOMVR::US, 0u));
+
+  size_t n = records.size();
+  vtkDICOMSequence seq(static_cast<unsigned int>(n));
+  for (size_t i = 0; i < n; i++)
+  {
+    seq.SetItem(i, records[i].Item);
+  }
+  meta->Set(DC::DirectoryRecordSequence, seq);
+
+  // write the DICOMDIR to memory with the offsets set to zero, and then
+  // parse it to get the offset of each record (since the offsets are
+  // fixed-size UL values, filling them in will not change the layout)
+  vtkDICOMMemoryStream output;
+  compiler->SetOutputStream(&output);
+  compiler->SetMetaData(meta);
+  compiler->WriteHeader();
+  compiler->Close();
+  compiler->SetOutputStream(nullptr);
+
+  std::vector<unsigned int> offsets;
+  if (compiler->GetErrorCode() == vtkErrorCode::NoError)
+  {
+    vtkDICOMMemoryStream input(
+      output.GetData(), static_cast<size_t>(output.GetSize()));
+    vtkSmartPointer<vtkDICOMMetaData> layout =
+      vtkSmartPointer<vtkDICOMMetaData>::New();
+    vtkSmartPointer<vtkDICOMParser> parser =
+      vtkSmartPointer<vtkDICOMParser>::New();
+    parser->SetMetaData(layout);
+    parser->SetInputStream(&input);
+    parser->Update();
+
+    const vtkDICOMValue& v = layout->Get(DC::DirectoryRecordSequence);
+    const vtkDICOMItem *items = v.GetSequenceData();
+    if (parser->GetErrorCode() == vtkErrorCode::NoError &&
+        v.GetNumberOfValues() == n)
+    {
+      offsets.resize(n);
+      for (size_t i = 0; i < n; i++)
+      {
+        offsets[i] = items[i].GetByteOffset();
+      }
+    }
+  }
+  output.Clear();
+
+  if (offsets.size() != n)
+  {
+    vtkErrorMacro("Write: Unable to compute the offsets for " << filename);
+    this->SetErrorCode(compiler->GetErrorCode() != vtkErrorCode::NoError ?
+      compiler->GetErrorCode() : vtkErrorCode::UnknownError);
+    return;
+  }
+
+  // fill in the offsets
+  vtkDICOMSequence finalSeq(static_cast<unsigned int>(n));
+  for (size_t i = 0; i < n; i++)
+  {
+    vtkDICOMDirectoryWriterRecord& record = records[i];
+    unsigned int next = (record.Next >= 0 ? offsets[record.Next] : 0);
+    unsigned int lower = (record.Lower >= 0 ? offsets[record.Lower] : 0);
+    record.Item.Set(DC::OffsetOfTheNextDirectoryRecord,
+      vtkDICOMValue(vtkDICOMVR::UL, next));
+    record.Item.Set(DC::OffsetOfReferencedLowerLevelDirectoryEntity,
+      vtkDICOMValue(vtkDICOMVR::UL, lower));
+    finalSeq.SetItem(i, record.Item);
+  }
+
+  unsigned int firstOffset = (n > 0 ? offsets[0] : 0);
+  unsigned int lastOffset = (lastPatient >= 0 ? offsets[lastPatient] : 0);
+
+  meta->Set(DC::OffsetOfTheFirstDirectoryRecordOfTheRootDirectoryEntity,
+    vtkDICOMValue(vtkDICOMVR::UL, firstOffset));
+  meta->Set(DC::OffsetOfTheLastDirectoryRecordOfTheRootDirectoryEntity,
+    vtkDICOMValue(vtkDICOMVR::UL, lastOffset));
+  meta->Set(DC::DirectoryRecordSequence, finalSeq);
+
+  // write the file itself
+  compiler->SetMetaData(meta);
+  compiler->WriteHeader();
+  compiler->Close();
+
+  if (compiler->GetErrorCode() != vtkErrorCode::NoError)
+  {
+    vtkErrorMacro("Write: Unable to write the file " << filename);
+    this->SetErrorCode(compiler->GetErrorCode());
+  }
+}
@@ -0,0 +1,120 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef vtkDICOMDirectoryWriter_h
+#define vtkDICOMDirectoryWriter_h
+
+#include "vtkObject.h"
+#include "vtkDICOMModule.h" // For export macro
+#include "vtkDICOMConfig.h" // For configuration details
+
+class vtkDICOMDirectory;
+
+//! Write a DICOMDIR file for the results of a directory scan.
+/*!
+ *  This class takes the patient, study, series, and image records that
+ *  were found by vtkDICOMDirectory and writes them as a DICOMDIR file,
+ *  so that the next time the directory is opened, vtkDICOMDirectory
+ *  can read the DICOMDIR instead of scanning every file.  The records
+ *  are stored in the usual PATIENT, STUDY, SERIES, IMAGE hierarchy,
+ *  except that files that are not images (e.g. SR, KO, PR, or RT
+ *  objects) are given the record type that matches their SOP class.
+ *  Each of these records contains the ReferencedFileID of the file,
+ *  relative to the directory that contains the DICOMDIR.  Files that
+ *  are not located within that directory cannot be referenced, and will
+ *  be skipped.
+ *
+ *  Note that DICOM restricts each component of a ReferencedFileID to
+ *  eight upper-case characters, but this writer uses the file names as
+ *  they are, so the DICOMDIR will only conform to the standard if the
+ *  files that it references have conformant names.
+ */
+class VTKDICOM_EXPORT vtkDICOMDirectoryWriter : public vtkObject
+{
+public:
+  //! Static method for construction.
+  //@{
+  static vtkDICOMDirectoryWriter *New();
+  vtkTypeMacro(vtkDICOMDirectoryWriter, vtkObject);
+  //@}
+
+  //! Print information about this object.
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_DICOM_OVERRIDE;
+
+  //@{
+  //! Set the directory object that provides the records.
+  /*!
+   *  The directory will be updated before the records are written.
+   */
+  void SetDirectory(vtkDICOMDirectory *directory);
+  vtkDICOMDirectory *GetDirectory() { return this->Directory; }
+  //@}
+
+  //@{
+  //! Set the name of the DICOMDIR file to write.
+  /*!
+   *  By default, a file named DICOMDIR will be written within the
+   *  DirectoryName of the vtkDICOMDirectory.
+   */
+  vtkSetStringMacro(FileName);
+  vtkGetStringMacro(FileName);
+  //@}
+
+  //@{
+  //! Set the FileSetID to store in the DICOMDIR.
+  /*!
+   *  If this is not set, then the FileSetID from the vtkDICOMDirectory
+   *  will be used.
+   */
+  vtkSetStringMacro(FileSetID);
+  vtkGetStringMacro(FileSetID);
+  //@}
+
+  //@{
+  //! Write the DICOMDIR file.
+  virtual void Write();
+
+  //! Get the number of files that could not be referenced by the DICOMDIR.
+  /*!
+   *  This is only valid after Write() has been called.
+   */
+  int GetNumberOfSkippedFiles() { return this->NumberOfSkippedFiles; }
+
+  //! Get the error code.
+  unsigned long GetErrorCode() { return this->ErrorCode; }
+  //@}
+
+protected:
+  vtkDICOMDirectoryWriter();
+  ~vtkDICOMDirectoryWriter();
+
+  //! Internal method for setting the error code.
+  void SetErrorCode(unsigned long e) { this->ErrorCode = e; }
+
+  vtkDICOMDirectory *Directory;
+  char *FileName;
+  char *FileSetID;
+  int NumberOfSkippedFiles;
+  unsigned long ErrorCode;
+
+private:
+#ifdef VTK_DICOM_DELETE
+  vtkDICOMDirectoryWriter(const vtkDICOMDirectoryWriter&) VTK_DICOM_DELETE;
+  void operator=(const vtkDICOMDirectoryWriter&) VTK_DICOM_DELETE;
+#else
+  vtkDICOMDirectoryWriter(const vtkDICOMDirectoryWriter&) = delete;
+  void operator=(const vtkDICOMDirectoryWriter&) = delete;
+#endif
+};
+
+#endif /* vtkDICOMDirectoryWriter_h */
@@ -13,7 +13,9 @@
 =========================================================================*/
 
 #include "vtkDICOMFile.h"
+#include "vtkDICOMArchive.h"
 #include "vtkDICOMFilePath.h"
+#include "vtkDICOMStream.h"
 
 #if defined(VTK_DICOM_POSIX_IO)
 #include <sys/types.h>
@@ -40,6 +42,56 @@
 //----------------------------------------------------------------------------
 vtkDICOMFile::vtkDICOMFile(const char *filename, Mode mode)
 {
+  this->Open(filename, mode);
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMFile::vtkDICOMFile(vtkDICOMStream *stream, Mode mode)
+{
+  this->Open(stream, mode);
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMFile::vtkDICOMFile(
+  const char *filename, vtkDICOMStream *stream, Mode mode)
+{
+  if (stream)
+  {
+    this->Open(stream, mode);
+  }
+  else
+  {
+    this->Open(filename, mode);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMFile::Open(vtkDICOMStream *stream, Mode mode)
+{
+#if defined(VTK_DICOM_POSIX_IO)
+  this->Handle = 0;
+#elif defined(VTK_DICOM_WIN32_IO)
+  this->Handle = INVALID_HANDLE_VALUE;
+#else
+  this->Handle = nullptr;
+#endif
+  this->Stream = stream;
+  this->OwnsStream = false;
+  this->Error = 0;
+  this->Eof = false;
+
+  if (!stream->SetPosition(0) || (mode == Out && !stream->Truncate()))
+  {
+    this->Error = (mode == Out ? AccessDenied : UnknownError);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMFile::Open(const char *filename, Mode mode)
+{
+  this->Stream = nullptr;
+  this->OwnsStream = false;
+
 #if defined(VTK_DICOM_POSIX_IO)
   this->Handle = -1;
   this->Error = 0;
@@ -159,6 +211,17 @@ vtkDICOMFile::vtkDICOMFile(const char *filename, Mode mode)
     this->Error = UnknownError;
   }
 #endif
+
+  // check for a path that goes through an archive file
+  if (this->Error == FileNotFound && mode == In)
+  {
+    vtkDICOMStream *stream = vtkDICOMArchive::OpenPath(filename);
+    if (stream)
+    {
+      this->Open(stream, mode);
+      this->OwnsStream = true;
+    }
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -170,6 +233,18 @@ vtkDICOMFile::~vtkDICOMFile()
 //----------------------------------------------------------------------------
 void vtkDICOMFile::Close()
 {
+  if (this->Stream)
+  {
+    // the stream is owned by the caller, unless it is an archive member
+    if (this->OwnsStream)
+    {
+      delete this->Stream;
+      this->OwnsStream = false;
+    }
+    this->Stream = nullptr;
+    return;
+  }
+
 #if defined(VTK_DICOM_POSIX_IO)
   if (this->Handle)
   {
@@ -198,6 +273,23 @@ void vtkDICOMFile::Close()
 //----------------------------------------------------------------------------
 size_t vtkDICOMFile::Read(unsigned char *data, size_t len)
 {
+  if (this->Stream)
+  {
+    size_t n = this->Stream->Read(data, len);
+    if (n == 0)
+    {
+      if (this->Stream->GetError())
+      {
+        this->Error = UnknownError;
+      }
+      else
+      {
+        this->Eof = true;
+      }
+    }
+    return n;
+  }
+
 #if defined(VTK_DICOM_POSIX_IO)
   ssize_t n;
   while ((n = read(this->Handle, data, len)) == -1)
@@ -258,6 +350,16 @@ size_t vtkDICOMFile::Read(unsigned char *data, size_t len)
 //----------------------------------------------------------------------------
 size_t vtkDICOMFile::Write(const unsigned char *data, size_t len)
 {
+  if (this->Stream)
+  {
+    size_t n = this->Stream->Write(data, len);
+    if (n != len)
+    {
+      this->Error = UnknownError;
+    }
+    return n;
+  }
+
 #if defined(VTK_DICOM_POSIX_IO)
   ssize_t n;
   while ((n = write(this->Handle, data, len)) == -1)
@@ -312,6 +414,16 @@ size_t vtkDICOMFile::Write(const unsigned char *data, size_t len)
 //----------------------------------------------------------------------------
 bool vtkDICOMFile::SetPosition(Size offset)
 {
+  if (this->Stream)
+  {
+    if (!this->Stream->SetPosition(offset))
+    {
+      this->Error = UnknownError;
+      return false;
+    }
+    return true;
+  }
+
 #if defined(VTK_DICOM_POSIX_IO)
 #if defined(_LARGEFILE64_SOURCE) && _LFS64_LARGEFILE-0
   off64_t pos = lseek64(this->Handle, offset, SEEK_SET);
@@ -342,6 +454,11 @@ bool vtkDICOMFile::SetPosition(Size offset)
 //----------------------------------------------------------------------------
 vtkDICOMFile::Size vtkDICOMFile::GetSize()
 {
+  if (this->Stream)
+  {
+    return this->Stream->GetSize();
+  }
+
 #if defined(VTK_DICOM_POSIX_IO)
   struct stat fs;
   if (fstat(this->Handle, &fs) != 0)
@@ -424,6 +541,12 @@ int vtkDICOMFile::Access(const char *filename, Mode mode)
       errorCode = FileIsDirectory;
     }
   }
+  if (errorCode == FileNotFound && mode == In &&
+      vtkDICOMArchive::MemberExists(filename))
+  {
+    // the path goes through an archive file
+    errorCode = 0;
+  }
   return errorCode;
 #else
   int errorCode = 0;
@@ -453,6 +576,12 @@ int vtkDICOMFile::Access(const char *filename, Mode mode)
   {
     errorCode = FileIsDirectory;
   }
+  if (errorCode == FileNotFound && mode == In &&
+      vtkDICOMArchive::MemberExists(filename))
+  {
+    // the path goes through an archive file
+    errorCode = 0;
+  }
   return errorCode;
 #endif
 }
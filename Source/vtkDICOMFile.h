@@ -24,11 +24,17 @@
 #define VTK_DICOM_POSIX_IO
 #endif
 
+class vtkDICOMStream;
+
 //! A class that provides basic input/output operations.
 /*!
  *  The purpose of this class is to centralize all of the I/O operations.
  *  It uses system-level I/O calls so that it can eventually be used not
- *  only on files, but on sockets as well.
+ *  only on files, but on sockets as well.  It can also be constructed
+ *  from a vtkDICOMStream, in which case all operations are passed to
+ *  the stream.  When opened for reading, a path that goes through a zip
+ *  or tar file (e.g. "/data/study.zip/IM0001") will read the member of
+ *  the archive, see vtkDICOMArchive.
  */
 class VTKDICOM_EXPORT vtkDICOMFile
 {
@@ -62,6 +68,21 @@ public:
    */
   vtkDICOMFile(const char *filename, Mode mode);
 
+  //! Construct a file object that uses a stream.
+  /*!
+   *  The stream will be positioned at the beginning of the data.  For
+   *  mode "Out", any data that was already in the stream is discarded.
+   *  The stream is not deleted when the file is closed.
+   */
+  vtkDICOMFile(vtkDICOMStream *stream, Mode mode);
+
+  //! Construct a file object that uses a stream, if one is given.
+  /*!
+   *  If the stream is null, then the file is opened instead.  This
+   *  allows the same code path to be used for files and streams.
+   */
+  vtkDICOMFile(const char *filename, vtkDICOMStream *stream, Mode mode);
+
   //! Destruct the object and close the file.
   ~vtkDICOMFile();
   //@}
@@ -131,17 +152,26 @@ public:
   // Copy constructor creates a closed file.  The copy constructor would
   // normally be deleted, but that would cause the VTK python wrappers to
   // skip this class.  Once the wrappers are fixed, this can be deleted.
-  vtkDICOMFile(const vtkDICOMFile&) : Handle(0), Error(0), Eof(false) {}
+  vtkDICOMFile(const vtkDICOMFile&) :
+    Handle(0), Stream(nullptr), OwnsStream(false), Error(0), Eof(false) {}
   //! @endcond
 
 private:
   vtkDICOMFile& operator=(const vtkDICOMFile&); // = delete;
 
+  //! Open the named file (used by the constructors).
+  void Open(const char *filename, Mode mode);
+
+  //! Attach a stream (used by the constructors).
+  void Open(vtkDICOMStream *stream, Mode mode);
+
 #ifdef VTK_DICOM_POSIX_IO
   int Handle;
 #else
   void *Handle;
 #endif
+  vtkDICOMStream *Stream;
+  bool OwnsStream;
   int Error;
   bool Eof;
 };
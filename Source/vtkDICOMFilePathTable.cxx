@@ -0,0 +1,173 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "vtkDICOMFilePathTable.h"
+
+#include <string.h>
+
+//----------------------------------------------------------------------------
+vtkDICOMFilePathTable::vtkDICOMFilePathTable()
+  : LastDirectoryIndex(-1)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMFilePathTable::~vtkDICOMFilePathTable()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMFilePathTable::Clear()
+{
+  std::vector<char>().swap(this->Strings);
+  std::vector<Entry>().swap(this->Paths);
+  std::vector<Entry>().swap(this->Directories);
+  this->DirectoryMap.clear();
+  this->LastDirectory.clear();
+  this->LastDirectoryIndex = -1;
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkDICOMFilePathTable::AddString(const char *cp, size_t l)
+{
+  unsigned int offset = static_cast<unsigned int>(this->Strings.size());
+  this->Strings.insert(this->Strings.end(), cp, cp + l);
+  this->Strings.push_back('\0');
+  return offset;
+}
+
+//----------------------------------------------------------------------------
+int vtkDICOMFilePathTable::FindDirectory(const char *cp, size_t l)
+{
+  // Files are usually inserted one directory at a time
+  if (this->LastDirectoryIndex >= 0 &&
+      this->LastDirectory.length() == l &&
+      memcmp(this->LastDirectory.data(), cp, l) == 0)
+  {
+    return this->LastDirectoryIndex;
+  }
+
+  // Walk the components, each of which includes its trailing separator
+  int dir = -1;
+  size_t i = 0;
+  while (i < l)
+  {
+    size_t j = i;
+    while (!IsSeparator(cp[j])) { j++; }
+    j++;
+
+    std::pair<int, std::string> key(dir, std::string(cp + i, j - i));
+    std::map<std::pair<int, std::string>, int>::iterator iter =
+      this->DirectoryMap.find(key);
+    if (iter != this->DirectoryMap.end())
+    {
+      dir = iter->second;
+    }
+    else
+    {
+      Entry e;
+      e.Directory = dir;
+      e.Name = this->AddString(cp + i, j - i);
+      dir = static_cast<int>(this->Directories.size());
+      this->Directories.push_back(e);
+      this->DirectoryMap.insert(std::make_pair(key, dir));
+    }
+    i = j;
+  }
+
+  this->LastDirectory.assign(cp, l);
+  this->LastDirectoryIndex = dir;
+
+  return dir;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkDICOMFilePathTable::InsertNextPath(const std::string& path)
+{
+  // Split the path after the final separator
+  const char *cp = path.c_str();
+  size_t l = path.length();
+  size_t n = l;
+  while (n > 0 && !IsSeparator(cp[n-1])) { n--; }
+
+  Entry e;
+  e.Directory = (n > 0 ? this->FindDirectory(cp, n) : -1);
+  e.Name = this->AddString(cp + n, l - n);
+  this->Paths.push_back(e);
+
+  return static_cast<vtkIdType>(this->Paths.size() - 1);
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMFilePathTable::AppendDirectory(int dir, std::string *path) const
+{
+  // Collect the components from the leaf to the root
+  std::vector<const char *> components;
+  while (dir >= 0)
+  {
+    const Entry& e = this->Directories[dir];
+    components.push_back(&this->Strings[e.Name]);
+    dir = e.Directory;
+  }
+
+  for (size_t k = components.size(); k > 0; k--)
+  {
+    path->append(components[k-1]);
+  }
+}
+
+//----------------------------------------------------------------------------
+std::string vtkDICOMFilePathTable::GetDirectory(vtkIdType i) const
+{
+  std::string path;
+  this->AppendDirectory(this->Paths[i].Directory, &path);
+  return path;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkDICOMFilePathTable::GetPath(vtkIdType i) const
+{
+  std::string path;
+  this->AppendDirectory(this->Paths[i].Directory, &path);
+  path.append(&this->Strings[this->Paths[i].Name]);
+  return path;
+}
+
+//----------------------------------------------------------------------------
+int vtkDICOMFilePathTable::Compare(vtkIdType i, vtkIdType j) const
+{
+  if (this->Paths[i].Directory == this->Paths[j].Directory)
+  {
+    // Only the file names need to be compared
+    return strcmp(this->GetFileName(i), this->GetFileName(j));
+  }
+
+  return strcmp(this->GetPath(i).c_str(), this->GetPath(j).c_str());
+}
+
+//----------------------------------------------------------------------------
+size_t vtkDICOMFilePathTable::GetMemorySize() const
+{
+  size_t size = this->Strings.capacity();
+  size += this->Paths.capacity()*sizeof(Entry);
+  size += this->Directories.capacity()*sizeof(Entry);
+  // allow 64 bytes of overhead per map node, in addition to the key
+  std::map<std::pair<int, std::string>, int>::const_iterator iter;
+  for (iter = this->DirectoryMap.begin();
+       iter != this->DirectoryMap.end(); ++iter)
+  {
+    size += sizeof(*iter) + 64 + iter->first.second.capacity();
+  }
+  return size;
+}
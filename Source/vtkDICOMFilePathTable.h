@@ -0,0 +1,123 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef vtkDICOMFilePathTable_h
+#define vtkDICOMFilePathTable_h
+
+#include "vtkSystemIncludes.h"
+#include "vtkDICOMModule.h" // For export macro
+#include "vtkDICOMConfig.h" // For configuration details
+
+#include <string> // Interface type
+#include <vector> // Internal storage
+#include <map> // Internal storage
+#include <utility> // Internal storage
+
+//! A compact table of file paths.
+/*!
+ *  Each path is split into a directory and a file name.  The directories
+ *  are stored as a tree of path components, so that each directory (and
+ *  therefore each common prefix) is stored only once, no matter how many
+ *  files it contains.  For a large scan, this uses much less memory than
+ *  storing the full path of every file.  Each path is identified by its
+ *  index, in the order that the paths were inserted.
+ */
+class VTKDICOM_EXPORT vtkDICOMFilePathTable
+{
+public:
+  //@{
+  //! Construct an empty table.
+  vtkDICOMFilePathTable();
+
+  //! Destructor.
+  ~vtkDICOMFilePathTable();
+  //@}
+
+  //@{
+  //! Add a path to the table, and return its index.
+  vtkIdType InsertNextPath(const std::string& path);
+
+  //! Get the number of paths in the table.
+  vtkIdType GetNumberOfPaths() const {
+    return static_cast<vtkIdType>(this->Paths.size()); }
+
+  //! Remove all paths from the table.
+  void Clear();
+  //@}
+
+  //@{
+  //! Get the full path, exactly as it was inserted.
+  std::string GetPath(vtkIdType i) const;
+
+  //! Get the file name, i.e. the path without the directory.
+  /*!
+   *  The returned pointer is invalidated when more paths are inserted.
+   */
+  const char *GetFileName(vtkIdType i) const {
+    return &this->Strings[this->Paths[i].Name]; }
+
+  //! Get the directory, including the trailing separator.
+  std::string GetDirectory(vtkIdType i) const;
+
+  //! Get an index for the directory, or -1 if the path has no directory.
+  /*!
+   *  Two paths are in the same directory if they have the same index.
+   */
+  int GetDirectoryIndex(vtkIdType i) const {
+    return this->Paths[i].Directory; }
+  //@}
+
+  //@{
+  //! Compare two paths, with the same result as strcmp().
+  int Compare(vtkIdType i, vtkIdType j) const;
+
+  //! Get the approximate number of bytes used by the table.
+  size_t GetMemorySize() const;
+  //@}
+
+private:
+  //! A path or directory: a parent directory plus a name.
+  struct Entry
+  {
+    int Directory;
+    unsigned int Name; // offset into Strings
+  };
+
+  //! Check if the given character is a separator.
+  static bool IsSeparator(char c) {
+#ifdef _WIN32
+    return (c == '/' || c == '\\');
+#else
+    return (c == '/');
+#endif
+  }
+
+  //! Add a string to the string storage, return its offset.
+  unsigned int AddString(const char *cp, size_t l);
+
+  //! Find or add a directory (the length includes the final separator).
+  int FindDirectory(const char *cp, size_t l);
+
+  //! Append the directory, including the trailing separator.
+  void AppendDirectory(int dir, std::string *path) const;
+
+  std::vector<char> Strings;
+  std::vector<Entry> Paths;
+  std::vector<Entry> Directories;
+  std::map<std::pair<int, std::string>, int> DirectoryMap;
+  std::string LastDirectory;
+  int LastDirectoryIndex;
+};
+
+#endif /* vtkDICOMFilePathTable_h */
+// VTK-HeaderTest-Exclude: vtkDICOMFilePathTable.h
@@ -928,25 +928,16 @@ void vtkDICOMMetaData::CopyAttributes(vtkDICOMMetaData *o)
       const vtkDICOMDataElement *iterEnd = &o->Tail;
       while (iter != iterEnd)
       {
-        // if this is a per-instance element, then make a copy of it
+        // per-instance elements are shared, rather than copied, since
+        // they will be copied on write (see vtkDICOMValue::GetMultiplex)
         const vtkDICOMValue *vptr = iter->Value.GetMultiplexData();
-        if (vptr == nullptr)
+        if (vptr == nullptr ||
+            this->NumberOfInstances == o->NumberOfInstances)
         {
           vtkDICOMDataElement *e = this->FindDataElementOrInsert(iter->Tag);
           e->Tag = iter->Tag;
           e->Value = iter->Value;
         }
-        else if (this->NumberOfInstances == o->NumberOfInstances)
-        {
-          vtkDICOMDataElement *e = this->FindDataElementOrInsert(iter->Tag);
-          e->Tag = iter->Tag;
-          vtkDICOMValue *nvptr = e->Value.AllocateMultiplexData(
-            iter->Value.GetVR(), this->NumberOfInstances);
-          for (int i = 0; i < this->NumberOfInstances; i++)
-          {
-            nvptr[i] = vptr[i];
-          }
-        }
         iter = iter->Next;
       }
     }
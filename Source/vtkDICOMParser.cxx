@@ -14,15 +14,25 @@
 #include "vtkDICOMParser.h"
 #include "vtkDICOMDictionary.h"
 #include "vtkDICOMFile.h"
+#include "vtkDICOMStream.h"
 #include "vtkDICOMMetaData.h"
 #include "vtkDICOMSequence.h"
 #include "vtkDICOMItem.h"
+#include "vtkDICOMTracer.h"
 
 #include "vtkObjectFactory.h"
 #include "vtkUnsignedShortArray.h"
 #include "vtkErrorCode.h"
 
+// Header for zlib
+#ifdef DICOM_USE_VTKZLIB
+#include "vtk_zlib.h"
+#else
+#include "zlib.h"
+#endif
+
 #include <ctype.h>
+#include <string.h>
 #include <assert.h>
 
 #include <sstream>
@@ -60,6 +70,20 @@ public:
     return parser->FillBuffer(cp, ep);
   }
 
+  static size_t ReadDirect(vtkDICOMParser *parser,
+    const unsigned char* &cp, const unsigned char* &ep,
+    unsigned char *data, size_t n)
+  {
+    return parser->ReadDirect(cp, ep, data, n);
+  }
+
+  static bool AddBulkData(vtkDICOMParser *parser,
+    const unsigned char *cp, const unsigned char *ep,
+    vtkDICOMTag tag, vtkDICOMVR vr, unsigned int vl, int idx)
+  {
+    return parser->AddBulkData(cp, ep, tag, vr, vl, idx);
+  }
+
   static bool SeekBuffer(vtkDICOMParser *parser,
     const unsigned char* &cp, const unsigned char* &ep,
     vtkTypeInt64 offset)
@@ -651,7 +675,7 @@ inline void DecoderBase::CopyBuffer(
     size_t m = cp - sp;
     size_t n = v->GetNumberOfValues();
     unsigned char *ptr = v->ReallocateUnsignedCharData(n + m) + n;
-    do { *ptr++ = *sp++; } while (--m);
+    memcpy(ptr, sp, m);
   }
 }
 
@@ -1132,6 +1156,21 @@ size_t Decoder<E>::ReadData(
   const unsigned char* &cp, const unsigned char* &ep, T *ptr, size_t n)
 {
   size_t l = n*sizeof(T);
+
+  // large values bypass the buffer and are decoded in-place
+  if (l >= static_cast<size_t>(this->Parser->GetBufferSize()))
+  {
+    unsigned char *dp = reinterpret_cast<unsigned char *>(ptr);
+    size_t m = vtkDICOMParserInternalFriendship::ReadDirect(
+      this->Parser, cp, ep, dp, l);
+    n = m/sizeof(T);
+    if (sizeof(T) > 1 && n != 0)
+    {
+      Decoder<E>::GetValues(dp, ptr, n);
+    }
+    return n*sizeof(T);
+  }
+
   while (n != 0 && this->CheckBuffer(cp, ep, sizeof(T)))
   {
     size_t m = (ep - cp)/sizeof(T);
@@ -1585,6 +1624,16 @@ bool Decoder<E>::ReadElements(
       // (see DICOM Part 5, Section 6.2.2)
       rl = this->ImplicitLE->ReadElementValue(cp, ep, vr, vl, v);
     }
+    else if (!this->Item && !this->HasQuery &&
+             vtkDICOMParserInternalFriendship::AddBulkData(
+               this->Parser, cp, ep, tag, vr, vl, this->Index))
+    {
+      // skip the value, its position in the file has been recorded
+      rl = this->SkipData(cp, ep, vl);
+      if (rl != static_cast<size_t>(vl)) { return false; }
+      tl += rl;
+      continue;
+    }
     else
     {
       rl = this->ReadElementValue(cp, ep, vr, vl, v);
@@ -1787,7 +1836,7 @@ bool Decoder<E>::SkipElements(
           size_t m = cp - sp;
           size_t n = v->GetNumberOfValues();
           unsigned char *ptr = v->ReallocateUnsignedCharData(n + vl + m) + n;
-          if (m) { do { *ptr++ = *sp++; } while (--m); }
+          if (m) { memcpy(ptr, sp, m); ptr += m; }
           size_t tl = this->ReadData(cp, ep, ptr, vl);
           sp = cp;
           if (tl != static_cast<size_t>(vl)) { return false; }
@@ -1829,6 +1878,22 @@ bool Decoder<E>::SkipElements(
 
 } // end anonymous namespace
 
+//----------------------------------------------------------------------------
+// The state for inflating data with the Deflate transfer syntax
+class vtkDICOMParser::Inflater
+{
+public:
+  z_stream Stream;
+  // buffer for compressed data from the file
+  unsigned char *Buffer;
+  size_t BufferSize;
+  // number of bytes read from the file, including the meta header
+  vtkTypeInt64 BytesIn;
+  bool Initialized;
+  bool Done;
+  bool Error;
+};
+
 //----------------------------------------------------------------------------
 //----------------------------------------------------------------------------
 // Constructor
@@ -1840,14 +1905,18 @@ vtkDICOMParser::vtkDICOMParser()
   this->QueryItem = nullptr;
   this->Groups = nullptr;
   this->InputFile = nullptr;
+  this->InputStream = nullptr;
+  this->InputInflater = nullptr;
   this->BytesRead = 0;
   this->FileOffset = 0;
   this->FileSize = 0;
   this->Buffer = nullptr;
   this->BufferSize = 8192;
   this->ChunkSize = 0;
+  this->FillCount = 0;
   this->Index = -1;
   this->PixelDataVL = 0;
+  this->BulkDataThreshold = 0;
   this->PixelDataFound = false;
   this->QueryMatched = false;
   this->DefaultCharacterSet = vtkDICOMCharacterSet::GetGlobalDefault();
@@ -1911,6 +1980,16 @@ void vtkDICOMParser::SetOverrideCharacterSet(bool b)
   }
 }
 
+//----------------------------------------------------------------------------
+void vtkDICOMParser::SetInputStream(vtkDICOMStream *stream)
+{
+  if (this->InputStream != stream)
+  {
+    this->InputStream = stream;
+    this->Modified();
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkDICOMParser::SetBufferSize(int size)
 {
@@ -1952,17 +2031,21 @@ bool vtkDICOMParser::ReadFile(vtkDICOMMetaData *data, int idx)
   this->QueryMatched = (this->Query != nullptr || this->QueryItem != nullptr);
   this->FileOffset = 0;
   this->FileSize = 0;
+  this->BulkData.clear();
 
-  // Check that the file name has been set.
-  if (!this->FileName)
+  // Check that the file name (or the stream) has been set.
+  if (!this->FileName && !this->InputStream)
   {
     this->SetErrorCode(vtkErrorCode::NoFileNameError);
     vtkErrorMacro("ReadFile: No file name has been set");
     return false;
   }
 
+  const char *fileName = (this->FileName ? this->FileName : "(stream)");
+  vtkDICOMTraceSpan span("Parse", fileName);
+
   // Make sure that the file is readable.
-  vtkDICOMFile infile(this->FileName, vtkDICOMFile::In);
+  vtkDICOMFile infile(this->FileName, this->InputStream, vtkDICOMFile::In);
   if (infile.GetError())
   {
     this->SetErrorCode(vtkErrorCode::CannotOpenFileError);
@@ -1975,16 +2058,23 @@ bool vtkDICOMParser::ReadFile(vtkDICOMMetaData *data, int idx)
     {
       errText = "The selected file is a directory ";
     }
-    vtkErrorMacro("ReadFile: " << errText << this->FileName);
+    vtkErrorMacro("ReadFile: " << errText << fileName);
     return false;
   }
 
   this->InputFile = &infile;
   this->FileSize = infile.GetSize();
-  this->Buffer = new unsigned char [this->BufferSize + 8];
   this->BytesRead = 0;
+  this->FillCount = 0;
   // guard against anyone changing BufferSize while reading
   this->ChunkSize = this->BufferSize;
+  if (this->FileSize >= 0 && this->FileSize < this->ChunkSize)
+  {
+    // no need for a buffer that is larger than the file
+    this->ChunkSize = static_cast<int>(
+      this->FileSize > 256 ? this->FileSize : 256);
+  }
+  this->Buffer = new unsigned char [this->ChunkSize + 8];
 
   const unsigned char *cp = nullptr;
   const unsigned char *ep = nullptr;
@@ -2004,12 +2094,26 @@ bool vtkDICOMParser::ReadFile(vtkDICOMMetaData *data, int idx)
   }
 
   this->ReadMetaHeader(cp, ep, data, idx);
-  this->ReadMetaData(cp, ep, data, idx);
+  if (this->TransferSyntax == "1.2.840.10008.1.2.1.99")
+  {
+    // Deflated Explicit VR Little Endian
+    if (this->StartInflate(cp, ep))
+    {
+      this->ReadMetaData(cp, ep, data, idx);
+    }
+    this->EndInflate();
+  }
+  else
+  {
+    this->ReadMetaData(cp, ep, data, idx);
+  }
 
   delete [] this->Buffer;
   infile.Close();
   this->InputFile = nullptr;
 
+  span.SetBytes(this->BytesRead);
+
   return true;
 }
 
@@ -2342,9 +2446,41 @@ bool vtkDICOMParser::ReadMetaData(
 bool vtkDICOMParser::FillBuffer(
   const unsigned char* &ucp, const unsigned char* &ep)
 {
-  unsigned char *dp = this->Buffer;
   size_t n = ep - ucp;
-  const unsigned char *cp = ucp;
+
+  if (n == 0)
+  {
+    if (this->InputFile->GetError())
+    {
+      this->SetErrorCode(vtkErrorCode::UnknownError);
+      vtkErrorMacro("FillBuffer: error reading from file "
+                    << (this->FileName ? this->FileName : "(stream)"));
+      return false;
+    }
+    else if (this->InputInflater && this->InputInflater->Error)
+    {
+      this->SetErrorCode(vtkErrorCode::FileFormatError);
+      vtkErrorMacro("FillBuffer: corrupt deflated data in file "
+                    << (this->FileName ? this->FileName : "(stream)"));
+      return false;
+    }
+    else if (this->InputInflater ? this->InputInflater->Done :
+             this->InputFile->EndOfFile())
+    {
+      // if buffer is drained, and eof, then done
+      return false;
+    }
+  }
+
+  // if the data is being read sequentially, read it in larger chunks
+  unsigned char *dp = this->Buffer;
+  if (++this->FillCount > 2 && this->ChunkSize < 262144 &&
+      (this->FileSize < 0 ||
+       this->FileSize - this->BytesRead > this->ChunkSize))
+  {
+    this->ChunkSize *= 2;
+    dp = new unsigned char [this->ChunkSize + 8];
+  }
 
   // number of bytes to read
   size_t nbytes = this->ChunkSize;
@@ -2356,22 +2492,24 @@ bool vtkDICOMParser::FillBuffer(
       nbytes -= (n - 8);
     }
     // recycle unused buffer chars to head of buffer
-    do { *dp++ = *cp++; } while (--n);
-  }
-  else if (this->InputFile->GetError())
-  {
-    this->SetErrorCode(vtkErrorCode::UnknownError);
-    vtkErrorMacro("FillBuffer: error reading from file " << this->FileName);
-    return false;
+    memmove(dp, ucp, n);
   }
-  else if (this->InputFile->EndOfFile())
+  if (dp != this->Buffer)
   {
-    // if buffer is drained, and eof, then done
-    return false;
+    delete [] this->Buffer;
+    this->Buffer = dp;
   }
+  dp += n;
 
   // read at most n bytes
-  n = this->InputFile->Read(dp, nbytes);
+  if (this->InputInflater)
+  {
+    n = this->ReadInflated(dp, nbytes);
+  }
+  else
+  {
+    n = this->InputFile->Read(dp, nbytes);
+  }
 
   // get number of chars read
   this->BytesRead += n;
@@ -2383,6 +2521,149 @@ bool vtkDICOMParser::FillBuffer(
   return true;
 }
 
+//----------------------------------------------------------------------------
+bool vtkDICOMParser::AddBulkData(
+  const unsigned char *cp, const unsigned char *ep,
+  vtkDICOMTag tag, vtkDICOMVR vr, unsigned int vl, int idx)
+{
+  // deflated data cannot be seeked, so it cannot be read later
+  if (this->BulkDataThreshold == 0 || vl <= this->BulkDataThreshold ||
+      vl == 0xFFFFFFFF || this->InputInflater)
+  {
+    return false;
+  }
+
+  if (vr != vtkDICOMVR::OB && vr != vtkDICOMVR::OD &&
+      vr != vtkDICOMVR::OF && vr != vtkDICOMVR::OL &&
+      vr != vtkDICOMVR::OV && vr != vtkDICOMVR::OW &&
+      vr != vtkDICOMVR::UN)
+  {
+    return false;
+  }
+
+  BulkDataElement e;
+  e.Tag = tag;
+  e.VR = vr;
+  e.Length = vl;
+  e.Offset = this->GetBytesProcessed(cp, ep);
+  e.Index = idx;
+  this->BulkData.push_back(e);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkDICOMParser::ReadBulkData(int i)
+{
+  if (i < 0 || i >= static_cast<int>(this->BulkData.size()) ||
+      !this->MetaData)
+  {
+    return false;
+  }
+
+  const BulkDataElement& e = this->BulkData[i];
+  const char *fileName = (this->FileName ? this->FileName : "(stream)");
+
+  vtkDICOMFile infile(this->FileName, this->InputStream, vtkDICOMFile::In);
+  if (infile.GetError() || !infile.SetPosition(e.Offset))
+  {
+    this->SetErrorCode(vtkErrorCode::CannotOpenFileError);
+    vtkErrorMacro("ReadBulkData: Can't read the file " << fileName);
+    return false;
+  }
+
+  this->InputFile = &infile;
+  this->FileSize = infile.GetSize();
+  this->BytesRead = e.Offset;
+  this->FillCount = 0;
+  this->ChunkSize = this->BufferSize;
+  this->Buffer = new unsigned char [this->ChunkSize + 8];
+
+  // the buffer is empty, it will be filled as the value is read
+  const unsigned char *cp = this->Buffer;
+  const unsigned char *ep = this->Buffer;
+  vtkDICOMValue v;
+  size_t rl = 0;
+  if (this->TransferSyntax == "1.2.840.10008.1.2.2")
+  {
+    BigEndianDecoder decoder(this, this->MetaData, e.Index);
+    rl = decoder.ReadElementValue(cp, ep, e.VR, e.Length, v);
+  }
+  else
+  {
+    LittleEndianDecoder decoder(this, this->MetaData, e.Index);
+    rl = decoder.ReadElementValue(cp, ep, e.VR, e.Length, v);
+  }
+
+  delete [] this->Buffer;
+  this->Buffer = nullptr;
+  infile.Close();
+  this->InputFile = nullptr;
+
+  if (rl != static_cast<size_t>(e.Length))
+  {
+    this->SetErrorCode(vtkErrorCode::PrematureEndOfFileError);
+    vtkErrorMacro("ReadBulkData: Unexpected end of file " << fileName);
+    return false;
+  }
+
+  if (e.Index < 0)
+  {
+    this->MetaData->Set(e.Tag, v);
+  }
+  else
+  {
+    this->MetaData->Set(e.Index, e.Tag, v);
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+size_t vtkDICOMParser::ReadDirect(
+  const unsigned char* &cp, const unsigned char* &ep,
+  unsigned char *data, size_t n)
+{
+  // use whatever data is already in the buffer
+  size_t m = ep - cp;
+  m = (m < n ? m : n);
+  if (m != 0)
+  {
+    memcpy(data, cp, m);
+    cp += m;
+  }
+
+  // read the remainder directly from the file
+  size_t l = m;
+  while (l < n)
+  {
+    size_t r;
+    if (this->InputInflater)
+    {
+      r = this->ReadInflated(data + l, n - l);
+    }
+    else
+    {
+      r = this->InputFile->Read(data + l, n - l);
+    }
+    if (r == 0)
+    {
+      break;
+    }
+    this->BytesRead += r;
+    l += r;
+  }
+
+  if (l != m)
+  {
+    // the buffer is empty
+    cp = this->Buffer;
+    ep = this->Buffer;
+  }
+
+  return l;
+}
+
 //----------------------------------------------------------------------------
 bool vtkDICOMParser::SeekBuffer(
   const unsigned char* &ucp, const unsigned char* &ep, vtkTypeInt64 offset)
@@ -2394,6 +2675,22 @@ bool vtkDICOMParser::SeekBuffer(
     return true;
   }
 
+  // deflated data can only be advanced by inflating it
+  if (this->InputInflater)
+  {
+    while (offset > static_cast<vtkTypeInt64>(ep - ucp))
+    {
+      offset -= (ep - ucp);
+      ucp = ep;
+      if (!this->FillBuffer(ucp, ep))
+      {
+        return false;
+      }
+    }
+    ucp += (offset > 0 ? offset : 0);
+    return true;
+  }
+
   // otherwise, seek within the file
   vtkTypeInt64 pos = this->GetBytesProcessed(ucp, ep);
   if (!this->InputFile->GetError() &&
@@ -2402,6 +2699,8 @@ bool vtkDICOMParser::SeekBuffer(
     // read just 8 bytes at the new position, i.e. enough to take a peek
     // at the next element
     size_t n = this->InputFile->Read(this->Buffer, 8);
+    // the buffer only grows while data is read sequentially
+    this->FillCount = 0;
     ucp = this->Buffer;
     ep = ucp + n;
     this->BytesRead = pos + offset + n;
@@ -2445,6 +2744,22 @@ bool vtkDICOMParser::SkipValue(
 vtkTypeInt64 vtkDICOMParser::GetBytesRemaining(
   const unsigned char *cp, const unsigned char *ep)
 {
+  if (this->FileSize < 0)
+  {
+    // the size of the stream is unknown, so there is no limit
+    return VTK_TYPE_INT64_MAX;
+  }
+
+  if (this->InputInflater)
+  {
+    // the inflated size is unknown, so use the maximum possible size
+    // (deflate cannot compress by more than a factor of 1032)
+    const Inflater *inflater = this->InputInflater;
+    vtkTypeInt64 m = this->FileSize - inflater->BytesIn;
+    m += inflater->Stream.avail_in;
+    return static_cast<vtkTypeInt64>(ep - cp) + 1032*m;
+  }
+
   return static_cast<vtkTypeInt64>(
     this->FileSize - this->BytesRead + (ep - cp));
 }
@@ -2458,6 +2773,111 @@ vtkTypeInt64 vtkDICOMParser::GetBytesProcessed(
   return this->BytesRead - (ep - cp);
 }
 
+//----------------------------------------------------------------------------
+bool vtkDICOMParser::StartInflate(
+  const unsigned char* &cp, const unsigned char* &ep)
+{
+  Inflater *inflater = new Inflater;
+  this->InputInflater = inflater;
+
+  // the unparsed bytes in the buffer are the start of the deflated data
+  size_t n = ep - cp;
+  inflater->BufferSize = this->ChunkSize + 8;
+  inflater->Buffer = new unsigned char[inflater->BufferSize];
+  memcpy(inflater->Buffer, cp, n);
+  inflater->BytesIn = this->BytesRead;
+  inflater->Initialized = false;
+  inflater->Done = false;
+  inflater->Error = false;
+
+  // from now on, BytesRead counts the inflated bytes
+  this->BytesRead -= n;
+  cp = this->Buffer;
+  ep = cp;
+
+  z_stream *strm = &inflater->Stream;
+  strm->zalloc = Z_NULL;
+  strm->zfree = Z_NULL;
+  strm->opaque = Z_NULL;
+  strm->next_in = inflater->Buffer;
+  strm->avail_in = static_cast<uInt>(n);
+
+  // the standard requires raw deflate, but some writers add a zlib header
+  int windowBits = -MAX_WBITS;
+  if (n >= 2 && (inflater->Buffer[0] & 0x0f) == Z_DEFLATED &&
+      ((inflater->Buffer[0] << 8) + inflater->Buffer[1]) % 31 == 0)
+  {
+    windowBits = MAX_WBITS;
+  }
+
+  if (inflateInit2(strm, windowBits) != Z_OK)
+  {
+    inflater->Done = true;
+    inflater->Error = true;
+    this->ParseError(cp, ep, "Unable to initialize zlib inflate.");
+    return false;
+  }
+
+  inflater->Initialized = true;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+size_t vtkDICOMParser::ReadInflated(unsigned char *cp, size_t n)
+{
+  Inflater *inflater = this->InputInflater;
+  z_stream *strm = &inflater->Stream;
+  strm->next_out = cp;
+  strm->avail_out = static_cast<uInt>(n);
+
+  while (strm->avail_out > 0 && !inflater->Done)
+  {
+    if (strm->avail_in == 0)
+    {
+      size_t m = this->InputFile->Read(inflater->Buffer, inflater->BufferSize);
+      if (m == 0)
+      {
+        // the deflated data ended prematurely
+        inflater->Done = true;
+        inflater->Error = (this->InputFile->GetError() != 0);
+        break;
+      }
+      inflater->BytesIn += m;
+      strm->next_in = inflater->Buffer;
+      strm->avail_in = static_cast<uInt>(m);
+    }
+
+    int r = inflate(strm, Z_NO_FLUSH);
+    if (r == Z_STREAM_END)
+    {
+      inflater->Done = true;
+    }
+    else if (r != Z_OK && r != Z_BUF_ERROR)
+    {
+      inflater->Done = true;
+      inflater->Error = true;
+    }
+  }
+
+  return n - strm->avail_out;
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMParser::EndInflate()
+{
+  Inflater *inflater = this->InputInflater;
+  if (inflater)
+  {
+    if (inflater->Initialized)
+    {
+      inflateEnd(&inflater->Stream);
+    }
+    delete [] inflater->Buffer;
+    delete inflater;
+    this->InputInflater = nullptr;
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkDICOMParser::ParseError(
   const unsigned char* cp, const unsigned char* ep, const char* message)
@@ -2465,7 +2885,8 @@ void vtkDICOMParser::ParseError(
   this->FileOffset = this->GetBytesProcessed(cp, ep);
   this->SetErrorCode(vtkErrorCode::FileFormatError);
   vtkErrorMacro("At byte offset " << this->FileOffset << " in file \""
-                << this->FileName << "\": " << message);
+                << (this->FileName ? this->FileName : "(stream)")
+                << "\": " << message);
 }
 
 //----------------------------------------------------------------------------
@@ -2475,6 +2896,7 @@ void vtkDICOMParser::PrintSelf(ostream& os, vtkIndent indent)
 
   os << indent << "FileName: "
      << (this->FileName ? this->FileName : "(NULL)") << "\n";
+  os << indent << "InputStream: " << this->InputStream << "\n";
   os << indent << "DefaultCharacterSet: "
      << this->DefaultCharacterSet << "\n";
   os << indent << "OverrideCharacterSet: "
@@ -2487,6 +2909,7 @@ void vtkDICOMParser::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "MetaData: " << this->MetaData << "\n";
   os << indent << "Index: " << this->Index << "\n";
   os << indent << "BufferSize: " << this->BufferSize << "\n";
+  os << indent << "BulkDataThreshold: " << this->BulkDataThreshold << "\n";
   os << indent << "Query: " << this->Query << "\n";
   os << indent << "QueryItem: " << this->QueryItem << "\n";
   os << indent << "QueryMatched: "
@@ -19,6 +19,10 @@
 #include "vtkDICOMModule.h" // For export macro
 #include "vtkDICOMConfig.h" // For configuration details
 #include "vtkDICOMCharacterSet.h" // For character sets
+#include "vtkDICOMTag.h" // For bulk data tags
+#include "vtkDICOMVR.h" // For bulk data VRs
+
+#include <vector> // For bulk data list
 
 // Declare VTK classes within VTK's optional namespace
 #if defined(VTK_ABI_NAMESPACE_BEGIN)
@@ -32,6 +36,7 @@ VTK_ABI_NAMESPACE_END
 #endif
 
 class vtkDICOMFile;
+class vtkDICOMStream;
 class vtkDICOMItem;
 class vtkDICOMMetaData;
 class vtkDICOMParserInternalFriendship;
@@ -62,6 +67,18 @@ public:
   vtkGetStringMacro(FileName);
   //@}
 
+  //@{
+  //! Read from a stream, instead of from a file.
+  /*!
+   *  If a stream is set, then the data will be read from the stream and
+   *  the FileName will only be used in error messages.  This allows data
+   *  to be parsed directly from memory, via vtkDICOMMemoryStream, or from
+   *  any other source.  The stream is not deleted by the parser.
+   */
+  void SetInputStream(vtkDICOMStream *stream);
+  vtkDICOMStream *GetInputStream() { return this->InputStream; }
+  //@}
+
   //@{
   //! Set the metadata object for storing the data elements.
   void SetMetaData(vtkDICOMMetaData *);
@@ -133,6 +150,54 @@ public:
   vtkUnsignedShortArray *GetGroups() { return this->Groups; }
   //@}
 
+  //@{
+  //! Skip binary values that are larger than the given size, in bytes.
+  /*!
+   *  This is useful for scanning the headers of files that contain large
+   *  private elements, such as Siemens CSA headers or GE protocol data,
+   *  since these values will be skipped over instead of being read.
+   *  The tag, VR, length, and file offset of each skipped element are
+   *  kept, and the value can be read later with ReadBulkData().  Only
+   *  values with VR of OB, OD, OF, OL, OV, OW, or UN are skipped, and
+   *  values that are in the query or are nested within sequences are
+   *  never skipped.  Nothing is skipped when reading deflated files.
+   *  The default value is zero, which means that all values are read.
+   *  Note that if a query is set, then values that are not in the query
+   *  are always skipped without being recorded.  This is why the threshold
+   *  is not used by vtkDICOMDirectory (which always uses a query), and it
+   *  is not used by vtkDICOMReader because the reader needs large values
+   *  such as palettes and overlays.
+   */
+  vtkSetMacro(BulkDataThreshold, unsigned int);
+  unsigned int GetBulkDataThreshold() { return this->BulkDataThreshold; }
+
+  //! Get the number of elements that were skipped as bulk data.
+  int GetNumberOfBulkDataElements() {
+    return static_cast<int>(this->BulkData.size()); }
+
+  //! Get the tag of an element that was skipped as bulk data.
+  vtkDICOMTag GetBulkDataTag(int i) { return this->BulkData[i].Tag; }
+
+  //! Get the VR of an element that was skipped as bulk data.
+  vtkDICOMVR GetBulkDataVR(int i) { return this->BulkData[i].VR; }
+
+  //! Get the length, in bytes, of the value of a skipped element.
+  unsigned int GetBulkDataLength(int i) { return this->BulkData[i].Length; }
+
+  //! Get the file offset to the value of a skipped element.
+  vtkTypeInt64 GetBulkDataOffset(int i) { return this->BulkData[i].Offset; }
+
+  //! Read the value of a skipped element into the meta data.
+  /*!
+   *  The file is opened again and the value is read from the offset
+   *  that was recorded, and is then stored in the meta data (using the
+   *  same instance index as when the file was parsed).  This must be
+   *  called before the parser is used to read a different file.  The
+   *  return value is false if an error occurred.
+   */
+  bool ReadBulkData(int i);
+  //@}
+
   //@{
   //! This is true only if the file matched the query.
   bool GetQueryMatched() { return this->QueryMatched; }
@@ -148,18 +213,27 @@ public:
   //! Get the byte offset to the end of the metadata.
   /*!
    *  After the metadata has been read, the file offset
-   *  will be set to the position of the pixel data.
+   *  will be set to the position of the pixel data.  For the
+   *  Deflate transfer syntax, this is an offset into the
+   *  inflated data rather than into the file.
    */
   vtkTypeInt64 GetFileOffset() { return this->FileOffset; }
 
   //! Get the total file length (only valid after Update).
+  /*!
+   *  This will be -1 if the input is a stream of unknown size.
+   */
   vtkTypeInt64 GetFileSize() { return this->FileSize; }
 
   //@{
   //! Set the buffer size, the default is 8192 (8k).
   /*!
    *  A larger buffer size results in fewer IO calls.  The
-   *  minimum buffer size is 256 bytes.
+   *  minimum buffer size is 256 bytes.  This is the initial size,
+   *  the buffer will grow (up to 256k) if a long run of data is
+   *  read without skipping any of it, but it will never be larger
+   *  than the file.  Values that are larger than the buffer are
+   *  read directly from the file, rather than through the buffer.
    */
   void SetBufferSize(int size);
   int GetBufferSize() { return this->BufferSize; }
@@ -191,6 +265,28 @@ protected:
   virtual bool FillBuffer(
     const unsigned char* &cp, const unsigned char* &ep);
 
+  //! Internal method to record an element that will be skipped.
+  /*!
+   *  If the element should be skipped because of the BulkDataThreshold,
+   *  then its position is recorded and the return value is true.  The
+   *  cp and ep pointers must mark the beginning of the value.
+   */
+  virtual bool AddBulkData(
+    const unsigned char *cp, const unsigned char *ep,
+    vtkDICOMTag tag, vtkDICOMVR vr, unsigned int vl, int idx);
+
+  //! Internal method for reading data without using the buffer.
+  /*!
+   *  This reads n bytes into the supplied memory, starting with any
+   *  bytes that remain in the buffer between cp and ep, and then
+   *  reading the remainder directly from the file.  It is used for
+   *  large values, to avoid copying them through the buffer.  The
+   *  return value is the number of bytes that were read.
+   */
+  virtual size_t ReadDirect(
+    const unsigned char* &cp, const unsigned char* &ep,
+    unsigned char *data, size_t n);
+
   //! Internal method to advance the buffer to a new file position.
   /*!
    *  This will move to a new position within the file.
@@ -235,6 +331,23 @@ protected:
   vtkTypeInt64 GetBytesProcessed(
     const unsigned char* cp, const unsigned char* ep);
 
+  //! Start inflating the data set, for the Deflate transfer syntax.
+  /*!
+   *  The unparsed bytes in the buffer (which follow the meta header) are
+   *  the beginning of the deflated data.  After this is called, the
+   *  offsets reported by the parser are offsets into the inflated data.
+   */
+  bool StartInflate(const unsigned char* &cp, const unsigned char* &ep);
+
+  //! Read compressed data from the file and inflate it.
+  size_t ReadInflated(unsigned char *cp, size_t n);
+
+  //! Free the memory that was used for inflating the data.
+  void EndInflate();
+
+  //! The state of the inflater, used for the Deflate transfer syntax.
+  class Inflater;
+
   char *FileName;
   std::string TransferSyntax;
   vtkDICOMMetaData *MetaData;
@@ -242,20 +355,36 @@ protected:
   vtkDICOMItem *QueryItem;
   vtkUnsignedShortArray *Groups;
   vtkDICOMFile *InputFile;
+  vtkDICOMStream *InputStream;
+  Inflater *InputInflater;
   vtkTypeInt64 BytesRead;
   vtkTypeInt64 FileOffset;
   vtkTypeInt64 FileSize;
   unsigned char *Buffer;
   int BufferSize;
   int ChunkSize;
+  int FillCount;
   int Index;
   unsigned int PixelDataVL;
+  unsigned int BulkDataThreshold;
   bool PixelDataFound;
   bool QueryMatched;
   vtkDICOMCharacterSet DefaultCharacterSet;
   bool OverrideCharacterSet;
   unsigned long ErrorCode;
 
+  //! Information about a value that was skipped as bulk data.
+  struct BulkDataElement
+  {
+    vtkDICOMTag Tag;
+    vtkDICOMVR VR;
+    unsigned int Length;
+    vtkTypeInt64 Offset;
+    int Index;
+  };
+
+  std::vector<BulkDataElement> BulkData;
+
   // used to share FillBuffer with internal classes
   friend class vtkDICOMParserInternalFriendship;
 
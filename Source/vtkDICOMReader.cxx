@@ -12,7 +12,9 @@
 
 =========================================================================*/
 #include "vtkDICOMReader.h"
+#include "vtkDICOMReaderStatistics.h"
 #include "vtkDICOMAlgorithm.h"
+#include "vtkDICOMArchive.h"
 #include "vtkDICOMFile.h"
 #include "vtkDICOMFilePath.h"
 #include "vtkDICOMMetaData.h"
@@ -23,6 +25,8 @@
 #include "vtkDICOMTagPath.h"
 #include "vtkDICOMImageCodec.h"
 #include "vtkDICOMSliceSorter.h"
+#include "vtkDICOMStream.h"
+#include "vtkDICOMTracer.h"
 #include "vtkDICOMUtilities.h"
 #include "vtkDICOMConfig.h"
 
@@ -36,6 +40,7 @@
 #include "vtkByteSwap.h"
 #include "vtkMatrix4x4.h"
 #include "vtkMedicalImageProperties.h"
+#include "vtkMultiThreader.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkStringArray.h"
 #include "vtkMath.h"
@@ -65,9 +70,20 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 // For compatibility with new VTK generic data arrays
 #ifdef vtkGenericDataArray_h
@@ -92,6 +108,21 @@ vtkDICOMReader::vtkDICOMReader()
   this->DefaultCharacterSet = vtkDICOMCharacterSet::GetGlobalDefault();
   this->OverrideCharacterSet = vtkDICOMCharacterSet::GetGlobalOverride();
   this->Parser = nullptr;
+  this->InputStream = nullptr;
+  this->NumberOfParserThreads = 1;
+  this->NumberOfReadAheadThreads = 0;
+  this->CacheSize = 0;
+  this->PrefetchCount = 0;
+  this->DecimationFactors[0] = 1;
+  this->DecimationFactors[1] = 1;
+  this->DecimationFactors[2] = 1;
+  this->DecimationMode = vtkDICOMReader::Subsample;
+  this->Statistics = vtkDICOMReaderStatistics::New();
+  this->CollectStatistics = 0;
+  this->TimingActive = false;
+  this->StatisticsStale = false;
+  this->Cache = nullptr;
+  this->ReadAhead = nullptr;
   this->Sorter = vtkDICOMSliceSorter::New();
   this->FileIndexArray = vtkIntArray::New();
   this->FrameIndexArray = vtkIntArray::New();
@@ -136,6 +167,10 @@ vtkDICOMReader::vtkDICOMReader()
 //----------------------------------------------------------------------------
 vtkDICOMReader::~vtkDICOMReader()
 {
+  this->FinishPrefetch();
+  delete this->Cache;
+  this->Statistics->Delete();
+
 #ifdef DICOM_USE_DCMTK
   DcmRLEDecoderRegistration::cleanup();
   DJLSDecoderRegistration::cleanup();
@@ -253,6 +288,20 @@ void vtkDICOMReader::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "MemoryRowOrder: "
      << this->GetMemoryRowOrderAsString() << "\n";
   os << indent << "OutputScalarType: " << this->OutputScalarType << "\n";
+  os << indent << "NumberOfParserThreads: "
+     << this->NumberOfParserThreads << "\n";
+  os << indent << "NumberOfReadAheadThreads: "
+     << this->NumberOfReadAheadThreads << "\n";
+  os << indent << "CacheSize: " << this->CacheSize << "\n";
+  os << indent << "PrefetchCount: " << this->PrefetchCount << "\n";
+  os << indent << "InputStream: " << this->InputStream << "\n";
+  os << indent << "DecimationFactors: " << this->DecimationFactors[0] << " "
+     << this->DecimationFactors[1] << " " << this->DecimationFactors[2] << "\n";
+  os << indent << "DecimationMode: "
+     << this->GetDecimationModeAsString() << "\n";
+  os << indent << "CollectStatistics: "
+     << (this->CollectStatistics ? "On\n" : "Off\n");
+  os << indent << "Statistics: " << this->Statistics << "\n";
 
   os << indent << "OverlayBitfield: 0b";
   for (int i = 16; i >= 0; --i)
@@ -308,6 +357,8 @@ protected:
 
 void vtkDICOMErrorSilencer::Execute(vtkObject *, unsigned long, void *)
 {
+  // keep the error from being passed to any other observers
+  this->SetAbortFlag(1);
 }
 
 } // end anonymous namespace
@@ -345,6 +396,104 @@ const char *vtkDICOMReader::GetMemoryRowOrderAsString()
   return text;
 }
 
+//----------------------------------------------------------------------------
+void vtkDICOMReader::SetInputStream(vtkDICOMStream *stream)
+{
+  if (stream != this->InputStream)
+  {
+    // cached frames are keyed by file name, which a stream doesn't have
+    this->ClearCache();
+    this->InputStream = stream;
+    this->Modified();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::ComputeInternalFileName(int slice)
+{
+  if (!this->InputStream)
+  {
+    this->Superclass::ComputeInternalFileName(slice);
+    return;
+  }
+
+  const char *name = (this->FileName ? this->FileName : "(stream)");
+  delete [] this->InternalFileName;
+  size_t n = strlen(name);
+  this->InternalFileName = new char[n + 1];
+  strcpy(this->InternalFileName, name);
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::SetDecimationFactors(int fx, int fy, int fz)
+{
+  fx = (fx > 1 ? fx : 1);
+  fy = (fy > 1 ? fy : 1);
+  fz = (fz > 1 ? fz : 1);
+  if (fx != this->DecimationFactors[0] ||
+      fy != this->DecimationFactors[1] ||
+      fz != this->DecimationFactors[2])
+  {
+    // cached frames were decoded with the old factors
+    this->ClearCache();
+    this->DecimationFactors[0] = fx;
+    this->DecimationFactors[1] = fy;
+    this->DecimationFactors[2] = fz;
+    this->Modified();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::SetDecimationMode(int mode)
+{
+  if (mode >= 0 && mode <= vtkDICOMReader::BlockAverage)
+  {
+    if (mode != this->DecimationMode)
+    {
+      this->ClearCache();
+      this->DecimationMode = mode;
+      this->Modified();
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+const char *vtkDICOMReader::GetDecimationModeAsString()
+{
+  const char *text = "";
+  switch (this->DecimationMode)
+  {
+    case vtkDICOMReader::Subsample:
+      text = "Subsample";
+      break;
+    case vtkDICOMReader::BlockAverage:
+      text = "BlockAverage";
+      break;
+  }
+
+  return text;
+}
+
+//----------------------------------------------------------------------------
+double vtkDICOMReader::StartStage()
+{
+  if (this->TimingActive && this->CollectStatistics)
+  {
+    return vtkDICOMReaderStatistics::GetClock();
+  }
+  return 0.0;
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::EndStage(int stage, double startTime)
+{
+  if (this->TimingActive && this->CollectStatistics)
+  {
+    this->Statistics->AddStageTime(
+      stage, vtkDICOMReaderStatistics::GetClock() - startTime);
+  }
+}
+
 //----------------------------------------------------------------------------
 int vtkDICOMReader::CanReadFile(const char *filename)
 {
@@ -389,8 +538,753 @@ struct vtkDICOMReaderFileInfo
   vtkDICOMReaderFileInfo(int i, int n) : FileIndex(i), FramesInFile(n) {}
 };
 
+// make a list of all the files needed for the given range of slices
+void vtkDICOMReaderCollectFiles(
+  vtkDICOMMetaData *meta, vtkIntArray *fileArray, vtkIntArray *frameArray,
+  int sMin, int sMax, std::vector<vtkDICOMReaderFileInfo> *files)
+{
+  int nComp = fileArray->GetNumberOfComponents();
+  for (int sIdx = sMin; sIdx <= sMax; sIdx++)
+  {
+    for (int cIdx = 0; cIdx < nComp; cIdx++)
+    {
+      int fileIdx = fileArray->GetComponent(sIdx, cIdx);
+      int frameIdx = frameArray->GetComponent(sIdx, cIdx);
+      std::vector<vtkDICOMReaderFileInfo>::iterator iter = files->begin();
+      while (iter != files->end() && iter->FileIndex != fileIdx)
+      {
+        ++iter;
+      }
+      if (iter == files->end())
+      {
+        int n = meta->Get(fileIdx, DC::NumberOfFrames).AsInt();
+        n = (n > 0 ? n : 1);
+        files->push_back(vtkDICOMReaderFileInfo(fileIdx, n));
+        iter = files->end();
+        --iter;
+      }
+      iter->Frames.push_back(vtkDICOMReaderFrameInfo(frameIdx, sIdx, cIdx));
+    }
+  }
+}
+
+// check whether a transfer syntax can be read without a decompressor
+bool vtkDICOMReaderIsNative(const std::string& transferSyntax)
+{
+  return (transferSyntax == "1.2.840.10008.1.2"   ||  // Implicit LE
+          transferSyntax == "1.2.840.10008.1.20"  ||  // Papyrus Implicit LE
+          transferSyntax == "1.2.840.10008.1.2.1" ||  // Explicit LE
+          transferSyntax == "1.2.840.10008.1.2.2" ||  // Explicit BE
+          transferSyntax == "1.2.840.10008.1.2.5" ||  // RLE compressed
+          transferSyntax == "1.2.840.113619.5.2"  ||  // GE LE with BE data
+          transferSyntax == "");
+}
+
+// a file that will be decoded by the prefetch thread
+struct vtkDICOMReaderPrefetchJob
+{
+  std::string FileName;
+  int FileIndex;
+  int FramesInFile;
+  int NeedsYBRToRGB;
+  std::vector<int> Frames;
+  // the result, which is only examined after the thread is joined
+  unsigned long ErrorCode;
+  std::string ErrorText;
+};
+
+} // end anonymous namespace
+
+//----------------------------------------------------------------------------
+// The state for decoding one file.
+struct vtkDICOMReader::DecodeState
+{
+  DecodeState(int ybr, bool deferErrors)
+    : NeedsYBRToRGB(ybr), DeferErrors(deferErrors), BytesRead(0),
+      ErrorCode(0) {}
+
+  // This is cleared if the decoder does the YBR to RGB conversion.
+  int NeedsYBRToRGB;
+
+  // If set, errors are saved here instead of being reported.
+  bool DeferErrors;
+
+  // The number of bytes that were read from the current file.
+  vtkTypeInt64 BytesRead;
+
+  // The first error that was deferred.
+  unsigned long ErrorCode;
+  std::string ErrorText;
+};
+
+// Format a message for DecodeError(), in the manner of vtkErrorMacro.
+#define vtkDICOMReaderDecodeErrorMacro(state, code, x) \
+{ \
+  std::stringstream vtkDICOMReaderMsg; \
+  vtkDICOMReaderMsg << x; \
+  this->DecodeError(state, code, vtkDICOMReaderMsg.str().c_str()); \
+}
+
+//----------------------------------------------------------------------------
+// A cache of decoded frames that is shared with the prefetch thread.
+class vtkDICOMReader::FrameCache
+{
+public:
+  // Frames are identified by file name, frame, and decoded data type.
+  struct Key
+  {
+    std::string FileName;
+    int Frame;
+    int Type;
+
+    Key(const std::string& f, int i, int t) : FileName(f), Frame(i), Type(t) {}
+
+    bool operator<(const Key& k) const {
+      return (this->Frame < k.Frame ||
+              (this->Frame == k.Frame &&
+               (this->Type < k.Type ||
+                (this->Type == k.Type && this->FileName < k.FileName)))); }
+  };
+
+  FrameCache() : MaximumSize(0), MemoryUsed(0), Hits(0), Misses(0),
+    Prefetches(0), LastSlice(-1), Direction(1), Abort(false),
+    FrameSize(0) {}
+
+  // Copy a frame into the buffer, return false if not present.
+  bool Fetch(const Key& key, unsigned char *buffer, vtkIdType size,
+             int *ybr);
+
+  // Check whether a frame is present.
+  bool Contains(const Key& key);
+
+  // Add a frame to the cache (the least recently used are discarded).
+  void Store(const Key& key, const unsigned char *data, vtkIdType size,
+             int ybr);
+
+  // Set the maximum size, discarding frames if necessary.
+  void SetMaximumSize(vtkIdType size);
+
+  // Discard all the frames.
+  void Clear();
+
+  // Statistics, guarded by the mutex.
+  void Count(vtkTypeInt64 hits, vtkTypeInt64 misses, vtkTypeInt64 prefetches);
+  vtkIdType MaximumSize;
+  vtkIdType MemoryUsed;
+  vtkTypeInt64 Hits;
+  vtkTypeInt64 Misses;
+  vtkTypeInt64 Prefetches;
+
+  // Prefetch state, only used by the main thread.
+  int LastSlice;
+  int Direction;
+  std::thread Thread;
+  std::atomic<bool> Abort;
+  vtkIdType FrameSize;
+  std::vector<vtkDICOMReaderPrefetchJob> Jobs;
+
+  std::mutex Mutex;
+
+private:
+  struct Entry
+  {
+    Key Id;
+    std::vector<unsigned char> Data;
+    int NeedsYBRToRGB;
+
+    Entry(const Key& k) : Id(k), NeedsYBRToRGB(0) {}
+  };
+
+  typedef std::list<Entry> EntryList;
+  typedef std::map<Key, EntryList::iterator> EntryMap;
+
+  // Discard least recently used frames until the cache fits.
+  void Prune(vtkIdType size);
+
+  EntryList Entries;
+  EntryMap Index;
+};
+
+//----------------------------------------------------------------------------
+bool vtkDICOMReader::FrameCache::Fetch(
+  const Key& key, unsigned char *buffer, vtkIdType size, int *ybr)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  EntryMap::iterator iter = this->Index.find(key);
+  if (iter == this->Index.end() ||
+      static_cast<vtkIdType>(iter->second->Data.size()) != size)
+  {
+    return false;
+  }
+
+  // move the entry to the front of the list
+  this->Entries.splice(this->Entries.begin(), this->Entries, iter->second);
+  memcpy(buffer, &iter->second->Data[0], size);
+  *ybr = iter->second->NeedsYBRToRGB;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkDICOMReader::FrameCache::Contains(const Key& key)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return (this->Index.find(key) != this->Index.end());
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::FrameCache::Store(
+  const Key& key, const unsigned char *data, vtkIdType size, int ybr)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  EntryMap::iterator iter = this->Index.find(key);
+  if (iter != this->Index.end())
+  {
+    this->MemoryUsed -= static_cast<vtkIdType>(iter->second->Data.size());
+    this->Entries.erase(iter->second);
+    this->Index.erase(iter);
+  }
+
+  if (size <= 0 || size > this->MaximumSize)
+  {
+    return;
+  }
+
+  this->Prune(this->MaximumSize - size);
+  this->Entries.push_front(Entry(key));
+  Entry& e = this->Entries.front();
+  e.Data.assign(data, data + size);
+  e.NeedsYBRToRGB = ybr;
+  this->Index[key] = this->Entries.begin();
+  this->MemoryUsed += size;
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::FrameCache::SetMaximumSize(vtkIdType size)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->MaximumSize = size;
+  this->Prune(size);
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::FrameCache::Clear()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Prune(0);
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::FrameCache::Prune(vtkIdType size)
+{
+  // the caller must hold the lock
+  while (this->MemoryUsed > size && !this->Entries.empty())
+  {
+    Entry& e = this->Entries.back();
+    this->MemoryUsed -= static_cast<vtkIdType>(e.Data.size());
+    this->Index.erase(e.Id);
+    this->Entries.pop_back();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::FrameCache::Count(
+  vtkTypeInt64 hits, vtkTypeInt64 misses, vtkTypeInt64 prefetches)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Hits += hits;
+  this->Misses += misses;
+  this->Prefetches += prefetches;
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::SetCacheSize(vtkIdType size)
+{
+  size = (size > 0 ? size : 0);
+  if (size != this->CacheSize)
+  {
+    // no call to Modified(), since the cache does not affect the output
+    this->FinishPrefetch();
+    if (this->Cache == nullptr)
+    {
+      this->Cache = new FrameCache;
+    }
+    this->Cache->SetMaximumSize(size);
+    this->CacheSize = size;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::ClearCache()
+{
+  if (this->Cache)
+  {
+    this->FinishPrefetch();
+    this->Cache->Clear();
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkTypeInt64 vtkDICOMReader::GetCacheHits()
+{
+  vtkTypeInt64 n = 0;
+  if (this->Cache)
+  {
+    std::lock_guard<std::mutex> lock(this->Cache->Mutex);
+    n = this->Cache->Hits;
+  }
+  return n;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeInt64 vtkDICOMReader::GetCacheMisses()
+{
+  vtkTypeInt64 n = 0;
+  if (this->Cache)
+  {
+    std::lock_guard<std::mutex> lock(this->Cache->Mutex);
+    n = this->Cache->Misses;
+  }
+  return n;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeInt64 vtkDICOMReader::GetCachePrefetches()
+{
+  vtkTypeInt64 n = 0;
+  if (this->Cache)
+  {
+    std::lock_guard<std::mutex> lock(this->Cache->Mutex);
+    n = this->Cache->Prefetches;
+  }
+  return n;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkDICOMReader::GetCacheMemoryUsed()
+{
+  vtkIdType n = 0;
+  if (this->Cache)
+  {
+    std::lock_guard<std::mutex> lock(this->Cache->Mutex);
+    n = this->Cache->MemoryUsed;
+  }
+  return n;
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::ResetCacheStatistics()
+{
+  if (this->Cache)
+  {
+    std::lock_guard<std::mutex> lock(this->Cache->Mutex);
+    this->Cache->Hits = 0;
+    this->Cache->Misses = 0;
+    this->Cache->Prefetches = 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::StartPrefetch(
+  const int extent[6], vtkIdType frameSize, int ybr)
+{
+  FrameCache *cache = this->Cache;
+
+  // use the motion of the update extent to choose the direction
+  if (cache->LastSlice >= 0 && extent[4] != cache->LastSlice)
+  {
+    cache->Direction = (extent[4] > cache->LastSlice ? 1 : -1);
+  }
+  cache->LastSlice = extent[4];
+
+  int maxSlice = static_cast<int>(this->FileIndexArray->GetNumberOfTuples());
+  int sMin = extent[5] + 1;
+  int sMax = extent[5] + this->PrefetchCount;
+  if (cache->Direction < 0)
+  {
+    sMin = extent[4] - this->PrefetchCount;
+    sMax = extent[4] - 1;
+  }
+  sMin = (sMin > 0 ? sMin : 0);
+  sMax = (sMax < maxSlice ? sMax : maxSlice - 1);
+  if (sMin > sMax)
+  {
+    return;
+  }
+
+  std::vector<vtkDICOMReaderFileInfo> files;
+  vtkDICOMReaderCollectFiles(this->MetaData,
+    this->FileIndexArray, this->FrameIndexArray, sMin, sMax, &files);
+  if (cache->Direction < 0)
+  {
+    // the nearest slices should be decoded first
+    std::reverse(files.begin(), files.end());
+  }
+
+  int type = 2*this->FileScalarType + ybr;
+  cache->Jobs.clear();
+  cache->FrameSize = frameSize;
+  for (size_t i = 0; i < files.size(); i++)
+  {
+    this->ComputeInternalFileName(files[i].FileIndex);
+    vtkDICOMReaderPrefetchJob job;
+    job.FileName = this->InternalFileName;
+    job.FileIndex = files[i].FileIndex;
+    job.FramesInFile = files[i].FramesInFile;
+    job.NeedsYBRToRGB = ybr;
+    job.ErrorCode = 0;
+    for (size_t j = 0; j < files[i].Frames.size(); j++)
+    {
+      int frameIdx = files[i].Frames[j].FrameIndex;
+      if (!cache->Contains(FrameCache::Key(job.FileName, frameIdx, type)))
+      {
+        job.Frames.push_back(frameIdx);
+      }
+    }
+    if (!job.Frames.empty())
+    {
+      cache->Jobs.push_back(job);
+    }
+  }
+
+  if (cache->Jobs.empty())
+  {
+    return;
+  }
+
+  cache->Abort = false;
+  cache->Thread = std::thread(&vtkDICOMReader::PrefetchWorker, this);
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::FinishPrefetch()
+{
+  FrameCache *cache = this->Cache;
+  if (cache && cache->Thread.joinable())
+  {
+    cache->Abort = true;
+    cache->Thread.join();
+
+    // the frames that failed were not cached, so they will be read again
+    // if they are needed, hence these errors do not set the error code
+    for (size_t i = 0; i < cache->Jobs.size(); i++)
+    {
+      const vtkDICOMReaderPrefetchJob& job = cache->Jobs[i];
+      if (job.ErrorCode != 0)
+      {
+        vtkWarningMacro("Prefetch failed for " << job.FileName << ": "
+                        << job.ErrorText);
+      }
+    }
+    cache->Jobs.clear();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::PrefetchWorker(vtkDICOMReader *self)
+{
+  FrameCache *cache = self->Cache;
+  vtkIdType frameSize = cache->FrameSize;
+  int fileScalarSize = vtkDataArray::GetDataTypeSize(self->FileScalarType);
+  std::vector<unsigned char> buffer;
+
+  for (size_t i = 0; i < cache->Jobs.size() && !cache->Abort; i++)
+  {
+    vtkDICOMReaderPrefetchJob& job = cache->Jobs[i];
+    int fileIdx = job.FileIndex;
+    vtkIdType bufferSize = frameSize*job.FramesInFile;
+    buffer.resize(bufferSize);
+
+    // the job has its own state, and its errors are reported later
+    DecodeState state(job.NeedsYBRToRGB, true);
+    if (!self->ReadOneFile(job.FileName.c_str(), fileIdx,
+                           &buffer[0], bufferSize, &state))
+    {
+      job.ErrorCode = state.ErrorCode;
+      job.ErrorText = state.ErrorText;
+      continue;
+    }
+
+    int bitsStored = self->MetaData->Get(fileIdx, DC::BitsStored).AsInt();
+    if (bitsStored > 0 && bitsStored < fileScalarSize*8)
+    {
+      int pixelRepresentation =
+        self->MetaData->Get(fileIdx, DC::PixelRepresentation).AsInt();
+      self->MaskBits(&buffer[0], bufferSize,
+          fileScalarSize, bitsStored, pixelRepresentation);
+    }
+
+    int type = 2*self->FileScalarType + job.NeedsYBRToRGB;
+    for (size_t j = 0; j < job.Frames.size(); j++)
+    {
+      int frameIdx = job.Frames[j];
+      cache->Store(FrameCache::Key(job.FileName, frameIdx, type),
+        &buffer[frameIdx*frameSize], frameSize, state.NeedsYBRToRGB);
+    }
+    cache->Count(0, 0, static_cast<vtkTypeInt64>(job.Frames.size()));
+  }
+}
+
+//----------------------------------------------------------------------------
+namespace {
+
+// A stream for a block of data that was read from a file.
+class vtkDICOMReaderBlockStream : public vtkDICOMStream
+{
+public:
+  // The data is taken from the vector, which is left empty.
+  vtkDICOMReaderBlockStream(std::vector<unsigned char> *data, Size offset)
+    : Offset(offset), Position(offset), Error(false) {
+    this->Data.swap(*data); }
+
+  size_t Read(unsigned char *data, size_t size) VTK_DICOM_OVERRIDE
+  {
+    // only the data from the block offset onwards is available
+    if (this->Position < this->Offset)
+    {
+      this->Error = true;
+      return 0;
+    }
+    Size l = this->Offset + this->Data.size();
+    Size n = (this->Position < l ? l - this->Position : 0);
+    n = (size < n ? size : n);
+    if (n > 0)
+    {
+      memcpy(data, &this->Data[this->Position - this->Offset], n);
+      this->Position += n;
+    }
+    return static_cast<size_t>(n);
+  }
+
+  bool SetPosition(Size offset) VTK_DICOM_OVERRIDE
+  {
+    this->Position = offset;
+    return true;
+  }
+
+  Size GetSize() VTK_DICOM_OVERRIDE
+  {
+    return this->Offset + this->Data.size();
+  }
+
+  bool GetError() VTK_DICOM_OVERRIDE
+  {
+    return this->Error;
+  }
+
+private:
+  std::vector<unsigned char> Data;
+  Size Offset;
+  Size Position;
+  bool Error;
+};
+
 } // end anonymous namespace
 
+//----------------------------------------------------------------------------
+// A queue of files whose pixel data is read by a pool of threads, while
+// the main thread takes the data from the queue in order and decodes it.
+class vtkDICOMReader::ReadAheadQueue
+{
+public:
+  // The number of files and bytes that can be read ahead of the decoder.
+  ReadAheadQueue(size_t maxFiles, size_t maxBytes)
+    : MaximumFiles(maxFiles), MaximumBytes(maxBytes), BytesHeld(0),
+      Next(0), Current(0), Abort(false) {}
+
+  // The threads are stopped when the queue is destroyed.
+  ~ReadAheadQueue();
+
+  // Add a file, this must be done before the threads are started.
+  void Add(const char *filename, int fileIdx,
+           vtkTypeInt64 offset, vtkTypeInt64 size);
+
+  // Start the threads.
+  void Start(int numThreads);
+
+  // Wait for a file to be read, and return a stream that holds its data.
+  // The return value is null if the file was not queued or not read.
+  vtkDICOMStream *Take(int fileIdx);
+
+private:
+  enum JobStatus { Waiting, Reading, Done, Failed, Taken };
+
+  struct Job
+  {
+    std::string FileName;
+    vtkTypeInt64 Offset;
+    size_t Size;
+    std::vector<unsigned char> Data;
+    JobStatus Status;
+  };
+
+  // The method that is run by each thread.
+  void Worker();
+
+  // Discard the data for a job that was not taken (mutex must be held).
+  void Discard(Job *job);
+
+  std::vector<Job> Jobs;
+  std::map<int, size_t> JobIndex;
+  std::vector<std::thread> Threads;
+  size_t MaximumFiles;
+  size_t MaximumBytes;
+  size_t BytesHeld;
+  size_t Next;
+  size_t Current;
+  bool Abort;
+  std::mutex Mutex;
+  std::condition_variable Space;
+  std::condition_variable Ready;
+};
+
+//----------------------------------------------------------------------------
+vtkDICOMReader::ReadAheadQueue::~ReadAheadQueue()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Abort = true;
+  }
+  this->Space.notify_all();
+  for (size_t i = 0; i < this->Threads.size(); i++)
+  {
+    this->Threads[i].join();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::ReadAheadQueue::Add(
+  const char *filename, int fileIdx, vtkTypeInt64 offset, vtkTypeInt64 size)
+{
+  this->JobIndex[fileIdx] = this->Jobs.size();
+  this->Jobs.push_back(Job());
+  Job& job = this->Jobs.back();
+  job.FileName = filename;
+  job.Offset = offset;
+  job.Size = static_cast<size_t>(size);
+  job.Status = Waiting;
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::ReadAheadQueue::Start(int numThreads)
+{
+  for (int i = 0; i < numThreads; i++)
+  {
+    this->Threads.push_back(
+      std::thread(&vtkDICOMReader::ReadAheadQueue::Worker, this));
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::ReadAheadQueue::Discard(Job *job)
+{
+  if (job->Status == Done)
+  {
+    this->BytesHeld -= job->Data.size();
+    std::vector<unsigned char>().swap(job->Data);
+  }
+  job->Status = Taken;
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMStream *vtkDICOMReader::ReadAheadQueue::Take(int fileIdx)
+{
+  std::map<int, size_t>::iterator iter = this->JobIndex.find(fileIdx);
+  if (iter == this->JobIndex.end())
+  {
+    return nullptr;
+  }
+
+  size_t i = iter->second;
+  std::unique_lock<std::mutex> lock(this->Mutex);
+
+  // files that were skipped by the decoder will not be needed
+  while (this->Current < i)
+  {
+    this->Discard(&this->Jobs[this->Current++]);
+  }
+  this->Space.notify_all();
+
+  Job& job = this->Jobs[i];
+  while (job.Status == Waiting || job.Status == Reading)
+  {
+    this->Ready.wait(lock);
+  }
+
+  vtkDICOMStream *stream = nullptr;
+  if (job.Status == Done)
+  {
+    this->BytesHeld -= job.Data.size();
+    stream = new vtkDICOMReaderBlockStream(&job.Data, job.Offset);
+  }
+  job.Status = Taken;
+  this->Current = i + 1;
+  this->Space.notify_all();
+
+  return stream;
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::ReadAheadQueue::Worker()
+{
+  std::unique_lock<std::mutex> lock(this->Mutex);
+
+  while (!this->Abort && this->Next < this->Jobs.size())
+  {
+    // wait if too far ahead, but never hold up the file being decoded
+    Job& job = this->Jobs[this->Next];
+    if (this->Next > this->Current &&
+        (this->Next >= this->Current + this->MaximumFiles ||
+         this->BytesHeld + job.Size > this->MaximumBytes))
+    {
+      this->Space.wait(lock);
+      continue;
+    }
+
+    this->Next++;
+    if (job.Status != Waiting)
+    {
+      // the decoder skipped this file
+      continue;
+    }
+    job.Status = Reading;
+    this->BytesHeld += job.Size;
+    lock.unlock();
+
+    std::vector<unsigned char> data(job.Size);
+    vtkDICOMFile infile(job.FileName.c_str(), vtkDICOMFile::In);
+    bool success = (!infile.GetError() && infile.SetPosition(job.Offset));
+    size_t n = 0;
+    while (success && n < data.size())
+    {
+      size_t m = infile.Read(&data[n], data.size() - n);
+      success = !infile.GetError();
+      if (m == 0)
+      {
+        break;
+      }
+      n += m;
+    }
+    infile.Close();
+    // a short read is not a failure here, the decoder will report it
+    data.resize(n);
+
+    lock.lock();
+    this->BytesHeld -= job.Size;
+    if (success && job.Status == Reading)
+    {
+      job.Data.swap(data);
+      job.Status = Done;
+      this->BytesHeld += job.Data.size();
+    }
+    else if (job.Status == Reading)
+    {
+      // the decoder will open the file itself and report the error
+      job.Status = Failed;
+    }
+    this->Ready.notify_all();
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkDICOMReader::SortFiles(vtkIntArray *files, vtkIntArray *frames)
 {
@@ -669,6 +1563,204 @@ int vtkDICOMReader::ComputeRescaledScalarType(
   return scalarType;
 }
 
+//----------------------------------------------------------------------------
+namespace {
+
+// An error that was reported by a parser in a thread.
+struct vtkDICOMReaderParseError
+{
+  unsigned long ErrorCode;
+  std::string Message;
+};
+
+// This captures the error messages when a parser is used in a thread.
+class vtkDICOMErrorCapture : public vtkCommand
+{
+public:
+  static vtkDICOMErrorCapture *New() { return new vtkDICOMErrorCapture; }
+  vtkTypeMacro(vtkDICOMErrorCapture,vtkCommand);
+  void Execute(vtkObject *caller, unsigned long eventId, void *callData)
+    VTK_DICOM_OVERRIDE;
+  const std::vector<vtkDICOMReaderParseError>& GetErrors() {
+    return this->Errors; }
+  void Clear() { this->Errors.clear(); }
+protected:
+  vtkDICOMErrorCapture() {};
+  vtkDICOMErrorCapture(const vtkDICOMErrorCapture& c) : vtkCommand(c) {}
+  void operator=(const vtkDICOMErrorCapture&) {}
+  std::vector<vtkDICOMReaderParseError> Errors;
+};
+
+void vtkDICOMErrorCapture::Execute(vtkObject *o, unsigned long, void *data)
+{
+  // keep the error code at the time of the error, like RelayError()
+  vtkDICOMReaderParseError e;
+  vtkDICOMParser *parser = vtkDICOMParser::SafeDownCast(o);
+  e.ErrorCode = (parser ? parser->GetErrorCode() : 0);
+  if (data)
+  {
+    e.Message = static_cast<char *>(data);
+  }
+  else
+  {
+    e.Message = "An unknown error occurred!";
+  }
+  this->Errors.push_back(e);
+}
+
+// The information that is shared by the threads that read the headers.
+struct vtkDICOMReaderParseInfo
+{
+  std::vector<std::string> FileNames;
+  std::vector<vtkDICOMMetaData *> MetaData;
+  std::vector<vtkTypeInt64> Offsets;
+  std::vector<unsigned long> ErrorCodes;
+  std::vector<std::vector<vtkDICOMReaderParseError> > Errors;
+  vtkDICOMCharacterSet DefaultCharacterSet;
+  bool OverrideCharacterSet;
+};
+
+// Each thread reads every Nth file into its own meta data object.
+VTK_THREAD_RETURN_TYPE vtkDICOMReaderParseThread(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *ti =
+    static_cast<vtkMultiThreader::ThreadInfo *>(arg);
+  vtkDICOMReaderParseInfo *info =
+    static_cast<vtkDICOMReaderParseInfo *>(ti->UserData);
+  int n = static_cast<int>(info->FileNames.size());
+
+  vtkDICOMErrorCapture *capture = vtkDICOMErrorCapture::New();
+  vtkDICOMParser *parser = vtkDICOMParser::New();
+  parser->SetDefaultCharacterSet(info->DefaultCharacterSet);
+  parser->SetOverrideCharacterSet(info->OverrideCharacterSet);
+  parser->AddObserver(vtkCommand::ErrorEvent, capture);
+
+  // The files are read in increasing order and each thread stops at its
+  // first error, so every file before the first bad file will be read.
+  for (int idx = ti->ThreadID; idx < n; idx += ti->NumberOfThreads)
+  {
+    parser->SetMetaData(info->MetaData[idx]);
+    parser->SetFileName(info->FileNames[idx].c_str());
+    capture->Clear();
+    parser->Update();
+
+    // Keep all errors, even those that don't stop the parser.
+    info->Errors[idx] = capture->GetErrors();
+    if (parser->GetErrorCode())
+    {
+      info->ErrorCodes[idx] = parser->GetErrorCode();
+      break;
+    }
+
+    info->Offsets[2*idx] = parser->GetFileOffset();
+    info->Offsets[2*idx + 1] = parser->GetFileSize();
+  }
+
+  parser->Delete();
+  capture->Delete();
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+// Merge the meta data for one file into the meta data for the series,
+// with the same result as if the parser had read the file directly.
+void vtkDICOMReaderMergeMetaData(
+  vtkDICOMMetaData *meta, vtkDICOMMetaData *source, int idx)
+{
+  vtkDICOMDataElementIterator iter;
+
+  if (meta->GetNumberOfDataElements() == 0 ||
+      meta->GetNumberOfInstances() <= 1)
+  {
+    for (iter = source->Begin(); iter != source->End(); ++iter)
+    {
+      meta->Set(iter->GetTag(), iter->GetValue());
+    }
+    return;
+  }
+
+  // find attributes that other instances have but this instance lacks
+  std::vector<vtkDICOMTag> missing;
+  for (iter = meta->Begin(); iter != meta->End(); ++iter)
+  {
+    vtkDICOMTag tag = iter->GetTag();
+    if (tag.GetGroup() != 0x0002 && !source->Has(tag))
+    {
+      missing.push_back(tag);
+    }
+  }
+
+  for (iter = source->Begin(); iter != source->End(); ++iter)
+  {
+    meta->Set(idx, iter->GetTag(), iter->GetValue());
+  }
+
+  for (size_t i = 0; i < missing.size(); i++)
+  {
+    meta->Set(idx, missing[i], vtkDICOMValue());
+  }
+}
+
+} // end anonymous namespace
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::ParseFilesThreaded(int numFiles, int numThreads)
+{
+  vtkDICOMReaderParseInfo info;
+  info.FileNames.resize(numFiles);
+  info.MetaData.resize(numFiles);
+  info.Offsets.resize(2*numFiles, 0);
+  info.ErrorCodes.resize(numFiles, 0);
+  info.Errors.resize(numFiles);
+  info.DefaultCharacterSet = this->DefaultCharacterSet;
+  info.OverrideCharacterSet = this->OverrideCharacterSet;
+
+  // Each file is read into its own meta data object.
+  for (int idx = 0; idx < numFiles; idx++)
+  {
+    this->ComputeInternalFileName(this->DataExtent[4] + idx);
+    info.FileNames[idx] = this->InternalFileName;
+    info.MetaData[idx] = vtkDICOMMetaData::New();
+  }
+
+  vtkMultiThreader *threader = vtkMultiThreader::New();
+  threader->SetNumberOfThreads(numThreads);
+  threader->SetSingleMethod(vtkDICOMReaderParseThread, &info);
+  threader->SingleMethodExecute();
+  threader->Delete();
+
+  // Merge the results in file order, stop at the first bad file.
+  for (int idx = 0; idx < numFiles; idx++)
+  {
+    this->Parser->SetFileName(info.FileNames[idx].c_str());
+    this->Parser->SetIndex(idx);
+
+    // Report the errors in the same way as RelayError().
+    for (size_t i = 0; i < info.Errors[idx].size(); i++)
+    {
+      const vtkDICOMReaderParseError& e = info.Errors[idx][i];
+      this->SetErrorCode(
+        e.ErrorCode ? e.ErrorCode : vtkErrorCode::UnknownError);
+      vtkErrorMacro(<< e.Message);
+    }
+
+    if (info.ErrorCodes[idx])
+    {
+      break;
+    }
+
+    vtkDICOMReaderMergeMetaData(this->MetaData, info.MetaData[idx], idx);
+    this->FileOffsetArray->SetTupleValue(idx, &info.Offsets[2*idx]);
+  }
+
+  for (int idx = 0; idx < numFiles; idx++)
+  {
+    info.MetaData[idx]->Delete();
+  }
+
+  this->MetaData->Modified();
+}
+
 //----------------------------------------------------------------------------
 int vtkDICOMReader::RequestInformation(
   vtkInformation* vtkNotUsed(request),
@@ -678,8 +1770,18 @@ int vtkDICOMReader::RequestInformation(
   // Clear the error indicator.
   this->SetErrorCode(vtkErrorCode::NoError);
 
+  // Start collecting statistics for this update
+  this->TimingActive = (this->CollectStatistics != 0);
+  this->StatisticsStale = false;
+  this->Statistics->Initialize();
+
   // How many files are to be loaded?
-  if (this->FileNames)
+  if (this->InputStream)
+  {
+    this->DataExtent[4] = 0;
+    this->DataExtent[5] = 0;
+  }
+  else if (this->FileNames)
   {
     vtkIdType numFileNames = this->FileNames->GetNumberOfValues();
     this->DataExtent[4] = 0;
@@ -732,6 +1834,7 @@ int vtkDICOMReader::RequestInformation(
   this->Parser->SetDefaultCharacterSet(this->DefaultCharacterSet);
   this->Parser->SetOverrideCharacterSet(this->OverrideCharacterSet);
   this->Parser->SetMetaData(this->MetaData);
+  this->Parser->SetInputStream(this->InputStream);
   this->Parser->AddObserver(
     vtkCommand::ErrorEvent, this, &vtkDICOMReader::RelayError);
 
@@ -740,23 +1843,52 @@ int vtkDICOMReader::RequestInformation(
   this->FileOffsetArray->SetNumberOfComponents(2);
   this->FileOffsetArray->SetNumberOfTuples(numFiles);
 
-  for (int idx = 0; idx < numFiles; idx++)
-  {
-    this->ComputeInternalFileName(this->DataExtent[4] + idx);
-    this->Parser->SetFileName(this->InternalFileName);
-    this->Parser->SetIndex(idx);
-    this->Parser->Update();
+  int numThreads = this->NumberOfParserThreads;
+  if (numThreads <= 0)
+  {
+    numThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  }
+  numThreads = (numThreads < numFiles ? numThreads : numFiles);
+
+  double startTime = this->StartStage();
+  if (numThreads > 1)
+  {
+    // Read the headers in parallel, results are merged in file order.
+    this->ParseFilesThreaded(numFiles, numThreads);
+  }
+  else
+  {
+    for (int idx = 0; idx < numFiles; idx++)
+    {
+      this->ComputeInternalFileName(this->DataExtent[4] + idx);
+      this->Parser->SetFileName(this->InternalFileName);
+      this->Parser->SetIndex(idx);
+      this->Parser->Update();
+
+      if (this->Parser->GetErrorCode())
+      {
+        break;
+      }
+
+      // save the offset to the pixel data
+      vtkTypeInt64 offset[2];
+      offset[0] = this->Parser->GetFileOffset();
+      offset[1] = this->Parser->GetFileSize();
+      this->FileOffsetArray->SetTupleValue(idx, offset);
+    }
+  }
+  this->EndStage(vtkDICOMReaderStatistics::Parse, startTime);
 
-    if (this->Parser->GetErrorCode())
+  if (this->TimingActive && this->GetErrorCode() == vtkErrorCode::NoError)
+  {
+    // the parser reads everything that precedes the pixel data
+    for (int idx = 0; idx < numFiles; idx++)
     {
-      break;
+      vtkTypeInt64 offset[2];
+      this->FileOffsetArray->GetTupleValue(idx, offset);
+      this->Statistics->AddBytesRead(offset[0]);
     }
-
-    // save the offset to the pixel data
-    vtkTypeInt64 offset[2];
-    offset[0] = this->Parser->GetFileOffset();
-    offset[1] = this->Parser->GetFileSize();
-    this->FileOffsetArray->SetTupleValue(idx, offset);
+    this->Statistics->AddFilesOpened(numFiles);
   }
 
   // Files are read in the order provided, but they might have
@@ -779,6 +1911,38 @@ int vtkDICOMReader::RequestInformation(
     this->ValidateStructure(this->FileIndexArray, this->FrameIndexArray);
   }
 
+  // For preview reads, discard slices so that their files are never read.
+  // If time is interleaved with the slices, keep whole groups of slices.
+  int sliceStep = this->DecimationFactors[2];
+  if (sliceStep > 1 && this->GetErrorCode() == vtkErrorCode::NoError)
+  {
+    int groupSize = 1;
+    if (this->TimeDimension > 1 && this->TimeAsVector == 0 &&
+        this->DesiredTimeIndex < 0)
+    {
+      groupSize = this->TimeDimension;
+    }
+    vtkIdType numSlices = this->FileIndexArray->GetNumberOfTuples();
+    vtkIdType n = 0;
+    for (vtkIdType i = 0; i < numSlices; i++)
+    {
+      if ((i/groupSize) % sliceStep == 0)
+      {
+        for (int j = 0; j < this->FileIndexArray->GetNumberOfComponents(); j++)
+        {
+          this->FileIndexArray->SetComponent(
+            n, j, this->FileIndexArray->GetComponent(i, j));
+          this->FrameIndexArray->SetComponent(
+            n, j, this->FrameIndexArray->GetComponent(i, j));
+        }
+        n++;
+      }
+    }
+    this->FileIndexArray->SetNumberOfTuples(n);
+    this->FrameIndexArray->SetNumberOfTuples(n);
+    this->DataSpacing[2] *= sliceStep;
+  }
+
   if (this->GetErrorCode() != vtkErrorCode::NoError)
   {
     // Last chance to bail out
@@ -798,6 +1962,11 @@ int vtkDICOMReader::RequestInformation(
   int rows = this->MetaData->Get(fileIndex, DC::Rows).AsInt();
   int slices = static_cast<int>(this->FileIndexArray->GetNumberOfTuples());
 
+  // the dimensions of a preview image are rounded up
+  columns = (columns + this->DecimationFactors[0] - 1)/
+    this->DecimationFactors[0];
+  rows = (rows + this->DecimationFactors[1] - 1)/this->DecimationFactors[1];
+
   int extent[6];
   extent[0] = 0;
   extent[1] = columns - 1;
@@ -868,6 +2037,16 @@ int vtkDICOMReader::RequestInformation(
     }
   }
 
+  // For block averaging, each pixel is centered within its block
+  double blockOffset[2] = { 0.0, 0.0 };
+  if (this->DecimationMode == vtkDICOMReader::BlockAverage)
+  {
+    blockOffset[0] = 0.5*(this->DecimationFactors[0] - 1)*this->DataSpacing[0];
+    blockOffset[1] = 0.5*(this->DecimationFactors[1] - 1)*this->DataSpacing[1];
+  }
+  this->DataSpacing[0] *= this->DecimationFactors[0];
+  this->DataSpacing[1] *= this->DecimationFactors[1];
+
   // offset is part of the transform, so set origin to zero
   this->DataOrigin[0] = 0.0;
   this->DataOrigin[1] = 0.0;
@@ -1054,6 +2233,12 @@ int vtkDICOMReader::RequestInformation(
       vtkMath::Normalize(&orient[0]);
       vtkMath::Normalize(&orient[3]);
 
+      // move the point to the center of the first block
+      for (int ii = 0; ii < 3; ii++)
+      {
+        point[ii] += orient[ii]*blockOffset[0] + orient[3+ii]*blockOffset[1];
+      }
+
       if (this->MemoryRowOrder == vtkDICOMReader::BottomUp)
       {
         // calculate position of point at lower left
@@ -1239,6 +2424,40 @@ void vtkDICOMMaskBits(T *ptr, size_t n, int bits, int pixelRepr)
   }
 }
 
+//----------------------------------------------------------------------------
+// templated decimation function, for preview reads
+
+template<class T>
+void vtkDICOMDecimateBuffer(
+  const T *inPtr, T *outPtr, int columns, int rows, int nc,
+  int fx, int fy, bool average)
+{
+  bool isInteger = (static_cast<T>(0.5) == 0);
+  vtkIdType rowLen = static_cast<vtkIdType>(columns)*nc;
+  for (int y = 0; y < rows; y += fy)
+  {
+    int ny = (average && rows - y < fy ? rows - y : (average ? fy : 1));
+    for (int x = 0; x < columns; x += fx)
+    {
+      int nx = (average && columns - x < fx ? columns - x : (average ? fx : 1));
+      for (int c = 0; c < nc; c++)
+      {
+        const T *ptr = inPtr + y*rowLen + x*nc + c;
+        double sum = 0.0;
+        for (int j = 0; j < ny; j++)
+        {
+          for (int i = 0; i < nx; i++)
+          {
+            sum += ptr[j*rowLen + i*nc];
+          }
+        }
+        double v = sum/(nx*ny);
+        *outPtr++ = static_cast<T>(isInteger ? floor(v + 0.5) : v);
+      }
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 // templated conversion functions, for converting to and from floating point
 
@@ -1623,10 +2842,30 @@ void vtkDICOMReader::UnpackOverlay(
   }
 }
 
+//----------------------------------------------------------------------------
+void vtkDICOMReader::DecodeError(
+  DecodeState *state, unsigned long code, const char *text)
+{
+  if (state->DeferErrors)
+  {
+    // the prefetch thread must not invoke events on the reader
+    if (state->ErrorCode == 0)
+    {
+      state->ErrorCode = code;
+      state->ErrorText = text;
+    }
+  }
+  else
+  {
+    this->SetErrorCode(code);
+    vtkErrorMacro(<< text);
+  }
+}
+
 //----------------------------------------------------------------------------
 bool vtkDICOMReader::ReadFileNative(
   const char *filename, int fileIdx,
-  unsigned char *buffer, vtkIdType bufferSize)
+  unsigned char *buffer, vtkIdType bufferSize, DecodeState *state)
 {
   // get the offset to the PixelData in the file
   vtkTypeInt64 offsetAndSize[2];
@@ -1634,19 +2873,36 @@ bool vtkDICOMReader::ReadFileNative(
   vtkTypeInt64 offset = offsetAndSize[0];
 
   vtkDebugMacro("Opening DICOM file " << filename);
-  vtkDICOMFile infile(filename, vtkDICOMFile::In);
+  double startTime = this->StartStage();
+  // use the data from the read-ahead threads, if it is available
+  vtkDICOMStream *stream = this->InputStream;
+  std::unique_ptr<vtkDICOMStream> block;
+  if (!stream && this->ReadAhead)
+  {
+    block.reset(this->ReadAhead->Take(fileIdx));
+    stream = block.get();
+  }
+  vtkDICOMFile infile(filename, stream, vtkDICOMFile::In);
+  this->EndStage(vtkDICOMReaderStatistics::Open, startTime);
 
   if (infile.GetError())
   {
-    this->SetErrorCode(vtkErrorCode::CannotOpenFileError);
-    vtkErrorMacro("ReadFile: Can't read the file " << filename);
+    vtkDICOMReaderDecodeErrorMacro(state,
+      vtkErrorCode::CannotOpenFileError,
+      "ReadFile: Can't read the file " << filename);
     return false;
   }
 
+  if (this->TimingActive)
+  {
+    this->Statistics->AddFilesOpened(1);
+  }
+
   if (!infile.SetPosition(offset))
   {
-    this->SetErrorCode(vtkErrorCode::PrematureEndOfFileError);
-    vtkErrorMacro("DICOM file is truncated, some data is missing.");
+    vtkDICOMReaderDecodeErrorMacro(state,
+      vtkErrorCode::PrematureEndOfFileError,
+      "DICOM file is truncated, some data is missing.");
     infile.Close();
     return false;
   }
@@ -1665,6 +2921,7 @@ bool vtkDICOMReader::ReadFileNative(
 
   size_t readSize = bufferSize;
   size_t resultSize = 0;
+  startTime = this->StartStage();
   if (transferSyntax == "1.2.840.10008.1.2.5")
   {
     vtkDICOMImageCodec codec(transferSyntax);
@@ -1756,19 +3013,28 @@ bool vtkDICOMReader::ReadFileNative(
   {
     resultSize = infile.Read(buffer, readSize);
   }
+  this->EndStage(vtkDICOMReaderStatistics::Read, startTime);
+  state->BytesRead += resultSize;
+
+  if (this->TimingActive)
+  {
+    this->Statistics->AddBytesRead(resultSize);
+  }
 
   bool success = true;
   if (infile.EndOfFile() || resultSize != readSize)
   {
-    this->SetErrorCode(vtkErrorCode::PrematureEndOfFileError);
-    vtkErrorMacro("DICOM file is truncated, " <<
+    vtkDICOMReaderDecodeErrorMacro(state,
+      vtkErrorCode::PrematureEndOfFileError,
+      "DICOM file is truncated, " <<
       (readSize - resultSize) << " bytes are missing.");
     success = false;
   }
   else if (infile.GetError())
   {
-    this->SetErrorCode(vtkErrorCode::FileFormatError);
-    vtkErrorMacro("Error in DICOM file, cannot read.");
+    vtkDICOMReaderDecodeErrorMacro(state,
+      vtkErrorCode::FileFormatError,
+      "Error in DICOM file, cannot read.");
     success = false;
   }
   else if (fileBigEndian != memoryBigEndian)
@@ -1784,11 +3050,11 @@ bool vtkDICOMReader::ReadFileNative(
 //----------------------------------------------------------------------------
 bool vtkDICOMReader::ReadFileDelegated(
   const char *filename, int fileIdx,
-  unsigned char *buffer, vtkIdType bufferSize)
+  unsigned char *buffer, vtkIdType bufferSize, DecodeState *state)
 {
 #if defined(DICOM_USE_DCMTK)
   // For JPEG, DCMTK will do the YBR to RGB
-  this->NeedsYBRToRGB = false;
+  state->NeedsYBRToRGB = false;
 
 #ifdef _WIN32
   // Convert utf8 filename to local character set for dcmtk
@@ -1803,8 +3069,9 @@ bool vtkDICOMReader::ReadFileDelegated(
 
   if (!status.good())
   {
-    vtkErrorMacro("DCMTK error: " << status.text());
-    this->SetErrorCode(vtkErrorCode::FileFormatError);
+    vtkDICOMReaderDecodeErrorMacro(state,
+      vtkErrorCode::FileFormatError,
+      "DCMTK error: " << status.text());
     delete fileformat;
     return false;
   }
@@ -1832,9 +3099,11 @@ bool vtkDICOMReader::ReadFileDelegated(
   }
   else
   {
-    vtkErrorMacro(<< filename << ": The uncompressed image size is "
-                  << imageSize << " bytes, expected "
-                  << bufferSize << " bytes.");
+    vtkDICOMReaderDecodeErrorMacro(state,
+      vtkErrorCode::FileFormatError,
+      filename << ": The uncompressed image size is "
+      << imageSize << " bytes, expected "
+      << bufferSize << " bytes.");
     delete fileformat;
     return false;
   }
@@ -1862,18 +3131,20 @@ bool vtkDICOMReader::ReadFileDelegated(
   reader.SetFileName(filename);
   if(!reader.Read())
   {
-    vtkErrorMacro("The GDCM ImageReader could not read the image.");
-    this->SetErrorCode(vtkErrorCode::FileFormatError);
+    vtkDICOMReaderDecodeErrorMacro(state,
+      vtkErrorCode::FileFormatError,
+      "The GDCM ImageReader could not read the image.");
     return false;
   }
 
   gdcm::Image &image = reader.GetImage();
   if (static_cast<vtkIdType>(image.GetBufferLength()) < bufferSize)
   {
-    vtkErrorMacro(<< filename << ": The uncompressed image size is "
-                  << image.GetBufferLength() << " bytes, expected "
-                  << bufferSize << " bytes.");
-    this->SetErrorCode(vtkErrorCode::FileFormatError);
+    vtkDICOMReaderDecodeErrorMacro(state,
+      vtkErrorCode::FileFormatError,
+      filename << ": The uncompressed image size is "
+      << image.GetBufferLength() << " bytes, expected "
+      << bufferSize << " bytes.");
     return false;
   }
 
@@ -1887,33 +3158,290 @@ bool vtkDICOMReader::ReadFileDelegated(
   (void)buffer;
   (void)bufferSize;
 
-  this->SetErrorCode(vtkErrorCode::FileFormatError);
-  vtkErrorMacro("DICOM file is compressed, cannot read.");
+  vtkDICOMReaderDecodeErrorMacro(state,
+    vtkErrorCode::FileFormatError,
+    "DICOM file is compressed, cannot read.");
   return false;
 
 #endif
 }
 
+//----------------------------------------------------------------------------
+bool vtkDICOMReader::ReadFileNativeDecimated(
+  const char *filename, int fileIdx,
+  unsigned char *buffer, vtkIdType bufferSize, DecodeState *state)
+{
+  // get the offset to the PixelData in the file
+  vtkTypeInt64 offsetAndSize[2];
+  this->FileOffsetArray->GetTupleValue(fileIdx, offsetAndSize);
+  vtkTypeInt64 offset = offsetAndSize[0];
+
+  vtkDebugMacro("Opening DICOM file " << filename);
+  double startTime = this->StartStage();
+  vtkDICOMFile infile(filename, this->InputStream, vtkDICOMFile::In);
+  this->EndStage(vtkDICOMReaderStatistics::Open, startTime);
+
+  if (infile.GetError())
+  {
+    vtkDICOMReaderDecodeErrorMacro(state,
+      vtkErrorCode::CannotOpenFileError,
+      "ReadFile: Can't read the file " << filename);
+    return false;
+  }
+
+  if (this->TimingActive)
+  {
+    this->Statistics->AddFilesOpened(1);
+  }
+
+  std::string transferSyntax =
+    this->MetaData->Get(fileIdx, DC::TransferSyntaxUID).AsString();
+
+  // this will set endiancheck.s to 1 on big endian architectures
+  union { char c[2]; short s; } endianCheck = { { 0, 1 } };
+  bool memoryBigEndian = (endianCheck.s == 1);
+  bool fileBigEndian = (transferSyntax == "1.2.840.10008.1.2.2" ||
+                        transferSyntax == "1.2.840.113619.5.2");
+
+  int columns = this->MetaData->Get(fileIdx, DC::Columns).AsInt();
+  int rows = this->MetaData->Get(fileIdx, DC::Rows).AsInt();
+  int numFrames = this->MetaData->Get(fileIdx, DC::NumberOfFrames).AsInt();
+  numFrames = (numFrames > 0 ? numFrames : 1);
+  int numComponents = this->NumberOfPackedComponents;
+  int numPlanes = this->NumberOfPlanarComponents;
+  int scalarSize = vtkDataArray::GetDataTypeSize(this->FileScalarType);
+  int fy = this->DecimationFactors[1];
+  bool average = (this->DecimationMode == vtkDICOMReader::BlockAverage);
+
+  int bitsStored = this->MetaData->Get(fileIdx, DC::BitsStored).AsInt();
+  int pixelRepresentation =
+    this->MetaData->Get(fileIdx, DC::PixelRepresentation).AsInt();
+  bool maskBits = (average && bitsStored > 0 && bitsStored < scalarSize*8);
+
+  vtkIdType rowSize = static_cast<vtkIdType>(columns)*numComponents*scalarSize;
+  int outRows = (rows + fy - 1)/fy;
+  vtkIdType outRowSize = bufferSize/(static_cast<vtkIdType>(numFrames)*
+                                     numPlanes*outRows);
+
+  // for subsampling, only one row of each block is read
+  unsigned char *rowBuffer = new unsigned char[rowSize*(average ? fy : 1)];
+
+  bool success = true;
+  size_t readSize = 0;
+  size_t resultSize = 0;
+  vtkTypeInt64 bytesRead = 0;
+  unsigned char *outPtr = buffer;
+  startTime = this->StartStage();
+  for (int i = 0; i < numFrames*numPlanes && success; i++)
+  {
+    for (int j = 0; j < outRows && success; j++)
+    {
+      int firstRow = j*fy;
+      int numRows = 1;
+      if (average)
+      {
+        numRows = (rows - firstRow < fy ? rows - firstRow : fy);
+      }
+
+      // seek to the first row of the block and read it
+      vtkTypeInt64 rowOffset = offset +
+        (static_cast<vtkTypeInt64>(i)*rows + firstRow)*rowSize;
+      readSize = rowSize*numRows;
+      resultSize = 0;
+      if (infile.SetPosition(rowOffset))
+      {
+        resultSize = infile.Read(rowBuffer, readSize);
+      }
+      bytesRead += resultSize;
+      if (resultSize != readSize || infile.GetError())
+      {
+        success = false;
+        break;
+      }
+
+      if (fileBigEndian != memoryBigEndian)
+      {
+        vtkByteSwap::SwapVoidRange(
+          rowBuffer, readSize/scalarSize, scalarSize);
+      }
+      if (maskBits)
+      {
+        this->MaskBits(rowBuffer, readSize,
+          scalarSize, bitsStored, pixelRepresentation);
+      }
+
+      this->DecimateBuffer(rowBuffer, outPtr, columns, numRows, numComponents);
+      outPtr += outRowSize;
+    }
+  }
+  this->EndStage(vtkDICOMReaderStatistics::Read, startTime);
+  state->BytesRead += bytesRead;
+
+  if (this->TimingActive)
+  {
+    this->Statistics->AddBytesRead(bytesRead);
+  }
+
+  if (!success)
+  {
+    if (infile.EndOfFile() || resultSize != readSize)
+    {
+      vtkDICOMReaderDecodeErrorMacro(state,
+        vtkErrorCode::PrematureEndOfFileError,
+        "DICOM file is truncated, some data is missing.");
+    }
+    else
+    {
+      vtkDICOMReaderDecodeErrorMacro(state,
+        vtkErrorCode::FileFormatError,
+        "Error in DICOM file, cannot read.");
+    }
+  }
+
+  delete [] rowBuffer;
+  infile.Close();
+  return success;
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReader::DecimateBuffer(
+  const unsigned char *source, unsigned char *buffer,
+  int columns, int rows, int numComponents)
+{
+  int fx = this->DecimationFactors[0];
+  int fy = this->DecimationFactors[1];
+  bool average = (this->DecimationMode == vtkDICOMReader::BlockAverage);
+
+  switch (this->FileScalarType)
+  {
+    vtkTemplateAliasMacro(
+      vtkDICOMDecimateBuffer(
+        reinterpret_cast<const VTK_TT *>(source),
+        reinterpret_cast<VTK_TT *>(buffer),
+        columns, rows, numComponents, fx, fy, average));
+  }
+}
+
 //----------------------------------------------------------------------------
 bool vtkDICOMReader::ReadOneFile(
   const char *filename, int fileIdx,
-  unsigned char *buffer, vtkIdType bufferSize)
+  unsigned char *buffer, vtkIdType bufferSize, DecodeState *state)
 {
+  vtkDICOMTraceSpan span("Read", filename);
+  state->BytesRead = 0;
+
   std::string transferSyntax =
     this->MetaData->Get(fileIdx, DC::TransferSyntaxUID).AsString();
 
-  if (transferSyntax == "1.2.840.10008.1.2"   ||  // Implicit LE
-      transferSyntax == "1.2.840.10008.1.20"  ||  // Papyrus Implicit LE
-      transferSyntax == "1.2.840.10008.1.2.1" ||  // Explicit LE
-      transferSyntax == "1.2.840.10008.1.2.2" ||  // Explicit BE
-      transferSyntax == "1.2.840.10008.1.2.5" ||  // RLE compressed
-      transferSyntax == "1.2.840.113619.5.2"  ||  // GE LE with BE data
-      transferSyntax == "")
+  bool native = vtkDICOMReaderIsNative(transferSyntax);
+
+  if (!native &&
+      (this->InputStream || vtkDICOMArchive::MemberExists(filename)))
+  {
+    // the decompression libraries can only read from files
+    vtkDICOMReaderDecodeErrorMacro(state,
+      vtkErrorCode::FileFormatError,
+      "ReadFile: Can't decode a stream or archive member "
+      "with transfer syntax " << transferSyntax);
+    return false;
+  }
+
+  bool decimate = (this->DecimationFactors[0] > 1 ||
+                   this->DecimationFactors[1] > 1);
+
+  if (native && !decimate)
+  {
+    bool success =
+      this->ReadFileNative(filename, fileIdx, buffer, bufferSize, state);
+    span.SetBytes(success ? state->BytesRead : 0);
+    return success;
+  }
+
+  // for uncompressed data, read only the rows that are needed
+  int bitsAllocated =
+    this->MetaData->Get(fileIdx, DC::BitsAllocated).AsInt();
+  if (native && transferSyntax != "1.2.840.10008.1.2.5" &&
+      bitsAllocated != 12 && bitsAllocated != 1 &&
+      !this->MetaData->GetAttributeValue(fileIdx,
+         DC::PhotometricInterpretation).Matches("YBR_*_422"))
+  {
+    bool success =
+      this->ReadFileNativeDecimated(
+        filename, fileIdx, buffer, bufferSize, state);
+    span.SetBytes(success ? state->BytesRead : 0);
+    return success;
+  }
+
+  // compressed data must be fully decoded before it is decimated
+  int columns = this->MetaData->Get(fileIdx, DC::Columns).AsInt();
+  int rows = this->MetaData->Get(fileIdx, DC::Rows).AsInt();
+  int numFrames = this->MetaData->Get(fileIdx, DC::NumberOfFrames).AsInt();
+  numFrames = (numFrames > 0 ? numFrames : 1);
+  int numComponents = this->NumberOfPackedComponents;
+  int numPlanes = this->NumberOfPlanarComponents;
+  int scalarSize = vtkDataArray::GetDataTypeSize(this->FileScalarType);
+  vtkIdType planeSize =
+    static_cast<vtkIdType>(columns)*rows*numComponents*scalarSize;
+  vtkIdType fullSize = bufferSize;
+  unsigned char *fullBuffer = buffer;
+  if (decimate)
+  {
+    fullSize = planeSize*numPlanes*numFrames;
+    fullBuffer = new unsigned char[fullSize];
+  }
+
+  bool success = false;
+  if (native)
+  {
+    success = this->ReadFileNative(
+      filename, fileIdx, fullBuffer, fullSize, state);
+  }
+  else
+  {
+    double startTime = this->StartStage();
+    success = this->ReadFileDelegated(
+      filename, fileIdx, fullBuffer, fullSize, state);
+    this->EndStage(vtkDICOMReaderStatistics::Decode, startTime);
+
+    // the decompression library reads the whole file
+    vtkTypeInt64 offsetAndSize[2];
+    this->FileOffsetArray->GetTupleValue(fileIdx, offsetAndSize);
+    state->BytesRead += offsetAndSize[1];
+
+    if (this->TimingActive)
+    {
+      this->Statistics->AddFilesOpened(1);
+      this->Statistics->AddBytesRead(offsetAndSize[1]);
+    }
+  }
+
+  if (decimate)
   {
-    return this->ReadFileNative(filename, fileIdx, buffer, bufferSize);
+    if (success && this->DecimationMode == vtkDICOMReader::BlockAverage)
+    {
+      // unused bits must be cleared before averaging
+      int bitsStored = this->MetaData->Get(fileIdx, DC::BitsStored).AsInt();
+      if (bitsStored > 0 && bitsStored < scalarSize*8)
+      {
+        int pixelRepresentation =
+          this->MetaData->Get(fileIdx, DC::PixelRepresentation).AsInt();
+        this->MaskBits(fullBuffer, fullSize,
+          scalarSize, bitsStored, pixelRepresentation);
+      }
+    }
+
+    vtkIdType outPlaneSize = bufferSize/(numPlanes*numFrames);
+    for (int i = 0; i < numFrames*numPlanes && success; i++)
+    {
+      this->DecimateBuffer(fullBuffer + i*planeSize, buffer + i*outPlaneSize,
+                           columns, rows, numComponents);
+    }
+
+    delete [] fullBuffer;
   }
 
-  return this->ReadFileDelegated(filename, fileIdx, buffer, bufferSize);
+  span.SetBytes(success ? state->BytesRead : 0);
+  return success;
 }
 
 //----------------------------------------------------------------------------
@@ -1931,6 +3459,9 @@ vtkTypeBool vtkDICOMReader::ProcessRequest(
   vtkInformationVector** inputVector,
   vtkInformationVector* outputVector)
 {
+  // the prefetch thread must not run while the pipeline is executing
+  this->FinishPrefetch();
+
   if (request->Has(vtkDemandDrivenPipeline::REQUEST_DATA_NOT_GENERATED()))
   {
     // which output port did the request come from
@@ -1980,7 +3511,14 @@ int vtkDICOMReader::RequestData(
     vtkImageData *data =
       static_cast<vtkImageData *>(outInfo->Get(vtkDataObject::DATA_OBJECT()));
     this->AllocateOutputData(data, outInfo, uExtent);
-    this->ReadOverlays(data);
+    if (this->DecimationFactors[0] > 1 || this->DecimationFactors[1] > 1)
+    {
+      this->ReadDecimatedOverlays(data);
+    }
+    else
+    {
+      this->ReadOverlays(data);
+    }
   }
 
   // if output port 0 was not requested, then return
@@ -1989,6 +3527,14 @@ int vtkDICOMReader::RequestData(
     return true;
   }
 
+  // continue the statistics from RequestInformation, or start anew
+  this->TimingActive = (this->CollectStatistics != 0);
+  if (this->StatisticsStale)
+  {
+    this->Statistics->Initialize();
+    this->StatisticsStale = false;
+  }
+
   // do the main output
   vtkInformation* outInfo = outputVector->GetInformationObject(0);
 
@@ -2005,29 +3551,9 @@ int vtkDICOMReader::RequestData(
 
   // make a list of all the files inside the update extent
   std::vector<vtkDICOMReaderFileInfo> files;
-  int nComp = this->FileIndexArray->GetNumberOfComponents();
-  for (int sIdx = extent[4]; sIdx <= extent[5]; sIdx++)
-  {
-    for (int cIdx = 0; cIdx < nComp; cIdx++)
-    {
-      int fileIdx = this->FileIndexArray->GetComponent(sIdx, cIdx);
-      int frameIdx = this->FrameIndexArray->GetComponent(sIdx, cIdx);
-      std::vector<vtkDICOMReaderFileInfo>::iterator iter = files.begin();
-      while (iter != files.end() && iter->FileIndex != fileIdx)
-      {
-        ++iter;
-      }
-      if (iter == files.end())
-      {
-        int n = this->MetaData->Get(fileIdx, DC::NumberOfFrames).AsInt();
-        n = (n > 0 ? n : 1);
-        files.push_back(vtkDICOMReaderFileInfo(fileIdx, n));
-        iter = files.end();
-        --iter;
-      }
-      iter->Frames.push_back(vtkDICOMReaderFrameInfo(frameIdx, sIdx, cIdx));
-    }
-  }
+  vtkDICOMReaderCollectFiles(this->MetaData,
+    this->FileIndexArray, this->FrameIndexArray, extent[4], extent[5],
+    &files);
 
   // get the data object, allocate memory
   vtkImageData *data =
@@ -2073,6 +3599,38 @@ int vtkDICOMReader::RequestData(
   }
   unsigned char *fileBuffer = nullptr;
   int framesInPreviousFile = -1;
+  bool useCache = (this->Cache != nullptr && this->CacheSize > 0);
+
+  // start reading the files before they are needed by the decoder
+  bool decimate = (this->DecimationFactors[0] > 1 ||
+                   this->DecimationFactors[1] > 1);
+  if (this->NumberOfReadAheadThreads > 0 && files.size() > 1 &&
+      !this->InputStream && !decimate)
+  {
+    int numThreads = this->NumberOfReadAheadThreads;
+    this->ReadAhead = new ReadAheadQueue(4*numThreads, 256*1024*1024);
+    int cacheType = 2*this->FileScalarType +
+      (this->AutoYBRToRGB && numComponents == 3 && scalarSize == 1);
+    for (size_t idx = 0; idx < files.size(); idx++)
+    {
+      int fileIdx = files[idx].FileIndex;
+      std::string transferSyntax =
+        this->MetaData->Get(fileIdx, DC::TransferSyntaxUID).AsString();
+      vtkTypeInt64 offsetAndSize[2];
+      this->FileOffsetArray->GetTupleValue(fileIdx, offsetAndSize);
+      this->ComputeInternalFileName(fileIdx);
+      if (vtkDICOMReaderIsNative(transferSyntax) &&
+          offsetAndSize[1] > offsetAndSize[0] &&
+          !(useCache && this->Cache->Contains(FrameCache::Key(
+            this->InternalFileName, files[idx].Frames[0].FrameIndex,
+            cacheType))))
+      {
+        this->ReadAhead->Add(this->InternalFileName, fileIdx,
+          offsetAndSize[0], offsetAndSize[1] - offsetAndSize[0]);
+      }
+    }
+    this->ReadAhead->Start(numThreads);
+  }
 
   // loop through all files in the update extent
   for (size_t idx = 0; idx < files.size(); idx++)
@@ -2132,18 +3690,56 @@ int vtkDICOMReader::RequestData(
                            numComponents == 3 &&
                            scalarSize == 1);
 
-    // this is the method that actually reads the file
-    this->ReadOneFile(this->InternalFileName, fileIdx,
-                      bufferPtr, framesInFile*fileFrameSize);
+    // check the cache for the decoded frames
+    bool cached = false;
+    int cacheType = 2*this->FileScalarType + this->NeedsYBRToRGB;
+    if (useCache)
+    {
+      cached = true;
+      for (int sIdx = 0; sIdx < numFrames && cached; sIdx++)
+      {
+        int frameIdx = frames[sIdx].FrameIndex;
+        FrameCache::Key key(this->InternalFileName, frameIdx, cacheType);
+        cached = this->Cache->Fetch(key, bufferPtr + frameIdx*fileFrameSize,
+                                    fileFrameSize, &this->NeedsYBRToRGB);
+      }
+      this->Cache->Count((cached ? numFrames : 0), (cached ? 0 : numFrames), 0);
+    }
 
-    // clear or sign-extend any unused bits
-    int bitsStored = this->MetaData->Get(fileIdx, DC::BitsStored).AsInt();
-    if (bitsStored > 0 && bitsStored < fileScalarSize*8)
+    if (!cached)
     {
-      int pixelRepresentation =
-        this->MetaData->Get(fileIdx, DC::PixelRepresentation).AsInt();
-      vtkDICOMReader::MaskBits(bufferPtr, framesInFile*fileFrameSize,
-          fileScalarSize, bitsStored, pixelRepresentation);
+      // this is the method that actually reads the file
+      DecodeState state(this->NeedsYBRToRGB, false);
+      bool success = this->ReadOneFile(this->InternalFileName, fileIdx,
+                                       bufferPtr, framesInFile*fileFrameSize,
+                                       &state);
+      this->NeedsYBRToRGB = state.NeedsYBRToRGB;
+
+      if (success && this->TimingActive)
+      {
+        this->Statistics->AddFramesDecoded(framesInFile);
+      }
+
+      // clear or sign-extend any unused bits
+      int bitsStored = this->MetaData->Get(fileIdx, DC::BitsStored).AsInt();
+      if (bitsStored > 0 && bitsStored < fileScalarSize*8)
+      {
+        double startTime = this->StartStage();
+        int pixelRepresentation =
+          this->MetaData->Get(fileIdx, DC::PixelRepresentation).AsInt();
+        vtkDICOMReader::MaskBits(bufferPtr, framesInFile*fileFrameSize,
+            fileScalarSize, bitsStored, pixelRepresentation);
+        this->EndStage(vtkDICOMReaderStatistics::MaskBits, startTime);
+      }
+
+      // save the decoded frames in the cache
+      for (int sIdx = 0; sIdx < numFrames && useCache && success; sIdx++)
+      {
+        int frameIdx = frames[sIdx].FrameIndex;
+        FrameCache::Key key(this->InternalFileName, frameIdx, cacheType);
+        this->Cache->Store(key, bufferPtr + frameIdx*fileFrameSize,
+                           fileFrameSize, this->NeedsYBRToRGB);
+      }
     }
 
     // iterate through all frames contained in the file
@@ -2166,6 +3762,7 @@ int vtkDICOMReader::RequestData(
         // flip the data if necessary
         if (flipImage)
         {
+          double startTime = this->StartStage();
           int numRows = extent[3] - extent[2] + 1;
           int halfRows = numRows/2;
           for (int yIdx = 0; yIdx < halfRows; yIdx++)
@@ -2176,9 +3773,11 @@ int vtkDICOMReader::RequestData(
             memcpy(row1, row2, fileRowSize);
             memcpy(row2, rowBuffer, fileRowSize);
           }
+          this->EndStage(vtkDICOMReaderStatistics::Flip, startTime);
         }
 
         // convert planes into vector components
+        double startTime = this->StartStage();
         if (this->NeedsRescale)
         {
           this->RescaleBuffer(
@@ -2203,6 +3802,7 @@ int vtkDICOMReader::RequestData(
         {
           memcpy(slicePtr, planePtr, filePlaneSize);
         }
+        this->EndStage(vtkDICOMReaderStatistics::Rescale, startTime);
 
         planePtr += filePlaneSize;
       }
@@ -2210,7 +3810,9 @@ int vtkDICOMReader::RequestData(
       // convert to RGB if data was read from file as YUV
       if (this->NeedsYBRToRGB)
       {
+        double startTime = this->StartStage();
         this->YBRToRGB(fileIdx, frameIdx, slicePtr, sliceSize);
+        this->EndStage(vtkDICOMReaderStatistics::YBRToRGB, startTime);
       }
     }
   }
@@ -2218,6 +3820,27 @@ int vtkDICOMReader::RequestData(
   delete [] rowBuffer;
   delete [] fileBuffer;
 
+  // stop the read-ahead threads
+  delete this->ReadAhead;
+  this->ReadAhead = nullptr;
+
+  // the statistics are complete, the prefetch thread is not included
+  this->TimingActive = false;
+  this->StatisticsStale = true;
+  if (this->CollectStatistics)
+  {
+    this->InvokeEvent(vtkDICOMReader::StatisticsEvent, this->Statistics);
+  }
+
+  // decode the next few slices while the application is busy
+  // (a stream cannot be shared with the prefetch thread)
+  if (useCache && this->PrefetchCount > 0 && !this->AbortExecute &&
+      !this->InputStream)
+  {
+    this->StartPrefetch(extent, fileFrameSize,
+      (this->AutoYBRToRGB && numComponents == 3 && scalarSize == 1));
+  }
+
   this->UpdateProgress(1.0);
   this->SetProgressText(nullptr);
   this->InvokeEvent(vtkCommand::EndEvent);
@@ -2383,6 +4006,60 @@ bool vtkDICOMReader::ReadOverlays(vtkImageData *data)
   return success;
 }
 
+//----------------------------------------------------------------------------
+bool vtkDICOMReader::ReadDecimatedOverlays(vtkImageData *data)
+{
+  int extent[6];
+  data->GetExtent(extent);
+  int fx = this->DecimationFactors[0];
+  int fy = this->DecimationFactors[1];
+
+  // read the overlays at full resolution
+  int fileIdx = this->FileIndexArray->GetComponent(0, 0);
+  int columns = this->MetaData->Get(fileIdx, DC::Columns).AsInt();
+  int rows = this->MetaData->Get(fileIdx, DC::Rows).AsInt();
+  int fullExtent[6] = { 0, columns - 1, 0, rows - 1, extent[4], extent[5] };
+  vtkSmartPointer<vtkImageData> fullData =
+    vtkSmartPointer<vtkImageData>::New();
+  fullData->SetExtent(fullExtent);
+  fullData->AllocateScalars(
+    data->GetScalarType(), data->GetNumberOfScalarComponents());
+  bool success = this->ReadOverlays(fullData);
+
+  // keep the first pixel of each block (the overlays are bitfields,
+  // so they cannot be averaged), and match the row order of the image
+  int outRows = (rows + fy - 1)/fy;
+  vtkIdType pixelSize =
+    data->GetScalarSize()*data->GetNumberOfScalarComponents();
+  vtkIdType rowSize = pixelSize*columns;
+  const unsigned char *inPtr =
+    static_cast<const unsigned char *>(fullData->GetScalarPointer());
+  unsigned char *outPtr = static_cast<unsigned char *>(data->GetScalarPointer());
+  for (int z = extent[4]; z <= extent[5]; z++)
+  {
+    const unsigned char *slicePtr =
+      inPtr + (z - extent[4])*rowSize*rows;
+    for (int y = extent[2]; y <= extent[3]; y++)
+    {
+      int r = y*fy;
+      if (this->MemoryRowOrder == vtkDICOMReader::BottomUp)
+      {
+        r = rows - 1 - (outRows - 1 - y)*fy;
+      }
+      for (int x = extent[0]; x <= extent[1]; x++)
+      {
+        const unsigned char *ptr = slicePtr + r*rowSize + x*fx*pixelSize;
+        for (vtkIdType k = 0; k < pixelSize; k++)
+        {
+          *outPtr++ = ptr[k];
+        }
+      }
+    }
+  }
+
+  return success;
+}
+
 //----------------------------------------------------------------------------
 void vtkDICOMReader::RelayError(vtkObject *o, unsigned long e, void *data)
 {
@@ -23,6 +23,7 @@
 #define vtkDICOMReader_h
 
 #include "vtkImageReader2.h"
+#include "vtkCommand.h" // For UserEvent
 #include "vtkDICOMModule.h" // For export macro
 #include "vtkDICOMConfig.h" // For configuration details
 #include "vtkDICOMCharacterSet.h" // For character sets
@@ -43,7 +44,9 @@ VTK_ABI_NAMESPACE_END
 #endif
 
 class vtkDICOMMetaData;
+class vtkDICOMReaderStatistics;
 class vtkDICOMParser;
+class vtkDICOMStream;
 class vtkDICOMSliceSorter;
 
 // For compatibility with VTK 7.0 and earlier
@@ -77,6 +80,19 @@ public:
   int CanReadFile(const char* filename) VTK_DICOM_OVERRIDE;
   //@}
 
+  //@{
+  //! Read from a stream, instead of from a file.
+  /*!
+   *  If a stream is set, then a single DICOM file will be read from the
+   *  stream, and FileName and FileNames will be ignored.  The stream is
+   *  not deleted by the reader.  Only data that can be decoded without
+   *  the help of an external library (i.e. uncompressed or RLE) can be
+   *  read from a stream.
+   */
+  void SetInputStream(vtkDICOMStream *stream);
+  vtkDICOMStream *GetInputStream() { return this->InputStream; }
+  //@}
+
   //@{
   //! Set the Stack ID of the stack to load, for named stacks.
   /*!
@@ -315,6 +331,150 @@ public:
   vtkGetMacro(OutputScalarType, int);
   //@}
 
+  //@{
+  //! Set the number of threads to use when reading the headers.
+  /*!
+   *  The default value is 1, which means that the headers of the files
+   *  will be read one at a time.  For larger values, the files will be
+   *  divided among the threads and the results will be merged into the
+   *  meta data in file order, so the meta data will be the same as if
+   *  the files had been read sequentially.  If an error occurs, the error
+   *  for the first bad file (in file order) will be reported.  A value of
+   *  zero means that VTK's default number of threads will be used.
+   */
+  vtkSetMacro(NumberOfParserThreads, int);
+  vtkGetMacro(NumberOfParserThreads, int);
+  //@}
+
+  //@{
+  //! Set the number of threads that read pixel data ahead of the decoder.
+  /*!
+   *  The default value is 0, which means that each file is read just before
+   *  it is decoded.  For larger values, the pixel data for the upcoming
+   *  files is read into memory by this many threads at once, so that many
+   *  reads are in flight while the files are decoded in order.  This helps
+   *  most on network filesystems and fast SSDs, where the time to read each
+   *  file is dominated by latency rather than bandwidth.  Only uncompressed
+   *  and RLE files are read ahead, and the amount of memory used for data
+   *  that has been read but not yet decoded is limited.
+   */
+  vtkSetMacro(NumberOfReadAheadThreads, int);
+  vtkGetMacro(NumberOfReadAheadThreads, int);
+  //@}
+
+  //@{
+  //! Set the maximum size of the cache of decoded frames, in bytes.
+  /*!
+   *  When this is set to a positive value, each frame that is read from
+   *  a file is kept in memory after it has been decoded, so that if the
+   *  reader is updated again with a different UPDATE_EXTENT (for example,
+   *  while scrolling through the slices in a viewer), then the frames
+   *  do not have to be read and decoded again.  When the cache is full,
+   *  the least recently used frames are discarded.  The default value
+   *  is zero, which means that no cache is used.
+   */
+  void SetCacheSize(vtkIdType size);
+  vtkIdType GetCacheSize() { return this->CacheSize; }
+
+  //! Set the number of slices to prefetch after each update.
+  /*!
+   *  If the cache is enabled, then after each update the reader will use
+   *  a background thread to decode this many slices beyond the update
+   *  extent, in the direction that the update extent most recently moved.
+   *  The background thread will stop as soon as the reader receives a
+   *  new pipeline request.  Files that the thread could not decode are
+   *  reported as warnings when it stops.  The default value is zero.
+   */
+  void SetPrefetchCount(int n) { this->PrefetchCount = (n > 0 ? n : 0); }
+  int GetPrefetchCount() { return this->PrefetchCount; }
+
+  //! Discard all frames that are held in the cache.
+  /*!
+   *  The cache does not check whether files have been modified, so this
+   *  should be called if files are overwritten after they are read.
+   */
+  void ClearCache();
+
+  //! Get the number of frames that were found in the cache.
+  vtkTypeInt64 GetCacheHits();
+
+  //! Get the number of frames that had to be read from disk.
+  vtkTypeInt64 GetCacheMisses();
+
+  //! Get the number of frames that were read by the prefetch thread.
+  vtkTypeInt64 GetCachePrefetches();
+
+  //! Get the number of bytes that are currently held in the cache.
+  vtkIdType GetCacheMemoryUsed();
+
+  //! Reset the hit, miss, and prefetch counts to zero.
+  void ResetCacheStatistics();
+  //@}
+
+  //! Enumeration for decimation modes.
+  enum DecimationModeEnum { Subsample, BlockAverage };
+
+  //@{
+  //! Read a reduced-resolution preview of the image.
+  /*!
+   *  If any of these factors is greater than one, then the output will
+   *  contain only every Nth column, row, and slice of the image, which is
+   *  useful for generating thumbnails.  For uncompressed files, only the
+   *  needed rows are read from disk, and files (or frames) for discarded
+   *  slices are never read.  The spacing is multiplied by the factors,
+   *  so that the output covers the same region in patient coordinates.
+   *  The default factors are 1, 1, 1 (i.e. full resolution).
+   */
+  void SetDecimationFactors(int fx, int fy, int fz);
+  void SetDecimationFactors(const int f[3]) {
+    this->SetDecimationFactors(f[0], f[1], f[2]); }
+  int *GetDecimationFactors() { return this->DecimationFactors; }
+  void GetDecimationFactors(int f[3]) {
+    f[0] = this->DecimationFactors[0];
+    f[1] = this->DecimationFactors[1];
+    f[2] = this->DecimationFactors[2]; }
+  //@}
+
+  //@{
+  //! Set whether to subsample or to average when decimating.
+  /*!
+   *  In Subsample mode (the default), the first pixel of each block of
+   *  pixels is kept.  In BlockAverage mode, the pixels within each block
+   *  of rows and columns are averaged, which gives a smoother preview but
+   *  requires every row to be read.  Slices are always subsampled.
+   */
+  void SetDecimationMode(int mode);
+  void SetDecimationModeToSubsample() {
+    this->SetDecimationMode(Subsample); }
+  void SetDecimationModeToBlockAverage() {
+    this->SetDecimationMode(BlockAverage); }
+  int GetDecimationMode() { return this->DecimationMode; }
+  const char *GetDecimationModeAsString();
+  //@}
+
+  //! The event that is invoked after an update if statistics are collected.
+  enum { StatisticsEvent = vtkCommand::UserEvent + 1 };
+
+  //@{
+  //! Collect timing statistics and counters while reading.
+  /*!
+   *  If this is on, the reader will record the time spent in each stage
+   *  of reading (parsing, opening, reading, decompressing, and the pixel
+   *  conversions), as well as the number of files opened, bytes read,
+   *  and frames decoded.  The statistics are reset at the beginning of
+   *  each update, and after each update the StatisticsEvent is invoked
+   *  with the vtkDICOMReaderStatistics object as call data.  This is off
+   *  by default.  Changing it does not cause the reader to re-execute.
+   */
+  void SetCollectStatistics(int val) { this->CollectStatistics = val; }
+  void CollectStatisticsOn() { this->SetCollectStatistics(1); }
+  void CollectStatisticsOff() { this->SetCollectStatistics(0); }
+  int GetCollectStatistics() { return this->CollectStatistics; }
+
+  //! Get the statistics that were collected during the last update.
+  vtkDICOMReaderStatistics *GetStatistics() { return this->Statistics; }
+  //@}
+
 #ifndef __WRAP__
   //@{
   using Superclass::Update;
@@ -348,6 +508,9 @@ protected:
   //! Read the overlays into an allocated vtkImageData object.
   virtual bool ReadOverlays(vtkImageData *data);
 
+  //! Read the overlays and decimate them to match the image.
+  bool ReadDecimatedOverlays(vtkImageData *data);
+
   //! Unpack overlay bits to build the overlay image.
   void UnpackOverlay(
     const void *filePtr, vtkIdType bitskip, vtkIdType count,
@@ -355,10 +518,20 @@ protected:
   //@}
 
   //@{
+  //! The state for decoding one file.
+  /*!
+   *  This holds the values that are set while a file is decoded, so that
+   *  the prefetch thread can decode files without modifying the reader.
+   */
+  struct DecodeState;
+
+  //! Report a decoding error, or save it in the state if it is deferred.
+  void DecodeError(DecodeState *state, unsigned long code, const char *text);
+
   //! Read one file.  Specify the offset to the PixelData.
   virtual bool ReadOneFile(
     const char *filename, int idx,
-    unsigned char *buffer, vtkIdType bufferSize);
+    unsigned char *buffer, vtkIdType bufferSize, DecodeState *state);
 
   //! Clear or sign-extend any bits beyond BitsStored.
   void MaskBits(void *buffer, vtkIdType bufferSize, int scalarSize,
@@ -375,14 +548,33 @@ protected:
   //! Read an DICOM file directly.
   virtual bool ReadFileNative(
     const char *filename, int idx,
-    unsigned char *buffer, vtkIdType bufferSize);
+    unsigned char *buffer, vtkIdType bufferSize, DecodeState *state);
 
   //! Read a DICOM file via DCMTK or GDCM.
   virtual bool ReadFileDelegated(
     const char *filename, int idx,
-    unsigned char *buffer, vtkIdType bufferSize);
+    unsigned char *buffer, vtkIdType bufferSize, DecodeState *state);
+
+  //! Read only the rows needed for decimation from an uncompressed file.
+  virtual bool ReadFileNativeDecimated(
+    const char *filename, int idx,
+    unsigned char *buffer, vtkIdType bufferSize, DecodeState *state);
+
+  //! Start timing a stage (returns zero if statistics are off).
+  double StartStage();
+
+  //! Add the time since StartStage() to the statistics for a stage.
+  void EndStage(int stage, double startTime);
+
+  //! Decimate the rows and columns of a block of file-native data.
+  void DecimateBuffer(
+    const unsigned char *source, unsigned char *buffer,
+    int columns, int rows, int numComponents);
   //@}
 
+  //! Compute the name of a file, or provide a name for the stream.
+  void ComputeInternalFileName(int slice) VTK_DICOM_OVERRIDE;
+
   //@{
   //! Check if rescaling will change scalar type.
   virtual int ComputeRescaledScalarType(
@@ -404,6 +596,23 @@ protected:
   void RelayError(vtkObject *o, unsigned long e, void *data);
   //@}
 
+  //@{
+  //! Read the headers of all the files, using multiple threads.
+  /*!
+   *  This is called by RequestInformation() if NumberOfParserThreads
+   *  is not one.  It fills in the MetaData and the FileOffsetArray.
+   */
+  virtual void ParseFilesThreaded(int numFiles, int numThreads);
+  //@}
+
+  //@{
+  //! Start a thread that decodes the slices following the given extent.
+  void StartPrefetch(const int extent[6], vtkIdType frameSize, int ybr);
+
+  //! Stop the prefetch thread and wait for it to finish.
+  void FinishPrefetch();
+  //@}
+
   //@{
   //! Verify that the files can be composed into a volume.
   /*!
@@ -450,6 +659,29 @@ protected:
   //! The parser that is used to read the file.
   vtkDICOMParser *Parser;
 
+  //! The stream to read from, instead of a file.
+  vtkDICOMStream *InputStream;
+
+  //! The number of threads to use for reading the headers.
+  int NumberOfParserThreads;
+
+  //! The number of threads to use for reading the pixel data.
+  int NumberOfReadAheadThreads;
+
+  //! The maximum size of the frame cache, and the prefetch count.
+  vtkIdType CacheSize;
+  int PrefetchCount;
+
+  //! The decimation factors and mode for preview reads.
+  int DecimationFactors[3];
+  int DecimationMode;
+
+  //! Statistics for the current update.
+  vtkDICOMReaderStatistics *Statistics;
+  int CollectStatistics;
+  bool TimingActive;
+  bool StatisticsStale;
+
   //! The sorter that orders the slices within the volume.
   vtkDICOMSliceSorter *Sorter;
 
@@ -508,6 +740,19 @@ private:
   vtkDICOMReader(const vtkDICOMReader&) = delete;
   void operator=(const vtkDICOMReader&) = delete;
 #endif
+
+  class FrameCache;
+
+  //! The cache of decoded frames, and the state of the prefetch thread.
+  FrameCache *Cache;
+
+  //! The method that is run by the prefetch thread.
+  static void PrefetchWorker(vtkDICOMReader *self);
+
+  class ReadAheadQueue;
+
+  //! The files being read ahead of the decoder, during RequestData.
+  ReadAheadQueue *ReadAhead;
 };
 
 #endif // vtkDICOMReader_h
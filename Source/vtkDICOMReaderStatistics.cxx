@@ -0,0 +1,88 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkDICOMReaderStatistics.h"
+
+#include "vtkObjectFactory.h"
+
+#include <chrono>
+
+vtkStandardNewMacro(vtkDICOMReaderStatistics);
+
+//----------------------------------------------------------------------------
+vtkDICOMReaderStatistics::vtkDICOMReaderStatistics()
+{
+  this->Initialize();
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMReaderStatistics::~vtkDICOMReaderStatistics()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReaderStatistics::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  for (int i = 0; i < NumberOfStages; i++)
+  {
+    os << indent << vtkDICOMReaderStatistics::GetStageName(i) << "Time: "
+       << this->StageTime[i] << "\n";
+  }
+  os << indent << "TotalTime: " << this->GetTotalTime() << "\n";
+  os << indent << "FilesOpened: " << this->FilesOpened << "\n";
+  os << indent << "BytesRead: " << this->BytesRead << "\n";
+  os << indent << "FramesDecoded: " << this->FramesDecoded << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMReaderStatistics::Initialize()
+{
+  for (int i = 0; i < NumberOfStages; i++)
+  {
+    this->StageTime[i] = 0.0;
+  }
+  this->FilesOpened = 0;
+  this->BytesRead = 0;
+  this->FramesDecoded = 0;
+}
+
+//----------------------------------------------------------------------------
+double vtkDICOMReaderStatistics::GetTotalTime()
+{
+  double t = 0.0;
+  for (int i = 0; i < NumberOfStages; i++)
+  {
+    t += this->StageTime[i];
+  }
+  return t;
+}
+
+//----------------------------------------------------------------------------
+const char *vtkDICOMReaderStatistics::GetStageName(int stage)
+{
+  static const char *names[NumberOfStages] = {
+    "Parse", "Open", "Read", "Decode", "MaskBits", "Flip", "Rescale",
+    "YBRToRGB"
+  };
+
+  return (stage >= 0 && stage < NumberOfStages ? names[stage] : "");
+}
+
+//----------------------------------------------------------------------------
+double vtkDICOMReaderStatistics::GetClock()
+{
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,113 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef vtkDICOMReaderStatistics_h
+#define vtkDICOMReaderStatistics_h
+
+#include "vtkObject.h"
+#include "vtkDICOMModule.h" // For export macro
+#include "vtkDICOMConfig.h" // For configuration details
+
+//! Timing and counters for the stages of reading DICOM files.
+/*!
+ *  This class holds the wall-clock time that vtkDICOMReader spent in
+ *  each stage of reading, as well as the number of files opened, the
+ *  number of bytes read, and the number of frames decoded.  The reader
+ *  fills it in during each update if CollectStatistics is on.
+ */
+class VTKDICOM_EXPORT vtkDICOMReaderStatistics : public vtkObject
+{
+public:
+  //! Static method for construction.
+  //@{
+  static vtkDICOMReaderStatistics *New();
+  vtkTypeMacro(vtkDICOMReaderStatistics, vtkObject);
+  //@}
+
+  //! Print information about this object.
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_DICOM_OVERRIDE;
+
+  //! The stages for which the time is recorded.
+  enum StageEnum
+  {
+    Parse,     // reading the headers in RequestInformation
+    Open,      // opening the files to read the pixel data
+    Read,      // reading (and RLE decoding) the pixel data
+    Decode,    // decompression via DCMTK or GDCM
+    MaskBits,  // clearing the bits beyond BitsStored
+    Flip,      // flipping the rows for BottomUp order
+    Rescale,   // rescaling or reordering the components
+    YBRToRGB,  // color space conversion
+    NumberOfStages
+  };
+
+  //@{
+  //! Get the time in seconds that was spent in the given stage.
+  double GetStageTime(int stage) {
+    return (stage >= 0 && stage < NumberOfStages ?
+            this->StageTime[stage] : 0.0); }
+
+  //! Get the sum of the times for all stages.
+  double GetTotalTime();
+
+  //! Get the name of a stage.
+  static const char *GetStageName(int stage);
+
+  //! Get the number of files that were opened.
+  int GetFilesOpened() { return this->FilesOpened; }
+
+  //! Get the number of bytes that were read from the files.
+  vtkTypeInt64 GetBytesRead() { return this->BytesRead; }
+
+  //! Get the number of frames that were decoded.
+  int GetFramesDecoded() { return this->FramesDecoded; }
+  //@}
+
+  //@{
+  //! Reset all of the times and counters to zero.
+  void Initialize();
+
+  //! Add time (in seconds) to a stage.
+  void AddStageTime(int stage, double t) {
+    if (stage >= 0 && stage < NumberOfStages) {
+      this->StageTime[stage] += t; } }
+
+  //! Increment the counters.
+  void AddFilesOpened(int n) { this->FilesOpened += n; }
+  void AddBytesRead(vtkTypeInt64 n) { this->BytesRead += n; }
+  void AddFramesDecoded(int n) { this->FramesDecoded += n; }
+
+  //! Get a monotonic wall-clock time in seconds, for timing stages.
+  static double GetClock();
+  //@}
+
+protected:
+  vtkDICOMReaderStatistics();
+  ~vtkDICOMReaderStatistics() VTK_DICOM_OVERRIDE;
+
+  double StageTime[NumberOfStages];
+  int FilesOpened;
+  vtkTypeInt64 BytesRead;
+  int FramesDecoded;
+
+private:
+#ifdef VTK_DICOM_DELETE
+  vtkDICOMReaderStatistics(const vtkDICOMReaderStatistics&) VTK_DICOM_DELETE;
+  void operator=(const vtkDICOMReaderStatistics&) VTK_DICOM_DELETE;
+#else
+  vtkDICOMReaderStatistics(const vtkDICOMReaderStatistics&) = delete;
+  void operator=(const vtkDICOMReaderStatistics&) = delete;
+#endif
+};
+
+#endif // vtkDICOMReaderStatistics_h
@@ -0,0 +1,165 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "vtkDICOMStream.h"
+
+#include <string.h>
+
+//----------------------------------------------------------------------------
+vtkDICOMStream::~vtkDICOMStream()
+{
+}
+
+//----------------------------------------------------------------------------
+size_t vtkDICOMStream::Read(unsigned char *, size_t)
+{
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+size_t vtkDICOMStream::Write(const unsigned char *, size_t)
+{
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkDICOMStream::SetPosition(Size)
+{
+  return false;
+}
+
+//----------------------------------------------------------------------------
+bool vtkDICOMStream::Truncate()
+{
+  return false;
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMStream::Size vtkDICOMStream::GetSize()
+{
+  return ~0ull;
+}
+
+//----------------------------------------------------------------------------
+bool vtkDICOMStream::GetError()
+{
+  return false;
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMMemoryStream::vtkDICOMMemoryStream()
+  : ReadOnlyData(nullptr), ReadOnlySize(0), Position(0)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMMemoryStream::vtkDICOMMemoryStream(const void *data, size_t size)
+  : ReadOnlyData(static_cast<const unsigned char *>(data)),
+    ReadOnlySize(size), Position(0)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMMemoryStream::~vtkDICOMMemoryStream()
+{
+}
+
+//----------------------------------------------------------------------------
+const unsigned char *vtkDICOMMemoryStream::GetData() const
+{
+  if (this->ReadOnlyData)
+  {
+    return this->ReadOnlyData;
+  }
+  return (this->Buffer.empty() ? nullptr : &this->Buffer[0]);
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMMemoryStream::Clear()
+{
+  std::vector<unsigned char>().swap(this->Buffer);
+  this->Position = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMStream::Size vtkDICOMMemoryStream::GetSize()
+{
+  return (this->ReadOnlyData ? this->ReadOnlySize : this->Buffer.size());
+}
+
+//----------------------------------------------------------------------------
+size_t vtkDICOMMemoryStream::Read(unsigned char *data, size_t size)
+{
+  size_t l = static_cast<size_t>(this->GetSize());
+  size_t n = (this->Position < l ? l - this->Position : 0);
+  n = (size < n ? size : n);
+  if (n > 0)
+  {
+    memcpy(data, this->GetData() + this->Position, n);
+    this->Position += n;
+  }
+  return n;
+}
+
+//----------------------------------------------------------------------------
+size_t vtkDICOMMemoryStream::Write(const unsigned char *data, size_t size)
+{
+  if (this->ReadOnlyData)
+  {
+    return 0;
+  }
+
+  size_t end = this->Position + size;
+  if (end > this->Buffer.size())
+  {
+    if (end > this->Buffer.capacity())
+    {
+      // grow geometrically, since writes are usually small
+      size_t capacity = 2*this->Buffer.capacity();
+      this->Buffer.reserve(capacity > end ? capacity : end);
+    }
+    this->Buffer.resize(end);
+  }
+  if (size > 0)
+  {
+    memcpy(&this->Buffer[this->Position], data, size);
+  }
+  this->Position = end;
+  return size;
+}
+
+//----------------------------------------------------------------------------
+bool vtkDICOMMemoryStream::SetPosition(Size offset)
+{
+  if (offset > static_cast<Size>(static_cast<size_t>(-1)))
+  {
+    return false;
+  }
+  this->Position = static_cast<size_t>(offset);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkDICOMMemoryStream::Truncate()
+{
+  if (this->ReadOnlyData)
+  {
+    return false;
+  }
+  if (this->Position < this->Buffer.size())
+  {
+    this->Buffer.resize(this->Position);
+  }
+  return true;
+}
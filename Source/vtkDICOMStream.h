@@ -0,0 +1,140 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef vtkDICOMStream_h
+#define vtkDICOMStream_h
+
+#include "vtkSystemIncludes.h"
+#include "vtkDICOMModule.h" // For export macro
+#include "vtkDICOMConfig.h" // For configuration details
+
+#include <vector> // For internal buffer
+
+//! A source or destination for data that is not a file.
+/*!
+ *  A stream can be given to vtkDICOMParser, vtkDICOMReader, or
+ *  vtkDICOMCompiler to use instead of a file.  To read from or write to
+ *  something other than memory (for example a network connection, or a
+ *  container format), create a subclass and override the methods.  A
+ *  stream used for reading must support SetPosition(), since the reader
+ *  reads the meta data and the pixel data separately.  The stream is not
+ *  deleted by the objects that use it.
+ */
+class VTKDICOM_EXPORT vtkDICOMStream
+{
+public:
+  //! Typedef for a stream size.
+  typedef unsigned long long Size;
+
+  //@{
+  //! Constructor.
+  vtkDICOMStream() {}
+
+  //! Destructor.
+  virtual ~vtkDICOMStream();
+  //@}
+
+  //@{
+  //! Read data from the stream.
+  /*!
+   *  The number of bytes read will be returned.  A return value of
+   *  zero indicates the end of the data, or an error if GetError()
+   *  returns true.  The default implementation always returns zero.
+   */
+  virtual size_t Read(unsigned char *data, size_t size);
+
+  //! Write data to the stream.
+  /*!
+   *  The number of bytes written will be returned.  If it is less than
+   *  the size requested, an error occurred.  The default implementation
+   *  always returns zero.
+   */
+  virtual size_t Write(const unsigned char *data, size_t size);
+
+  //! Go to a specific location in the stream.
+  /*!
+   *  The return value is false if an error occurred.
+   */
+  virtual bool SetPosition(Size offset);
+
+  //! Discard any data after the current position.
+  /*!
+   *  This is called before the stream is written, after the position
+   *  has been set to zero.  The return value is false on error.
+   */
+  virtual bool Truncate();
+
+  //! Get the size of the data, returns ULLONG_MAX if not known.
+  virtual Size GetSize();
+
+  //! Return true if an error occurred.
+  virtual bool GetError();
+  //@}
+
+private:
+#ifdef VTK_DICOM_DELETE
+  vtkDICOMStream(const vtkDICOMStream&) VTK_DICOM_DELETE;
+  void operator=(const vtkDICOMStream&) VTK_DICOM_DELETE;
+#else
+  vtkDICOMStream(const vtkDICOMStream&) = delete;
+  void operator=(const vtkDICOMStream&) = delete;
+#endif
+};
+
+//! A stream that reads from or writes to memory.
+/*!
+ *  If this stream is constructed with a pointer to existing data, then
+ *  it will read from that data without copying it, and the data must
+ *  remain valid for as long as the stream is used.  Otherwise, it will
+ *  store everything that is written to it in a buffer that grows as
+ *  needed, which can be retrieved with GetData() and GetSize().
+ */
+class VTKDICOM_EXPORT vtkDICOMMemoryStream : public vtkDICOMStream
+{
+public:
+  //@{
+  //! Construct a stream for writing to memory.
+  vtkDICOMMemoryStream();
+
+  //! Construct a stream for reading from existing memory.
+  vtkDICOMMemoryStream(const void *data, size_t size);
+
+  //! Destructor.
+  ~vtkDICOMMemoryStream() VTK_DICOM_OVERRIDE;
+  //@}
+
+  //@{
+  //! Get a pointer to the data.
+  const unsigned char *GetData() const;
+
+  //! Discard all data that has been written, and free the memory.
+  void Clear();
+  //@}
+
+  //@{
+  size_t Read(unsigned char *data, size_t size) VTK_DICOM_OVERRIDE;
+  size_t Write(const unsigned char *data, size_t size) VTK_DICOM_OVERRIDE;
+  bool SetPosition(Size offset) VTK_DICOM_OVERRIDE;
+  bool Truncate() VTK_DICOM_OVERRIDE;
+  Size GetSize() VTK_DICOM_OVERRIDE;
+  //@}
+
+private:
+  const unsigned char *ReadOnlyData;
+  size_t ReadOnlySize;
+  std::vector<unsigned char> Buffer;
+  size_t Position;
+};
+
+#endif /* vtkDICOMStream_h */
+// VTK-HeaderTest-Exclude: vtkDICOMStream.h
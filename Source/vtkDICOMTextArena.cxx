@@ -0,0 +1,125 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkDICOMTextArena.h"
+#include "vtkDICOMMetaData.h"
+#include "vtkDICOMItem.h"
+#include "vtkDICOMValue.h"
+
+//----------------------------------------------------------------------------
+void vtkDICOMTextArena::AddMetaData(vtkDICOMMetaData *meta, int idx)
+{
+  vtkDICOMTagPath root;
+  vtkDICOMDataElementIterator iter = meta->Begin();
+  vtkDICOMDataElementIterator iterEnd = meta->End();
+  for (; iter != iterEnd; ++iter)
+  {
+    if (iter->IsPerInstance())
+    {
+      // only use per-instance values if the index is in range
+      if (idx >= 0 && idx < iter->GetNumberOfInstances())
+      {
+        this->AddValue(
+          vtkDICOMTagPath(root, 0, iter->GetTag()), iter->GetValue(idx));
+      }
+    }
+    else
+    {
+      this->AddValue(
+        vtkDICOMTagPath(root, 0, iter->GetTag()), iter->GetValue());
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMTextArena::AddItem(const vtkDICOMItem& item)
+{
+  vtkDICOMTagPath root;
+  vtkDICOMDataElementIterator iter = item.Begin();
+  vtkDICOMDataElementIterator iterEnd = item.End();
+  for (; iter != iterEnd; ++iter)
+  {
+    this->AddValue(
+      vtkDICOMTagPath(root, 0, iter->GetTag()), iter->GetValue());
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMTextArena::AddValue(
+  const vtkDICOMTagPath& path, const vtkDICOMValue& v)
+{
+  vtkDICOMVR vr = v.GetVR();
+
+  if (vr == vtkDICOMVR::SQ)
+  {
+    // add the contents of each item in the sequence
+    const vtkDICOMItem *items = v.GetSequenceData();
+    unsigned int n = static_cast<unsigned int>(v.GetNumberOfValues());
+    for (unsigned int i = 0; i < n && items; i++)
+    {
+      vtkDICOMDataElementIterator iter = items[i].Begin();
+      vtkDICOMDataElementIterator iterEnd = items[i].End();
+      for (; iter != iterEnd; ++iter)
+      {
+        this->AddValue(
+          vtkDICOMTagPath(path, i, iter->GetTag()), iter->GetValue());
+      }
+    }
+    return;
+  }
+
+  const char *cp = v.GetCharData();
+  if (cp == nullptr || !vr.HasTextValue())
+  {
+    return;
+  }
+
+  Entry e;
+  e.Path = path;
+  e.VR = vr;
+  e.Offset = this->Data.length();
+
+  // strip the padding, as is done by vtkDICOMValue::AsUTF8String()
+  vtkDICOMCharacterSet cs = v.GetCharacterSet();
+  size_t l = v.GetVL();
+  while (l > 0 && cp[l-1] == '\0') { l--; }
+  if (vr.HasSingleValue())
+  {
+    while (l > 0 && cp[l-1] == ' ') { l--; }
+    cs.AppendToUTF8(cp, l, &this->Data);
+  }
+  else
+  {
+    // convert each value separately, since each value starts with
+    // the initial state for iso-2022 escape codes
+    const char *ep = cp + l;
+    while (cp != ep && *cp != '\0')
+    {
+      size_t n = cs.NextBackslash(cp, ep);
+      while (n > 0 && *cp == ' ') { cp++; n--; }
+      size_t m = n;
+      while (m > 0 && cp[m-1] == ' ') { m--; }
+      cs.AppendToUTF8(cp, m, &this->Data);
+      cp += n;
+      if (cp != ep && *cp == '\\')
+      {
+        this->Data.push_back('\\');
+        cp++;
+      }
+    }
+  }
+
+  e.Length = this->Data.length() - e.Offset;
+  this->Data.push_back('\0');
+  this->Entries.push_back(e);
+}
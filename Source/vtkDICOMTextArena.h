@@ -0,0 +1,132 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef vtkDICOMTextArena_h
+#define vtkDICOMTextArena_h
+
+#include "vtkDICOMModule.h" // For export macro
+#include "vtkDICOMTagPath.h"
+#include "vtkDICOMVR.h"
+
+#include <string>
+#include <vector>
+
+class vtkDICOMItem;
+class vtkDICOMMetaData;
+class vtkDICOMValue;
+
+//! Convert all of the text in a data set to UTF-8 in a single pass.
+/*!
+ *  This class converts the text attributes of a vtkDICOMMetaData object
+ *  or a vtkDICOMItem to UTF-8, and stores the results one after another
+ *  in a single contiguous buffer.  Each converted attribute becomes an
+ *  entry that is described by its tag path, its VR, and its offset and
+ *  length within the buffer.  Sequences are searched recursively, so
+ *  the tag path of each entry gives its location within the data set.
+ *
+ *  This is much cheaper than calling vtkDICOMValue::AsUTF8String() for
+ *  each attribute, because no temporary strings are created, and because
+ *  the buffer and the entry list can be re-used for many data sets by
+ *  calling Clear() between data sets.  Multi-valued attributes are kept
+ *  as a single entry, with backslashes between the values.  Only the
+ *  attributes with text VRs are stored, and attributes with binary VRs
+ *  (such as US, FD, or OB) are skipped.
+ */
+class VTKDICOM_EXPORT vtkDICOMTextArena
+{
+public:
+  //@{
+  //! Construct an empty arena.
+  vtkDICOMTextArena() {}
+  //@}
+
+  //@{
+  //! Remove all entries, but keep the memory for re-use.
+  void Clear() {
+    this->Entries.clear(); this->Data.clear(); }
+
+  //! Add the text attributes of one instance of the meta data.
+  /*!
+   *  The meta data can hold attributes for several instances (i.e.
+   *  several files), and the instance index selects which of these to
+   *  convert.  Elements that are identical for all instances are added
+   *  regardless of which instance is chosen.
+   */
+  void AddMetaData(vtkDICOMMetaData *meta, int idx=0);
+
+  //! Add the text attributes of a data set item.
+  void AddItem(const vtkDICOMItem& item);
+
+  //! Add a single value, with the given tag path.
+  /*!
+   *  If the value is a sequence, then the attributes within the sequence
+   *  will be added, with tag paths that start with the given path.  If
+   *  the value is not text, it will be ignored.
+   */
+  void AddValue(const vtkDICOMTagPath& path, const vtkDICOMValue& v);
+  //@}
+
+  //@{
+  //! Get the number of entries.
+  size_t GetNumberOfEntries() const {
+    return this->Entries.size(); }
+
+  //! Get the tag path for the entry at index i.
+  const vtkDICOMTagPath& GetPath(size_t i) const {
+    return this->Entries[i].Path; }
+
+  //! Get the VR for the entry at index i.
+  vtkDICOMVR GetVR(size_t i) const {
+    return this->Entries[i].VR; }
+
+  //! Get the offset of the entry's text within the buffer.
+  size_t GetOffset(size_t i) const {
+    return this->Entries[i].Offset; }
+
+  //! Get the length of the entry's text, in bytes.
+  size_t GetLength(size_t i) const {
+    return this->Entries[i].Length; }
+
+  //! Get the text for the entry at index i, as a null-terminated string.
+  const char *GetText(size_t i) const {
+    return this->Data.c_str() + this->Entries[i].Offset; }
+  //@}
+
+  //@{
+  //! Get the buffer that holds the text for all entries.
+  /*!
+   *  Within this buffer, the text of each entry is followed by a null.
+   */
+  const char *GetData() const {
+    return this->Data.c_str(); }
+
+  //! Get the size of the buffer, in bytes.
+  size_t GetDataSize() const {
+    return this->Data.length(); }
+  //@}
+
+private:
+  struct Entry
+  {
+    vtkDICOMTagPath Path;
+    vtkDICOMVR VR;
+    size_t Offset;
+    size_t Length;
+  };
+
+  std::vector<Entry> Entries;
+  std::string Data;
+};
+
+#endif /* vtkDICOMTextArena_h */
+// VTK-HeaderTest-Exclude: vtkDICOMTextArena.h
@@ -0,0 +1,144 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkDICOMTracer.h"
+
+#include "vtkObjectFactory.h"
+
+#include <atomic>
+#include <mutex>
+
+vtkStandardNewMacro(vtkDICOMTracer);
+
+// The global tracer is atomic, so that spans can check it without a lock
+static std::atomic<vtkDICOMTracer *> vtkDICOMTracerGlobal(nullptr);
+
+//----------------------------------------------------------------------------
+// A helper class to release the global tracer when the program exits.
+static unsigned int vtkDICOMTracerInitializerCounter;
+
+// The mutex that guards the global tracer, it is allocated by the
+// initializer so that it outlives every span and the final release.
+static std::mutex *vtkDICOMTracerMutex;
+
+vtkDICOMTracerInitializer::vtkDICOMTracerInitializer()
+{
+  if (vtkDICOMTracerInitializerCounter++ == 0)
+  {
+    vtkDICOMTracerMutex = new std::mutex;
+  }
+}
+
+vtkDICOMTracerInitializer::~vtkDICOMTracerInitializer()
+{
+  if (--vtkDICOMTracerInitializerCounter == 0)
+  {
+    vtkDICOMTracer::SetGlobalTracer(nullptr);
+    delete vtkDICOMTracerMutex;
+    vtkDICOMTracerMutex = nullptr;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMTracer::vtkDICOMTracer()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMTracer::~vtkDICOMTracer()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMTracer::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMTracer::BeginSpan(const char *, const char *)
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMTracer::EndSpan(const char *, const char *, vtkTypeInt64)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMTracer *vtkDICOMTracer::GetGlobalTracer()
+{
+  return vtkDICOMTracerGlobal.load();
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMTracer::SetGlobalTracer(vtkDICOMTracer *tracer)
+{
+  vtkDICOMTracer *oldTracer = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(*vtkDICOMTracerMutex);
+    if (tracer != vtkDICOMTracerGlobal.load())
+    {
+      if (tracer)
+      {
+        tracer->Register(nullptr);
+      }
+      oldTracer = vtkDICOMTracerGlobal.exchange(tracer);
+    }
+  }
+
+  // spans that are still open hold their own reference
+  if (oldTracer)
+  {
+    oldTracer->UnRegister(nullptr);
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMTraceSpan::vtkDICOMTraceSpan(const char *name, const char *filename)
+  : Tracer(nullptr), Name(name), Bytes(0)
+{
+  // the usual case, no tracer and therefore no lock
+  if (vtkDICOMTracerGlobal.load() == nullptr)
+  {
+    return;
+  }
+
+  {
+    // keep the tracer alive until the span is finished, the lock ensures
+    // that SetGlobalTracer() cannot release it before it is registered
+    std::lock_guard<std::mutex> lock(*vtkDICOMTracerMutex);
+    this->Tracer = vtkDICOMTracerGlobal.load();
+    if (this->Tracer)
+    {
+      this->Tracer->Register(nullptr);
+    }
+  }
+
+  if (this->Tracer)
+  {
+    // copy the filename, the caller might free it before the span ends
+    this->FileName = (filename ? filename : "");
+    this->Tracer->BeginSpan(this->Name, this->FileName.c_str());
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMTraceSpan::~vtkDICOMTraceSpan()
+{
+  if (this->Tracer)
+  {
+    this->Tracer->EndSpan(this->Name, this->FileName.c_str(), this->Bytes);
+    this->Tracer->UnRegister(nullptr);
+  }
+}
@@ -0,0 +1,156 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef vtkDICOMTracer_h
+#define vtkDICOMTracer_h
+
+#include "vtkObject.h"
+#include "vtkDICOMModule.h" // For export macro
+#include "vtkDICOMConfig.h" // For configuration details
+
+#include <string> // For std::string
+
+//! Receive begin/end notifications for file operations.
+/*!
+ *  This class provides hooks for measuring the latency of the file
+ *  operations that are performed by vtk-dicom.  A span begins when
+ *  an operation starts (for example, when vtkDICOMParser starts to read
+ *  a file) and ends when the operation is complete, at which time the
+ *  number of bytes that were read or written is reported.  The spans
+ *  are "Parse" (vtkDICOMParser::ReadFile), "Read" (reading pixel data
+ *  in vtkDICOMReader), "Write" (vtkDICOMCompiler::WriteFile),
+ *  "Transcode" (vtkDICOMTranscoder::Transcode), and "Scan" (scanning a
+ *  directory with vtkDICOMDirectory).
+ *
+ *  To use it, subclass this class and override BeginSpan() and EndSpan(),
+ *  and then call SetGlobalTracer() with an instance of the subclass.
+ *  The methods will be called from multiple threads if vtk-dicom is used
+ *  from multiple threads, so they must be thread-safe.  When no global
+ *  tracer is set (the default), tracing has no measurable cost.  See
+ *  vtkDICOMChromeTracer for a tracer that writes spans to a file.
+ */
+class VTKDICOM_EXPORT vtkDICOMTracer : public vtkObject
+{
+public:
+  //! Static method for construction.
+  //@{
+  static vtkDICOMTracer *New();
+  vtkTypeMacro(vtkDICOMTracer, vtkObject);
+  //@}
+
+  //! Print information about this object.
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_DICOM_OVERRIDE;
+
+  //@{
+  //! This is called when an operation begins.
+  /*!
+   *  The name identifies the operation, and the filename gives the file
+   *  or directory that the operation is acting upon.
+   */
+  virtual void BeginSpan(const char *name, const char *filename);
+
+  //! This is called when an operation ends.
+  /*!
+   *  The number of bytes that were read or written is provided,
+   *  and will be zero if the operation failed.
+   */
+  virtual void EndSpan(
+    const char *name, const char *filename, vtkTypeInt64 bytes);
+  //@}
+
+  //@{
+  //! Set the tracer that will be used by all vtk-dicom classes.
+  /*!
+   *  Set this to nullptr (the default) to disable tracing.
+   */
+  static void SetGlobalTracer(vtkDICOMTracer *tracer);
+
+  //! Get the tracer that will be used by all vtk-dicom classes.
+  static vtkDICOMTracer *GetGlobalTracer();
+  //@}
+
+protected:
+  vtkDICOMTracer();
+  ~vtkDICOMTracer() VTK_DICOM_OVERRIDE;
+
+private:
+  friend class vtkDICOMTracerInitializer;
+
+#ifdef VTK_DICOM_DELETE
+  vtkDICOMTracer(const vtkDICOMTracer&) VTK_DICOM_DELETE;
+  void operator=(const vtkDICOMTracer&) VTK_DICOM_DELETE;
+#else
+  vtkDICOMTracer(const vtkDICOMTracer&) = delete;
+  void operator=(const vtkDICOMTracer&) = delete;
+#endif
+};
+
+//! @cond
+//! Initializer (Schwarz counter).
+/*!
+ *  This ensures that the global tracer is released (and its output is
+ *  finished) when the program exits.
+ */
+class VTKDICOM_EXPORT vtkDICOMTracerInitializer
+{
+public:
+  vtkDICOMTracerInitializer();
+  ~vtkDICOMTracerInitializer();
+private:
+#ifdef VTK_DICOM_DELETE
+  vtkDICOMTracerInitializer(
+    const vtkDICOMTracerInitializer&) VTK_DICOM_DELETE;
+  vtkDICOMTracerInitializer& operator=(
+    const vtkDICOMTracerInitializer&) VTK_DICOM_DELETE;
+#else
+  vtkDICOMTracerInitializer(
+    const vtkDICOMTracerInitializer&) = delete;
+  vtkDICOMTracerInitializer& operator=(
+    const vtkDICOMTracerInitializer&) = delete;
+#endif
+};
+
+static vtkDICOMTracerInitializer vtkDICOMTracerInitializerInstance;
+
+//! A helper that traces a span within the scope of a function.
+/*!
+ *  The span begins when this object is constructed, and ends when it
+ *  goes out of scope.  Nothing is done if there is no global tracer.
+ *  The name must be a string literal, but the filename is copied.
+ */
+class VTKDICOM_EXPORT vtkDICOMTraceSpan
+{
+public:
+  vtkDICOMTraceSpan(const char *name, const char *filename);
+  ~vtkDICOMTraceSpan();
+
+  //! Set the number of bytes to report when the span ends.
+  void SetBytes(vtkTypeInt64 bytes) { this->Bytes = bytes; }
+
+private:
+  vtkDICOMTracer *Tracer;
+  const char *Name;
+  std::string FileName;
+  vtkTypeInt64 Bytes;
+
+#ifdef VTK_DICOM_DELETE
+  vtkDICOMTraceSpan(const vtkDICOMTraceSpan&) VTK_DICOM_DELETE;
+  void operator=(const vtkDICOMTraceSpan&) VTK_DICOM_DELETE;
+#else
+  vtkDICOMTraceSpan(const vtkDICOMTraceSpan&) = delete;
+  void operator=(const vtkDICOMTraceSpan&) = delete;
+#endif
+};
+//! @endcond
+
+#endif // vtkDICOMTracer_h
@@ -0,0 +1,379 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkDICOMTranscoder.h"
+#include "vtkDICOMMetaData.h"
+#include "vtkDICOMDataElement.h"
+#include "vtkDICOMParser.h"
+#include "vtkDICOMCompiler.h"
+#include "vtkDICOMImageCodec.h"
+#include "vtkDICOMUtilities.h"
+#include "vtkDICOMFile.h"
+#include "vtkDICOMTracer.h"
+
+#include "vtkObjectFactory.h"
+#include "vtkErrorCode.h"
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+vtkStandardNewMacro(vtkDICOMTranscoder);
+
+namespace {
+
+// The kinds of transfer syntax that the transcoder understands.
+enum SyntaxType
+{
+  Unsupported,
+  LittleEndian,
+  BigEndian,
+  Deflated,
+  RLE
+};
+
+// Get the kind of transfer syntax.
+SyntaxType GetSyntaxType(const char *uid)
+{
+  std::string tsyntax = (uid ? uid : "");
+  if (tsyntax == "" || // If no meta header, use Implicit LE
+      tsyntax == "1.2.840.10008.1.2" ||  // Implicit LE
+      tsyntax == "1.2.840.10008.1.2.1" || // Explicit LE
+      tsyntax == "1.2.840.10008.1.20")   // Papyrus Implicit LE
+  {
+    return LittleEndian;
+  }
+  else if (tsyntax == "1.2.840.10008.1.2.2" || // Explicit BE
+           tsyntax == "1.2.840.113619.5.2")    // GE LE with BE data
+  {
+    return BigEndian;
+  }
+  else if (tsyntax == "1.2.840.10008.1.2.1.99") // Deflated Explicit LE
+  {
+    return Deflated;
+  }
+  else if (tsyntax == "1.2.840.10008.1.2.5") // RLE
+  {
+    return RLE;
+  }
+
+  return Unsupported;
+}
+
+// Swap the bytes of each sample within a buffer.
+void SwapBytes(unsigned char *data, size_t n, int scalarSize)
+{
+  unsigned char *ep = data + n - (n % scalarSize);
+  for (unsigned char *cp = data; cp != ep; cp += scalarSize)
+  {
+    for (int i = 0, j = scalarSize - 1; i < j; i++, j--)
+    {
+      unsigned char t = cp[i];
+      cp[i] = cp[j];
+      cp[j] = t;
+    }
+  }
+}
+
+// Read the head of an encapsulated item, return its length or -1.
+vtkTypeInt64 ReadItemHead(vtkDICOMFile *file)
+{
+  // encapsulated data is always little endian
+  unsigned char head[8];
+  if (file->Read(head, 8) != 8)
+  {
+    return -1;
+  }
+  unsigned int tag = vtkDICOMUtilities::UnpackUnsignedInt(head);
+  unsigned int vl = vtkDICOMUtilities::UnpackUnsignedInt(head + 4);
+  if (tag != 0xE000FFFEu || vl == 0xFFFFFFFFu)
+  {
+    return -1;
+  }
+  return vl;
+}
+
+} // end anonymous namespace
+
+//----------------------------------------------------------------------------
+// Constructor
+vtkDICOMTranscoder::vtkDICOMTranscoder()
+{
+  this->FileName = nullptr;
+  this->OutputFileName = nullptr;
+  this->TransferSyntaxUID = nullptr;
+  this->MetaData = vtkDICOMMetaData::New();
+  this->BufferSize = 8192;
+  this->ErrorCode = 0;
+
+  // This is our default transfer syntax
+  this->SetTransferSyntaxUID("1.2.840.10008.1.2.1");
+}
+
+//----------------------------------------------------------------------------
+// Destructor
+vtkDICOMTranscoder::~vtkDICOMTranscoder()
+{
+  delete [] this->FileName;
+  delete [] this->OutputFileName;
+  delete [] this->TransferSyntaxUID;
+
+  this->MetaData->Delete();
+}
+
+//----------------------------------------------------------------------------
+bool vtkDICOMTranscoder::CanTranscode(
+  const char *fromSyntax, const char *toSyntax)
+{
+  SyntaxType fromType = GetSyntaxType(fromSyntax);
+  SyntaxType toType = GetSyntaxType(toSyntax);
+
+  // the pixel data offset for deflated files is within the inflated data,
+  // so deflated files can only be written, not read
+  return (fromType != Unsupported && fromType != Deflated &&
+          toType != Unsupported);
+}
+
+//----------------------------------------------------------------------------
+bool vtkDICOMTranscoder::Transcode()
+{
+  this->ErrorCode = vtkErrorCode::NoError;
+
+  if (!this->FileName || !this->OutputFileName)
+  {
+    this->SetErrorCode(vtkErrorCode::NoFileNameError);
+    vtkErrorMacro("Transcode: No file name has been set");
+    return false;
+  }
+
+  vtkDICOMTraceSpan span("Transcode", this->FileName);
+
+  // read the meta data, the parser stops at the PixelData
+  vtkDICOMMetaData *meta = this->MetaData;
+  meta->Initialize();
+  vtkDICOMParser *parser = vtkDICOMParser::New();
+  parser->SetMetaData(meta);
+  parser->SetBufferSize(this->BufferSize);
+  parser->SetFileName(this->FileName);
+  parser->Update();
+  unsigned long errorCode = parser->GetErrorCode();
+  bool pixelDataFound = parser->GetPixelDataFound();
+  vtkTypeInt64 offset = parser->GetFileOffset();
+  unsigned int pixelDataVL = parser->GetPixelDataVL();
+  parser->Delete();
+
+  if (errorCode != vtkErrorCode::NoError)
+  {
+    this->SetErrorCode(errorCode);
+    vtkErrorMacro("Transcode: Can't read the file " << this->FileName);
+    return false;
+  }
+
+  const char *inSyntax = meta->Get(DC::TransferSyntaxUID).GetCharData();
+  if (!vtkDICOMTranscoder::CanTranscode(inSyntax, this->TransferSyntaxUID))
+  {
+    this->SetErrorCode(vtkErrorCode::FileFormatError);
+    vtkErrorMacro("Transcode: Can't convert " << this->FileName
+                  << " from " << (inSyntax ? inSyntax : "(none)")
+                  << " to " << (this->TransferSyntaxUID ?
+                                this->TransferSyntaxUID : "(none)"));
+    return false;
+  }
+  SyntaxType inType = GetSyntaxType(inSyntax);
+
+  // compute the size of each frame
+  vtkDICOMImageCodec::ImageFormat image(meta);
+  int numFrames = meta->Get(DC::NumberOfFrames).AsInt();
+  numFrames = (numFrames > 1 ? numFrames : 1);
+  int scalarSize = image.BitsAllocated/8;
+  size_t frameSize = image.Rows;
+  frameSize *= image.Columns;
+  frameSize *= (image.SamplesPerPixel > 1 ? image.SamplesPerPixel : 1);
+  frameSize *= scalarSize;
+
+  if (pixelDataFound &&
+      (!meta->Has(DC::PixelData) || frameSize == 0 ||
+       image.BitsAllocated % 8 != 0))
+  {
+    // e.g. FloatPixelData, or 12-bit packed data
+    this->SetErrorCode(vtkErrorCode::FileFormatError);
+    vtkErrorMacro("Transcode: Unsupported pixel format in "
+                  << this->FileName);
+    return false;
+  }
+
+  // discard any elements that follow the PixelData
+  std::vector<vtkDICOMTag> trailing;
+  for (vtkDICOMDataElementIterator iter = meta->Begin();
+       iter != meta->End(); ++iter)
+  {
+    if (iter->GetTag() > vtkDICOMTag(DC::PixelData))
+    {
+      trailing.push_back(iter->GetTag());
+    }
+  }
+  for (size_t i = 0; i < trailing.size(); i++)
+  {
+    meta->Erase(trailing[i]);
+  }
+
+  // open the input file at the position of the pixel data
+  vtkDICOMFile infile(this->FileName, vtkDICOMFile::In);
+  if (pixelDataFound &&
+      (infile.GetError() || !infile.SetPosition(offset)))
+  {
+    this->SetErrorCode(vtkErrorCode::CannotOpenFileError);
+    vtkErrorMacro("Transcode: Can't read the file " << this->FileName);
+    return false;
+  }
+
+  // write the meta data, keeping the original UIDs
+  vtkDICOMCompiler *compiler = vtkDICOMCompiler::New();
+  compiler->SetMetaData(meta);
+  compiler->SetBufferSize(this->BufferSize);
+  compiler->SetFileName(this->OutputFileName);
+  compiler->SetTransferSyntaxUID(this->TransferSyntaxUID);
+  const char *instanceUID = meta->Get(DC::SOPInstanceUID).GetCharData();
+  if (instanceUID == nullptr)
+  {
+    instanceUID = meta->Get(DC::MediaStorageSOPInstanceUID).GetCharData();
+  }
+  compiler->SetSOPInstanceUID(instanceUID);
+  compiler->SetSeriesInstanceUID(
+    meta->Get(DC::SeriesInstanceUID).GetCharData());
+  compiler->SetStudyInstanceUID(
+    meta->Get(DC::StudyInstanceUID).GetCharData());
+  compiler->SetSourceApplicationEntityTitle(
+    meta->Get(DC::SourceApplicationEntityTitle).GetCharData());
+  compiler->WriteHeader();
+
+  // this will set endiancheck.s to 1 on little endian architectures
+  union { char c[2]; short s; } endiancheck;
+  endiancheck.c[0] = 1;
+  endiancheck.c[1] = 0;
+  bool swap = (scalarSize > 1 &&
+               ((inType == BigEndian) ^ (endiancheck.s != 1)));
+
+  // convert the pixel data one frame at a time
+  const char *errText = nullptr;
+  if (pixelDataFound && compiler->GetErrorCode() == vtkErrorCode::NoError)
+  {
+    vtkDICOMImageCodec codec(inSyntax ? inSyntax : "");
+    std::vector<unsigned char> frame(frameSize);
+    std::vector<unsigned char> fragment;
+
+    // skip the basic offset table of the encapsulated data
+    if (inType == RLE)
+    {
+      vtkTypeInt64 l = ReadItemHead(&infile);
+      if (l < 0 || pixelDataVL != 0xFFFFFFFFu ||
+          !infile.SetPosition(offset + 8 + l))
+      {
+        errorCode = vtkErrorCode::FileFormatError;
+        errText = "Bad encapsulated PixelData in ";
+      }
+    }
+
+    for (int i = 0; i < numFrames && !errText; i++)
+    {
+      if (inType == RLE)
+      {
+        // each RLE frame is stored in exactly one fragment
+        vtkTypeInt64 l = ReadItemHead(&infile);
+        if (l < 64) // the RLE header is 64 bytes
+        {
+          errorCode = vtkErrorCode::FileFormatError;
+          errText = "Missing fragment in the PixelData of ";
+          break;
+        }
+        fragment.resize(static_cast<size_t>(l));
+        if (infile.Read(fragment.data(), fragment.size()) != fragment.size())
+        {
+          errorCode = vtkErrorCode::PrematureEndOfFileError;
+          errText = "Premature end of file while reading PixelData from ";
+          break;
+        }
+        if (codec.Decode(image, fragment.data(), fragment.size(),
+                         frame.data(), frameSize) !=
+            vtkDICOMImageCodec::NoError)
+        {
+          errorCode = vtkErrorCode::FileFormatError;
+          errText = "Can't decode the RLE PixelData in ";
+          break;
+        }
+      }
+      else
+      {
+        // uncompressed frames must be in native byte order
+        if (static_cast<vtkTypeInt64>((i + 1)*frameSize) > pixelDataVL ||
+            infile.Read(frame.data(), frameSize) != frameSize)
+        {
+          errorCode = vtkErrorCode::PrematureEndOfFileError;
+          errText = "Premature end of file while reading PixelData from ";
+          break;
+        }
+        if (swap)
+        {
+          SwapBytes(frame.data(), frameSize, scalarSize);
+        }
+      }
+
+      compiler->WriteFrame(frame.data(), frameSize);
+      if (compiler->GetErrorCode() != vtkErrorCode::NoError)
+      {
+        break;
+      }
+    }
+  }
+
+  bool success = false;
+  if (errText)
+  {
+    compiler->CloseAndRemove();
+    this->SetErrorCode(errorCode);
+    vtkErrorMacro("Transcode: " << errText << this->FileName);
+  }
+  else if (compiler->GetErrorCode() != vtkErrorCode::NoError)
+  {
+    // the compiler has already reported the error
+    compiler->CloseAndRemove();
+    this->SetErrorCode(compiler->GetErrorCode());
+  }
+  else
+  {
+    compiler->Close();
+    this->SetErrorCode(compiler->GetErrorCode());
+    success = (this->ErrorCode == vtkErrorCode::NoError);
+  }
+
+  compiler->Delete();
+  infile.Close();
+
+  return success;
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMTranscoder::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "FileName: "
+     << (this->FileName ? this->FileName : "(NULL)") << "\n";
+  os << indent << "OutputFileName: "
+     << (this->OutputFileName ? this->OutputFileName : "(NULL)") << "\n";
+  os << indent << "TransferSyntaxUID: "
+     << (this->TransferSyntaxUID ? this->TransferSyntaxUID : "(NULL)") << "\n";
+  os << indent << "MetaData: " << this->MetaData << "\n";
+  os << indent << "BufferSize: " << this->BufferSize << "\n";
+}
@@ -0,0 +1,126 @@
+/*=========================================================================
+
+  Program: DICOM for VTK
+
+  Copyright (c) 2012-2024 David Gobbi
+  All rights reserved.
+  See Copyright.txt or http://dgobbi.github.io/bsd3.txt for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef vtkDICOMTranscoder_h
+#define vtkDICOMTranscoder_h
+
+#include "vtkObject.h"
+#include "vtkDICOMModule.h" // For export macro
+#include "vtkDICOMConfig.h" // For configuration details
+
+class vtkDICOMMetaData;
+
+//! Convert a DICOM file from one transfer syntax to another.
+/*!
+ *  This class rewrites a DICOM file with a different transfer syntax,
+ *  while keeping all of the original attributes (including the UIDs).
+ *  The meta data is read with vtkDICOMParser and written back out with
+ *  vtkDICOMCompiler, and the pixel data is converted one frame at a time,
+ *  so that the image never has to be loaded in its entirety.  The input
+ *  and output can be any uncompressed transfer syntax (implicit or
+ *  explicit little endian, or explicit big endian) or RLE, and the output
+ *  can also use the Deflate transfer syntax.  Since all of these are
+ *  lossless, the pixel values are unchanged.
+ *
+ *  Elements that follow the PixelData (such as digital signatures, which
+ *  will no longer be valid after the conversion) are discarded.
+ */
+class VTKDICOM_EXPORT vtkDICOMTranscoder : public vtkObject
+{
+public:
+  //! Create a new vtkDICOMTranscoder instance.
+  static vtkDICOMTranscoder *New();
+
+  //! VTK dynamic type information macro.
+  vtkTypeMacro(vtkDICOMTranscoder, vtkObject);
+
+  //! Print a summary of the contents of this object.
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_DICOM_OVERRIDE;
+
+  //@{
+  //! Set the name of the file to convert.
+  vtkSetStringMacro(FileName);
+  vtkGetStringMacro(FileName);
+  //@}
+
+  //@{
+  //! Set the name of the file to write.
+  vtkSetStringMacro(OutputFileName);
+  vtkGetStringMacro(OutputFileName);
+  //@}
+
+  //@{
+  //! Set the Transfer Syntax UID for the output file.
+  /*!
+   *  The default is 1.2.840.10008.1.2.1 (explicit little endian).
+   */
+  vtkSetStringMacro(TransferSyntaxUID);
+  vtkGetStringMacro(TransferSyntaxUID);
+  //@}
+
+  //@{
+  //! Set the buffer size for reading and writing, the default is 8192.
+  /*!
+   *  This sets the buffer size for the parser and for the compiler.
+   *  The pixel data is read one frame at a time, regardless of the
+   *  buffer size.
+   */
+  vtkSetMacro(BufferSize, int);
+  int GetBufferSize() { return this->BufferSize; }
+  //@}
+
+  //@{
+  //! Convert the file, and return false if an error occurred.
+  virtual bool Transcode();
+
+  //! Get the IO error code.
+  unsigned long GetErrorCode() { return this->ErrorCode; }
+
+  //! Get the meta data that was read from the file.
+  vtkDICOMMetaData *GetMetaData() { return this->MetaData; }
+  //@}
+
+  //@{
+  //! Check whether one transfer syntax can be converted to another.
+  /*!
+   *  An empty string stands for implicit little endian without a
+   *  meta header, as with the vtkDICOMCompiler.
+   */
+  static bool CanTranscode(const char *fromSyntax, const char *toSyntax);
+  //@}
+
+protected:
+  vtkDICOMTranscoder();
+  ~vtkDICOMTranscoder() VTK_DICOM_OVERRIDE;
+
+  //! Set the error code.
+  void SetErrorCode(unsigned long e) { this->ErrorCode = e; }
+
+  char *FileName;
+  char *OutputFileName;
+  char *TransferSyntaxUID;
+  vtkDICOMMetaData *MetaData;
+  int BufferSize;
+  unsigned long ErrorCode;
+
+private:
+#ifdef VTK_DICOM_DELETE
+  vtkDICOMTranscoder(const vtkDICOMTranscoder&) VTK_DICOM_DELETE;
+  void operator=(const vtkDICOMTranscoder&) VTK_DICOM_DELETE;
+#else
+  vtkDICOMTranscoder(const vtkDICOMTranscoder&) = delete;
+  void operator=(const vtkDICOMTranscoder&) = delete;
+#endif
+};
+
+#endif /* vtkDICOMTranscoder_h */
@@ -1504,6 +1504,20 @@ vtkDICOMValue *vtkDICOMValue::GetMultiplex()
   if (this->V && this->V->Type == VTK_DICOM_VALUE)
   {
     ptr = static_cast<ValueT<vtkDICOMValue> *>(this->V)->Data;
+    if (this->V->ReferenceCount != 1)
+    {
+      // the multiplex is shared, so copy it before it is modified
+      // (this copies only the references to the values it contains)
+      size_t n = this->V->NumberOfValues;
+      vtkDICOMValue v;
+      vtkDICOMValue *nptr = v.AllocateMultiplexData(this->V->VR, n);
+      for (size_t i = 0; i < n; i++)
+      {
+        nptr[i] = ptr[i];
+      }
+      *this = v;
+      ptr = nptr;
+    }
   }
   return ptr;
 }
@@ -1916,7 +1930,7 @@ std::string vtkDICOMValue::AsUTF8String() const
         while (n > 0 && *cp == ' ') { cp++; n--; }
         size_t m = n;
         while (m > 0 && cp[m-1] == ' ') { m--; }
-        s.append(cs.ToUTF8(cp, m));
+        cs.AppendToUTF8(cp, m, &s);
         cp += n;
         if (cp != ep && *cp == '\\')
         {
@@ -2102,7 +2116,7 @@ void vtkDICOMValue::AppendValueToUTF8String(
       l = dp - cp;
     }
     vtkDICOMCharacterSet cs(this->V->CharacterSet);
-    str += cs.ToUTF8(cp, l);
+    cs.AppendToUTF8(cp, l, &str);
   }
   else
   {
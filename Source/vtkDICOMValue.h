@@ -466,6 +466,10 @@ private:
   void SetValue(size_t i, const T &item);
 
   //! Method used by vtkDICOMMetaData to change multiplexed value.
+  /*!
+   *  If the multiplex is shared with other values, it is copied first,
+   *  so that multiplexed values can be shared until they are modified.
+   */
   vtkDICOMValue *GetMultiplex();
 
   //! Get the start and end for the "i"th backslash-delimited value.
@@ -27,6 +27,7 @@
 #include "vtkInformationVector.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkStringArray.h"
+#include "vtkMultiThreader.h"
 #include "vtkVersion.h"
 
 #ifdef _WIN32
@@ -47,13 +48,27 @@
 #include "zlib.h"
 #endif
 
+#if !defined(_WIN32)
+// For memory mapping of files
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include <ctype.h>
 #include <string.h>
+#include <atomic>
+#include <map>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #ifdef _WIN32
 // To allow use of wchar_t paths on Windows
 #include "vtkDICOMFilePath.h"
+// For memory mapping of files
+#include <windows.h>
 #if VTK_MAJOR_VERSION >= 7
 #ifdef gzopen
 #undef gzopen
@@ -76,6 +91,9 @@ vtkNIFTIReader::vtkNIFTIReader()
     this->PixDim[i] = 1.0;
   }
   this->TimeAsVector = 0;
+  this->TimeIndex = 0;
+  this->NumberOfThreads = 1;
+  this->MemoryMapping = false;
   this->RescaleSlope = 1.0;
   this->RescaleIntercept = 0.0;
   this->QFac = 1.0;
@@ -119,6 +137,10 @@ void vtkNIFTIReader::PrintSelf(ostream& os, vtkIndent indent)
 
   os << indent << "TimeAsVector: "
      << (this->TimeAsVector ? "On\n" : "Off\n");
+  os << indent << "TimeIndex: " << this->TimeIndex << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "MemoryMapping: "
+     << (this->MemoryMapping ? "On\n" : "Off\n");
   os << indent << "TimeDimension: " << this->GetTimeDimension() << "\n";
   os << indent << "TimeSpacing: " << this->GetTimeSpacing() << "\n";
   os << indent << "RescaleSlope: " << this->RescaleSlope << "\n";
@@ -1011,6 +1033,460 @@ int vtkNIFTIReader::RequestInformation(
   return 1;
 }
 
+//----------------------------------------------------------------------------
+namespace {
+
+// The information needed for reading the volumes from the file.
+struct vtkNIFTIReaderVolumeInfo
+{
+  vtkNIFTIReader *Reader;
+  std::vector<gzFile> Files; // one file handle per thread
+  unsigned char *DataPtr; // where to write the first volume
+  z_off_t Offset; // file offset for the first volume
+  z_off_t VoxelIncr; // file increments
+  z_off_t RowIncr;
+  z_off_t PlaneIncr;
+  z_off_t SliceIncr;
+  z_off_t VectorIncr;
+  vtkIdType SliceOffset; // for reversing the slice order
+  vtkIdType PlanarOffset; // for planar RGB
+  vtkIdType PlanarEndOffset;
+  int SizeX; // size of the output extent
+  int SizeY;
+  int SizeZ;
+  int ScalarSize;
+  int NumberOfComponents;
+  int PlanarSize;
+  int TimeDim;
+  int VectorDim;
+  bool TimeAsVector;
+  bool SwapBytes;
+  bool NeedsBuffer;
+  std::vector<int> ErrorCodes; // error code for each volume
+  std::atomic<vtkIdType> RowCount; // for progress reporting
+  vtkIdType ProgressTarget;
+  vtkIdType ProgressStep;
+};
+
+// Swap the bytes of "n" values, with simple loops that the compiler
+// can vectorize (unlike vtkByteSwap, which swaps one value at a time).
+void vtkNIFTIReaderSwapBytes(unsigned char *data, size_t n, int size)
+{
+  if (size == 2)
+  {
+    for (size_t i = 0; i < n; i++)
+    {
+      unsigned short v;
+      memcpy(&v, data + 2*i, 2);
+      v = static_cast<unsigned short>((v >> 8) | (v << 8));
+      memcpy(data + 2*i, &v, 2);
+    }
+  }
+  else if (size == 4)
+  {
+    for (size_t i = 0; i < n; i++)
+    {
+      unsigned int v;
+      memcpy(&v, data + 4*i, 4);
+      v = ((v >> 24) | ((v >> 8) & 0x0000FF00u) |
+           ((v << 8) & 0x00FF0000u) | (v << 24));
+      memcpy(data + 4*i, &v, 4);
+    }
+  }
+  else if (size == 8)
+  {
+    for (size_t i = 0; i < n; i++)
+    {
+      unsigned long long v;
+      memcpy(&v, data + 8*i, 8);
+      v = ((v >> 56) | ((v >> 40) & 0x000000000000FF00ull) |
+           ((v >> 24) & 0x0000000000FF0000ull) |
+           ((v >> 8) & 0x00000000FF000000ull) |
+           ((v << 8) & 0x000000FF00000000ull) |
+           ((v << 24) & 0x0000FF0000000000ull) |
+           ((v << 40) & 0x00FF000000000000ull) | (v << 56));
+      memcpy(data + 8*i, &v, 8);
+    }
+  }
+  else if (size > 1)
+  {
+    vtkByteSwap::SwapVoidRange(data, static_cast<int>(n), size);
+  }
+}
+
+// Get the error code after a failed seek or read.
+int vtkNIFTIReaderFileError(gzFile file)
+{
+  return (gzeof(file) ? vtkErrorCode::PrematureEndOfFileError :
+                        vtkErrorCode::FileFormatError);
+}
+
+// Read one volume (i.e. one vector component) into the output, one row
+// at a time, with planar-to-packed conversion of the vector components.
+// The return value is zero unless an error occurred.
+int vtkNIFTIReaderReadVolume(
+  vtkNIFTIReaderVolumeInfo *info, gzFile file, int c,
+  unsigned char *rowBuffer, bool reportProgress)
+{
+  int scalarSize = info->ScalarSize;
+  int planarSize = info->PlanarSize;
+  z_off_t fileVoxelIncr = info->VoxelIncr;
+  int rowSize = static_cast<int>(fileVoxelIncr/scalarSize*info->SizeX);
+
+  // the vector component to write to
+  unsigned char *ptr = info->DataPtr + c*fileVoxelIncr*planarSize;
+  if (info->TimeAsVector)
+  {
+    // if timeDim is included in the vectorDim (and hence in the
+    // VTK scalar components) then we have to make sure that
+    // the vector components are packed before the time steps
+    int t = c % info->TimeDim;
+    ptr = info->DataPtr + (c + t*(info->VectorDim - 1))/info->TimeDim*
+                          fileVoxelIncr*planarSize;
+  }
+
+  // seek to the start of the volume
+  z_off_t offset = info->Offset + c*info->VectorIncr;
+  if (gzseek(file, offset, SEEK_SET) == -1)
+  {
+    return vtkNIFTIReaderFileError(file);
+  }
+
+  offset = 0;
+  for (int k = 0; k < info->SizeZ; k++)
+  {
+    for (int p = 0; p < planarSize; p++)
+    {
+      for (int j = 0; j < info->SizeY; j++)
+      {
+        if (info->Reader->AbortExecute)
+        {
+          return 0;
+        }
+
+        // skip unread sections of the file, for when
+        // the update extent is less than the whole extent
+        if (offset && gzseek(file, offset, SEEK_CUR) == -1)
+        {
+          return vtkNIFTIReaderFileError(file);
+        }
+
+        // read directly into the output if possible
+        unsigned char *buffer = (info->NeedsBuffer ? rowBuffer : ptr);
+        int code = gzread(file, buffer, rowSize*scalarSize);
+        if (code != rowSize*scalarSize)
+        {
+          return vtkNIFTIReaderFileError(file);
+        }
+
+        if (info->SwapBytes && scalarSize > 1)
+        {
+          vtkNIFTIReaderSwapBytes(buffer, rowSize, scalarSize);
+        }
+
+        if (!info->NeedsBuffer)
+        {
+          // advance the pointer to the next row
+          ptr += info->SizeX*info->NumberOfComponents*scalarSize;
+        }
+        else
+        {
+          // write vector plane to packed vector component
+          unsigned char *tmpPtr = rowBuffer;
+          z_off_t skipOther =
+            scalarSize*info->NumberOfComponents - fileVoxelIncr;
+          for (int i = 0; i < info->SizeX; i++)
+          {
+            // write one vector component of one voxel
+            z_off_t n = fileVoxelIncr;
+            do { *ptr++ = *tmpPtr++; } while (--n);
+            // skip past the other components
+            ptr += skipOther;
+          }
+        }
+
+        // only one thread reports the progress
+        vtkIdType count = ++info->RowCount;
+        if (reportProgress &&
+            count/info->ProgressTarget != info->ProgressStep)
+        {
+          info->ProgressStep = count/info->ProgressTarget;
+          info->Reader->UpdateProgress(0.02*info->ProgressStep);
+        }
+
+        offset = info->RowIncr - info->SizeX*fileVoxelIncr;
+      }
+      offset += info->PlaneIncr - info->SizeY*info->RowIncr;
+      // back up for next plane (R, G, or B) if planar mode
+      ptr -= info->PlanarOffset;
+    }
+    ptr += info->PlanarEndOffset; // advance to start of next slice
+    ptr -= 2*info->SliceOffset; // for reverse slice order
+  }
+
+  return 0;
+}
+
+// Each thread reads every Nth volume with its own file handle.
+VTK_THREAD_RETURN_TYPE vtkNIFTIReaderReadThread(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *ti =
+    static_cast<vtkMultiThreader::ThreadInfo *>(arg);
+  vtkNIFTIReaderVolumeInfo *info =
+    static_cast<vtkNIFTIReaderVolumeInfo *>(ti->UserData);
+  gzFile file = info->Files[ti->ThreadID];
+
+  unsigned char *rowBuffer = nullptr;
+  if (info->NeedsBuffer)
+  {
+    rowBuffer = new unsigned char[info->SizeX*info->VoxelIncr];
+  }
+
+  for (int c = ti->ThreadID; c < info->VectorDim;
+       c += ti->NumberOfThreads)
+  {
+    info->ErrorCodes[c] = vtkNIFTIReaderReadVolume(
+      info, file, c, rowBuffer, (ti->ThreadID == 0));
+    if (info->ErrorCodes[c] || info->Reader->AbortExecute)
+    {
+      break;
+    }
+  }
+
+  delete [] rowBuffer;
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+#if VTK_MAJOR_VERSION >= 9
+// The memory maps that are in use as array memory, indexed by the array
+// pointer, so that they can be unmapped when the arrays are freed.
+struct vtkNIFTIReaderMapping
+{
+  void *Base;
+  size_t Length;
+};
+
+std::mutex vtkNIFTIReaderMappingMutex;
+std::map<void *, vtkNIFTIReaderMapping> vtkNIFTIReaderMappings;
+
+// Get the alignment that is required for the file offset of a mapping.
+size_t vtkNIFTIReaderMapGranularity()
+{
+#ifdef _WIN32
+  SYSTEM_INFO sysInfo;
+  GetSystemInfo(&sysInfo);
+  return sysInfo.dwAllocationGranularity;
+#else
+  long pageSize = sysconf(_SC_PAGESIZE);
+  return (pageSize > 0 ? static_cast<size_t>(pageSize) : 4096);
+#endif
+}
+
+// Map part of a file as private (copy-on-write) memory.
+void *vtkNIFTIReaderMapFile(
+  const char *fname, vtkDICOMFile::Size start, size_t length)
+{
+  void *base = nullptr;
+#ifdef _WIN32
+  vtkDICOMFilePath fpath(fname);
+  const wchar_t *wname = fpath.Wide();
+  if (wname == nullptr)
+  {
+    return nullptr;
+  }
+  HANDLE h = CreateFileW(wname, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (h == INVALID_HANDLE_VALUE)
+  {
+    return nullptr;
+  }
+  HANDLE m = CreateFileMappingW(h, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+  if (m != nullptr)
+  {
+    base = MapViewOfFile(m, FILE_MAP_COPY,
+                         static_cast<DWORD>(start >> 32),
+                         static_cast<DWORD>(start & 0xFFFFFFFFu), length);
+    CloseHandle(m);
+  }
+  CloseHandle(h);
+#else
+  int fd = open(fname, O_RDONLY);
+  if (fd == -1)
+  {
+    return nullptr;
+  }
+  base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+              fd, static_cast<off_t>(start));
+  if (base == MAP_FAILED)
+  {
+    base = nullptr;
+  }
+  close(fd);
+#endif
+  return base;
+}
+
+// Release a mapping that was created by vtkNIFTIReaderMapFile().
+void vtkNIFTIReaderUnmapFile(void *base, size_t length)
+{
+#ifdef _WIN32
+  (void)length;
+  UnmapViewOfFile(base);
+#else
+  munmap(base, length);
+#endif
+}
+
+// The free function for arrays that use mapped memory.
+void vtkNIFTIReaderFreeMapping(void *ptr)
+{
+  vtkNIFTIReaderMapping mapping = { nullptr, 0 };
+  vtkNIFTIReaderMappingMutex.lock();
+  std::map<void *, vtkNIFTIReaderMapping>::iterator iter =
+    vtkNIFTIReaderMappings.find(ptr);
+  if (iter != vtkNIFTIReaderMappings.end())
+  {
+    mapping = iter->second;
+    vtkNIFTIReaderMappings.erase(iter);
+  }
+  vtkNIFTIReaderMappingMutex.unlock();
+
+  if (mapping.Base)
+  {
+    vtkNIFTIReaderUnmapFile(mapping.Base, mapping.Length);
+  }
+}
+#endif
+
+} // end anonymous namespace
+
+//----------------------------------------------------------------------------
+bool vtkNIFTIReader::MapOutputData(
+  vtkImageData *data, int extent[6], const char *imgname)
+{
+#if VTK_MAJOR_VERSION >= 9
+  // only the whole extent can be provided by mapping
+  for (int i = 0; i < 6; i++)
+  {
+    if (extent[i] != this->DataExtent[i])
+    {
+      return false;
+    }
+  }
+
+  // check if planar RGB is applicable (Analyze only)
+  bool planarRGB = (this->PlanarRGB &&
+                    (this->NIFTIHeader->GetDataType() == NIFTI_TYPE_RGB24 ||
+                     this->NIFTIHeader->GetDataType() == NIFTI_TYPE_RGBA32));
+
+  int timeDim = (this->Dim[0] >= 4 ? this->Dim[4] : 1);
+  int vectorDim = (this->Dim[0] >= 5 ? this->Dim[5] : 1);
+  if (this->TimeAsVector)
+  {
+    vectorDim *= timeDim;
+  }
+
+  // the voxels must already be laid out the way that VTK needs them
+  if (vectorDim != 1 || planarRGB || this->GetSwapBytes() ||
+      this->GetQFac() < 0)
+  {
+    return false;
+  }
+
+  // let the reading code report a bad TimeIndex
+  int timeIndex = 0;
+  if (timeDim > 1 && !this->TimeAsVector)
+  {
+    timeIndex = this->TimeIndex;
+    if (timeIndex < 0 || timeIndex >= timeDim)
+    {
+      return false;
+    }
+  }
+
+  // compute the position of the volume within the file
+  vtkIdType numValues = this->NumberOfScalarComponents;
+  numValues *= extent[1] - extent[0] + 1;
+  numValues *= extent[3] - extent[2] + 1;
+  numValues *= extent[5] - extent[4] + 1;
+  vtkDICOMFile::Size scalarSize =
+    vtkDataArray::GetDataTypeSize(this->DataScalarType);
+  vtkDICOMFile::Size volumeSize = scalarSize*numValues;
+  vtkDICOMFile::Size offset = this->GetHeaderSize();
+  offset += timeIndex*volumeSize;
+
+  // the scalars must be aligned in memory
+  if (volumeSize == 0 || scalarSize == 0 || offset % scalarSize != 0)
+  {
+    return false;
+  }
+
+  // the file must be large enough, and must not be compressed
+  vtkDICOMFile infile(imgname, vtkDICOMFile::In);
+  if (infile.GetError())
+  {
+    return false;
+  }
+  vtkDICOMFile::Size fileSize = infile.GetSize();
+  unsigned char magic[2] = { 0, 0 };
+  if (infile.GetError() || fileSize < offset + volumeSize ||
+      infile.Read(magic, 2) != 2 ||
+      (magic[0] == 0x1f && magic[1] == 0x8b))
+  {
+    return false;
+  }
+  infile.Close();
+
+  // the start of the mapping must be at a page boundary
+  vtkDICOMFile::Size granularity = vtkNIFTIReaderMapGranularity();
+  vtkDICOMFile::Size start = offset - offset % granularity;
+  vtkDICOMFile::Size length = offset - start + volumeSize;
+  if (length != static_cast<size_t>(length))
+  {
+    // too large for the address space
+    return false;
+  }
+
+  void *base = vtkNIFTIReaderMapFile(
+    imgname, start, static_cast<size_t>(length));
+  if (base == nullptr)
+  {
+    vtkDebugMacro("Unable to map NIFTI file " << imgname);
+    return false;
+  }
+
+  void *ptr = static_cast<char *>(base) + (offset - start);
+  vtkNIFTIReaderMapping mapping;
+  mapping.Base = base;
+  mapping.Length = static_cast<size_t>(length);
+  vtkNIFTIReaderMappingMutex.lock();
+  vtkNIFTIReaderMappings[ptr] = mapping;
+  vtkNIFTIReaderMappingMutex.unlock();
+
+  // the array will unmap the memory when it is freed
+  vtkDataArray *array = vtkDataArray::CreateDataArray(this->DataScalarType);
+  array->SetNumberOfComponents(this->NumberOfScalarComponents);
+  array->SetVoidArray(
+    ptr, numValues, 0, vtkDataArray::VTK_DATA_ARRAY_USER_DEFINED);
+  array->SetArrayFreeFunction(vtkNIFTIReaderFreeMapping);
+  array->SetName("NIFTI");
+
+  data->SetExtent(extent);
+  data->GetPointData()->SetScalars(array);
+  array->Delete();
+
+  vtkDebugMacro("Mapped NIFTI file " << imgname);
+
+  return true;
+#else
+  (void)data;
+  (void)extent;
+  (void)imgname;
+  return false;
+#endif
+}
+
 //----------------------------------------------------------------------------
 int vtkNIFTIReader::RequestData(
   vtkInformation* request,
@@ -1038,12 +1514,9 @@ int vtkNIFTIReader::RequestData(
   int extent[6];
   outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), extent);
 
-  // get the data object, allocate memory
+  // get the data object
   vtkImageData *data =
     static_cast<vtkImageData *>(outInfo->Get(vtkDataObject::DATA_OBJECT()));
-  this->AllocateOutputData(data, outInfo, extent);
-
-  data->GetPointData()->GetScalars()->SetName("NIFTI");
 
   const char *filename = nullptr;
   char *imgname = nullptr;
@@ -1094,6 +1567,20 @@ int vtkNIFTIReader::RequestData(
     return 0;
   }
 
+  // if possible, map the file into memory instead of reading it
+  if (this->MemoryMapping && this->MapOutputData(data, extent, imgname))
+  {
+    delete [] imgname;
+    this->InvokeEvent(vtkCommand::StartEvent);
+    this->UpdateProgress(0.0);
+    this->UpdateProgress(1.0);
+    this->InvokeEvent(vtkCommand::EndEvent);
+    return 1;
+  }
+
+  // allocate memory for reading the file
+  this->AllocateOutputData(data, outInfo, extent);
+
   vtkDebugMacro("Opening NIFTI file " << imgname);
 
   data->GetPointData()->GetScalars()->SetName("NIFTI");
@@ -1120,10 +1607,9 @@ int vtkNIFTIReader::RequestData(
     file = gzopen(uimgname, "rb");
   }
 
-  delete [] imgname;
-
   if (!file)
   {
+    delete [] imgname;
     return 0;
   }
 
@@ -1132,7 +1618,6 @@ int vtkNIFTIReader::RequestData(
                     (this->NIFTIHeader->GetDataType() == NIFTI_TYPE_RGB24 ||
                      this->NIFTIHeader->GetDataType() == NIFTI_TYPE_RGBA32));
 
-  int swapBytes = this->GetSwapBytes();
   int scalarSize = data->GetScalarSize();
   int numComponents = data->GetNumberOfScalarComponents();
   int timeDim = (this->Dim[0] >= 4 ? this->Dim[4] : 1);
@@ -1146,196 +1631,169 @@ int vtkNIFTIReader::RequestData(
   int outSizeY = extent[3] - extent[2] + 1;
   int outSizeZ = extent[5] - extent[4] + 1;
 
-  z_off_t fileVoxelIncr = scalarSize*numComponents/vectorDim;
-  z_off_t fileRowIncr = fileVoxelIncr*this->Dim[1];
-  z_off_t filePlaneIncr = fileRowIncr*this->Dim[2];
-  z_off_t fileSliceIncr = fileRowIncr*this->Dim[2];
-  z_off_t fileTimeIncr = fileSliceIncr*this->Dim[3];
-  z_off_t fileVectorIncr = fileTimeIncr*this->Dim[4];
+  vtkNIFTIReaderVolumeInfo info;
+  info.Reader = this;
+  info.SizeX = outSizeX;
+  info.SizeY = outSizeY;
+  info.SizeZ = outSizeZ;
+  info.ScalarSize = scalarSize;
+  info.NumberOfComponents = numComponents;
+  info.TimeDim = timeDim;
+  info.VectorDim = vectorDim;
+  info.TimeAsVector = (this->TimeAsVector != 0);
+  info.SwapBytes = (this->GetSwapBytes() != 0);
+
+  info.VoxelIncr = scalarSize*numComponents/vectorDim;
+  info.RowIncr = info.VoxelIncr*this->Dim[1];
+  info.PlaneIncr = info.RowIncr*this->Dim[2];
+  info.SliceIncr = info.RowIncr*this->Dim[2];
+  z_off_t fileTimeIncr = info.SliceIncr*this->Dim[3];
+  info.VectorIncr = fileTimeIncr*this->Dim[4];
   if (this->TimeAsVector)
   {
-    fileVectorIncr = fileTimeIncr;
+    info.VectorIncr = fileTimeIncr;
   }
 
   // planar RGB requires different increments
-  int planarSize = 1; // if > 1, indicates planar RGB
+  info.PlanarSize = 1; // if > 1, indicates planar RGB
   if (planarRGB)
   {
-    planarSize = numComponents/vectorDim;
-    fileVoxelIncr = scalarSize;
-    fileRowIncr = fileVoxelIncr*this->Dim[1];
-    filePlaneIncr = fileRowIncr*this->Dim[2];
+    info.PlanarSize = numComponents/vectorDim;
+    info.VoxelIncr = scalarSize;
+    info.RowIncr = info.VoxelIncr*this->Dim[1];
+    info.PlaneIncr = info.RowIncr*this->Dim[2];
   }
 
-  // add a buffer for planar-vector to packed-vector conversion
-  unsigned char *rowBuffer = nullptr;
-  if (vectorDim > 1 || planarRGB)
-  {
-    rowBuffer = new unsigned char[outSizeX*fileVoxelIncr];
-  }
+  // a buffer is needed for planar-vector to packed-vector conversion
+  info.NeedsBuffer = (vectorDim > 1 || planarRGB);
 
   // special increment to reverse the slices if needed
-  vtkIdType sliceOffset = 0;
-
+  info.SliceOffset = 0;
+  info.DataPtr = dataPtr;
   if (this->GetQFac() < 0)
   {
     // put slices in reverse order
-    sliceOffset = scalarSize*numComponents;
-    sliceOffset *= outSizeX;
-    sliceOffset *= outSizeY;
-    dataPtr += sliceOffset*(outSizeZ - 1);
+    info.SliceOffset = scalarSize*numComponents;
+    info.SliceOffset *= outSizeX;
+    info.SliceOffset *= outSizeY;
+    info.DataPtr += info.SliceOffset*(outSizeZ - 1);
   }
 
   // special increment to handle planar RGB
-  vtkIdType planarOffset = 0;
-  vtkIdType planarEndOffset = 0;
+  info.PlanarOffset = 0;
+  info.PlanarEndOffset = 0;
   if (planarRGB)
   {
-    planarOffset = scalarSize*numComponents;
-    planarOffset *= outSizeX;
-    planarOffset *= outSizeY;
-    planarOffset -= scalarSize;
-    planarEndOffset = planarOffset - scalarSize*(planarSize - 1);
+    info.PlanarOffset = scalarSize*numComponents;
+    info.PlanarOffset *= outSizeX;
+    info.PlanarOffset *= outSizeY;
+    info.PlanarOffset -= scalarSize;
+    info.PlanarEndOffset =
+      info.PlanarOffset - scalarSize*(info.PlanarSize - 1);
+  }
+
+  // the offset to the start of the data
+  info.Offset = static_cast<z_off_t>(this->GetHeaderSize());
+  info.Offset += extent[0]*info.VoxelIncr;
+  info.Offset += extent[2]*info.RowIncr;
+  info.Offset += extent[4]*info.SliceIncr;
+
+  // if only one time point is read, choose which one
+  if (timeDim > 1 && !this->TimeAsVector)
+  {
+    if (this->TimeIndex < 0 || this->TimeIndex >= timeDim)
+    {
+      vtkErrorMacro("TimeIndex " << this->TimeIndex <<
+                    " is out of range [0," << (timeDim - 1) << "]");
+      this->SetErrorCode(vtkErrorCode::FileFormatError);
+      gzclose(file);
+      delete [] imgname;
+      return 0;
+    }
+    info.Offset += this->TimeIndex*fileTimeIncr;
   }
 
   // report progress every 2% of the way to completion
   this->InvokeEvent(vtkCommand::StartEvent);
   this->UpdateProgress(0.0);
-  vtkIdType target =
-    static_cast<vtkIdType>(0.02*planarSize*outSizeY*outSizeZ*vectorDim) + 1;
-  vtkIdType count = 0;
-
-  // seek to the start of the data
-  z_off_t offset = static_cast<z_off_t>(this->GetHeaderSize());
-  offset += extent[0]*fileVoxelIncr;
-  offset += extent[2]*fileRowIncr;
-  offset += extent[4]*fileSliceIncr;
-
-  // read the data one row at a time, do planar-to-packed conversion
-  // of vector components if NIFTI file has a vector dimension
-  int rowSize = fileVoxelIncr/scalarSize*outSizeX;
-  int t = 0; // counter for time
-  int c = 0; // counter for vector components
-  int j = 0; // counter for rows
-  int p = 0; // counter for planes (planar RGB)
-  int k = 0; // counter for slices
-  unsigned char *ptr = dataPtr;
-
-  int errorCode = 0;
+  info.RowCount = 0;
+  info.ProgressStep = 0;
+  info.ProgressTarget = static_cast<vtkIdType>(
+    0.02*info.PlanarSize*outSizeY*outSizeZ*vectorDim) + 1;
+  info.ErrorCodes.resize(vectorDim, 0);
+
+  // volumes can only be read in parallel from uncompressed files,
+  // since each thread must be able to seek within its own file handle
+  int numThreads = this->NumberOfThreads;
+  if (numThreads <= 0)
+  {
+    numThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  }
+  numThreads = (numThreads < vectorDim ? numThreads : vectorDim);
+  if (numThreads > 1 && !gzdirect(file))
+  {
+    numThreads = 1;
+  }
 
-  while (!this->AbortExecute)
+  if (numThreads > 1)
   {
-    if (offset)
+    vtkMultiThreader *threader = vtkMultiThreader::New();
+    threader->SetNumberOfThreads(numThreads);
+    numThreads = threader->GetNumberOfThreads();
+
+    // each thread gets its own file handle
+    info.Files.push_back(file);
+    for (int i = 1; i < numThreads; i++)
     {
-      int rval = gzseek(file, offset, SEEK_CUR);
-      if (rval == -1)
+      gzFile tfile = gzopen(uimgname, "rb");
+      if (!tfile)
       {
-        errorCode = vtkErrorCode::FileFormatError;
-        if (gzeof(file))
-        {
-          errorCode = vtkErrorCode::PrematureEndOfFileError;
-        }
         break;
       }
+      info.Files.push_back(tfile);
     }
 
-    if (vectorDim == 1 && !planarRGB)
-    {
-      // read directly into the output instead of into a buffer
-      rowBuffer = ptr;
-    }
+    threader->SetNumberOfThreads(static_cast<int>(info.Files.size()));
+    threader->SetSingleMethod(vtkNIFTIReaderReadThread, &info);
+    threader->SingleMethodExecute();
+    threader->Delete();
 
-    int code = gzread(file, rowBuffer, rowSize*scalarSize);
-    if (code != rowSize*scalarSize)
+    for (size_t i = 1; i < info.Files.size(); i++)
     {
-      errorCode = vtkErrorCode::FileFormatError;
-      if (gzeof(file))
-      {
-        errorCode = vtkErrorCode::PrematureEndOfFileError;
-      }
-      break;
+      gzclose(info.Files[i]);
     }
-
-    if (swapBytes != 0 && scalarSize > 1)
-    {
-      vtkByteSwap::SwapVoidRange(rowBuffer, rowSize, scalarSize);
-    }
-
-    if (vectorDim == 1 && !planarRGB)
-    {
-      // advance the pointer to the next row
-      ptr += outSizeX*numComponents*scalarSize;
-      rowBuffer = nullptr;
-    }
-    else
-    {
-      // write vector plane to packed vector component
-      unsigned char *tmpPtr = rowBuffer;
-      z_off_t skipOther = scalarSize*numComponents - fileVoxelIncr;
-      for (int i = 0; i < outSizeX; i++)
-      {
-        // write one vector component of one voxel
-        z_off_t n = fileVoxelIncr;
-        do { *ptr++ = *tmpPtr++; } while (--n);
-        // skip past the other components
-        ptr += skipOther;
-      }
-    }
-
-    if (++count % target == 0)
+  }
+  else
+  {
+    // read the volumes one at a time, in file order
+    unsigned char *rowBuffer = nullptr;
+    if (info.NeedsBuffer)
     {
-      this->UpdateProgress(0.02*count/target);
+      rowBuffer = new unsigned char[outSizeX*info.VoxelIncr];
     }
 
-    // offset to skip unread sections of the file, for when
-    // the update extent is less than the whole extent
-    offset = fileRowIncr - outSizeX*fileVoxelIncr;
-    if (++j == outSizeY)
+    for (int c = 0; c < vectorDim && !this->AbortExecute; c++)
     {
-      j = 0;
-      offset += filePlaneIncr - outSizeY*fileRowIncr;
-      // back up for next plane (R, G, or B) if planar mode
-      ptr -= planarOffset;
-      if (++p == planarSize)
+      info.ErrorCodes[c] = vtkNIFTIReaderReadVolume(
+        &info, file, c, rowBuffer, true);
+      if (info.ErrorCodes[c])
       {
-        p = 0;
-        ptr += planarEndOffset; // advance to start of next slice
-        ptr -= 2*sliceOffset; // for reverse slice order
-        if (++k == outSizeZ)
-        {
-          k = 0;
-          offset += fileVectorIncr - outSizeZ*fileSliceIncr;
-          if (++t == timeDim)
-          {
-            t = 0;
-          }
-          if (++c == vectorDim)
-          {
-            break;
-          }
-          // back up the ptr to the beginning of the image,
-          // then increment to the next vector component
-          ptr = dataPtr + c*fileVoxelIncr*planarSize;
-
-          if (this->TimeAsVector)
-          {
-            // if timeDim is included in the vectorDim (and hence in the
-            // VTK scalar components) then we have to make sure that
-            // the vector components are packed before the time steps
-            ptr = dataPtr + (c + t*(vectorDim - 1))/timeDim*
-                            fileVoxelIncr*planarSize;
-          }
-        }
+        break;
       }
     }
-  }
 
-  if (vectorDim > 1 || planarRGB)
-  {
     delete [] rowBuffer;
   }
 
   gzclose(file);
+  delete [] imgname;
+
+  // report the error for the first volume that failed
+  int errorCode = 0;
+  for (int c = 0; c < vectorDim && errorCode == 0; c++)
+  {
+    errorCode = info.ErrorCodes[c];
+  }
 
   if (errorCode)
   {
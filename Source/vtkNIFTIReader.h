@@ -22,9 +22,10 @@
  * are decompressed on-the-fly while they are being read.  Files with
  * complex numbers or vector dimensions will be read as multi-component
  * images.  If a NIFTI file has a time dimension, then by default only the
- * first image in the time series will be read, but the TimeAsVector
- * flag can be set to read the time steps as vector components.  Files in
- * Analyze 7.5 format are also supported by this reader.
+ * first image in the time series will be read (or the image chosen with
+ * SetTimeIndex()), but the TimeAsVector flag can be set to read the time
+ * steps as vector components.  Files in Analyze 7.5 format are also
+ * supported by this reader.
  *
  * This class was contributed to VTK by the Calgary Image Processing and
  * Analysis Centre (CIPAC).
@@ -44,6 +45,7 @@
 VTK_ABI_NAMESPACE_BEGIN
 #endif
 
+class vtkImageData;
 class vtkMatrix4x4;
 
 #if defined(VTK_ABI_NAMESPACE_BEGIN)
@@ -91,6 +93,51 @@ public:
   vtkBooleanMacro(TimeAsVector, int);
   //@}
 
+  //@{
+  //! Set the time point to read, if TimeAsVector is off (default: 0).
+  /*!
+   *  If the file has a time dimension and TimeAsVector is off, then only
+   *  one time point will be read, and this index selects which one.  The
+   *  other time points will be skipped without being read, unless the
+   *  file is compressed (in which case they must be decompressed).
+   */
+  vtkSetMacro(TimeIndex, int);
+  vtkGetMacro(TimeIndex, int);
+  //@}
+
+  //@{
+  //! Set the number of threads to use for reading volumes (default: 1).
+  /*!
+   *  If the file contains multiple volumes (i.e. a time dimension that is
+   *  read with TimeAsVector, or a vector dimension), then the volumes can
+   *  be read in parallel.  Each thread uses its own file handle to read
+   *  every Nth volume.  This is only done for uncompressed files, since
+   *  compressed files must be read sequentially.  A value of zero means
+   *  that VTK's default number of threads will be used.
+   */
+  vtkSetMacro(NumberOfThreads, int);
+  vtkGetMacro(NumberOfThreads, int);
+  //@}
+
+  //@{
+  //! Map the file into memory, instead of reading it (default: Off).
+  /*!
+   *  If this is on, and if the file is uncompressed, has native byte order,
+   *  and has a voxel layout that matches VTK's (no vector dimension, no
+   *  planar RGB, and no slice reversal), then the whole extent will be
+   *  provided by mapping the file into memory and using the mapped memory
+   *  as the output scalars.  Nothing is read until the data is accessed,
+   *  so this is very fast for large files.  The mapping is private, which
+   *  means that if the data is modified, the modified pages are copied and
+   *  the file itself is not changed.  The file must not be truncated or
+   *  overwritten while the data is in use.  If mapping isn't possible, the
+   *  file will be read as usual.  This is only supported for VTK 9 and up.
+   */
+  vtkSetMacro(MemoryMapping, bool);
+  vtkGetMacro(MemoryMapping, bool);
+  vtkBooleanMacro(MemoryMapping, bool);
+  //@}
+
   //@{
   //! Get the time dimension that was stored in the NIFTI header.
   int GetTimeDimension() { return this->Dim[4]; }
@@ -211,9 +258,27 @@ protected:
   //! Check for Analyze 7.5 header.
   static bool CheckAnalyzeHeader(const nifti_1_header *hdr);
 
+  //! Provide the output by mapping the file into memory.
+  /*!
+   *  This is called by RequestData() when MemoryMapping is on.  If the
+   *  file cannot be mapped, then it returns false, and the output data
+   *  must be allocated and read in the usual manner.
+   */
+  bool MapOutputData(
+    vtkImageData *data, int extent[6], const char *imgname);
+
   //! Read the time dimension as if it was a vector dimension.
   int TimeAsVector;
 
+  //! The time point to read, if TimeAsVector is off.
+  int TimeIndex;
+
+  //! The number of threads for reading the volumes.
+  int NumberOfThreads;
+
+  //! Map uncompressed files into memory.
+  bool MemoryMapping;
+
   //! Information for rescaling data to quantitative units.
   double RescaleIntercept;
   double RescaleSlope;
@@ -48,6 +48,8 @@
 #include <float.h>
 #include <math.h>
 
+#include <string>
+
 #ifdef _WIN32
 // To allow use of wchar_t paths on Windows
 #include "vtkDICOMFilePath.h"
@@ -58,11 +60,14 @@
 #define gzopen gzopen_w
 #define fopen _wfopen
 #define NIFTI_FILE_MODE L"wb"
+#define NIFTI_TEMP_FILE_MODE L"w+b"
 #else
 #define NIFTI_FILE_MODE "wb"
+#define NIFTI_TEMP_FILE_MODE "w+b"
 #endif
 #else
 #define NIFTI_FILE_MODE "wb"
+#define NIFTI_TEMP_FILE_MODE "w+b"
 #endif
 
 vtkStandardNewMacro(vtkNIFTIWriter);
@@ -70,6 +75,91 @@ vtkCxxSetObjectMacro(vtkNIFTIWriter,QFormMatrix,vtkMatrix4x4);
 vtkCxxSetObjectMacro(vtkNIFTIWriter,SFormMatrix,vtkMatrix4x4);
 vtkCxxSetObjectMacro(vtkNIFTIWriter,NIFTIHeader,vtkNIFTIHeader);
 
+//----------------------------------------------------------------------------
+// The state of the file that is being written.  This is kept between
+// calls to RequestData() when the data is streamed in chunks of slices.
+class vtkNIFTIWriter::Internals
+{
+public:
+  Internals() : File(nullptr), UFile(nullptr), TempFile(nullptr),
+    HdrName(nullptr), ImgName(nullptr), IsCompressed(false),
+    SingleFile(true), SwapBytes(0), DataOffset(0), Position(0),
+    Count(0), Target(1) {}
+
+  //! Get the uncompressed file that the image is written to, if any.
+  FILE *GetRawFile() {
+    return (this->TempFile ? this->TempFile : this->UFile); }
+
+  //! Go to the given offset, relative to the start of the image data.
+  bool Seek(vtkTypeInt64 offset);
+
+  //! Write to the file, return false if not all data was written.
+  bool Write(const void *data, size_t size);
+
+  gzFile File;              // the output file, if compressed
+  FILE *UFile;              // the output file, if not compressed
+  FILE *TempFile;           // temporary file, for streamed compression
+  std::string TempName;     // the name of the temporary file
+  char *HdrName;            // the name of the header file
+  char *ImgName;            // the name of the image file
+  bool IsCompressed;        // whether the output file is compressed
+  bool SingleFile;          // false if .hdr and .img are separate
+  int SwapBytes;            // whether to swap the bytes of the image
+  int WholeExtent[6];       // the extent of the whole image
+  vtkTypeInt64 DataOffset;  // the offset to the image data in the file
+  vtkTypeInt64 Position;    // the position relative to the DataOffset
+  vtkIdType Count;          // counter for the rows that have been written
+  vtkIdType Target;         // number of rows per progress step
+};
+
+//----------------------------------------------------------------------------
+bool vtkNIFTIWriter::Internals::Seek(vtkTypeInt64 offset)
+{
+  if (offset == this->Position)
+  {
+    return true;
+  }
+
+  // only uncompressed files allow seeking
+  FILE *fp = this->GetRawFile();
+  if (fp == nullptr)
+  {
+    return false;
+  }
+
+  offset += this->DataOffset;
+#ifdef _WIN32
+  int code = _fseeki64(fp, offset, SEEK_SET);
+#else
+  int code = fseeko(fp, static_cast<off_t>(offset), SEEK_SET);
+#endif
+  if (code != 0)
+  {
+    return false;
+  }
+
+  this->Position = offset - this->DataOffset;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkNIFTIWriter::Internals::Write(const void *data, size_t size)
+{
+  size_t bytesWritten = 0;
+  FILE *fp = this->GetRawFile();
+  if (fp)
+  {
+    bytesWritten = fwrite(data, 1, size, fp);
+  }
+  else
+  {
+    int code = gzwrite(this->File, data, static_cast<unsigned int>(size));
+    bytesWritten = (code < 0 ? 0 : code);
+  }
+  this->Position += bytesWritten;
+  return (bytesWritten == size);
+}
+
 //----------------------------------------------------------------------------
 vtkNIFTIWriter::vtkNIFTIWriter()
 {
@@ -90,6 +180,9 @@ vtkNIFTIWriter::vtkNIFTIWriter()
   // Planar RGB (NIFTI doesn't allow this, it's here for Analyze)
   this->PlanarRGB = false;
   this->DataByteOrder = LittleEndian;
+  this->Streaming = 0;
+  this->SlicesPerChunk = 16;
+  this->Internal = new Internals;
 }
 
 //----------------------------------------------------------------------------
@@ -112,6 +205,7 @@ vtkNIFTIWriter::~vtkNIFTIWriter()
     this->NIFTIHeader->Delete();
   }
   delete [] this->Description;
+  delete this->Internal;
 }
 
 //----------------------------------------------------------------------------
@@ -175,6 +269,8 @@ void vtkNIFTIWriter::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "DataByteOrder: "
      << ((this->DataByteOrder == BigEndian) ?
          "BigEndian\n" : "LittleEndian\n");
+  os << indent << "Streaming: " << (this->Streaming ? "On\n" : "Off\n");
+  os << indent << "SlicesPerChunk: " << this->SlicesPerChunk << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -603,14 +699,77 @@ int vtkNIFTIWriter::GenerateHeader(vtkInformation *info, bool singleFile)
   return 1;
 }
 
+//----------------------------------------------------------------------------
+void vtkNIFTIWriter::Write()
+{
+  if (!this->Streaming)
+  {
+    this->Superclass::Write();
+    return;
+  }
+
+  if (this->GetNumberOfInputConnections(0) == 0)
+  {
+    vtkErrorMacro("No input provided!");
+    return;
+  }
+
+  // call Modified to force update to execute
+  this->Modified();
+  this->UpdateInformation();
+  vtkInformation* inInfo = this->GetExecutive()->GetInputInformation(0, 0);
+  int wholeExtent[6];
+  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), wholeExtent);
+
+  // write the header, and keep the file open while the slices are written
+  int chunkSize = (this->SlicesPerChunk > 0 ? this->SlicesPerChunk : 1);
+  bool streaming = (chunkSize <= wholeExtent[5] - wholeExtent[4]);
+  if (!this->OpenFile(inInfo, streaming))
+  {
+    return;
+  }
+
+  // go through the slices in the order in which they are stored in the
+  // file, so that compressed files can be written sequentially
+  bool reverse = (this->QFac < 0);
+  int numChunks = (wholeExtent[5] - wholeExtent[4])/chunkSize + 1;
+  for (int i = 0; i < numChunks; i++)
+  {
+    int extent[6] = {
+      wholeExtent[0], wholeExtent[1],
+      wholeExtent[2], wholeExtent[3],
+      wholeExtent[4] + i*chunkSize,
+      wholeExtent[4] + i*chunkSize + chunkSize - 1
+    };
+    if (reverse)
+    {
+      extent[4] = wholeExtent[5] - i*chunkSize - chunkSize + 1;
+      extent[5] = wholeExtent[5] - i*chunkSize;
+    }
+    extent[4] = (extent[4] > wholeExtent[4] ? extent[4] : wholeExtent[4]);
+    extent[5] = (extent[5] < wholeExtent[5] ? extent[5] : wholeExtent[5]);
+
+    // set the update extent to the chunk
+    this->Modified();
+    inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
+                extent, 6);
+    this->Update();
+
+    if (this->ErrorCode || this->AbortExecute)
+    {
+      break;
+    }
+  }
+
+  this->CloseFile();
+}
+
 //----------------------------------------------------------------------------
 int vtkNIFTIWriter::RequestData(
   vtkInformation* vtkNotUsed(request),
   vtkInformationVector** inputVector,
   vtkInformationVector* vtkNotUsed(outputVector))
 {
-  this->SetErrorCode(vtkErrorCode::NoError);
-
   vtkInformation *info = inputVector[0]->GetInformationObject(0);
   vtkImageData *data =
     vtkImageData::SafeDownCast(info->Get(vtkDataObject::DATA_OBJECT()));
@@ -621,6 +780,30 @@ int vtkNIFTIWriter::RequestData(
     return 0;
   }
 
+  // check whether the file was already opened by Write(), for streaming
+  bool isOpen = (this->Internal->File || this->Internal->UFile);
+  if (!isOpen && !this->OpenFile(info, false))
+  {
+    return 0;
+  }
+
+  int extent[6];
+  info->Get(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), extent);
+  this->WriteData(data, extent);
+
+  if (!isOpen)
+  {
+    this->CloseFile();
+  }
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkNIFTIWriter::OpenFile(vtkInformation *info, bool streaming)
+{
+  this->SetErrorCode(vtkErrorCode::NoError);
+
   const char *filename = this->GetFileName();
   if (filename == nullptr)
   {
@@ -716,10 +899,26 @@ int vtkNIFTIWriter::RequestData(
         extent[5] - extent[4] + 1 > VTK_SHORT_MAX)
     {
       vtkErrorMacro("Image too large to store in NIFTI-1 format");
+      delete [] hdrname;
+      delete [] imgname;
       return 0;
     }
   }
 
+  // check if planar RGB is applicable (Analyze only)
+  bool planarRGB = (this->PlanarRGB &&
+                    (this->OwnHeader->GetDataType() == NIFTI_TYPE_RGB24 ||
+                     this->OwnHeader->GetDataType() == NIFTI_TYPE_RGBA32));
+  int planarSize = 1;
+  if (planarRGB)
+  {
+    planarSize = (this->OwnHeader->GetDataType() == NIFTI_TYPE_RGB24 ? 3 : 4);
+  }
+  int outSizeY = static_cast<int>(this->OwnHeader->GetDim(2));
+  int outSizeZ = static_cast<int>(this->OwnHeader->GetDim(3));
+  int timeDim = static_cast<int>(this->OwnHeader->GetDim(4));
+  int vectorDim = static_cast<int>(this->OwnHeader->GetDim(5));
+
 #ifdef _WIN32
   vtkDICOMFilePath fph(hdrname);
   vtkDICOMFilePath fpi(imgname);
@@ -780,6 +979,7 @@ int vtkNIFTIWriter::RequestData(
     this->SetErrorCode(vtkErrorCode::OutOfDiskSpaceError);
   }
 
+  vtkTypeInt64 dataOffset = 0;
   if (singleFile && !this->ErrorCode)
   {
     // write the padding between the header and the image to the .nii file
@@ -801,6 +1001,7 @@ int vtkNIFTIWriter::RequestData(
     {
       this->SetErrorCode(vtkErrorCode::OutOfDiskSpaceError);
     }
+    dataOffset = static_cast<vtkTypeInt64>(hdrsize + padsize);
   }
   else if (!this->ErrorCode)
   {
@@ -815,28 +1016,97 @@ int vtkNIFTIWriter::RequestData(
       fclose(ufile);
       ufile = fopen(uimgname, NIFTI_FILE_MODE);
     }
+    if (!file && !ufile)
+    {
+      vtkErrorMacro("Cannot open file " << imgname);
+      this->SetErrorCode(vtkErrorCode::CannotOpenFileError);
+    }
   }
 
-  if (!file && !ufile)
+  Internals *internal = this->Internal;
+  internal->File = file;
+  internal->UFile = ufile;
+  internal->HdrName = hdrname;
+  internal->ImgName = imgname;
+  internal->IsCompressed = isCompressed;
+  internal->SingleFile = singleFile;
+  internal->SwapBytes = swapBytes;
+  internal->DataOffset = dataOffset;
+  internal->Position = 0;
+  for (int i = 0; i < 6; i++)
   {
-    vtkErrorMacro("Cannot open file " << imgname);
-    this->SetErrorCode(vtkErrorCode::CannotOpenFileError);
+    internal->WholeExtent[i] = extent[i];
+  }
+
+  // report progress every 2% of the way to completion
+  internal->Count = 0;
+  internal->Target = static_cast<vtkIdType>(
+    0.02*planarSize*outSizeY*outSizeZ*vectorDim*timeDim) + 1;
+
+  // if the chunks of slices for each vector component (or time point)
+  // will not be written in file order, then compressed data must first
+  // be written to an uncompressed temporary file
+  if (streaming && isCompressed && vectorDim*timeDim > 1 &&
+      !this->ErrorCode)
+  {
+    internal->TempName = imgname;
+    internal->TempName += ".tmp";
+#ifdef _WIN32
+    vtkDICOMFilePath fpt(internal->TempName);
+#if VTK_MAJOR_VERSION < 7
+    const char *utempname = fpt.Local();
+#else
+    const wchar_t *utempname = fpt.Wide();
+#endif
+#else
+    const char *utempname = internal->TempName.c_str();
+#endif
+    if (utempname)
+    {
+      internal->TempFile = fopen(utempname, NIFTI_TEMP_FILE_MODE);
+    }
+    // the temporary file holds only the image data
+    internal->DataOffset = 0;
+    if (!internal->TempFile)
+    {
+      vtkErrorMacro("Cannot open file " << internal->TempName);
+      this->SetErrorCode(vtkErrorCode::CannotOpenFileError);
+    }
+  }
+
+  if (this->ErrorCode)
+  {
+    this->CloseFile();
+    return 0;
+  }
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkNIFTIWriter::WriteData(vtkImageData *data, int extent[6])
+{
+  Internals *internal = this->Internal;
+  if (this->ErrorCode)
+  {
+    return;
   }
 
   // write the image
   unsigned char *dataPtr =
-    static_cast<unsigned char *>(data->GetScalarPointer());
+    static_cast<unsigned char *>(data->GetScalarPointerForExtent(extent));
 
   // check if planar RGB is applicable (Analyze only)
   bool planarRGB = (this->PlanarRGB &&
                     (this->OwnHeader->GetDataType() == NIFTI_TYPE_RGB24 ||
                      this->OwnHeader->GetDataType() == NIFTI_TYPE_RGBA32));
 
+  int swapBytes = internal->SwapBytes;
   int scalarSize = data->GetScalarSize();
   int numComponents = data->GetNumberOfScalarComponents();
   int outSizeX = static_cast<int>(this->OwnHeader->GetDim(1));
   int outSizeY = static_cast<int>(this->OwnHeader->GetDim(2));
-  int outSizeZ = static_cast<int>(this->OwnHeader->GetDim(3));
+  int outSizeZ = extent[5] - extent[4] + 1;
   int timeDim = static_cast<int>(this->OwnHeader->GetDim(4));
   int vectorDim = static_cast<int>(this->OwnHeader->GetDim(5));
 
@@ -882,105 +1152,104 @@ int vtkNIFTIWriter::RequestData(
     planarEndOffset = planarOffset - scalarSize*(planarSize - 1);
   }
 
-  // report progress every 2% of the way to completion
-  vtkIdType target =
-    static_cast<vtkIdType>(0.02*planarSize*outSizeY*outSizeZ*vectorDim) + 1;
-  vtkIdType count = 0;
+  // the position of this chunk of slices within each volume of the file
+  const int *wholeExtent = internal->WholeExtent;
+  vtkTypeInt64 fileSliceSize = fileVoxelIncr*planarSize;
+  fileSliceSize *= outSizeX;
+  fileSliceSize *= outSizeY;
+  vtkTypeInt64 fileVolumeSize =
+    fileSliceSize*(wholeExtent[5] - wholeExtent[4] + 1);
+  vtkTypeInt64 fileChunkOffset = fileSliceSize*(this->QFac < 0 ?
+    wholeExtent[5] - extent[5] : extent[4] - wholeExtent[4]);
 
   // write the data one row at a time, do planar-to-packed conversion
   // of vector components if NIFTI file has a vector dimension
   int rowSize = fileVoxelIncr/scalarSize*outSizeX;
-  int c = 0; // counter for vector components
-  int j = 0; // counter for rows
-  int p = 0; // counter for planes (planar RGB)
-  int k = 0; // counter for slices
   int t = 0; // counter for time
 
-  unsigned char *ptr = dataPtr;
-
-  while (!this->AbortExecute && !this->ErrorCode)
+  for (int c = 0; c < vectorDim && !this->ErrorCode; c++)
   {
-    if (vectorDim == 1 && !planarRGB && !swapBytes)
-    {
-      // write directly from input, instead of using a buffer
-      rowBuffer = ptr;
-      ptr += outSizeX*numComponents*scalarSize;
-    }
-    else
-    {
-      // create a vector plane from packed vector components
-      unsigned char *tmpPtr = rowBuffer;
-      z_off_t skipOther = scalarSize*numComponents - fileVoxelIncr;
-      for (int i = 0; i < outSizeX; i++)
-      {
-        // write one vector component of one voxel
-        z_off_t nn = fileVoxelIncr;
-        do { *tmpPtr++ = *ptr++; } while (--nn);
-        // skip past the other components
-        ptr += skipOther;
-      }
-    }
-
-    if (swapBytes != 0 && scalarSize > 1)
+    if (this->AbortExecute)
     {
-      vtkByteSwap::SwapVoidRange(rowBuffer, rowSize, scalarSize);
+      break;
     }
 
-    if (isCompressed)
+    // go to the position of this chunk within the volume
+    if (!internal->Seek(c*fileVolumeSize + fileChunkOffset))
     {
-      int code = gzwrite(file, rowBuffer, rowSize*scalarSize);
-      bytesWritten = (code < 0 ? 0 : code);
-    }
-    else
-    {
-      bytesWritten = fwrite(rowBuffer, scalarSize, rowSize, ufile)*scalarSize;
-    }
-    if (bytesWritten < static_cast<size_t>(rowSize*scalarSize))
-    {
-      this->SetErrorCode(vtkErrorCode::OutOfDiskSpaceError);
+      vtkErrorMacro("Unable to seek within file " << internal->ImgName);
+      this->SetErrorCode(vtkErrorCode::UnknownError);
       break;
     }
 
-    if (++count % target == 0)
+    // back up the ptr to the beginning of the image,
+    // then increment to the next vector component
+    unsigned char *ptr = dataPtr + c*fileVoxelIncr*planarSize;
+
+    if (timeDim > 1)
     {
-      this->UpdateProgress(0.02*count/target);
+      // if timeDim is included in the vectorDim (and hence in the
+      // VTK scalar components) then we have to make sure that
+      // the vector components are packed before the time steps
+      ptr = dataPtr + (c + t*(vectorDim - 1))/timeDim*
+                       fileVoxelIncr*planarSize;
     }
 
-    if (++j == outSizeY)
+    for (int k = 0; k < outSizeZ && !this->ErrorCode; k++)
     {
-      j = 0;
-      // back up for next plane (R, G, or B) if planar mode
-      ptr -= planarOffset;
-      if (++p == planarSize)
+      for (int p = 0; p < planarSize && !this->ErrorCode; p++)
       {
-        p = 0;
-        ptr += planarEndOffset; // advance to start of next slice
-        ptr -= 2*sliceOffset; // for reverse slice order
-        if (++k == outSizeZ)
+        for (int j = 0; j < outSizeY && !this->AbortExecute; j++)
         {
-          k = 0;
-          if (++t == timeDim)
+          if (vectorDim == 1 && !planarRGB && !swapBytes)
           {
-            t = 0;
+            // write directly from input, instead of using a buffer
+            rowBuffer = ptr;
+            ptr += outSizeX*numComponents*scalarSize;
           }
-          if (++c == vectorDim)
+          else
           {
+            // create a vector plane from packed vector components
+            unsigned char *tmpPtr = rowBuffer;
+            z_off_t skipOther = scalarSize*numComponents - fileVoxelIncr;
+            for (int i = 0; i < outSizeX; i++)
+            {
+              // write one vector component of one voxel
+              z_off_t nn = fileVoxelIncr;
+              do { *tmpPtr++ = *ptr++; } while (--nn);
+              // skip past the other components
+              ptr += skipOther;
+            }
+          }
+
+          if (swapBytes != 0 && scalarSize > 1)
+          {
+            vtkByteSwap::SwapVoidRange(rowBuffer, rowSize, scalarSize);
+          }
+
+          if (!internal->Write(rowBuffer, rowSize*scalarSize))
+          {
+            this->SetErrorCode(vtkErrorCode::OutOfDiskSpaceError);
             break;
           }
-          // back up the ptr to the beginning of the image,
-          // then increment to the next vector component
-          ptr = dataPtr + c*fileVoxelIncr*planarSize;
 
-          if (timeDim > 1)
+          if (++internal->Count % internal->Target == 0)
           {
-            // if timeDim is included in the vectorDim (and hence in the
-            // VTK scalar components) then we have to make sure that
-            // the vector components are packed before the time steps
-            ptr = dataPtr + (c + t*(vectorDim - 1))/timeDim*
-                             fileVoxelIncr*planarSize;
+            this->UpdateProgress(0.02*internal->Count/internal->Target);
           }
         }
+
+        // back up for next plane (R, G, or B) if planar mode
+        ptr -= planarOffset;
       }
+
+      ptr += planarEndOffset; // advance to start of next slice
+      ptr -= 2*sliceOffset; // for reverse slice order
+    }
+
+    if (++t == timeDim)
+    {
+      t = 0;
     }
   }
 
@@ -988,22 +1257,64 @@ int vtkNIFTIWriter::RequestData(
   {
     delete [] rowBuffer;
   }
+}
 
-  if (isCompressed)
+//----------------------------------------------------------------------------
+void vtkNIFTIWriter::CloseFile()
+{
+  Internals *internal = this->Internal;
+
+  if (internal->TempFile)
   {
-    gzclose(file);
+    // compress the temporary file into the output file
+    FILE *tfile = internal->TempFile;
+    internal->TempFile = nullptr;
+    if (!this->ErrorCode && !this->AbortExecute)
+    {
+      const size_t bufferSize = 1048576;
+      unsigned char *buffer = new unsigned char[bufferSize];
+      fflush(tfile);
+      rewind(tfile);
+      size_t bytesRead;
+      while ((bytesRead = fread(buffer, 1, bufferSize, tfile)) > 0)
+      {
+        if (!internal->Write(buffer, bytesRead))
+        {
+          this->SetErrorCode(vtkErrorCode::OutOfDiskSpaceError);
+          break;
+        }
+      }
+      if (ferror(tfile))
+      {
+        vtkErrorMacro("Error reading file " << internal->TempName);
+        this->SetErrorCode(vtkErrorCode::UnknownError);
+      }
+      delete [] buffer;
+    }
+    fclose(tfile);
+    vtkDICOMFile::Remove(internal->TempName.c_str());
   }
-  else
+
+  if (internal->File)
   {
-    fclose(ufile);
+    gzclose(internal->File);
   }
+  if (internal->UFile)
+  {
+    fclose(internal->UFile);
+  }
+  internal->File = nullptr;
+  internal->UFile = nullptr;
+
+  const char *hdrname = internal->HdrName;
+  const char *imgname = internal->ImgName;
 
   if (this->ErrorCode == vtkErrorCode::OutOfDiskSpaceError)
   {
     // erase the file, rather than leave a corrupt file on disk
     vtkErrorMacro("Out of disk space, removing incomplete file " << imgname);
     vtkDICOMFile::Remove(imgname);
-    if (!singleFile)
+    if (!internal->SingleFile)
     {
       vtkDICOMFile::Remove(hdrname);
     }
@@ -1012,8 +1323,8 @@ int vtkNIFTIWriter::RequestData(
   this->UpdateProgress(1.0);
   this->InvokeEvent(vtkCommand::EndEvent);
 
-  delete [] hdrname;
-  delete [] imgname;
-
-  return 1;
+  delete [] internal->HdrName;
+  delete [] internal->ImgName;
+  internal->HdrName = nullptr;
+  internal->ImgName = nullptr;
 }
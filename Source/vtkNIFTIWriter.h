@@ -42,6 +42,7 @@
 VTK_ABI_NAMESPACE_BEGIN
 #endif
 
+class vtkImageData;
 class vtkMatrix4x4;
 
 #if defined(VTK_ABI_NAMESPACE_BEGIN)
@@ -189,6 +190,32 @@ public:
   vtkGetMacro(DataByteOrder, EndianEnum);
   //@}
 
+  //@{
+  //! Turn on streaming, to pass a chunk of slices at a time to the writer.
+  /*!
+   *  Streaming decreases memory usage for images with a large number of
+   *  slices, since only one chunk of slices will have to be in memory at
+   *  a time.  The slices are requested in the same order as they are
+   *  stored in the file, and are written as soon as they are received.
+   *  If the file is compressed and the image has more than one time point
+   *  or vector component, then the image data is written to a temporary
+   *  file next to the output file, and compressed after the last chunk
+   *  has been received.
+   */
+  vtkSetMacro(Streaming, int);
+  vtkGetMacro(Streaming, int);
+  vtkBooleanMacro(Streaming, int);
+  //@}
+
+  //@{
+  //! Set the number of slices per chunk, if Streaming is on (default: 16).
+  vtkSetMacro(SlicesPerChunk, int);
+  vtkGetMacro(SlicesPerChunk, int);
+  //@}
+
+  //! Write the file (this will stream the slices if Streaming is on).
+  void Write() VTK_DICOM_OVERRIDE;
+
 protected:
   vtkNIFTIWriter();
   ~vtkNIFTIWriter() VTK_DICOM_OVERRIDE;
@@ -196,6 +223,20 @@ protected:
   //! Generate the header information for the file.
   int GenerateHeader(vtkInformation *info, bool singleFile);
 
+  //! Open the file and write the header.
+  /*!
+   *  If streaming is true, then the image data will be written in chunks
+   *  of slices via WriteData(), rather than being written all at once.
+   *  The return value is zero if an error occurred.
+   */
+  int OpenFile(vtkInformation *info, bool streaming);
+
+  //! Write the slices within the given extent to the file.
+  void WriteData(vtkImageData *data, int extent[6]);
+
+  //! Finish writing the file, and close it.
+  void CloseFile();
+
   //! The main execution method, which writes the file.
   int RequestData(vtkInformation *request,
                   vtkInformationVector** inputVector,
@@ -239,7 +280,14 @@ protected:
   //! Whether the file should be little endian.
   EndianEnum DataByteOrder;
 
+  //! Whether to stream the data, and the number of slices per chunk.
+  int Streaming;
+  int SlicesPerChunk;
+
 private:
+  class Internals;
+  Internals *Internal;
+
 #ifdef VTK_DICOM_DELETE
   vtkNIFTIWriter(const vtkNIFTIWriter&) VTK_DICOM_DELETE;
   void operator=(const vtkNIFTIWriter&) VTK_DICOM_DELETE;
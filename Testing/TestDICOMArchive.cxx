@@ -0,0 +1,431 @@
+#include "vtkDICOMArchive.h"
+#include "vtkDICOMFile.h"
+#include "vtkDICOMFileDirectory.h"
+#include "vtkDICOMFilePath.h"
+#include "vtkDICOMStream.h"
+
+#include <string>
+#include <vector>
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+// macro for performing tests
+#define TestAssert(t) \
+if (!(t)) \
+{ \
+  cout << exename << ": Assertion Failed: " << #t << "\n"; \
+  cout << __FILE__ << ":" << __LINE__ << "\n"; \
+  cout.flush(); \
+  rval |= 1; \
+}
+
+typedef std::vector<unsigned char> Bytes;
+
+// create some data to store in the archives
+static Bytes MakeData(size_t n, int seed)
+{
+  Bytes data(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    data[i] = static_cast<unsigned char>((i*7 + seed) % 251);
+  }
+  return data;
+}
+
+// write an archive to a file
+static bool WriteBytes(const std::string& fname, const Bytes& data)
+{
+  vtkDICOMFile f(fname.c_str(), vtkDICOMFile::Out);
+  bool success = (f.GetError() == 0 &&
+                  f.Write(&data[0], data.size()) == data.size());
+  f.Close();
+  return success;
+}
+
+// read a member of an archive into memory
+static bool ReadMember(vtkDICOMStream *stream, Bytes *data)
+{
+  data->clear();
+  if (stream == nullptr)
+  {
+    return false;
+  }
+  unsigned char buffer[1000];
+  size_t n;
+  while ((n = stream->Read(buffer, sizeof(buffer))) != 0)
+  {
+    data->insert(data->end(), buffer, buffer + n);
+  }
+  bool success = !stream->GetError();
+  delete stream;
+  return success;
+}
+
+//----------------------------------------------------------------------------
+// Zip files
+
+static unsigned int ComputeCRC32(const Bytes& data)
+{
+  unsigned int crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < data.size(); i++)
+  {
+    crc ^= data[i];
+    for (int j = 0; j < 8; j++)
+    {
+      crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+  }
+  return ~crc;
+}
+
+static void AddLE16(Bytes *b, unsigned int v)
+{
+  b->push_back(static_cast<unsigned char>(v));
+  b->push_back(static_cast<unsigned char>(v >> 8));
+}
+
+static void AddLE32(Bytes *b, unsigned int v)
+{
+  AddLE16(b, v & 0xFFFF);
+  AddLE16(b, v >> 16);
+}
+
+// deflate the data with uncompressed blocks, so zlib is not needed
+static Bytes DeflateStored(const Bytes& data)
+{
+  Bytes result;
+  size_t pos = 0;
+  do
+  {
+    size_t n = data.size() - pos;
+    n = (n < 65535 ? n : 65535);
+    bool last = (pos + n == data.size());
+    result.push_back(last ? 1 : 0);
+    AddLE16(&result, static_cast<unsigned int>(n));
+    AddLE16(&result, static_cast<unsigned int>(~n & 0xFFFF));
+    result.insert(result.end(), data.begin() + pos, data.begin() + pos + n);
+    pos += n;
+  }
+  while (pos < data.size());
+  return result;
+}
+
+// build a zip file from a list of names and data
+static Bytes BuildZip(const std::vector<std::string>& names,
+                      const std::vector<Bytes>& members, bool deflate)
+{
+  Bytes zip;
+  Bytes directory;
+  for (size_t i = 0; i < names.size(); i++)
+  {
+    const Bytes& data = members[i];
+    Bytes stored = (deflate ? DeflateStored(data) : data);
+    unsigned int method = (deflate ? 8 : 0);
+    unsigned int crc = ComputeCRC32(data);
+    unsigned int offset = static_cast<unsigned int>(zip.size());
+    unsigned int nl = static_cast<unsigned int>(names[i].length());
+
+    AddLE32(&zip, 0x04034b50);
+    AddLE16(&zip, 20);
+    AddLE16(&zip, 0);
+    AddLE16(&zip, method);
+    AddLE32(&zip, 0);
+    AddLE32(&zip, crc);
+    AddLE32(&zip, static_cast<unsigned int>(stored.size()));
+    AddLE32(&zip, static_cast<unsigned int>(data.size()));
+    AddLE16(&zip, nl);
+    AddLE16(&zip, 0);
+    zip.insert(zip.end(), names[i].begin(), names[i].end());
+    zip.insert(zip.end(), stored.begin(), stored.end());
+
+    AddLE32(&directory, 0x02014b50);
+    AddLE16(&directory, 20);
+    AddLE16(&directory, 20);
+    AddLE16(&directory, 0);
+    AddLE16(&directory, method);
+    AddLE32(&directory, 0);
+    AddLE32(&directory, crc);
+    AddLE32(&directory, static_cast<unsigned int>(stored.size()));
+    AddLE32(&directory, static_cast<unsigned int>(data.size()));
+    AddLE16(&directory, nl);
+    AddLE16(&directory, 0);
+    AddLE16(&directory, 0);
+    AddLE16(&directory, 0);
+    AddLE16(&directory, 0);
+    AddLE32(&directory, 0);
+    AddLE32(&directory, offset);
+    directory.insert(directory.end(), names[i].begin(), names[i].end());
+  }
+
+  unsigned int cdOffset = static_cast<unsigned int>(zip.size());
+  zip.insert(zip.end(), directory.begin(), directory.end());
+  AddLE32(&zip, 0x06054b50);
+  AddLE16(&zip, 0);
+  AddLE16(&zip, 0);
+  AddLE16(&zip, static_cast<unsigned int>(names.size()));
+  AddLE16(&zip, static_cast<unsigned int>(names.size()));
+  AddLE32(&zip, static_cast<unsigned int>(directory.size()));
+  AddLE32(&zip, cdOffset);
+  AddLE16(&zip, 0);
+
+  return zip;
+}
+
+//----------------------------------------------------------------------------
+// Tar files
+
+// add a header block and the data blocks for one tar entry
+static void AddTarEntry(Bytes *tar, const std::string& name, char type,
+                        const Bytes& data, const std::string& prefix = "")
+{
+  char h[512];
+  memset(h, 0, sizeof(h));
+  strncpy(h, name.c_str(), 100);
+  snprintf(h + 100, 8, "%07o", 0644);
+  snprintf(h + 108, 8, "%07o", 0);
+  snprintf(h + 116, 8, "%07o", 0);
+  snprintf(h + 124, 12, "%011o", static_cast<unsigned int>(data.size()));
+  snprintf(h + 136, 12, "%011o", 0);
+  memset(h + 148, ' ', 8);
+  h[156] = type;
+  memcpy(h + 257, "ustar", 6);
+  memcpy(h + 263, "00", 2);
+  strncpy(h + 345, prefix.c_str(), 155);
+
+  unsigned int checksum = 0;
+  for (int i = 0; i < 512; i++)
+  {
+    checksum += static_cast<unsigned char>(h[i]);
+  }
+  snprintf(h + 148, 8, "%06o", checksum);
+  h[155] = ' ';
+
+  tar->insert(tar->end(), h, h + 512);
+  tar->insert(tar->end(), data.begin(), data.end());
+  tar->resize((tar->size() + 511)/512*512, 0);
+}
+
+// add the blocks of zeros that end a tar file
+static void EndTar(Bytes *tar)
+{
+  tar->resize(tar->size() + 1024, 0);
+}
+
+// make a pax record, "length key=value\n"
+static std::string PaxRecord(const std::string& key, const std::string& value)
+{
+  // the length includes the digits of the length itself
+  std::string text = " " + key + "=" + value + "\n";
+  size_t n = text.length();
+  char digits[32];
+  do
+  {
+    snprintf(digits, sizeof(digits), "%u", static_cast<unsigned int>(++n));
+  }
+  while (strlen(digits) + text.length() != n);
+  return digits + text;
+}
+
+static Bytes ToBytes(const std::string& s)
+{
+  return Bytes(s.begin(), s.end());
+}
+
+//----------------------------------------------------------------------------
+int TestDICOMArchive(int argc, char *argv[])
+{
+  int rval = 0;
+  const char *exename = (argc > 0 ? argv[0] : "TestDICOMArchive");
+
+  // remove path portion of exename
+  const char *cp = exename + strlen(exename);
+  while (cp != exename && cp[-1] != '\\' && cp[-1] != '/') { --cp; }
+  exename = cp;
+
+  vtkDICOMFilePath path("TestDICOMArchive.tmp");
+  std::string dirname = path.AsString();
+  vtkDICOMFileDirectory::Create(dirname.c_str());
+  vtkDICOMArchive::ClearCache();
+
+  std::vector<std::string> files;
+  Bytes data1 = MakeData(70000, 1);
+  Bytes data2 = MakeData(1000, 2);
+  Bytes data;
+
+  for (int deflate = 0; deflate < 2; deflate++)
+  { // test stored and deflated zip files
+  std::vector<std::string> names;
+  std::vector<Bytes> members;
+  names.push_back("series1/");
+  members.push_back(Bytes());
+  names.push_back("series1/IM0001");
+  members.push_back(data1);
+  names.push_back("IM0002");
+  members.push_back(data2);
+
+  std::string fname = path.Join(deflate ? "deflated.zip" : "stored.zip");
+  files.push_back(fname);
+  TestAssert(WriteBytes(fname, BuildZip(names, members, deflate != 0)));
+
+  vtkDICOMArchive archive(fname.c_str());
+  TestAssert(archive.GetError() == vtkDICOMArchive::Good);
+  // the directory is not a member
+  TestAssert(archive.GetNumberOfMembers() == 2);
+  int i = archive.FindMember("series1/IM0001");
+  TestAssert(i >= 0);
+  if (i >= 0)
+  {
+    TestAssert(archive.GetMemberSize(i) == data1.size());
+    TestAssert(ReadMember(archive.OpenMember(i), &data));
+    TestAssert(data == data1);
+  }
+  i = archive.FindMember("IM0002");
+  TestAssert(i >= 0);
+  if (i >= 0)
+  {
+    TestAssert(ReadMember(archive.OpenMember(i), &data));
+    TestAssert(data == data2);
+  }
+  TestAssert(archive.FindMember("series1/") < 0);
+
+  // read a member via a path through the archive
+  std::string mpath = fname + "/series1/IM0001";
+  TestAssert(vtkDICOMArchive::MemberExists(mpath.c_str()));
+  TestAssert(ReadMember(vtkDICOMArchive::OpenPath(mpath.c_str()), &data));
+  TestAssert(data == data1);
+  }
+
+  { // test a ustar file with a name prefix
+  Bytes tar;
+  AddTarEntry(&tar, "series1/", '5', Bytes());
+  AddTarEntry(&tar, "IM0001", '0', data1, "study1/series1");
+  AddTarEntry(&tar, "./IM0002", '0', data2);
+  EndTar(&tar);
+
+  std::string fname = path.Join("ustar.tar");
+  files.push_back(fname);
+  TestAssert(WriteBytes(fname, tar));
+
+  vtkDICOMArchive archive(fname.c_str());
+  TestAssert(archive.GetError() == vtkDICOMArchive::Good);
+  TestAssert(archive.GetNumberOfMembers() == 2);
+  int i = archive.FindMember("study1/series1/IM0001");
+  TestAssert(i >= 0);
+  if (i >= 0)
+  {
+    TestAssert(ReadMember(archive.OpenMember(i), &data));
+    TestAssert(data == data1);
+  }
+  // the leading "./" is removed
+  i = archive.FindMember("IM0002");
+  TestAssert(i >= 0);
+  if (i >= 0)
+  {
+    TestAssert(ReadMember(archive.OpenMember(i), &data));
+    TestAssert(data == data2);
+  }
+  }
+
+  { // test GNU long names and pax paths
+  std::string longName1 = "study1/";
+  std::string longName2 = "study2/";
+  for (int j = 0; j < 20; j++)
+  {
+    longName1 += "long_directory/";
+    longName2 += "longer_directory/";
+  }
+  longName1 += "IM0001";
+  longName2 += "IM0002";
+
+  Bytes tar;
+  std::string nameData = longName1;
+  nameData.push_back('\0');
+  AddTarEntry(&tar, "././@LongLink", 'L', ToBytes(nameData));
+  AddTarEntry(&tar, "IM0001", '0', data1);
+  AddTarEntry(&tar, "PaxHeader/IM0002", 'x',
+              ToBytes(PaxRecord("path", longName2)));
+  AddTarEntry(&tar, "IM0002", '0', data2);
+  EndTar(&tar);
+
+  std::string fname = path.Join("longname.tar");
+  files.push_back(fname);
+  TestAssert(WriteBytes(fname, tar));
+
+  vtkDICOMArchive archive(fname.c_str());
+  TestAssert(archive.GetError() == vtkDICOMArchive::Good);
+  TestAssert(archive.GetNumberOfMembers() == 2);
+  int i = archive.FindMember(longName1);
+  TestAssert(i >= 0);
+  if (i >= 0)
+  {
+    TestAssert(ReadMember(archive.OpenMember(i), &data));
+    TestAssert(data == data1);
+  }
+  i = archive.FindMember(longName2);
+  TestAssert(i >= 0);
+  if (i >= 0)
+  {
+    TestAssert(ReadMember(archive.OpenMember(i), &data));
+    TestAssert(data == data2);
+  }
+  }
+
+  { // test pax headers with records that are malformed
+  const char *badRecords[] = {
+    "1 path=bad\n",                      // length too short for the record
+    "3 path=bad\n",                      // length doesn't reach the newline
+    "99 path=bad\n",                     // length exceeds the header
+    "12 path=bad ",                      // record lacks the newline
+    "11path=bad\n",                      // no space after the length
+    "000000000000000000000000000000011", // only digits
+    "99999999999999999999999999 path=bad\n", // length overflows
+    nullptr
+  };
+
+  for (int j = 0; badRecords[j] != nullptr; j++)
+  {
+    Bytes tar;
+    AddTarEntry(&tar, "PaxHeader/IM0001", 'x', ToBytes(badRecords[j]));
+    AddTarEntry(&tar, "IM0001", '0', data2);
+    EndTar(&tar);
+
+    char name[32];
+    snprintf(name, sizeof(name), "badpax%d.tar", j + 1);
+    std::string fname = path.Join(name);
+    files.push_back(fname);
+    TestAssert(WriteBytes(fname, tar));
+
+    // the bad records are ignored, and the header name is used
+    vtkDICOMArchive archive(fname.c_str());
+    TestAssert(archive.GetError() == vtkDICOMArchive::Good);
+    TestAssert(archive.GetNumberOfMembers() == 1);
+    TestAssert(archive.FindMember("bad") < 0);
+    int i = archive.FindMember("IM0001");
+    TestAssert(i >= 0);
+    if (i >= 0)
+    {
+      TestAssert(ReadMember(archive.OpenMember(i), &data));
+      TestAssert(data == data2);
+    }
+  }
+  }
+
+  vtkDICOMArchive::ClearCache();
+
+  // remove the test files
+  for (size_t i = 0; i < files.size(); i++)
+  {
+    vtkDICOMFile::Remove(files[i].c_str());
+  }
+
+  return rval;
+}
+
+#ifdef VTK_DICOM_SEPARATE_TESTS
+int main(int argc, char *argv[])
+{
+  return TestDICOMArchive(argc, argv);
+}
+#endif
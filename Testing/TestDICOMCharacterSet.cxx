@@ -886,6 +886,36 @@ int TestDICOMCharacterSet(int argc, char *argv[])
   }
   }
 
+  { // test that the expanded tables give the same results
+  const char *sets[] = {
+    "GB18030", "GBK", "big5", "euc-kr", "euc-jp", "shift_jis", nullptr
+  };
+
+  std::string bytes;
+  for (unsigned int a = 0x81; a < 0xFF; a++)
+  {
+    for (unsigned int b = 0x40; b < 0xFF; b++)
+    {
+      bytes.push_back(static_cast<char>(a));
+      bytes.push_back(static_cast<char>(b));
+    }
+  }
+
+  for (int i = 0; sets[i]; i++)
+  {
+    vtkDICOMCharacterSet cs(sets[i]);
+    vtkDICOMCharacterSet::SetUseExpandedTables(false);
+    std::string u = cs.ToUTF8(bytes);
+    std::string t = cs.FromUTF8(u);
+    vtkDICOMCharacterSet::SetUseExpandedTables(true);
+    TestAssert(cs.ToUTF8(bytes) == u);
+    TestAssert(cs.FromUTF8(u) == t);
+  }
+
+  TestAssert(vtkDICOMCharacterSet::GetExpandedTablesMemory() > 0);
+  vtkDICOMCharacterSet::SetUseExpandedTables(false);
+  }
+
   return rval;
 }
 
@@ -0,0 +1,213 @@
+#include "vtkDICOMCompiler.h"
+#include "vtkDICOMParser.h"
+#include "vtkDICOMMetaData.h"
+#include "vtkDICOMFile.h"
+#include "vtkDICOMFileDirectory.h"
+#include "vtkDICOMFilePath.h"
+
+#include <string>
+#include <vector>
+
+#include <string.h>
+#include <stdlib.h>
+
+// macro for performing tests
+#define TestAssert(t) \
+if (!(t)) \
+{ \
+  cout << exename << ": Assertion Failed: " << #t << "\n"; \
+  cout << __FILE__ << ":" << __LINE__ << "\n"; \
+  cout.flush(); \
+  rval |= 1; \
+}
+
+// the image dimensions
+const int ImageColumns = 32;
+const int ImageRows = 24;
+const int ImageFrames = 3;
+
+// create the meta data for a multi-frame image
+static vtkDICOMMetaData *CreateMetaData()
+{
+  vtkDICOMMetaData *meta = vtkDICOMMetaData::New();
+  meta->Set(DC::SOPClassUID, "1.2.840.10008.5.1.4.1.1.7.3");
+  meta->Set(DC::SOPInstanceUID, "1.2.3.4.5.6.7");
+  meta->Set(DC::Modality, "OT");
+  meta->Set(DC::PatientName, "Test^Compiler");
+  meta->Set(DC::PatientID, "P001");
+  meta->Set(DC::StudyInstanceUID, "1.2.3.4.5");
+  meta->Set(DC::SeriesInstanceUID, "1.2.3.4.5.6");
+  meta->Set(DC::NumberOfFrames, ImageFrames);
+  meta->Set(DC::SamplesPerPixel, 1);
+  meta->Set(DC::PhotometricInterpretation, "MONOCHROME2");
+  meta->Set(DC::Rows, ImageRows);
+  meta->Set(DC::Columns, ImageColumns);
+  meta->Set(DC::BitsAllocated, 16);
+  meta->Set(DC::BitsStored, 12);
+  meta->Set(DC::HighBit, 11);
+  meta->Set(DC::PixelRepresentation, 0);
+  unsigned short empty = 0;
+  meta->Set(DC::PixelData, vtkDICOMValue(vtkDICOMVR::OW, &empty, 0));
+  return meta;
+}
+
+// write the image one frame at a time
+static bool WriteImage(
+  const std::string& fname, const char *syntax, vtkDICOMMetaData *meta,
+  const std::vector<unsigned short>& pixels)
+{
+  size_t frameSize = ImageColumns*ImageRows;
+  vtkDICOMCompiler *compiler = vtkDICOMCompiler::New();
+  compiler->SetFileName(fname.c_str());
+  compiler->SetTransferSyntaxUID(syntax);
+  compiler->SetSOPInstanceUID("1.2.3.4.5.6.7");
+  compiler->SetSeriesInstanceUID("1.2.3.4.5.6");
+  compiler->SetStudyInstanceUID("1.2.3.4.5");
+  compiler->SetMetaData(meta);
+  compiler->WriteHeader();
+  for (int i = 0; i < ImageFrames; i++)
+  {
+    compiler->WriteFrame(
+      reinterpret_cast<const unsigned char *>(&pixels[i*frameSize]),
+      frameSize*sizeof(unsigned short));
+  }
+  compiler->Close();
+  bool success = (compiler->GetErrorCode() == 0);
+  compiler->Delete();
+  return success;
+}
+
+// read the meta data, and the raw bytes from the PixelData onwards
+static bool ReadImage(
+  const std::string& fname, vtkDICOMMetaData *meta, vtkTypeInt64 *offset,
+  unsigned int *vl, std::vector<unsigned char> *data)
+{
+  vtkDICOMParser *parser = vtkDICOMParser::New();
+  parser->SetMetaData(meta);
+  parser->SetFileName(fname.c_str());
+  parser->Update();
+  bool success = (parser->GetErrorCode() == 0 &&
+                  parser->GetPixelDataFound());
+  *offset = parser->GetFileOffset();
+  *vl = parser->GetPixelDataVL();
+  parser->Delete();
+
+  data->clear();
+  if (success)
+  {
+    vtkDICOMFile infile(fname.c_str(), vtkDICOMFile::In);
+    size_t size = static_cast<size_t>(infile.GetSize() - *offset);
+    data->resize(size);
+    success = (infile.SetPosition(*offset) && size > 0 &&
+               infile.Read(&(*data)[0], size) == size);
+    infile.Close();
+  }
+
+  return success;
+}
+
+// test rewriting a header, while copying the pixel data from the source
+static int TestPixelDataSource(const char *exename, const std::string& dir)
+{
+  int rval = 0;
+
+  vtkDICOMFilePath path(dir);
+  std::string source = path.Join("source.dcm");
+  std::string target = path.Join("target.dcm");
+
+  std::vector<unsigned short> pixels(ImageColumns*ImageRows*ImageFrames);
+  for (size_t i = 0; i < pixels.size(); i++)
+  {
+    pixels[i] = static_cast<unsigned short>((i*7) % 4096);
+  }
+
+  // try native and encapsulated data, and copy with a tiny buffer
+  static const char *const syntaxes[] = {
+    "1.2.840.10008.1.2.1", // explicit little endian
+    "1.2.840.10008.1.2.2", // explicit big endian
+    "1.2.840.10008.1.2.5", // RLE
+    nullptr
+  };
+
+  for (int k = 0; syntaxes[k] != nullptr; k++)
+  {
+    vtkDICOMMetaData *meta = CreateMetaData();
+    TestAssert(WriteImage(source, syntaxes[k], meta, pixels));
+    meta->Delete();
+
+    vtkTypeInt64 offset = 0;
+    unsigned int sourceVL = 0;
+    std::vector<unsigned char> sourceData;
+    vtkDICOMMetaData *sourceMeta = vtkDICOMMetaData::New();
+    TestAssert(ReadImage(source, sourceMeta, &offset, &sourceVL, &sourceData));
+    TestAssert((k == 2) == (sourceVL == 0xffffffffu));
+
+    // change the header, and copy the pixel data
+    sourceMeta->Set(DC::PatientName, "Anonymous^Longer^Name");
+    sourceMeta->Erase(DC::PatientID);
+    vtkDICOMCompiler *compiler = vtkDICOMCompiler::New();
+    compiler->SetFileName(target.c_str());
+    compiler->SetTransferSyntaxUID(syntaxes[k]);
+    compiler->SetSOPInstanceUID("1.2.3.4.5.6.7");
+    compiler->SetSeriesInstanceUID("1.2.3.4.5.6");
+    compiler->SetStudyInstanceUID("1.2.3.4.5");
+    compiler->SetBufferSize(256);
+    compiler->SetMetaData(sourceMeta);
+    compiler->SetPixelDataSource(source.c_str(), offset, sourceVL);
+    compiler->WriteHeader();
+    compiler->Close();
+    TestAssert(compiler->GetErrorCode() == 0);
+    compiler->Delete();
+    sourceMeta->Delete();
+
+    // the pixel data must be identical, byte for byte
+    unsigned int targetVL = 0;
+    std::vector<unsigned char> targetData;
+    vtkDICOMMetaData *targetMeta = vtkDICOMMetaData::New();
+    TestAssert(ReadImage(target, targetMeta, &offset, &targetVL, &targetData));
+    TestAssert(targetMeta->Get(DC::PatientName).AsString() ==
+               "Anonymous^Longer^Name");
+    TestAssert(!targetMeta->Has(DC::PatientID));
+    TestAssert(targetMeta->Get(DC::TransferSyntaxUID).AsString() ==
+               syntaxes[k]);
+    TestAssert(targetVL == sourceVL);
+    TestAssert(targetData.size() == sourceData.size());
+    if (targetData.size() == sourceData.size() && !targetData.empty())
+    {
+      TestAssert(memcmp(&targetData[0], &sourceData[0],
+                        sourceData.size()) == 0);
+    }
+    targetMeta->Delete();
+
+    vtkDICOMFile::Remove(source.c_str());
+    vtkDICOMFile::Remove(target.c_str());
+  }
+
+  return rval;
+}
+
+int TestDICOMCompiler(int argc, char *argv[])
+{
+  int rval = 0;
+  const char *exename = (argc > 0 ? argv[0] : "TestDICOMCompiler");
+
+  // remove path portion of exename
+  const char *cp = exename + strlen(exename);
+  while (cp != exename && cp[-1] != '\\' && cp[-1] != '/') { --cp; }
+  exename = cp;
+
+  // create a directory for the test files
+  std::string dirname = "TestDICOMCompiler.tmp";
+  vtkDICOMFileDirectory::Create(dirname.c_str());
+
+  rval |= TestPixelDataSource(exename, dirname);
+
+  return rval;
+}
+
+#ifdef VTK_DICOM_SEPARATE_TESTS
+int main(int argc, char *argv[])
+{
+  return TestDICOMCompiler(argc, argv);
+}
+#endif
@@ -0,0 +1,518 @@
+#include "vtkDICOMDirectory.h"
+#include "vtkDICOMDirectoryWriter.h"
+#include "vtkDICOMCompiler.h"
+#include "vtkDICOMMetaData.h"
+#include "vtkDICOMItem.h"
+#include "vtkDICOMFile.h"
+#include "vtkDICOMFileDirectory.h"
+#include "vtkDICOMFilePath.h"
+#include "vtkDICOMParser.h"
+
+#include "vtkCallbackCommand.h"
+#include "vtkStringArray.h"
+
+#include <string>
+#include <vector>
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+// macro for performing tests
+#define TestAssert(t) \
+if (!(t)) \
+{ \
+  cout << exename << ": Assertion Failed: " << #t << "\n"; \
+  cout << __FILE__ << ":" << __LINE__ << "\n"; \
+  cout.flush(); \
+  rval |= 1; \
+}
+
+// the layout of the test files: the patient, study, and series of each
+static const int TestImages[][3] = {
+  { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 },
+  { 0, 0, 1 }, { 0, 0, 1 },
+  { 1, 1, 2 }, { 1, 1, 2 },
+  { 1, 2, 3 },
+  { -1, -1, -1 }
+};
+
+// the files that have no pixel data: the patient, study, and series
+static const int TestDocuments[][3] = {
+  { 1, 2, 4 }, { 1, 2, 5 },
+  { -1, -1, -1 }
+};
+
+// the SOP class, modality, and DirectoryRecordType of each document
+static const char *const TestDocumentTypes[][3] = {
+  { "1.2.840.10008.5.1.4.1.1.88.22", "SR", "SR" },
+  { "1.2.840.10008.5.1.4.1.1.88.59", "KO", "KEY OBJECT DOC" }
+};
+
+// count the test files in a series
+static int CountImages(int series)
+{
+  int n = 0;
+  for (int i = 0; TestImages[i][0] >= 0; i++)
+  {
+    n += (TestImages[i][2] == series);
+  }
+  return n;
+}
+
+// write a small CT image with the given patient, study, and series,
+// or if a document type is given, write a document with no pixel data
+static bool WriteTestFile(
+  const std::string& fname, int patient, int study, int series, int image,
+  const char *const *documentType = nullptr)
+{
+  char patientID[16];
+  char accession[16];
+  char studyUID[64];
+  char seriesUID[64];
+  char instanceUID[64];
+  snprintf(patientID, sizeof(patientID), "P%03d", patient);
+  snprintf(accession, sizeof(accession), "A%03d", study);
+  snprintf(studyUID, sizeof(studyUID), "1.2.3.4.%d", study + 1);
+  snprintf(seriesUID, sizeof(seriesUID), "1.2.3.4.%d.%d",
+           study + 1, series + 1);
+  snprintf(instanceUID, sizeof(instanceUID), "1.2.3.4.%d.%d.%d",
+           study + 1, series + 1, image + 1);
+
+  vtkDICOMMetaData *meta = vtkDICOMMetaData::New();
+  meta->Set(DC::SOPClassUID,
+            (documentType ? documentType[0] : "1.2.840.10008.5.1.4.1.1.2"));
+  meta->Set(DC::SOPInstanceUID, instanceUID);
+  meta->Set(DC::StudyDate, "20240101");
+  meta->Set(DC::Modality, (documentType ? documentType[1] : "CT"));
+  meta->Set(DC::PatientName, std::string("Test^") + patientID);
+  meta->Set(DC::PatientID, patientID);
+  meta->Set(DC::AccessionNumber, accession);
+  meta->Set(DC::StudyInstanceUID, studyUID);
+  meta->Set(DC::SeriesInstanceUID, seriesUID);
+  meta->Set(DC::StudyID, studyUID + 8);
+  meta->Set(DC::SeriesNumber, series + 1);
+  meta->Set(DC::InstanceNumber, image + 1);
+  meta->Set(DC::NumberOfSeriesRelatedInstances,
+            (documentType ? 1 : CountImages(series)));
+  if (documentType == nullptr)
+  {
+    meta->Set(DC::SamplesPerPixel, 1);
+    meta->Set(DC::PhotometricInterpretation, "MONOCHROME2");
+    meta->Set(DC::Rows, 4);
+    meta->Set(DC::Columns, 4);
+    meta->Set(DC::BitsAllocated, 16);
+    meta->Set(DC::BitsStored, 16);
+    meta->Set(DC::HighBit, 15);
+    meta->Set(DC::PixelRepresentation, 0);
+    unsigned short empty = 0;
+    meta->Set(DC::PixelData, vtkDICOMValue(vtkDICOMVR::OW, &empty, 0));
+  }
+
+  unsigned short pixels[16];
+  for (int i = 0; i < 16; i++)
+  {
+    pixels[i] = static_cast<unsigned short>(image*16 + i);
+  }
+
+  vtkDICOMCompiler *compiler = vtkDICOMCompiler::New();
+  compiler->SetFileName(fname.c_str());
+  compiler->SetTransferSyntaxUID("1.2.840.10008.1.2.1");
+  compiler->SetSOPInstanceUID(instanceUID);
+  compiler->SetSeriesInstanceUID(seriesUID);
+  compiler->SetStudyInstanceUID(studyUID);
+  compiler->SetMetaData(meta);
+  compiler->WriteHeader();
+  if (documentType == nullptr)
+  {
+    compiler->WritePixelData(
+      reinterpret_cast<const unsigned char *>(pixels), sizeof(pixels));
+  }
+  compiler->Close();
+  bool success = (compiler->GetErrorCode() == 0);
+  compiler->Delete();
+  meta->Delete();
+
+  return success;
+}
+
+// find the series with the same SeriesInstanceUID, or return -1
+static int FindSeries(vtkDICOMDirectory *dir, const vtkDICOMItem& record)
+{
+  const vtkDICOMValue& uid = record.Get(DC::SeriesInstanceUID);
+  for (int i = 0; i < dir->GetNumberOfSeries(); i++)
+  {
+    if (dir->GetSeriesRecord(i).Get(DC::SeriesInstanceUID) == uid)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// check that each file in a series has the right SOPInstanceUID
+static bool CheckInstances(vtkDICOMDirectory *dir, int i)
+{
+  std::string prefix =
+    dir->GetSeriesRecord(i).Get(DC::SeriesInstanceUID).AsString() + ".";
+  vtkDICOMMetaData *meta = dir->GetMetaDataForSeries(i);
+  int n = static_cast<int>(dir->GetNumberOfFilesForSeries(i));
+  bool success = (meta != nullptr && n > 0);
+  for (int j = 0; j < n && success; j++)
+  {
+    std::string uid = meta->Get(j, DC::SOPInstanceUID).AsString();
+    success = (uid.compare(0, prefix.length(), prefix) == 0);
+  }
+  return success;
+}
+
+// count all of the files that were found
+static int CountFiles(vtkDICOMDirectory *dir)
+{
+  int n = 0;
+  for (int i = 0; i < dir->GetNumberOfSeries(); i++)
+  {
+    n += static_cast<int>(dir->GetNumberOfFilesForSeries(i));
+  }
+  return n;
+}
+
+// count the records of the given type in a DICOMDIR
+static int CountRecords(const std::string& dicomdir, const char *type)
+{
+  vtkDICOMMetaData *meta = vtkDICOMMetaData::New();
+  vtkDICOMParser *parser = vtkDICOMParser::New();
+  parser->SetMetaData(meta);
+  parser->SetFileName(dicomdir.c_str());
+  parser->Update();
+  int n = 0;
+  const vtkDICOMValue& seq = meta->Get(DC::DirectoryRecordSequence);
+  for (size_t i = 0; i < seq.GetNumberOfValues(); i++)
+  {
+    const vtkDICOMItem& item = seq.GetSequenceData()[i];
+    n += (item.Get(DC::DirectoryRecordType).AsString() == type);
+  }
+  parser->Delete();
+  meta->Delete();
+  return n;
+}
+
+// check that two directories found the same series and files
+static bool SameSeries(vtkDICOMDirectory *dir, vtkDICOMDirectory *other)
+{
+  bool success = (dir->GetNumberOfPatients() == other->GetNumberOfPatients() &&
+                  dir->GetNumberOfStudies() == other->GetNumberOfStudies() &&
+                  dir->GetNumberOfSeries() == other->GetNumberOfSeries());
+  for (int i = 0; i < dir->GetNumberOfSeries() && success; i++)
+  {
+    int j = FindSeries(other, dir->GetSeriesRecord(i));
+    vtkStringArray *files = dir->GetFileNamesForSeries(i);
+    vtkStringArray *otherFiles = (j >= 0 ?
+      other->GetFileNamesForSeries(j) : nullptr);
+    success = (files != nullptr && otherFiles != nullptr &&
+               files->GetNumberOfValues() ==
+               otherFiles->GetNumberOfValues());
+    for (vtkIdType k = 0; success && k < files->GetNumberOfValues(); k++)
+    {
+      success = (files->GetValue(k) == otherFiles->GetValue(k));
+    }
+  }
+  return success;
+}
+
+// the information that is collected from SeriesCompleteEvent
+struct SeriesEventInfo
+{
+  std::vector<int> Indices;
+  std::vector<int> NumberOfSeries;
+  std::vector<int> NumberOfFiles;
+  std::vector<bool> InstancesValid;
+};
+
+static void SeriesComplete(
+  vtkObject *caller, unsigned long, void *clientData, void *callData)
+{
+  vtkDICOMDirectory *dir = static_cast<vtkDICOMDirectory *>(caller);
+  SeriesEventInfo *info = static_cast<SeriesEventInfo *>(clientData);
+  int idx = *static_cast<int *>(callData);
+  vtkStringArray *files = dir->GetFileNamesForSeries(idx);
+  info->Indices.push_back(idx);
+  info->NumberOfSeries.push_back(dir->GetNumberOfSeries());
+  info->NumberOfFiles.push_back(
+    files ? static_cast<int>(files->GetNumberOfValues()) : 0);
+  info->InstancesValid.push_back(CheckInstances(dir, idx));
+}
+
+int TestDICOMDirectory(int argc, char *argv[])
+{
+  int rval = 0;
+  const char *exename = (argc > 0 ? argv[0] : "TestDICOMDirectory");
+
+  // remove path portion of exename
+  const char *cp = exename + strlen(exename);
+  while (cp != exename && cp[-1] != '\\' && cp[-1] != '/') { --cp; }
+  exename = cp;
+
+  // create the test files in a new directory
+  vtkDICOMFilePath path("TestDICOMDirectory.tmp");
+  std::string dirname = path.AsString();
+  std::string dicomdir = path.Join("DICOMDIR");
+  vtkDICOMFileDirectory::Create(dirname.c_str());
+  vtkDICOMFile::Remove(dicomdir.c_str());
+
+  std::vector<std::string> files;
+  for (int i = 0; TestImages[i][0] >= 0; i++)
+  {
+    char name[16];
+    snprintf(name, sizeof(name), "IM%06d", i + 1);
+    files.push_back(path.Join(name));
+    bool written = WriteTestFile(files.back(),
+      TestImages[i][0], TestImages[i][1], TestImages[i][2], i);
+    TestAssert(written);
+  }
+  int numberOfImages = static_cast<int>(files.size());
+  for (int i = 0; TestDocuments[i][0] >= 0; i++)
+  {
+    char name[16];
+    snprintf(name, sizeof(name), "IM%06d", numberOfImages + i + 1);
+    files.push_back(path.Join(name));
+    bool written = WriteTestFile(files.back(),
+      TestDocuments[i][0], TestDocuments[i][1], TestDocuments[i][2],
+      numberOfImages + i, TestDocumentTypes[i]);
+    TestAssert(written);
+  }
+  int numberOfFiles = static_cast<int>(files.size());
+
+  { // test a DICOMDIR written for a directory scan
+  vtkDICOMDirectory *scan = vtkDICOMDirectory::New();
+  scan->SetDirectoryName(dirname.c_str());
+  scan->IgnoreDicomdirOn();
+  scan->Update();
+  TestAssert(scan->GetErrorCode() == 0);
+  TestAssert(scan->GetNumberOfSeries() == 4);
+
+  vtkDICOMDirectoryWriter *writer = vtkDICOMDirectoryWriter::New();
+  writer->SetDirectory(scan);
+  writer->Write();
+  TestAssert(writer->GetErrorCode() == 0);
+  TestAssert(writer->GetNumberOfSkippedFiles() == 0);
+  writer->Delete();
+
+  // read the DICOMDIR, the files themselves are not scanned
+  vtkDICOMDirectory *dir = vtkDICOMDirectory::New();
+  dir->SetDirectoryName(dirname.c_str());
+  dir->SetScanDepth(0);
+  dir->Update();
+  TestAssert(dir->GetErrorCode() == 0);
+  TestAssert(dir->GetNumberOfSeries() == 4);
+  for (int i = 0; i < dir->GetNumberOfSeries(); i++)
+  {
+    int j = FindSeries(scan, dir->GetSeriesRecord(i));
+    TestAssert(j >= 0);
+    if (j >= 0)
+    {
+      TestAssert(dir->GetNumberOfFilesForSeries(i) ==
+                 scan->GetNumberOfFilesForSeries(j));
+    }
+  }
+  dir->Delete();
+
+  // scan with a tiny memory budget, so that the records are spilled
+  dir = vtkDICOMDirectory::New();
+  dir->SetDirectoryName(dirname.c_str());
+  dir->IgnoreDicomdirOn();
+  dir->SetMemoryBudget(1);
+  dir->Update();
+  TestAssert(dir->GetErrorCode() == 0);
+  TestAssert(dir->GetNumberOfSeries() == 4);
+  for (int i = 0; i < dir->GetNumberOfSeries(); i++)
+  {
+    int j = FindSeries(scan, dir->GetSeriesRecord(i));
+    TestAssert(j >= 0);
+    if (j >= 0)
+    {
+      TestAssert(dir->GetNumberOfFilesForSeries(i) ==
+                 scan->GetNumberOfFilesForSeries(j));
+    }
+    TestAssert(CheckInstances(dir, i));
+  }
+  dir->Delete();
+
+  // stream the series, with and without the memory budget
+  for (int budget = 0; budget <= 1; budget++)
+  {
+    SeriesEventInfo info;
+    vtkCallbackCommand *cb = vtkCallbackCommand::New();
+    cb->SetCallback(SeriesComplete);
+    cb->SetClientData(&info);
+
+    dir = vtkDICOMDirectory::New();
+    dir->SetDirectoryName(dirname.c_str());
+    dir->IgnoreDicomdirOn();
+    dir->StreamSeriesOn();
+    dir->SetMemoryBudget(budget);
+    dir->AddObserver(vtkDICOMDirectory::SeriesCompleteEvent, cb);
+    dir->Update();
+    TestAssert(dir->GetErrorCode() == 0);
+    TestAssert(dir->GetNumberOfSeries() == 4);
+    TestAssert(info.Indices.size() == 4);
+    for (size_t k = 0; k < info.Indices.size(); k++)
+    {
+      // each series is reported with its own index
+      int i = info.Indices[k];
+      TestAssert(i == static_cast<int>(k));
+      TestAssert(info.NumberOfSeries[k] == i + 1);
+      TestAssert(info.InstancesValid[k]);
+      int j = FindSeries(scan, dir->GetSeriesRecord(i));
+      TestAssert(j >= 0);
+      if (j >= 0)
+      {
+        TestAssert(info.NumberOfFiles[k] ==
+                   scan->GetNumberOfFilesForSeries(j));
+      }
+      // the files were released after the event
+      TestAssert(dir->GetFileNamesForSeries(i) == nullptr);
+    }
+    dir->Delete();
+    cb->Delete();
+  }
+
+  scan->Delete();
+  }
+
+  { // test a DICOMDIR that includes files that are not images
+  vtkDICOMDirectory *scan = vtkDICOMDirectory::New();
+  scan->SetDirectoryName(dirname.c_str());
+  scan->IgnoreDicomdirOn();
+  scan->RequirePixelDataOff();
+  scan->Update();
+  TestAssert(scan->GetErrorCode() == 0);
+  TestAssert(scan->GetNumberOfPatients() == 2);
+  TestAssert(scan->GetNumberOfStudies() == 3);
+  TestAssert(scan->GetNumberOfSeries() == 6);
+  TestAssert(CountFiles(scan) == numberOfFiles);
+
+  vtkDICOMDirectoryWriter *writer = vtkDICOMDirectoryWriter::New();
+  writer->SetDirectory(scan);
+  writer->Write();
+  TestAssert(writer->GetErrorCode() == 0);
+  TestAssert(writer->GetNumberOfSkippedFiles() == 0);
+  writer->Delete();
+
+  // each record has the type that matches its SOP class
+  TestAssert(CountRecords(dicomdir, "PATIENT") == 2);
+  TestAssert(CountRecords(dicomdir, "STUDY") == 3);
+  TestAssert(CountRecords(dicomdir, "SERIES") == 6);
+  TestAssert(CountRecords(dicomdir, "IMAGE") == numberOfImages);
+  for (int i = 0; TestDocuments[i][0] >= 0; i++)
+  {
+    TestAssert(CountRecords(dicomdir, TestDocumentTypes[i][2]) == 1);
+  }
+
+  // read the DICOMDIR back, and compare it with the scan
+  vtkDICOMDirectory *dir = vtkDICOMDirectory::New();
+  dir->SetDirectoryName(dirname.c_str());
+  dir->RequirePixelDataOff();
+  dir->SetScanDepth(0);
+  dir->Update();
+  TestAssert(dir->GetErrorCode() == 0);
+  TestAssert(dir->GetNumberOfPatients() == scan->GetNumberOfPatients());
+  TestAssert(dir->GetNumberOfStudies() == scan->GetNumberOfStudies());
+  TestAssert(dir->GetNumberOfSeries() == scan->GetNumberOfSeries());
+  TestAssert(CountFiles(dir) == numberOfFiles);
+  for (int i = 0; i < dir->GetNumberOfSeries(); i++)
+  {
+    int j = FindSeries(scan, dir->GetSeriesRecord(i));
+    TestAssert(j >= 0);
+    if (j >= 0)
+    {
+      TestAssert(dir->GetNumberOfFilesForSeries(i) ==
+                 scan->GetNumberOfFilesForSeries(j));
+    }
+  }
+  dir->Delete();
+
+  // only the images are read if pixel data is required
+  dir = vtkDICOMDirectory::New();
+  dir->SetDirectoryName(dirname.c_str());
+  dir->SetScanDepth(0);
+  dir->Update();
+  TestAssert(dir->GetErrorCode() == 0);
+  TestAssert(dir->GetNumberOfSeries() == 4);
+  TestAssert(CountFiles(dir) == numberOfImages);
+  dir->Delete();
+
+  scan->Delete();
+  }
+
+#ifdef DICOM_USE_SQLITE
+  std::string index = path.Join("index.dcmdb");
+  { // test an index file, with and without a query
+  vtkDICOMDirectory *scan = vtkDICOMDirectory::New();
+  scan->SetDirectoryName(dirname.c_str());
+  scan->IgnoreDicomdirOn();
+  scan->Update();
+  TestAssert(scan->GetErrorCode() == 0);
+  TestAssert(scan->GetNumberOfSeries() == 4);
+  vtkDICOMFile::Remove(index.c_str());
+  scan->WriteIndexFile(index.c_str());
+  TestAssert(scan->GetErrorCode() == 0);
+  scan->Delete();
+
+  vtkStringArray *indexNames = vtkStringArray::New();
+  indexNames->InsertNextValue(index);
+
+  // the queries: none, indexed columns, and a wildcard
+  vtkDICOMItem queries[4];
+  queries[1].Set(DC::PatientID, "P001");
+  queries[2].Set(DC::AccessionNumber, "A001");
+  queries[3].Set(DC::PatientID, "P00*");
+  queries[3].Set(DC::AccessionNumber, "A002");
+  int expectedSeries[4] = { 4, 2, 1, 1 };
+
+  for (int q = 0; q < 4; q++)
+  {
+    // a plain scan of the files, for comparison
+    scan = vtkDICOMDirectory::New();
+    scan->SetDirectoryName(dirname.c_str());
+    scan->IgnoreDicomdirOn();
+    scan->SetFindQuery(queries[q]);
+    scan->Update();
+    TestAssert(scan->GetErrorCode() == 0);
+    TestAssert(scan->GetNumberOfSeries() == expectedSeries[q]);
+
+    vtkDICOMDirectory *dir = vtkDICOMDirectory::New();
+    dir->SetInputFileNames(indexNames);
+    dir->SetFindQuery(queries[q]);
+    dir->Update();
+    TestAssert(dir->GetErrorCode() == 0);
+    TestAssert(SameSeries(dir, scan));
+    for (int i = 0; i < dir->GetNumberOfSeries(); i++)
+    {
+      TestAssert(CheckInstances(dir, i));
+    }
+    dir->Delete();
+    scan->Delete();
+  }
+
+  indexNames->Delete();
+  }
+  vtkDICOMFile::Remove(index.c_str());
+#endif
+
+  // remove the test files
+  vtkDICOMFile::Remove(dicomdir.c_str());
+  for (int i = 0; i < numberOfFiles; i++)
+  {
+    vtkDICOMFile::Remove(files[i].c_str());
+  }
+
+  return rval;
+}
+
+#ifdef VTK_DICOM_SEPARATE_TESTS
+int main(int argc, char *argv[])
+{
+  return TestDICOMDirectory(argc, argv);
+}
+#endif
@@ -0,0 +1,108 @@
+#include "vtkDICOMFilePathTable.h"
+
+#include <string>
+
+#include <string.h>
+#include <stdlib.h>
+
+// macro for performing tests
+#define TestAssert(t) \
+if (!(t)) \
+{ \
+  cout << exename << ": Assertion Failed: " << #t << "\n"; \
+  cout << __FILE__ << ":" << __LINE__ << "\n"; \
+  cout.flush(); \
+  rval |= 1; \
+}
+
+int TestDICOMFilePathTable(int argc, char *argv[])
+{
+  int rval = 0;
+  const char *exename = (argc > 0 ? argv[0] : "TestDICOMFilePathTable");
+
+  // remove path portion of exename
+  const char *cp = exename + strlen(exename);
+  while (cp != exename && cp[-1] != '\\' && cp[-1] != '/') { --cp; }
+  exename = cp;
+
+  { // test that paths are returned exactly as inserted
+  const char *paths[] = {
+    "/data/study1/series1/IM0001",
+    "/data/study1/series1/IM0002",
+    "/data/study1/series2/IM0001",
+    "/data//study2/IM0001",
+    "/data/study1/series1/",
+    "/IM0001",
+    "IM0001",
+    "relative/dir/IM0001",
+    "",
+    nullptr
+  };
+  vtkDICOMFilePathTable table;
+  for (int i = 0; paths[i] != nullptr; i++)
+  {
+    TestAssert(table.InsertNextPath(paths[i]) == i);
+  }
+  TestAssert(table.GetNumberOfPaths() == 9);
+  for (int i = 0; paths[i] != nullptr; i++)
+  {
+    TestAssert(table.GetPath(i) == paths[i]);
+  }
+  TestAssert(strcmp(table.GetFileName(0), "IM0001") == 0);
+  TestAssert(strcmp(table.GetFileName(4), "") == 0);
+  TestAssert(table.GetDirectory(2) == "/data/study1/series2/");
+  TestAssert(table.GetDirectory(6) == "");
+  TestAssert(table.GetDirectoryIndex(0) == table.GetDirectoryIndex(1));
+  TestAssert(table.GetDirectoryIndex(0) == table.GetDirectoryIndex(4));
+  TestAssert(table.GetDirectoryIndex(0) != table.GetDirectoryIndex(2));
+  TestAssert(table.GetDirectoryIndex(6) == -1);
+  table.Clear();
+  TestAssert(table.GetNumberOfPaths() == 0);
+  }
+
+  { // test that comparisons match strcmp
+  const char *paths[] = {
+    "/a/b/c",
+    "/a/b.txt",
+    "/a/b/d",
+    "/a/bb/c",
+    "/a/b/c",
+    nullptr
+  };
+  vtkDICOMFilePathTable table;
+  for (int i = 0; paths[i] != nullptr; i++)
+  {
+    table.InsertNextPath(paths[i]);
+  }
+  for (int i = 0; paths[i] != nullptr; i++)
+  {
+    for (int j = 0; paths[j] != nullptr; j++)
+    {
+      int c1 = table.Compare(i, j);
+      int c2 = strcmp(paths[i], paths[j]);
+      TestAssert((c1 < 0) == (c2 < 0) && (c1 > 0) == (c2 > 0));
+    }
+  }
+  }
+
+  { // test that shared directories are stored only once
+  vtkDICOMFilePathTable table;
+  std::string dir = "/a/very/long/directory/name/that/is/shared/";
+  table.InsertNextPath(dir + "IM0");
+  size_t size = table.GetMemorySize();
+  for (int i = 0; i < 1000; i++)
+  {
+    table.InsertNextPath(dir + "IM" + std::to_string(i));
+  }
+  TestAssert(table.GetMemorySize() - size < 1000*(dir.length() + 8));
+  }
+
+  return rval;
+}
+
+#ifdef VTK_DICOM_SEPARATE_TESTS
+int main(int argc, char *argv[])
+{
+  return TestDICOMFilePathTable(argc, argv);
+}
+#endif
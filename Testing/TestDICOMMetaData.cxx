@@ -556,6 +556,20 @@ int TestDICOMMetaData(int argc, char *argv[])
   TestAssert(mcopy->Get(
     DC::AcquisitionDateTime).AsString() == acquisitionTime);
 
+  // per-instance values are shared, but modifying them must not
+  // change the values in the original
+  mcopy->Set(1, DC::Modality, "US");
+  mcopy->Set(2, DC::AcquisitionDateTime, "20240101");
+  TestAssert(mcopy->Get(1, DC::Modality).AsString() == "US");
+  TestAssert(metaData->Get(1, DC::Modality).AsString() == "CT");
+  TestAssert(mcopy->Get(
+    2, DC::AcquisitionDateTime).AsString() == "20240101");
+  TestAssert(metaData->Get(
+    2, DC::AcquisitionDateTime).AsString() == acquisitionTime);
+  metaData->Set(0, DC::Modality, "PT");
+  TestAssert(mcopy->Get(0, DC::Modality).AsString() == "MR");
+  TestAssert(metaData->Get(0, DC::Modality).AsString() == "PT");
+
   mcopy->Initialize();
   metaData->DeepCopy(mcopy);
   TestAssert(metaData->GetNumberOfInstances() == 1);
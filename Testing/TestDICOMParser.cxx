@@ -0,0 +1,474 @@
+#include "vtkDICOMParser.h"
+#include "vtkDICOMCompiler.h"
+#include "vtkDICOMMetaData.h"
+#include "vtkDICOMItem.h"
+#include "vtkDICOMSequence.h"
+#include "vtkDICOMStream.h"
+
+#include <string>
+#include <vector>
+
+#include <string.h>
+#include <stdlib.h>
+
+// macro for performing tests
+#define TestAssert(t) \
+if (!(t)) \
+{ \
+  cout << exename << ": Assertion Failed: " << #t << "\n"; \
+  cout << __FILE__ << ":" << __LINE__ << "\n"; \
+  cout.flush(); \
+  rval |= 1; \
+}
+
+// the image dimensions and the size of the large value
+const int ImageColumns = 64;
+const int ImageRows = 48;
+const size_t DocumentSize = 100000;
+
+// create an image with a sequence and with a large, compressible value
+static vtkDICOMMetaData *CreateMetaData(std::vector<unsigned char> *doc)
+{
+  doc->resize(DocumentSize);
+  for (size_t i = 0; i < DocumentSize; i++)
+  {
+    (*doc)[i] = static_cast<unsigned char>((i / 64) % 7 + 'a');
+  }
+
+  vtkDICOMMetaData *meta = vtkDICOMMetaData::New();
+  meta->Set(DC::SOPClassUID, "1.2.840.10008.5.1.4.1.1.7");
+  meta->Set(DC::SOPInstanceUID, "1.2.3.4.5.6.7");
+  meta->Set(DC::Modality, "OT");
+  meta->Set(DC::PatientName, "Test^Parser");
+  meta->Set(DC::PatientID, "P001");
+  meta->Set(DC::StudyInstanceUID, "1.2.3.4.5");
+  meta->Set(DC::SeriesInstanceUID, "1.2.3.4.5.6");
+  meta->Set(DC::ImageType, "ORIGINAL\\PRIMARY\\AXIAL");
+  meta->Set(DC::PixelSpacing, "0.5\\0.5");
+
+  vtkDICOMSequence seq(2);
+  for (unsigned int i = 0; i < 2; i++)
+  {
+    vtkDICOMItem item;
+    item.Set(DC::ReferencedSOPClassUID, "1.2.840.10008.5.1.4.1.1.7");
+    item.Set(DC::ReferencedSOPInstanceUID, (i == 0 ? "1.2.3.1" : "1.2.3.2"));
+    seq.SetItem(i, item);
+  }
+  meta->Set(DC::ReferencedImageSequence, seq);
+
+  meta->Set(DC::SamplesPerPixel, 1);
+  meta->Set(DC::PhotometricInterpretation, "MONOCHROME2");
+  meta->Set(DC::Rows, ImageRows);
+  meta->Set(DC::Columns, ImageColumns);
+  meta->Set(DC::BitsAllocated, 16);
+  meta->Set(DC::BitsStored, 16);
+  meta->Set(DC::HighBit, 15);
+  meta->Set(DC::PixelRepresentation, 0);
+  meta->Set(DC::EncapsulatedDocument,
+    vtkDICOMValue(vtkDICOMVR::OB, &(*doc)[0], DocumentSize));
+  unsigned short empty = 0;
+  meta->Set(DC::PixelData, vtkDICOMValue(vtkDICOMVR::OW, &empty, 0));
+
+  return meta;
+}
+
+// write the meta data and pixels to memory with the given syntax
+static bool WriteToStream(vtkDICOMMemoryStream *stream,
+  vtkDICOMMetaData *meta, const char *syntax,
+  const std::vector<unsigned short>& pixels)
+{
+  vtkDICOMCompiler *compiler = vtkDICOMCompiler::New();
+  compiler->SetOutputStream(stream);
+  compiler->SetTransferSyntaxUID(syntax);
+  compiler->SetSOPInstanceUID("1.2.3.4.5.6.7");
+  compiler->SetSeriesInstanceUID("1.2.3.4.5.6");
+  compiler->SetStudyInstanceUID("1.2.3.4.5");
+  compiler->SetMetaData(meta);
+  compiler->WriteHeader();
+  compiler->WritePixelData(
+    reinterpret_cast<const unsigned char *>(&pixels[0]),
+    pixels.size()*sizeof(unsigned short));
+  compiler->Close();
+  bool success = (compiler->GetErrorCode() == 0);
+  compiler->Delete();
+  return success;
+}
+
+// read the meta data from memory
+static vtkDICOMParser *ReadFromMemory(
+  vtkDICOMMetaData *meta, const unsigned char *data, size_t size,
+  int bufferSize)
+{
+  vtkDICOMMemoryStream input(data, size);
+  vtkDICOMParser *parser = vtkDICOMParser::New();
+  parser->SetMetaData(meta);
+  parser->SetInputStream(&input);
+  parser->SetBufferSize(bufferSize);
+  parser->Update();
+  parser->SetInputStream(nullptr);
+  return parser;
+}
+
+// check that all elements outside of the meta header are the same
+static bool SameDataSet(vtkDICOMMetaData *meta, vtkDICOMMetaData *other)
+{
+  int n = 0;
+  int m = 0;
+  vtkDICOMDataElementIterator iter;
+  for (iter = meta->Begin(); iter != meta->End(); ++iter)
+  {
+    vtkDICOMTag tag = iter->GetTag();
+    if (tag.GetGroup() != 0x0002)
+    {
+      n++;
+      if (other->Get(tag) != iter->GetValue())
+      {
+        return false;
+      }
+    }
+  }
+  for (iter = other->Begin(); iter != other->End(); ++iter)
+  {
+    m += (iter->GetTag().GetGroup() != 0x0002);
+  }
+  return (n > 0 && n == m);
+}
+
+// test writing and reading the Deflated Explicit VR Little Endian syntax
+static int TestDeflate(const char *exename)
+{
+  int rval = 0;
+
+  std::vector<unsigned char> doc;
+  vtkDICOMMetaData *meta = CreateMetaData(&doc);
+
+  std::vector<unsigned short> pixels(ImageColumns*ImageRows);
+  for (size_t i = 0; i < pixels.size(); i++)
+  {
+    pixels[i] = static_cast<unsigned short>(i % ImageColumns);
+  }
+  size_t pixelSize = pixels.size()*sizeof(unsigned short);
+
+  // write the data uncompressed, and deflated
+  vtkDICOMMemoryStream plain;
+  vtkDICOMMemoryStream deflated;
+  TestAssert(WriteToStream(&plain, meta, "1.2.840.10008.1.2.1", pixels));
+  TestAssert(WriteToStream(&deflated, meta, "1.2.840.10008.1.2.1.99",
+                           pixels));
+  meta->Delete();
+
+  // the deflated data must be smaller, and of even length
+  size_t plainSize = static_cast<size_t>(plain.GetSize());
+  size_t deflatedSize = static_cast<size_t>(deflated.GetSize());
+  TestAssert(plainSize > DocumentSize + pixelSize);
+  TestAssert(deflatedSize < plainSize/4);
+  TestAssert(deflatedSize % 2 == 0);
+
+  vtkDICOMMetaData *plainMeta = vtkDICOMMetaData::New();
+  vtkDICOMParser *parser =
+    ReadFromMemory(plainMeta, plain.GetData(), plainSize, 8192);
+  TestAssert(parser->GetErrorCode() == 0);
+  parser->Delete();
+
+  // read the deflated data with a large buffer, and with a tiny buffer
+  for (int bufferSize = 256; bufferSize <= 65536; bufferSize *= 256)
+  {
+    vtkDICOMMetaData *deflatedMeta = vtkDICOMMetaData::New();
+    parser = ReadFromMemory(
+      deflatedMeta, deflated.GetData(), deflatedSize, bufferSize);
+    TestAssert(parser->GetErrorCode() == 0);
+    TestAssert(parser->GetPixelDataFound());
+    TestAssert(parser->GetPixelDataVL() == pixelSize);
+    TestAssert(deflatedMeta->Get(DC::TransferSyntaxUID).AsString() ==
+               "1.2.840.10008.1.2.1.99");
+    TestAssert(SameDataSet(plainMeta, deflatedMeta));
+    const vtkDICOMValue& v = deflatedMeta->Get(DC::EncapsulatedDocument);
+    TestAssert(v.GetVL() == DocumentSize);
+    if (v.GetVL() == DocumentSize)
+    {
+      TestAssert(memcmp(v.GetUnsignedCharData(), &doc[0], DocumentSize) == 0);
+    }
+    parser->Delete();
+    deflatedMeta->Delete();
+  }
+
+  // truncated deflated data must be reported as an error
+  vtkDICOMMetaData *truncatedMeta = vtkDICOMMetaData::New();
+  parser = ReadFromMemory(
+    truncatedMeta, deflated.GetData(), deflatedSize/2, 8192);
+  TestAssert(parser->GetErrorCode() != 0);
+  parser->Delete();
+  truncatedMeta->Delete();
+
+  plainMeta->Delete();
+
+  return rval;
+}
+
+// test skipping large values, and reading them later
+static int TestBulkData(const char *exename)
+{
+  int rval = 0;
+
+  std::vector<unsigned char> doc;
+  vtkDICOMMetaData *meta = CreateMetaData(&doc);
+
+  // add a large private value, and a small one
+  std::vector<unsigned char> blob(5000);
+  for (size_t i = 0; i < blob.size(); i++)
+  {
+    blob[i] = static_cast<unsigned char>(i*13);
+  }
+  vtkDICOMTag creatorTag(0x0029, 0x0010);
+  vtkDICOMTag blobTag(0x0029, 0x1010);
+  vtkDICOMTag smallTag(0x0029, 0x1011);
+  meta->Set(creatorTag, vtkDICOMValue(vtkDICOMVR::LO, "TEST BULK DATA"));
+  meta->Set(blobTag, vtkDICOMValue(vtkDICOMVR::OB, &blob[0], blob.size()));
+  meta->Set(smallTag, vtkDICOMValue(vtkDICOMVR::OB, &blob[0], 16));
+
+  std::vector<unsigned short> pixels(ImageColumns*ImageRows);
+  for (size_t i = 0; i < pixels.size(); i++)
+  {
+    pixels[i] = static_cast<unsigned short>(i);
+  }
+  size_t pixelSize = pixels.size()*sizeof(unsigned short);
+
+  // the large values must be skipped for each of these syntaxes
+  static const char *const syntaxes[] = {
+    "1.2.840.10008.1.2.1", // explicit little endian
+    "1.2.840.10008.1.2", // implicit little endian
+    "1.2.840.10008.1.2.2", // explicit big endian
+    nullptr
+  };
+
+  for (int k = 0; syntaxes[k] != nullptr; k++)
+  {
+    vtkDICOMMemoryStream output;
+    TestAssert(WriteToStream(&output, meta, syntaxes[k], pixels));
+    vtkDICOMMemoryStream input(
+      output.GetData(), static_cast<size_t>(output.GetSize()));
+
+    // read everything, for comparison
+    vtkDICOMMetaData *fullMeta = vtkDICOMMetaData::New();
+    vtkDICOMParser *parser = vtkDICOMParser::New();
+    parser->SetMetaData(fullMeta);
+    parser->SetInputStream(&input);
+    parser->Update();
+    TestAssert(parser->GetErrorCode() == 0);
+    TestAssert(parser->GetNumberOfBulkDataElements() == 0);
+    TestAssert(fullMeta->Get(DC::EncapsulatedDocument).GetVL() ==
+               DocumentSize);
+    parser->Delete();
+
+    // skip the values that are larger than 1000 bytes
+    vtkDICOMMetaData *bulkMeta = vtkDICOMMetaData::New();
+    parser = vtkDICOMParser::New();
+    parser->SetMetaData(bulkMeta);
+    parser->SetInputStream(&input);
+    parser->SetBulkDataThreshold(1000);
+    parser->SetBufferSize(256);
+    parser->Update();
+    TestAssert(parser->GetErrorCode() == 0);
+    TestAssert(parser->GetPixelDataFound());
+    TestAssert(parser->GetPixelDataVL() == pixelSize);
+    TestAssert(!bulkMeta->Has(DC::EncapsulatedDocument));
+    TestAssert(!bulkMeta->Has(blobTag));
+    TestAssert(bulkMeta->Get(smallTag).GetVL() == 16);
+    TestAssert(bulkMeta->Get(DC::PatientName).AsString() == "Test^Parser");
+    TestAssert(bulkMeta->Get(DC::ReferencedImageSequence)
+               .GetNumberOfValues() == 2);
+
+    // check the skipped elements, and then read them
+    int n = parser->GetNumberOfBulkDataElements();
+    TestAssert(n == 2);
+    for (int i = 0; i < n; i++)
+    {
+      vtkDICOMTag tag = parser->GetBulkDataTag(i);
+      TestAssert(tag == DC::EncapsulatedDocument || tag == blobTag);
+      TestAssert(parser->GetBulkDataLength(i) ==
+                 (tag == blobTag ? blob.size() : DocumentSize));
+      TestAssert(parser->GetBulkDataOffset(i) > 0);
+      TestAssert(parser->GetBulkDataOffset(i) < output.GetSize());
+      TestAssert(parser->ReadBulkData(i));
+    }
+    TestAssert(parser->GetErrorCode() == 0);
+    const vtkDICOMValue& v = bulkMeta->Get(DC::EncapsulatedDocument);
+    TestAssert(v.GetVL() == DocumentSize);
+    if (v.GetVL() == DocumentSize)
+    {
+      TestAssert(memcmp(v.GetUnsignedCharData(), &doc[0], DocumentSize) == 0);
+    }
+    const vtkDICOMValue& u = bulkMeta->Get(blobTag);
+    TestAssert(u.GetVL() == blob.size());
+    if (u.GetVL() == blob.size())
+    {
+      TestAssert(memcmp(u.GetUnsignedCharData(), &blob[0], blob.size()) == 0);
+    }
+    TestAssert(SameDataSet(fullMeta, bulkMeta));
+    parser->Delete();
+    bulkMeta->Delete();
+
+    // values that are in the query are not skipped
+    vtkDICOMMetaData *queryMeta = vtkDICOMMetaData::New();
+    vtkDICOMItem query;
+    query.Set(DC::EncapsulatedDocument, vtkDICOMValue(vtkDICOMVR::OB));
+    parser = vtkDICOMParser::New();
+    parser->SetMetaData(queryMeta);
+    parser->SetInputStream(&input);
+    parser->SetQueryItem(query);
+    parser->SetBulkDataThreshold(1000);
+    parser->Update();
+    TestAssert(parser->GetErrorCode() == 0);
+    TestAssert(parser->GetNumberOfBulkDataElements() == 0);
+    TestAssert(queryMeta->Get(DC::EncapsulatedDocument) ==
+               fullMeta->Get(DC::EncapsulatedDocument));
+    parser->Delete();
+    queryMeta->Delete();
+
+    fullMeta->Delete();
+  }
+
+  meta->Delete();
+
+  return rval;
+}
+
+// test values that are larger than the buffer, with every type of value
+static int TestLargeValues(const char *exename)
+{
+  int rval = 0;
+
+  std::vector<unsigned char> doc;
+  vtkDICOMMetaData *meta = CreateMetaData(&doc);
+
+  // multi-byte values need byte swapping for big endian
+  std::vector<double> dvals(700);
+  std::vector<float> fvals(300);
+  std::vector<unsigned int> uvals(300);
+  std::vector<unsigned short> svals(1000);
+  std::vector<short> ssvals(1000);
+  std::vector<vtkDICOMTag> tvals(300);
+  for (size_t i = 0; i < dvals.size(); i++)
+  {
+    dvals[i] = 1.0/(i + 1);
+  }
+  for (size_t i = 0; i < fvals.size(); i++)
+  {
+    fvals[i] = static_cast<float>(i*0.25 - 10.0);
+  }
+  for (size_t i = 0; i < uvals.size(); i++)
+  {
+    uvals[i] = static_cast<unsigned int>(i*2654435761u);
+  }
+  for (size_t i = 0; i < svals.size(); i++)
+  {
+    svals[i] = static_cast<unsigned short>(i*257 + 1);
+    ssvals[i] = static_cast<short>(-static_cast<int>(i));
+  }
+  for (size_t i = 0; i < tvals.size(); i++)
+  {
+    tvals[i] = vtkDICOMTag(static_cast<unsigned short>(i + 8),
+                           static_cast<unsigned short>(i*3 + 1));
+  }
+  std::string text(3000, ' ');
+  for (size_t i = 0; i < text.size(); i++)
+  {
+    text[i] = static_cast<char>('A' + i % 26);
+  }
+
+  meta->Set(DC::SelectorFDValue,
+    vtkDICOMValue(vtkDICOMVR::FD, &dvals[0], dvals.size()));
+  meta->Set(DC::SelectorFLValue,
+    vtkDICOMValue(vtkDICOMVR::FL, &fvals[0], fvals.size()));
+  meta->Set(DC::SelectorULValue,
+    vtkDICOMValue(vtkDICOMVR::UL, &uvals[0], uvals.size()));
+  meta->Set(DC::SelectorUSValue,
+    vtkDICOMValue(vtkDICOMVR::US, &svals[0], svals.size()));
+  meta->Set(DC::SelectorSSValue,
+    vtkDICOMValue(vtkDICOMVR::SS, &ssvals[0], ssvals.size()));
+  meta->Set(DC::SelectorSequencePointer,
+    vtkDICOMValue(vtkDICOMVR::AT, &tvals[0], tvals.size()));
+  meta->Set(DC::TextValue, vtkDICOMValue(vtkDICOMVR::UT, text));
+
+  // large values within a sequence item
+  vtkDICOMItem item;
+  item.Set(DC::TextValue, vtkDICOMValue(vtkDICOMVR::UT, text));
+  item.Set(DC::SelectorUSValue,
+    vtkDICOMValue(vtkDICOMVR::US, &svals[0], 500));
+  meta->Set(DC::ContentSequence, vtkDICOMValue(vtkDICOMVR::SQ, item));
+
+  std::vector<unsigned short> pixels(ImageColumns*ImageRows);
+  for (size_t i = 0; i < pixels.size(); i++)
+  {
+    pixels[i] = static_cast<unsigned short>(i);
+  }
+  size_t pixelSize = pixels.size()*sizeof(unsigned short);
+
+  static const char *const syntaxes[] = {
+    "1.2.840.10008.1.2.1", // explicit little endian
+    "1.2.840.10008.1.2", // implicit little endian
+    "1.2.840.10008.1.2.2", // explicit big endian
+    nullptr
+  };
+
+  for (int k = 0; syntaxes[k] != nullptr; k++)
+  {
+    vtkDICOMMemoryStream output;
+    TestAssert(WriteToStream(&output, meta, syntaxes[k], pixels));
+    const unsigned char *data = output.GetData();
+    size_t size = static_cast<size_t>(output.GetSize());
+
+    // a tiny buffer, a buffer larger than most values, and a huge buffer
+    static const int bufferSizes[] = { 256, 4096, 1048576, 0 };
+    for (int j = 0; bufferSizes[j] != 0; j++)
+    {
+      vtkDICOMMetaData *readMeta = vtkDICOMMetaData::New();
+      vtkDICOMParser *parser =
+        ReadFromMemory(readMeta, data, size, bufferSizes[j]);
+      TestAssert(parser->GetErrorCode() == 0);
+      TestAssert(parser->GetPixelDataFound());
+      TestAssert(parser->GetPixelDataVL() == pixelSize);
+      TestAssert(parser->GetFileOffset() + pixelSize == size);
+      parser->Delete();
+      TestAssert(readMeta->Get(DC::TransferSyntaxUID).AsString() ==
+                 syntaxes[k]);
+      TestAssert(readMeta->Get(DC::SelectorFDValue) ==
+                 meta->Get(DC::SelectorFDValue));
+      TestAssert(readMeta->Get(DC::SelectorSSValue) ==
+                 meta->Get(DC::SelectorSSValue));
+      TestAssert(readMeta->Get(DC::SelectorSequencePointer) ==
+                 meta->Get(DC::SelectorSequencePointer));
+      TestAssert(readMeta->Get(DC::TextValue).AsString() == text);
+      TestAssert(SameDataSet(meta, readMeta));
+      readMeta->Delete();
+    }
+  }
+
+  meta->Delete();
+
+  return rval;
+}
+
+int TestDICOMParser(int argc, char *argv[])
+{
+  int rval = 0;
+  const char *exename = (argc > 0 ? argv[0] : "TestDICOMParser");
+
+  // remove path portion of exename
+  const char *cp = exename + strlen(exename);
+  while (cp != exename && cp[-1] != '\\' && cp[-1] != '/') { --cp; }
+  exename = cp;
+
+  rval |= TestDeflate(exename);
+  rval |= TestBulkData(exename);
+  rval |= TestLargeValues(exename);
+
+  return rval;
+}
+
+#ifdef VTK_DICOM_SEPARATE_TESTS
+int main(int argc, char *argv[])
+{
+  return TestDICOMParser(argc, argv);
+}
+#endif
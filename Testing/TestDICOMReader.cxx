@@ -0,0 +1,312 @@
+#include "vtkDICOMReader.h"
+#include "vtkDICOMCompiler.h"
+#include "vtkDICOMMetaData.h"
+#include "vtkDICOMFile.h"
+#include "vtkDICOMFileDirectory.h"
+#include "vtkDICOMFilePath.h"
+
+#include "vtkCommand.h"
+#include "vtkErrorCode.h"
+#include "vtkObjectFactory.h"
+#include "vtkStringArray.h"
+#include "vtkTypeInt64Array.h"
+
+#include <string>
+#include <vector>
+
+#include <string.h>
+#include <stdlib.h>
+
+// macro for performing tests
+#define TestAssert(t) \
+if (!(t)) \
+{ \
+  cout << exename << ": Assertion Failed: " << #t << "\n"; \
+  cout << __FILE__ << ":" << __LINE__ << "\n"; \
+  cout.flush(); \
+  rval |= 1; \
+}
+
+// the image dimensions
+const int ImageColumns = 32;
+const int ImageRows = 24;
+const int ImageSlices = 7;
+
+// a reader that provides access to the offsets of the pixel data
+class TestDICOMOffsetReader : public vtkDICOMReader
+{
+public:
+  static TestDICOMOffsetReader *New();
+  vtkTypeMacro(TestDICOMOffsetReader, vtkDICOMReader);
+
+  vtkTypeInt64Array *GetFileOffsetArray() { return this->FileOffsetArray; }
+
+protected:
+  TestDICOMOffsetReader() {}
+};
+
+vtkStandardNewMacro(TestDICOMOffsetReader);
+
+// an observer that keeps the first error message
+class TestDICOMErrorObserver : public vtkCommand
+{
+public:
+  static TestDICOMErrorObserver *New() { return new TestDICOMErrorObserver; }
+  vtkTypeMacro(TestDICOMErrorObserver, vtkCommand);
+
+  void Execute(vtkObject *, unsigned long, void *data) VTK_DICOM_OVERRIDE
+  {
+    if (this->Message.empty() && data)
+    {
+      this->Message = static_cast<char *>(data);
+    }
+  }
+
+  // get the parser's message, without the object addresses and lines
+  std::string GetParserMessage()
+  {
+    std::string text = this->Message;
+    size_t pos = text.find("vtkDICOMParser (");
+    if (pos != std::string::npos)
+    {
+      pos = text.find("): ", pos);
+      text = text.substr(pos == std::string::npos ? 0 : pos + 3);
+    }
+    return text.substr(0, text.find('\n'));
+  }
+
+  std::string Message;
+
+protected:
+  TestDICOMErrorObserver() {}
+};
+
+// write one slice of a series
+static bool WriteSlice(const std::string& fname, int slice)
+{
+  char uid[64];
+  snprintf(uid, sizeof(uid), "1.2.3.4.5.6.%d", slice + 1);
+
+  vtkDICOMMetaData *meta = vtkDICOMMetaData::New();
+  meta->Set(DC::SOPClassUID, "1.2.840.10008.5.1.4.1.1.7");
+  meta->Set(DC::SOPInstanceUID, uid);
+  meta->Set(DC::Modality, "OT");
+  meta->Set(DC::PatientName, "Test^Reader");
+  meta->Set(DC::StudyInstanceUID, "1.2.3.4.5");
+  meta->Set(DC::SeriesInstanceUID, "1.2.3.4.5.6");
+  meta->Set(DC::InstanceNumber, slice + 1);
+  double position[3] = { 0.0, 0.0, 2.5*slice };
+  double orientation[6] = { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0 };
+  double spacing[2] = { 0.75, 0.75 };
+  meta->Set(DC::ImagePositionPatient, vtkDICOMValue(vtkDICOMVR::DS,
+    position, 3));
+  meta->Set(DC::ImageOrientationPatient, vtkDICOMValue(vtkDICOMVR::DS,
+    orientation, 6));
+  meta->Set(DC::PixelSpacing, vtkDICOMValue(vtkDICOMVR::DS, spacing, 2));
+  // some attributes are only present for some of the slices
+  if (slice % 2 == 0)
+  {
+    meta->Set(DC::ImageComments, "Even slice");
+  }
+  if (slice >= 3)
+  {
+    meta->Set(DC::AcquisitionNumber, slice);
+  }
+  meta->Set(DC::SamplesPerPixel, 1);
+  meta->Set(DC::PhotometricInterpretation, "MONOCHROME2");
+  meta->Set(DC::Rows, ImageRows);
+  meta->Set(DC::Columns, ImageColumns);
+  meta->Set(DC::BitsAllocated, 16);
+  meta->Set(DC::BitsStored, 16);
+  meta->Set(DC::HighBit, 15);
+  meta->Set(DC::PixelRepresentation, 0);
+  unsigned short empty = 0;
+  meta->Set(DC::PixelData, vtkDICOMValue(vtkDICOMVR::OW, &empty, 0));
+
+  std::vector<unsigned short> pixels(ImageColumns*ImageRows);
+  for (size_t i = 0; i < pixels.size(); i++)
+  {
+    pixels[i] = static_cast<unsigned short>(i + 1000*slice);
+  }
+
+  vtkDICOMCompiler *compiler = vtkDICOMCompiler::New();
+  compiler->SetFileName(fname.c_str());
+  compiler->SetTransferSyntaxUID("1.2.840.10008.1.2.1");
+  compiler->SetSOPInstanceUID(uid);
+  compiler->SetSeriesInstanceUID("1.2.3.4.5.6");
+  compiler->SetStudyInstanceUID("1.2.3.4.5");
+  compiler->SetMetaData(meta);
+  compiler->WriteHeader();
+  compiler->WritePixelData(
+    reinterpret_cast<const unsigned char *>(&pixels[0]),
+    pixels.size()*sizeof(unsigned short));
+  compiler->Close();
+  bool success = (compiler->GetErrorCode() == 0);
+  compiler->Delete();
+  meta->Delete();
+  return success;
+}
+
+// cut a file short
+static bool TruncateFile(const std::string& fname, size_t size)
+{
+  std::vector<unsigned char> data(size);
+  vtkDICOMFile infile(fname.c_str(), vtkDICOMFile::In);
+  bool success = (infile.Read(&data[0], size) == size);
+  infile.Close();
+  if (success)
+  {
+    vtkDICOMFile outfile(fname.c_str(), vtkDICOMFile::Out);
+    success = (outfile.Write(&data[0], size) == size);
+    outfile.Close();
+  }
+  return success;
+}
+
+// read the headers of the files with the given number of threads
+static TestDICOMOffsetReader *ReadHeaders(
+  vtkStringArray *filenames, int numThreads, TestDICOMErrorObserver *errors)
+{
+  TestDICOMOffsetReader *reader = TestDICOMOffsetReader::New();
+  reader->AddObserver(vtkCommand::ErrorEvent, errors);
+  reader->SetNumberOfParserThreads(numThreads);
+  reader->SetFileNames(filenames);
+  reader->UpdateInformation();
+  return reader;
+}
+
+// compare the meta data and the offsets for the first n instances
+static int CompareReaders(
+  const char *exename, TestDICOMOffsetReader *reader1,
+  TestDICOMOffsetReader *reader2, int n)
+{
+  int rval = 0;
+
+  vtkDICOMMetaData *meta1 = reader1->GetMetaData();
+  vtkDICOMMetaData *meta2 = reader2->GetMetaData();
+  TestAssert(meta1->GetNumberOfInstances() == meta2->GetNumberOfInstances());
+  TestAssert(meta1->GetNumberOfDataElements() ==
+             meta2->GetNumberOfDataElements());
+
+  int badValues = 0;
+  vtkDICOMDataElementIterator iter;
+  for (iter = meta1->Begin(); iter != meta1->End(); ++iter)
+  {
+    vtkDICOMTag tag = iter->GetTag();
+    for (int i = 0; i < n; i++)
+    {
+      badValues += (meta1->Get(i, tag) != meta2->Get(i, tag));
+    }
+  }
+  TestAssert(badValues == 0);
+
+  vtkTypeInt64Array *offsets1 = reader1->GetFileOffsetArray();
+  vtkTypeInt64Array *offsets2 = reader2->GetFileOffsetArray();
+  TestAssert(offsets1->GetNumberOfTuples() == offsets2->GetNumberOfTuples());
+  int badOffsets = 0;
+  for (int i = 0; i < n; i++)
+  {
+    badOffsets += (offsets1->GetValue(2*i) != offsets2->GetValue(2*i) ||
+                   offsets1->GetValue(2*i + 1) != offsets2->GetValue(2*i + 1));
+    badOffsets += (offsets1->GetValue(2*i) <= 0);
+  }
+  TestAssert(badOffsets == 0);
+
+  return rval;
+}
+
+// check that reading the headers with threads gives the same results
+static int TestParserThreads(const char *exename, const std::string& dir)
+{
+  int rval = 0;
+
+  vtkDICOMFilePath path(dir);
+  vtkStringArray *filenames = vtkStringArray::New();
+  for (int i = 0; i < ImageSlices; i++)
+  {
+    char name[32];
+    snprintf(name, sizeof(name), "slice%02d.dcm", i);
+    std::string fname = path.Join(name);
+    TestAssert(WriteSlice(fname, i));
+    filenames->InsertNextValue(fname);
+  }
+
+  // read a valid series
+  TestDICOMErrorObserver *errors1 = TestDICOMErrorObserver::New();
+  TestDICOMErrorObserver *errors4 = TestDICOMErrorObserver::New();
+  TestDICOMOffsetReader *reader1 = ReadHeaders(filenames, 1, errors1);
+  TestDICOMOffsetReader *reader4 = ReadHeaders(filenames, 4, errors4);
+  TestAssert(reader1->GetErrorCode() == 0);
+  TestAssert(reader4->GetErrorCode() == 0);
+  TestAssert(errors1->Message.empty() && errors4->Message.empty());
+  rval |= CompareReaders(exename, reader1, reader4, ImageSlices);
+
+  // attributes that some slices lack must have no value for those slices
+  vtkDICOMMetaData *meta = reader4->GetMetaData();
+  TestAssert(meta->GetNumberOfInstances() == ImageSlices);
+  TestAssert(meta->Get(0, DC::ImageComments).AsString() == "Even slice");
+  TestAssert(!meta->Get(1, DC::ImageComments).IsValid());
+  TestAssert(!meta->Get(0, DC::AcquisitionNumber).IsValid());
+  TestAssert(meta->Get(5, DC::AcquisitionNumber).AsInt() == 5);
+  reader1->Delete();
+  reader4->Delete();
+  errors1->Delete();
+  errors4->Delete();
+
+  // corrupt a file in the middle of the series, and remove the last file,
+  // the first bad file (in file order) must be the one that is reported
+  int badSlice = ImageSlices/2;
+  std::string badName = filenames->GetValue(badSlice);
+  std::string lastName = filenames->GetValue(ImageSlices - 1);
+  TestAssert(TruncateFile(badName, 208));
+  vtkDICOMFile::Remove(lastName.c_str());
+
+  errors1 = TestDICOMErrorObserver::New();
+  errors4 = TestDICOMErrorObserver::New();
+  reader1 = ReadHeaders(filenames, 1, errors1);
+  reader4 = ReadHeaders(filenames, 4, errors4);
+  TestAssert(reader1->GetErrorCode() == vtkErrorCode::FileFormatError);
+  TestAssert(reader4->GetErrorCode() == reader1->GetErrorCode());
+  std::string message = errors1->GetParserMessage();
+  TestAssert(message.find(badName) != std::string::npos);
+  TestAssert(errors4->GetParserMessage() == message);
+  rval |= CompareReaders(exename, reader1, reader4, badSlice);
+  reader1->Delete();
+  reader4->Delete();
+  errors1->Delete();
+  errors4->Delete();
+
+  for (int i = 0; i < ImageSlices; i++)
+  {
+    vtkDICOMFile::Remove(filenames->GetValue(i).c_str());
+  }
+  filenames->Delete();
+
+  return rval;
+}
+
+int TestDICOMReader(int argc, char *argv[])
+{
+  int rval = 0;
+  const char *exename = (argc > 0 ? argv[0] : "TestDICOMReader");
+
+  // remove path portion of exename
+  const char *cp = exename + strlen(exename);
+  while (cp != exename && cp[-1] != '\\' && cp[-1] != '/') { --cp; }
+  exename = cp;
+
+  // create a directory for the test files
+  std::string dirname = "TestDICOMReader.tmp";
+  vtkDICOMFileDirectory::Create(dirname.c_str());
+
+  rval |= TestParserThreads(exename, dirname);
+
+  return rval;
+}
+
+#ifdef VTK_DICOM_SEPARATE_TESTS
+int main(int argc, char *argv[])
+{
+  return TestDICOMReader(argc, argv);
+}
+#endif
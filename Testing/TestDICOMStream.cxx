@@ -0,0 +1,198 @@
+#include "vtkDICOMStream.h"
+#include "vtkDICOMCompiler.h"
+#include "vtkDICOMParser.h"
+#include "vtkDICOMReader.h"
+#include "vtkDICOMMetaData.h"
+
+#include "vtkImageData.h"
+
+#include <vector>
+
+#include <string.h>
+#include <stdlib.h>
+
+// macro for performing tests
+#define TestAssert(t) \
+if (!(t)) \
+{ \
+  cout << exename << ": Assertion Failed: " << #t << "\n"; \
+  cout << __FILE__ << ":" << __LINE__ << "\n"; \
+  cout.flush(); \
+  rval |= 1; \
+}
+
+// a stream that reads from memory, but cannot report its size
+class UnknownSizeStream : public vtkDICOMStream
+{
+public:
+  UnknownSizeStream(const unsigned char *data, size_t size)
+    : Data(data), DataSize(size), Position(0) {}
+
+  size_t Read(unsigned char *data, size_t size) VTK_DICOM_OVERRIDE
+  {
+    size_t n = (this->Position < this->DataSize ?
+                this->DataSize - this->Position : 0);
+    n = (size < n ? size : n);
+    memcpy(data, this->Data + this->Position, n);
+    this->Position += n;
+    return n;
+  }
+
+  bool SetPosition(Size offset) VTK_DICOM_OVERRIDE
+  {
+    this->Position = static_cast<size_t>(offset);
+    return true;
+  }
+
+private:
+  const unsigned char *Data;
+  size_t DataSize;
+  size_t Position;
+};
+
+// the image dimensions and the size of the large value
+const int ImageColumns = 64;
+const int ImageRows = 48;
+const size_t DocumentSize = 20000;
+
+// create a small image with one value that is larger than the buffer
+static vtkDICOMMetaData *CreateMetaData(std::vector<unsigned char> *doc)
+{
+  doc->resize(DocumentSize);
+  for (size_t i = 0; i < DocumentSize; i++)
+  {
+    (*doc)[i] = static_cast<unsigned char>(i % 251);
+  }
+
+  vtkDICOMMetaData *meta = vtkDICOMMetaData::New();
+  meta->Set(DC::SOPClassUID, "1.2.840.10008.5.1.4.1.1.7");
+  meta->Set(DC::SOPInstanceUID, "1.2.3.4.5.6.7");
+  meta->Set(DC::Modality, "OT");
+  meta->Set(DC::PatientName, "Test^Stream");
+  meta->Set(DC::PatientID, "P001");
+  meta->Set(DC::StudyInstanceUID, "1.2.3.4.5");
+  meta->Set(DC::SeriesInstanceUID, "1.2.3.4.5.6");
+  meta->Set(DC::SamplesPerPixel, 1);
+  meta->Set(DC::PhotometricInterpretation, "MONOCHROME2");
+  meta->Set(DC::Rows, ImageRows);
+  meta->Set(DC::Columns, ImageColumns);
+  meta->Set(DC::BitsAllocated, 16);
+  meta->Set(DC::BitsStored, 16);
+  meta->Set(DC::HighBit, 15);
+  meta->Set(DC::PixelRepresentation, 0);
+  meta->Set(DC::EncapsulatedDocument,
+    vtkDICOMValue(vtkDICOMVR::OB, &(*doc)[0], DocumentSize));
+  unsigned short empty = 0;
+  meta->Set(DC::PixelData, vtkDICOMValue(vtkDICOMVR::OW, &empty, 0));
+
+  return meta;
+}
+
+// read the data from the stream, and check it against the original
+static int TestRead(const char *exename, vtkDICOMStream *stream,
+  const std::vector<unsigned char>& doc,
+  const std::vector<unsigned short>& pixels)
+{
+  int rval = 0;
+
+  // check the meta data
+  vtkDICOMMetaData *meta = vtkDICOMMetaData::New();
+  vtkDICOMParser *parser = vtkDICOMParser::New();
+  parser->SetMetaData(meta);
+  parser->SetInputStream(stream);
+  parser->Update();
+  TestAssert(parser->GetErrorCode() == 0);
+  TestAssert(parser->GetPixelDataFound());
+  TestAssert(meta->Get(DC::PatientName).AsString() == "Test^Stream");
+  TestAssert(meta->Get(DC::Rows).AsInt() == ImageRows);
+  const vtkDICOMValue& v = meta->Get(DC::EncapsulatedDocument);
+  TestAssert(v.GetVL() == DocumentSize);
+  if (v.GetVL() == DocumentSize)
+  {
+    TestAssert(memcmp(v.GetUnsignedCharData(), &doc[0], DocumentSize) == 0);
+  }
+  parser->Delete();
+  meta->Delete();
+
+  // check the pixel data
+  vtkDICOMReader *reader = vtkDICOMReader::New();
+  reader->SetInputStream(stream);
+  reader->SetMemoryRowOrderToFileNative();
+  reader->Update();
+  TestAssert(reader->GetErrorCode() == 0);
+  vtkImageData *image = reader->GetOutput();
+  int dims[3];
+  image->GetDimensions(dims);
+  TestAssert(dims[0] == ImageColumns && dims[1] == ImageRows && dims[2] == 1);
+  TestAssert(image->GetScalarType() == VTK_UNSIGNED_SHORT);
+  if (dims[0] == ImageColumns && dims[1] == ImageRows && dims[2] == 1 &&
+      image->GetScalarType() == VTK_UNSIGNED_SHORT)
+  {
+    TestAssert(memcmp(image->GetScalarPointer(), &pixels[0],
+                      pixels.size()*sizeof(unsigned short)) == 0);
+  }
+  reader->Delete();
+
+  return rval;
+}
+
+int TestDICOMStream(int argc, char *argv[])
+{
+  int rval = 0;
+  const char *exename = (argc > 0 ? argv[0] : "TestDICOMStream");
+
+  // remove path portion of exename
+  const char *cp = exename + strlen(exename);
+  while (cp != exename && cp[-1] != '\\' && cp[-1] != '/') { --cp; }
+  exename = cp;
+
+  std::vector<unsigned char> doc;
+  vtkDICOMMetaData *meta = CreateMetaData(&doc);
+
+  std::vector<unsigned short> pixels(ImageColumns*ImageRows);
+  for (size_t i = 0; i < pixels.size(); i++)
+  {
+    pixels[i] = static_cast<unsigned short>(i*7);
+  }
+
+  // write the file to memory
+  vtkDICOMMemoryStream output;
+  vtkDICOMCompiler *compiler = vtkDICOMCompiler::New();
+  compiler->SetOutputStream(&output);
+  compiler->SetTransferSyntaxUID("1.2.840.10008.1.2.1");
+  compiler->SetMetaData(meta);
+  compiler->WriteHeader();
+  compiler->WritePixelData(
+    reinterpret_cast<const unsigned char *>(&pixels[0]),
+    pixels.size()*sizeof(unsigned short));
+  compiler->Close();
+  TestAssert(compiler->GetErrorCode() == 0);
+  compiler->Delete();
+  meta->Delete();
+
+  // the pixel data is at the end of the file
+  size_t size = static_cast<size_t>(output.GetSize());
+  TestAssert(size > DocumentSize + pixels.size()*sizeof(unsigned short));
+  TestAssert(memcmp(output.GetData() + size -
+                    pixels.size()*sizeof(unsigned short),
+                    &pixels[0], pixels.size()*sizeof(unsigned short)) == 0);
+
+  { // test reading from memory
+  vtkDICOMMemoryStream input(output.GetData(), size);
+  rval |= TestRead(exename, &input, doc, pixels);
+  }
+
+  { // test reading from a stream of unknown size
+  UnknownSizeStream input(output.GetData(), size);
+  rval |= TestRead(exename, &input, doc, pixels);
+  }
+
+  return rval;
+}
+
+#ifdef VTK_DICOM_SEPARATE_TESTS
+int main(int argc, char *argv[])
+{
+  return TestDICOMStream(argc, argv);
+}
+#endif
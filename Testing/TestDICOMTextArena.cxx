@@ -0,0 +1,143 @@
+#include "vtkDICOMTextArena.h"
+#include "vtkDICOMMetaData.h"
+#include "vtkDICOMItem.h"
+#include "vtkDICOMDictionary.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+// macro for performing tests
+#define TestAssert(t) \
+if (!(t)) \
+{ \
+  cout << exename << ": Assertion Failed: " << #t << "\n"; \
+  cout << __FILE__ << ":" << __LINE__ << "\n"; \
+  cout.flush(); \
+  rval |= 1; \
+}
+
+// find the entry with the given path, or return -1
+static int FindEntry(const vtkDICOMTextArena& arena, const vtkDICOMTagPath& p)
+{
+  for (size_t i = 0; i < arena.GetNumberOfEntries(); i++)
+  {
+    if (arena.GetPath(i) == p)
+    {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+int TestDICOMTextArena(int argc, char *argv[])
+{
+  int rval = 0;
+  const char *exename = (argc > 0 ? argv[0] : "TestDICOMTextArena");
+
+  // remove path portion of exename
+  const char *cp = exename + strlen(exename);
+  while (cp != exename && cp[-1] != '\\' && cp[-1] != '/') { --cp; }
+  exename = cp;
+
+  vtkDICOMMetaData *meta = vtkDICOMMetaData::New();
+  meta->SetNumberOfInstances(2);
+  meta->Set(DC::SpecificCharacterSet, "ISO_IR 100");
+  meta->Set(DC::PatientName, "Buc^J\xe9r\xf4me ");
+  meta->Set(DC::ImageType, "ORIGINAL\\PRIMARY\\AXIAL");
+  meta->Set(DC::Rows, 256);
+  meta->Set(0, DC::SOPInstanceUID, "1.2.3.4");
+  meta->Set(1, DC::SOPInstanceUID, "1.2.3.5");
+  meta->Set(vtkDICOMTagPath(DC::ConceptNameCodeSequence, 0, DC::CodeMeaning),
+            "Caf\xe9");
+
+  { // test conversion of the meta data
+  vtkDICOMTextArena arena;
+  arena.AddMetaData(meta, 1);
+
+  // the numeric Rows attribute is not included
+  TestAssert(arena.GetNumberOfEntries() == 5);
+  TestAssert(FindEntry(arena, vtkDICOMTagPath(DC::Rows)) == -1);
+
+  int i = FindEntry(arena, vtkDICOMTagPath(DC::PatientName));
+  TestAssert(i >= 0);
+  if (i >= 0)
+  {
+    TestAssert(strcmp(arena.GetText(i), "Buc^J\xc3\xa9r\xc3\xb4me") == 0);
+    TestAssert(arena.GetLength(i) == strlen(arena.GetText(i)));
+    TestAssert(arena.GetVR(i) == vtkDICOMVR::PN);
+    TestAssert(arena.GetData() + arena.GetOffset(i) == arena.GetText(i));
+  }
+
+  i = FindEntry(arena, vtkDICOMTagPath(DC::ImageType));
+  TestAssert(i >= 0);
+  if (i >= 0)
+  {
+    TestAssert(strcmp(arena.GetText(i), "ORIGINAL\\PRIMARY\\AXIAL") == 0);
+  }
+
+  // per-instance values are chosen according to the index
+  i = FindEntry(arena, vtkDICOMTagPath(DC::SOPInstanceUID));
+  TestAssert(i >= 0);
+  if (i >= 0)
+  {
+    TestAssert(strcmp(arena.GetText(i), "1.2.3.5") == 0);
+  }
+
+  // values within sequences are included
+  i = FindEntry(arena, vtkDICOMTagPath(
+    DC::ConceptNameCodeSequence, 0, DC::CodeMeaning));
+  TestAssert(i >= 0);
+  if (i >= 0)
+  {
+    TestAssert(strcmp(arena.GetText(i), "Caf\xc3\xa9") == 0);
+  }
+
+  // each entry is followed by a null in the buffer
+  size_t total = 0;
+  for (size_t j = 0; j < arena.GetNumberOfEntries(); j++)
+  {
+    total += arena.GetLength(j) + 1;
+  }
+  TestAssert(total == arena.GetDataSize());
+
+  // after clearing, the arena can be re-used
+  arena.Clear();
+  TestAssert(arena.GetNumberOfEntries() == 0);
+  TestAssert(arena.GetDataSize() == 0);
+  arena.AddMetaData(meta, 0);
+  i = FindEntry(arena, vtkDICOMTagPath(DC::SOPInstanceUID));
+  TestAssert(i >= 0);
+  if (i >= 0)
+  {
+    TestAssert(strcmp(arena.GetText(i), "1.2.3.4") == 0);
+  }
+  }
+
+  { // test conversion of an item
+  vtkDICOMItem item(meta);
+  item.Set(DC::CodeValue, "T-A0100");
+  item.Set(DC::CodeMeaning, "Cerveau pr\xe9""frontal");
+  item.Set(DC::MappedPixelValue, 10);
+
+  vtkDICOMTextArena arena;
+  arena.AddItem(item);
+  TestAssert(arena.GetNumberOfEntries() == 2);
+  int i = FindEntry(arena, vtkDICOMTagPath(DC::CodeMeaning));
+  TestAssert(i >= 0);
+  if (i >= 0)
+  {
+    TestAssert(strcmp(arena.GetText(i), "Cerveau pr\xc3\xa9""frontal") == 0);
+  }
+  }
+
+  meta->Delete();
+
+  return rval;
+}
+
+#ifdef VTK_DICOM_SEPARATE_TESTS
+int main(int argc, char *argv[])
+{
+  return TestDICOMTextArena(argc, argv);
+}
+#endif
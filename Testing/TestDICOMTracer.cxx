@@ -0,0 +1,303 @@
+#include "vtkDICOMTracer.h"
+#include "vtkDICOMChromeTracer.h"
+#include "vtkDICOMCompiler.h"
+#include "vtkDICOMParser.h"
+#include "vtkDICOMMetaData.h"
+#include "vtkDICOMFile.h"
+#include "vtkDICOMFileDirectory.h"
+#include "vtkDICOMFilePath.h"
+
+#include "vtkObjectFactory.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <string.h>
+#include <stdlib.h>
+
+// macro for performing tests
+#define TestAssert(t) \
+if (!(t)) \
+{ \
+  cout << exename << ": Assertion Failed: " << #t << "\n"; \
+  cout << __FILE__ << ":" << __LINE__ << "\n"; \
+  cout.flush(); \
+  rval |= 1; \
+}
+
+// the image dimensions
+const int ImageColumns = 64;
+const int ImageRows = 48;
+
+// a tracer that keeps a record of every span
+class TestRecordingTracer : public vtkDICOMTracer
+{
+public:
+  static TestRecordingTracer *New();
+  vtkTypeMacro(TestRecordingTracer, vtkDICOMTracer);
+
+  struct Event
+  {
+    std::string Name;
+    std::string Phase;
+    std::string FileName;
+    vtkTypeInt64 Bytes;
+  };
+
+  void BeginSpan(const char *name, const char *filename) VTK_DICOM_OVERRIDE
+  {
+    this->AddEvent(name, "B", filename, -1);
+  }
+
+  void EndSpan(const char *name, const char *filename,
+               vtkTypeInt64 bytes) VTK_DICOM_OVERRIDE
+  {
+    this->AddEvent(name, "E", filename, bytes);
+  }
+
+  std::vector<Event> Events;
+
+protected:
+  TestRecordingTracer() {}
+
+  void AddEvent(const char *name, const char *phase,
+                const char *filename, vtkTypeInt64 bytes)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    Event e;
+    e.Name = name;
+    e.Phase = phase;
+    e.FileName = filename;
+    e.Bytes = bytes;
+    this->Events.push_back(e);
+  }
+
+  std::mutex Mutex;
+};
+
+vtkStandardNewMacro(TestRecordingTracer);
+
+// write a small image to a file
+static bool WriteImage(const std::string& fname, bool changeName)
+{
+  vtkDICOMMetaData *meta = vtkDICOMMetaData::New();
+  meta->Set(DC::SOPClassUID, "1.2.840.10008.5.1.4.1.1.7");
+  meta->Set(DC::Modality, "OT");
+  meta->Set(DC::PatientName, "Test^Tracer");
+  meta->Set(DC::SamplesPerPixel, 1);
+  meta->Set(DC::PhotometricInterpretation, "MONOCHROME2");
+  meta->Set(DC::Rows, ImageRows);
+  meta->Set(DC::Columns, ImageColumns);
+  meta->Set(DC::BitsAllocated, 16);
+  meta->Set(DC::BitsStored, 16);
+  meta->Set(DC::HighBit, 15);
+  meta->Set(DC::PixelRepresentation, 0);
+  unsigned short empty = 0;
+  meta->Set(DC::PixelData, vtkDICOMValue(vtkDICOMVR::OW, &empty, 0));
+
+  std::vector<unsigned short> pixels(ImageColumns*ImageRows);
+  for (size_t i = 0; i < pixels.size(); i++)
+  {
+    pixels[i] = static_cast<unsigned short>(i);
+  }
+
+  vtkDICOMCompiler *compiler = vtkDICOMCompiler::New();
+  compiler->SetFileName(fname.c_str());
+  compiler->SetTransferSyntaxUID("1.2.840.10008.1.2.1");
+  compiler->SetMetaData(meta);
+  compiler->WriteHeader();
+  compiler->WritePixelData(
+    reinterpret_cast<const unsigned char *>(&pixels[0]),
+    pixels.size()*sizeof(unsigned short));
+  if (changeName)
+  {
+    // the span must not refer to the old name
+    compiler->SetFileName("changed.dcm");
+  }
+  compiler->Close();
+  bool success = (compiler->GetErrorCode() == 0);
+  compiler->Delete();
+  meta->Delete();
+  return success;
+}
+
+// parse a file, and return the error code
+static unsigned long ParseFile(const std::string& fname)
+{
+  vtkDICOMMetaData *meta = vtkDICOMMetaData::New();
+  vtkDICOMParser *parser = vtkDICOMParser::New();
+  parser->SetMetaData(meta);
+  parser->SetFileName(fname.c_str());
+  parser->Update();
+  unsigned long errorCode = parser->GetErrorCode();
+  parser->Delete();
+  meta->Delete();
+  return errorCode;
+}
+
+// get the size of a file
+static vtkTypeInt64 FileSize(const std::string& fname)
+{
+  vtkDICOMFile infile(fname.c_str(), vtkDICOMFile::In);
+  vtkTypeInt64 size = infile.GetSize();
+  infile.Close();
+  return size;
+}
+
+// read a whole text file
+static std::string ReadText(const std::string& fname)
+{
+  std::string text;
+  vtkDICOMFile infile(fname.c_str(), vtkDICOMFile::In);
+  size_t size = static_cast<size_t>(infile.GetSize());
+  if (!infile.GetError() && size > 0)
+  {
+    std::vector<unsigned char> data(size);
+    size = infile.Read(&data[0], size);
+    text.assign(reinterpret_cast<char *>(&data[0]), size);
+  }
+  infile.Close();
+  return text;
+}
+
+// test the spans that are reported to a tracer
+static int TestSpans(const char *exename, const std::string& dir)
+{
+  int rval = 0;
+
+  vtkDICOMFilePath path(dir);
+  std::string fname = path.Join("image.dcm");
+  std::string missing = path.Join("missing.dcm");
+
+  TestRecordingTracer *tracer = TestRecordingTracer::New();
+  vtkDICOMTracer::SetGlobalTracer(tracer);
+  TestAssert(vtkDICOMTracer::GetGlobalTracer() == tracer);
+
+  // the write span must include the pixel data
+  TestAssert(WriteImage(fname, true));
+  vtkTypeInt64 size = FileSize(fname);
+  TestAssert(size > 2*ImageColumns*ImageRows);
+  TestAssert(tracer->Events.size() == 2);
+  if (tracer->Events.size() == 2)
+  {
+    const TestRecordingTracer::Event *e = &tracer->Events[0];
+    TestAssert(e[0].Name == "Write" && e[0].Phase == "B");
+    TestAssert(e[0].FileName == fname);
+    TestAssert(e[1].Name == "Write" && e[1].Phase == "E");
+    TestAssert(e[1].FileName == fname);
+    TestAssert(e[1].Bytes == size);
+  }
+  tracer->Events.clear();
+
+  // the parser stops at the pixel data
+  TestAssert(ParseFile(fname) == 0);
+  TestAssert(tracer->Events.size() == 2);
+  if (tracer->Events.size() == 2)
+  {
+    const TestRecordingTracer::Event *e = &tracer->Events[0];
+    TestAssert(e[0].Name == "Parse" && e[0].Phase == "B");
+    TestAssert(e[0].FileName == fname);
+    TestAssert(e[1].Name == "Parse" && e[1].Phase == "E");
+    TestAssert(e[1].FileName == fname);
+    TestAssert(e[1].Bytes > 0 && e[1].Bytes <= size);
+  }
+  tracer->Events.clear();
+
+  // a failed operation reports zero bytes
+  TestAssert(ParseFile(missing) != 0);
+  TestAssert(tracer->Events.size() == 2);
+  if (tracer->Events.size() == 2)
+  {
+    TestAssert(tracer->Events[1].Phase == "E");
+    TestAssert(tracer->Events[1].Bytes == 0);
+  }
+  tracer->Events.clear();
+
+  // nothing is reported after the tracer is removed
+  vtkDICOMTracer::SetGlobalTracer(nullptr);
+  TestAssert(vtkDICOMTracer::GetGlobalTracer() == nullptr);
+  TestAssert(WriteImage(fname, false));
+  TestAssert(ParseFile(fname) == 0);
+  TestAssert(tracer->Events.empty());
+  tracer->Delete();
+
+  vtkDICOMFile::Remove(fname.c_str());
+
+  return rval;
+}
+
+// test the tracer that writes a JSON file for chrome://tracing
+static int TestChromeTracer(const char *exename, const std::string& dir)
+{
+  int rval = 0;
+
+  vtkDICOMFilePath path(dir);
+  std::string fname = path.Join("image.dcm");
+  std::string jname = path.Join("trace.json");
+
+  vtkDICOMChromeTracer *tracer = vtkDICOMChromeTracer::New();
+  tracer->SetFileName(jname.c_str());
+  vtkDICOMTracer::SetGlobalTracer(tracer);
+  TestAssert(WriteImage(fname, false));
+  TestAssert(ParseFile(fname) == 0);
+  vtkDICOMTracer::SetGlobalTracer(nullptr);
+  tracer->Close();
+  tracer->Delete();
+
+  char bytesText[64];
+  snprintf(bytesText, sizeof(bytesText), "\"bytes\":%lld",
+           static_cast<long long>(FileSize(fname)));
+
+  // check for the events, without doing a full JSON parse
+  std::string text = ReadText(jname);
+  TestAssert(text.size() > 4);
+  TestAssert(text.compare(0, 2, "[\n") == 0);
+  TestAssert(text.compare(text.size() - 3, 3, "\n]\n") == 0);
+  TestAssert(text.find("{\"name\":\"Write\"") != std::string::npos);
+  TestAssert(text.find("{\"name\":\"Parse\"") != std::string::npos);
+  TestAssert(text.find(bytesText) != std::string::npos);
+
+  size_t begins = 0;
+  size_t ends = 0;
+  size_t pos = 0;
+  while ((pos = text.find("\"ph\":\"", pos)) != std::string::npos)
+  {
+    pos += 6;
+    begins += (text[pos] == 'B');
+    ends += (text[pos] == 'E');
+  }
+  TestAssert(begins == 2 && ends == 2);
+
+  vtkDICOMFile::Remove(fname.c_str());
+  vtkDICOMFile::Remove(jname.c_str());
+
+  return rval;
+}
+
+int TestDICOMTracer(int argc, char *argv[])
+{
+  int rval = 0;
+  const char *exename = (argc > 0 ? argv[0] : "TestDICOMTracer");
+
+  // remove path portion of exename
+  const char *cp = exename + strlen(exename);
+  while (cp != exename && cp[-1] != '\\' && cp[-1] != '/') { --cp; }
+  exename = cp;
+
+  // create a directory for the test files
+  std::string dirname = "TestDICOMTracer.tmp";
+  vtkDICOMFileDirectory::Create(dirname.c_str());
+
+  rval |= TestSpans(exename, dirname);
+  rval |= TestChromeTracer(exename, dirname);
+
+  return rval;
+}
+
+#ifdef VTK_DICOM_SEPARATE_TESTS
+int main(int argc, char *argv[])
+{
+  return TestDICOMTracer(argc, argv);
+}
+#endif
@@ -0,0 +1,214 @@
+#include "vtkDICOMTranscoder.h"
+#include "vtkDICOMCompiler.h"
+#include "vtkDICOMParser.h"
+#include "vtkDICOMMetaData.h"
+#include "vtkDICOMFile.h"
+#include "vtkDICOMFileDirectory.h"
+#include "vtkDICOMFilePath.h"
+
+#include <string>
+#include <vector>
+
+#include <string.h>
+#include <stdlib.h>
+
+// macro for performing tests
+#define TestAssert(t) \
+if (!(t)) \
+{ \
+  cout << exename << ": Assertion Failed: " << #t << "\n"; \
+  cout << __FILE__ << ":" << __LINE__ << "\n"; \
+  cout.flush(); \
+  rval |= 1; \
+}
+
+// the image dimensions
+const int ImageColumns = 33;
+const int ImageRows = 20;
+const int ImageFrames = 3;
+
+// write a multi-frame image in explicit little endian
+static bool WriteImage(
+  const std::string& fname, const std::vector<unsigned char>& pixels)
+{
+  vtkDICOMMetaData *meta = vtkDICOMMetaData::New();
+  meta->Set(DC::SOPClassUID, "1.2.840.10008.5.1.4.1.1.7.3");
+  meta->Set(DC::SOPInstanceUID, "1.2.3.4.5.6.7");
+  meta->Set(DC::Modality, "OT");
+  meta->Set(DC::PatientName, "Test^Transcoder");
+  meta->Set(DC::StudyInstanceUID, "1.2.3.4.5");
+  meta->Set(DC::SeriesInstanceUID, "1.2.3.4.5.6");
+  meta->Set(DC::NumberOfFrames, ImageFrames);
+  meta->Set(DC::SamplesPerPixel, 1);
+  meta->Set(DC::PhotometricInterpretation, "MONOCHROME2");
+  meta->Set(DC::Rows, ImageRows);
+  meta->Set(DC::Columns, ImageColumns);
+  meta->Set(DC::BitsAllocated, 16);
+  meta->Set(DC::BitsStored, 16);
+  meta->Set(DC::HighBit, 15);
+  meta->Set(DC::PixelRepresentation, 0);
+  unsigned short empty = 0;
+  meta->Set(DC::PixelData, vtkDICOMValue(vtkDICOMVR::OW, &empty, 0));
+
+  vtkDICOMCompiler *compiler = vtkDICOMCompiler::New();
+  compiler->SetFileName(fname.c_str());
+  compiler->SetTransferSyntaxUID("1.2.840.10008.1.2.1");
+  compiler->SetSOPInstanceUID("1.2.3.4.5.6.7");
+  compiler->SetSeriesInstanceUID("1.2.3.4.5.6");
+  compiler->SetStudyInstanceUID("1.2.3.4.5");
+  compiler->SetMetaData(meta);
+  compiler->WriteHeader();
+  compiler->WritePixelData(&pixels[0], pixels.size());
+  compiler->Close();
+  bool success = (compiler->GetErrorCode() == 0);
+  compiler->Delete();
+  meta->Delete();
+  return success;
+}
+
+// read the meta data, and the raw bytes from the PixelData onwards
+static bool ReadImage(
+  const std::string& fname, vtkDICOMMetaData *meta,
+  unsigned int *vl, std::vector<unsigned char> *data)
+{
+  vtkDICOMParser *parser = vtkDICOMParser::New();
+  parser->SetMetaData(meta);
+  parser->SetFileName(fname.c_str());
+  parser->Update();
+  bool success = (parser->GetErrorCode() == 0 &&
+                  parser->GetPixelDataFound());
+  vtkTypeInt64 offset = parser->GetFileOffset();
+  *vl = parser->GetPixelDataVL();
+  parser->Delete();
+
+  data->clear();
+  if (success)
+  {
+    vtkDICOMFile infile(fname.c_str(), vtkDICOMFile::In);
+    size_t size = static_cast<size_t>(infile.GetSize() - offset);
+    data->resize(size);
+    success = (infile.SetPosition(offset) && size > 0 &&
+               infile.Read(&(*data)[0], size) == size);
+    infile.Close();
+  }
+
+  return success;
+}
+
+// convert a file to a new transfer syntax
+static bool Transcode(
+  const std::string& inname, const std::string& outname,
+  const char *syntax, int bufferSize)
+{
+  vtkDICOMTranscoder *transcoder = vtkDICOMTranscoder::New();
+  transcoder->SetFileName(inname.c_str());
+  transcoder->SetOutputFileName(outname.c_str());
+  transcoder->SetTransferSyntaxUID(syntax);
+  transcoder->SetBufferSize(bufferSize);
+  bool success = transcoder->Transcode();
+  success &= (transcoder->GetErrorCode() == 0);
+  transcoder->Delete();
+  return success;
+}
+
+// test a lossless round trip through several transfer syntaxes
+static int TestRoundTrip(const char *exename, const std::string& dir)
+{
+  int rval = 0;
+
+  vtkDICOMFilePath path(dir);
+  std::string source = path.Join("explicit.dcm");
+  std::string rle = path.Join("rle.dcm");
+  std::string big = path.Join("big.dcm");
+  std::string implicit = path.Join("implicit.dcm");
+
+  // use values that make RLE runs as well as literals
+  size_t n = ImageColumns*ImageRows*ImageFrames;
+  std::vector<unsigned char> pixels(2*n);
+  std::vector<unsigned char> swapped(2*n);
+  for (size_t i = 0; i < n; i++)
+  {
+    unsigned int v = static_cast<unsigned int>(
+      (i % 50 < 20) ? 0x1234 : (i*2654435761u) >> 16);
+    pixels[2*i] = static_cast<unsigned char>(v);
+    pixels[2*i + 1] = static_cast<unsigned char>(v >> 8);
+    swapped[2*i] = pixels[2*i + 1];
+    swapped[2*i + 1] = pixels[2*i];
+  }
+
+  TestAssert(WriteImage(source, pixels));
+
+  // explicit little endian to RLE
+  TestAssert(Transcode(source, rle, "1.2.840.10008.1.2.5", 8192));
+  unsigned int vl = 0;
+  std::vector<unsigned char> data;
+  vtkDICOMMetaData *meta = vtkDICOMMetaData::New();
+  TestAssert(ReadImage(rle, meta, &vl, &data));
+  TestAssert(meta->Get(DC::TransferSyntaxUID).AsString() ==
+             "1.2.840.10008.1.2.5");
+  TestAssert(vl == 0xffffffffu);
+  TestAssert(data.size() < pixels.size());
+
+  // RLE to explicit big endian, with a tiny buffer
+  TestAssert(Transcode(rle, big, "1.2.840.10008.1.2.2", 256));
+  meta->Initialize();
+  TestAssert(ReadImage(big, meta, &vl, &data));
+  TestAssert(meta->Get(DC::TransferSyntaxUID).AsString() ==
+             "1.2.840.10008.1.2.2");
+  TestAssert(vl == swapped.size());
+  TestAssert(data == swapped);
+
+  // explicit big endian to implicit little endian
+  TestAssert(Transcode(big, implicit, "1.2.840.10008.1.2", 8192));
+  meta->Initialize();
+  TestAssert(ReadImage(implicit, meta, &vl, &data));
+  TestAssert(meta->Get(DC::TransferSyntaxUID).AsString() ==
+             "1.2.840.10008.1.2");
+  TestAssert(vl == pixels.size());
+  TestAssert(data == pixels);
+
+  // the header must survive the trip
+  TestAssert(meta->Get(DC::PatientName).AsString() == "Test^Transcoder");
+  TestAssert(meta->Get(DC::SOPInstanceUID).AsString() == "1.2.3.4.5.6.7");
+  TestAssert(meta->Get(DC::NumberOfFrames).AsInt() == ImageFrames);
+  meta->Delete();
+
+  // deflated input can't be transcoded, since it can't be seeked
+  TestAssert(!vtkDICOMTranscoder::CanTranscode(
+    "1.2.840.10008.1.2.1.99", "1.2.840.10008.1.2.1"));
+  TestAssert(vtkDICOMTranscoder::CanTranscode(
+    "1.2.840.10008.1.2.1", "1.2.840.10008.1.2.1.99"));
+
+  vtkDICOMFile::Remove(source.c_str());
+  vtkDICOMFile::Remove(rle.c_str());
+  vtkDICOMFile::Remove(big.c_str());
+  vtkDICOMFile::Remove(implicit.c_str());
+
+  return rval;
+}
+
+int TestDICOMTranscoder(int argc, char *argv[])
+{
+  int rval = 0;
+  const char *exename = (argc > 0 ? argv[0] : "TestDICOMTranscoder");
+
+  // remove path portion of exename
+  const char *cp = exename + strlen(exename);
+  while (cp != exename && cp[-1] != '\\' && cp[-1] != '/') { --cp; }
+  exename = cp;
+
+  // create a directory for the test files
+  std::string dirname = "TestDICOMTranscoder.tmp";
+  vtkDICOMFileDirectory::Create(dirname.c_str());
+
+  rval |= TestRoundTrip(exename, dirname);
+
+  return rval;
+}
+
+#ifdef VTK_DICOM_SEPARATE_TESTS
+int main(int argc, char *argv[])
+{
+  return TestDICOMTranscoder(argc, argv);
+}
+#endif
@@ -0,0 +1,227 @@
+#include "vtkNIFTIWriter.h"
+#include "vtkNIFTIReader.h"
+#include "vtkDICOMFile.h"
+#include "vtkDICOMFileDirectory.h"
+#include "vtkDICOMFilePath.h"
+
+#include "vtkImageAlgorithm.h"
+#include "vtkImageData.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkMatrix4x4.h"
+#include "vtkObjectFactory.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+
+#include <string>
+#include <vector>
+
+#include <string.h>
+#include <stdlib.h>
+
+// macro for performing tests
+#define TestAssert(t) \
+if (!(t)) \
+{ \
+  cout << exename << ": Assertion Failed: " << #t << "\n"; \
+  cout << __FILE__ << ":" << __LINE__ << "\n"; \
+  cout.flush(); \
+  rval |= 1; \
+}
+
+// the image dimensions, the number of slices is not a multiple of the chunk
+const int ImageColumns = 23;
+const int ImageRows = 17;
+const int ImageSlices = 19;
+const int ChunkSlices = 4;
+
+// a source that generates only the slices that are requested
+class TestNIFTIStreamingSource : public vtkImageAlgorithm
+{
+public:
+  static TestNIFTIStreamingSource *New();
+  vtkTypeMacro(TestNIFTIStreamingSource, vtkImageAlgorithm);
+
+  //! Set the number of scalar components.
+  void SetNumberOfComponents(int n) {
+    this->NumberOfComponents = n; this->Modified(); }
+
+  //! Get the value of a voxel.
+  static short GetVoxel(int i, int j, int k, int c) {
+    return static_cast<short>((i*3 + j*101 + k*1009 + c*17) % 30000 - 15000);
+  }
+
+  //! Get the slice extents that were requested, since the last reset.
+  const std::vector<int>& GetRequestedSlices() { return this->Requests; }
+  void ResetRequestedSlices() { this->Requests.clear(); }
+
+protected:
+  TestNIFTIStreamingSource() : NumberOfComponents(1) {
+    this->SetNumberOfInputPorts(0);
+  }
+
+  int RequestInformation(vtkInformation *,
+                         vtkInformationVector **,
+                         vtkInformationVector *outputVector)
+    VTK_DICOM_OVERRIDE
+  {
+    vtkInformation *outInfo = outputVector->GetInformationObject(0);
+    int extent[6] = {
+      0, ImageColumns - 1, 0, ImageRows - 1, 0, ImageSlices - 1 };
+    double spacing[3] = { 0.5, 0.5, 1.5 };
+    double origin[3] = { 0.0, 0.0, 0.0 };
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent, 6);
+    outInfo->Set(vtkDataObject::SPACING(), spacing, 3);
+    outInfo->Set(vtkDataObject::ORIGIN(), origin, 3);
+    vtkDataObject::SetPointDataActiveScalarInfo(
+      outInfo, VTK_SHORT, this->NumberOfComponents);
+    return 1;
+  }
+
+  void ExecuteDataWithInformation(vtkDataObject *out, vtkInformation *outInfo)
+    VTK_DICOM_OVERRIDE
+  {
+    vtkImageData *data = this->AllocateOutputData(out, outInfo);
+    int extent[6];
+    data->GetExtent(extent);
+    this->Requests.push_back(extent[4]);
+    this->Requests.push_back(extent[5]);
+
+    short *ptr = static_cast<short *>(
+      data->GetScalarPointer(extent[0], extent[2], extent[4]));
+    for (int k = extent[4]; k <= extent[5]; k++)
+    {
+      for (int j = extent[2]; j <= extent[3]; j++)
+      {
+        for (int i = extent[0]; i <= extent[1]; i++)
+        {
+          for (int c = 0; c < this->NumberOfComponents; c++)
+          {
+            *ptr++ = GetVoxel(i, j, k, c);
+          }
+        }
+      }
+    }
+  }
+
+  int NumberOfComponents;
+  std::vector<int> Requests;
+};
+
+vtkStandardNewMacro(TestNIFTIStreamingSource);
+
+// write the image in chunks, and check the file with the reader
+static int TestStreaming(
+  const char *exename, const std::string& fname, int numComponents,
+  bool reverse)
+{
+  int rval = 0;
+
+  TestNIFTIStreamingSource *source = TestNIFTIStreamingSource::New();
+  source->SetNumberOfComponents(numComponents);
+
+  vtkNIFTIWriter *writer = vtkNIFTIWriter::New();
+  writer->SetInputConnection(source->GetOutputPort());
+  writer->SetFileName(fname.c_str());
+  writer->StreamingOn();
+  writer->SetSlicesPerChunk(ChunkSlices);
+  vtkMatrix4x4 *matrix = vtkMatrix4x4::New();
+  if (reverse)
+  {
+    // the slices are stored in reverse order, so the last chunk is first
+    writer->SetQFac(-1.0);
+    writer->SetQFormMatrix(matrix);
+  }
+  writer->Write();
+  TestAssert(writer->GetErrorCode() == 0);
+  writer->Delete();
+  matrix->Delete();
+
+  // check that the source was asked for one chunk at a time
+  const std::vector<int>& requests = source->GetRequestedSlices();
+  int numChunks = (ImageSlices + ChunkSlices - 1)/ChunkSlices;
+  TestAssert(static_cast<int>(requests.size()) == 2*numChunks);
+  int numSlices = 0;
+  for (size_t i = 0; i + 1 < requests.size(); i += 2)
+  {
+    TestAssert(requests[i + 1] - requests[i] < ChunkSlices);
+    numSlices += requests[i + 1] - requests[i] + 1;
+  }
+  TestAssert(numSlices == ImageSlices);
+  if (!requests.empty())
+  {
+    TestAssert(reverse ? requests[1] == ImageSlices - 1 : requests[0] == 0);
+  }
+  source->Delete();
+
+  // read the file and check every voxel
+  vtkNIFTIReader *reader = vtkNIFTIReader::New();
+  reader->SetFileName(fname.c_str());
+  reader->Update();
+  TestAssert(reader->GetErrorCode() == 0);
+  TestAssert((reader->GetQFac() < 0) == reverse);
+  vtkImageData *image = reader->GetOutput();
+  int dims[3];
+  image->GetDimensions(dims);
+  bool sameFormat = (dims[0] == ImageColumns && dims[1] == ImageRows &&
+                     dims[2] == ImageSlices &&
+                     image->GetScalarType() == VTK_SHORT &&
+                     image->GetNumberOfScalarComponents() == numComponents);
+  TestAssert(sameFormat);
+  if (sameFormat)
+  {
+    const short *ptr = static_cast<const short *>(image->GetScalarPointer());
+    int badVoxels = 0;
+    for (int k = 0; k < ImageSlices; k++)
+    {
+      for (int j = 0; j < ImageRows; j++)
+      {
+        for (int i = 0; i < ImageColumns; i++)
+        {
+          for (int c = 0; c < numComponents; c++)
+          {
+            badVoxels += (*ptr++ !=
+                          TestNIFTIStreamingSource::GetVoxel(i, j, k, c));
+          }
+        }
+      }
+    }
+    TestAssert(badVoxels == 0);
+  }
+  reader->Delete();
+
+  vtkDICOMFile::Remove(fname.c_str());
+
+  return rval;
+}
+
+int TestNIFTIWriter(int argc, char *argv[])
+{
+  int rval = 0;
+  const char *exename = (argc > 0 ? argv[0] : "TestNIFTIWriter");
+
+  // remove path portion of exename
+  const char *cp = exename + strlen(exename);
+  while (cp != exename && cp[-1] != '\\' && cp[-1] != '/') { --cp; }
+  exename = cp;
+
+  // create a directory for the test files
+  std::string dirname = "TestNIFTIWriter.tmp";
+  vtkDICOMFileDirectory::Create(dirname.c_str());
+  vtkDICOMFilePath path(dirname);
+
+  // uncompressed files are written with a seek for each chunk, while
+  // compressed files with several components use a temporary file
+  rval |= TestStreaming(exename, path.Join("scalar.nii"), 1, false);
+  rval |= TestStreaming(exename, path.Join("vector.nii"), 3, true);
+  rval |= TestStreaming(exename, path.Join("scalar.nii.gz"), 1, true);
+  rval |= TestStreaming(exename, path.Join("vector.nii.gz"), 3, false);
+
+  return rval;
+}
+
+#ifdef VTK_DICOM_SEPARATE_TESTS
+int main(int argc, char *argv[])
+{
+  return TestNIFTIWriter(argc, argv);
+}
+#endif